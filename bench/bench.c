@@ -0,0 +1,584 @@
+/**
+ * CMS Benchmark
+ * --------------------------------------
+ * Times the database engine on a generated StudentRecords file and prints
+ * one JSON object per operation, so runs of two versions can be diffed or
+ * loaded into a spreadsheet:
+ *   {"op":"query","rows":100000,"count":10000,"seconds":0.0031,
+ *    "ops_per_sec":3225806,"p50_us":0.25,"p99_us":0.61,"peak_rss_kb":21500}
+ *
+ * The engine is linked in directly (every source file but main.c), so
+ * the numbers are those of the functions behind each command, without
+ * command parsing. Engine messages are sent to the null device; results go
+ * to the original stdout or to --out.
+ *
+ * Build (from the repository root):
+ *   gcc -O2 -pthread -o cms_bench bench/bench.c $(find src -maxdepth 1 -name "*.c" ! -name main.c) -lm
+ *
+ * Authors: Team P4-1
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/headers/cms.h"
+#include "../src/headers/file_io.h"
+#include "../src/headers/timer.h"
+
+#ifdef _WIN32
+#define PSAPI_VERSION 2
+#include <windows.h>
+#include <psapi.h>
+#include <direct.h>
+#include <io.h>
+#define NULL_DEVICE "NUL"
+#define makeDir(path) _mkdir(path)
+#define changeDir(path) _chdir(path)
+#define dupDescriptor _dup
+#define openDescriptor _fdopen
+#define streamDescriptor _fileno
+#else
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define NULL_DEVICE "/dev/null"
+#define makeDir(path) mkdir((path), 0755)
+#define changeDir(path) chdir(path)
+#define dupDescriptor dup
+#define openDescriptor fdopen
+#define streamDescriptor fileno
+#endif
+
+// =========================
+// Benchmark Configuration
+// =========================
+#define BENCH_DEFAULT_ROWS 100000
+#define BENCH_DEFAULT_OPS 10000         // Calls timed for each per-record operation
+#define BENCH_DEFAULT_REPEAT 5          // Runs of each whole-table operation
+#define BENCH_MAX_ROWS 10000000
+#define BENCH_FIRST_ID 2000000          // Rows past 1,000,000 get IDs beyond the 7-digit range
+#define BENCH_LONG_NAME_PCT 2           // Share of names padded to just under MAX_NAME
+
+
+// Options given on the command line
+typedef struct BenchOptions {
+    long rows;
+    long ops;
+    int repeat;
+    unsigned long long seed;
+    const char *dir;            // Working directory holding data/
+    const char *out;            // Results file, or NULL for stdout
+    const char *generate;       // Only write a dataset to this file
+} BenchOptions;
+
+// Latencies of one operation, in seconds
+typedef struct Samples {
+    double *values;
+    long count;
+    double total;
+} Samples;
+
+static FILE *results;           // Where the JSON lines go
+static unsigned long long rngState;
+
+
+// ---------------------------------------------------------------------
+// Dataset generation
+// ---------------------------------------------------------------------
+
+static const char *firstNames[] = {
+    "Wei Ming", "Aisha", "Rajesh", "Siti", "Daniel", "Mei Ling", "Arjun", "Nurul",
+    "Jonathan", "Hui Min", "Farhan", "Priya", "Marcus", "Xin Yi", "Kumar", "Amanda",
+    "Benjamin", "Zhi Hao", "Fatimah", "Ethan", "Shu Fen", "Vikram", "Chloe", "Hafiz",
+    "Isabelle", "Jun Jie", "Lakshmi", "Ryan", "Wen Qi", "Sebastian"
+};
+
+static const char *lastNames[] = {
+    "Tan", "Lim", "Lee", "Ng", "Wong", "Chua", "Goh", "Teo", "Ong", "Koh",
+    "Abdullah", "Ibrahim", "Rahman", "Kumar", "Pillai", "Nair", "Singh", "Krishnan",
+    "Fernandez", "Rodrigues", "Chen", "Levoy", "Hashim", "Suppiah", "Yeo",
+    "Sim", "Low", "Chan", "Ismail", "Menon"
+};
+
+// Listed from most to least popular; picked with Zipf weights 1/(rank+1)
+static const char *programmes[] = {
+    "Computer Science", "Software Engineering", "Information Security", "Data Science",
+    "Digital Supply Chain", "Electrical Engineering", "Mechanical Engineering", "Business Analytics",
+    "Accountancy", "Applied Artificial Intelligence", "Interactive Media", "Nursing",
+    "Physiotherapy", "Chemical Engineering", "Civil Engineering", "Hospitality Business",
+    "Food Technology", "Marine Engineering", "Aerospace Systems", "Pharmaceutical Science",
+    "Game Design", "Telematics", "Sustainable Infrastructure", "Robotics Systems"
+};
+
+#define COUNT_OF(array) ((int)(sizeof(array) / sizeof((array)[0])))
+
+static double programmeWeights[COUNT_OF(programmes)];   // Cumulative, last = 1
+
+
+// xorshift64*: fast and the same on every platform, so a seed always
+// produces the same dataset
+static unsigned long long nextRandom() {
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return rngState * 2685821657736338717ULL;
+}
+
+
+// Uniform in [0, 1)
+static double randomUnit() {
+    return (double)(nextRandom() >> 11) / 9007199254740992.0;
+}
+
+
+static long randomBelow(long limit) {
+    return (long)(nextRandom() % (unsigned long long)limit);
+}
+
+
+static void buildProgrammeWeights() {
+    double total = 0.0;
+    for (int p = 0; p < COUNT_OF(programmes); p++) total += 1.0 / (p + 1);
+    double running = 0.0;
+    for (int p = 0; p < COUNT_OF(programmes); p++) {
+        running += 1.0 / (p + 1) / total;
+        programmeWeights[p] = running;
+    }
+    programmeWeights[COUNT_OF(programmes) - 1] = 1.0;
+}
+
+
+static const char *randomProgramme() {
+    double pick = randomUnit();
+    int p = 0;
+    while (programmeWeights[p] < pick) p++;
+    return programmes[p];
+}
+
+
+/**
+ * randomName()
+ * -----------------------------------------
+ * Writes a Title Case name into out (MAX_NAME bytes). A few names get
+ * extra given names until they are just under the MAX_NAME limit.
+ *
+ * @return length of the name
+ */
+static size_t randomName(char *out) {
+    int length = snprintf(out, MAX_NAME, "%s %s",
+                          firstNames[randomBelow(COUNT_OF(firstNames))],
+                          lastNames[randomBelow(COUNT_OF(lastNames))]);
+    if (randomBelow(100) >= BENCH_LONG_NAME_PCT) return (size_t)length;
+
+    int target = MAX_NAME - 1 - (int)randomBelow(10);
+    while (length < target) {
+        const char *extra = firstNames[randomBelow(COUNT_OF(firstNames))];
+        int room = target - length - 1;
+        int take = (int)strlen(extra) < room ? (int)strlen(extra) : room;
+        if (take <= 0) break;
+        out[length++] = ' ';
+        memcpy(out + length, extra, (size_t)take);
+        length += take;
+    }
+    out[length] = '\0';
+    return (size_t)length;
+}
+
+
+// Mark around 65 with a spread of about 14 (sum of four uniforms), one decimal
+static float randomMark() {
+    double mark = 65.0 + (randomUnit() + randomUnit() + randomUnit() + randomUnit() - 2.0) * 24.0;
+    if (mark < 0.0) mark = 0.0;
+    if (mark > 100.0) mark = 100.0;
+    return (float)((long)(mark * 10.0 + 0.5) / 10.0);
+}
+
+
+// Returns a step coprime to rows, so i * step % rows visits every row once
+static long permutationStep(long rows) {
+    long step = rows / 2 + 7919;
+    while (1) {
+        long a = step, b = rows;
+        while (b) {
+            long t = a % b;
+            a = b;
+            b = t;
+        }
+        if (a == 1) return step;
+        step++;
+    }
+}
+
+
+/**
+ * generateDataset()
+ * -----------------------------------------
+ * Writes a database file in the format saveDB() produces. IDs are
+ * BENCH_FIRST_ID .. BENCH_FIRST_ID + rows - 1 in shuffled order.
+ *
+ * @return 1 on success, 0 if the file could not be written
+ */
+static int generateDataset(const char *path, long rows) {
+    FILE *file = fopen(path, "w");
+    if (!file) return 0;
+    setvbuf(file, NULL, _IOFBF, IO_BUFFER_SIZE);
+
+    fprintf(file, "Database Name: P4_1-CMS\nAuthors: P4-1\n\nTable Name: StudentRecords\nID\tName\tProgramme\tMark\n");
+
+    long step = permutationStep(rows);
+    char name[MAX_NAME];
+    for (long i = 0; i < rows; i++) {
+        long id = BENCH_FIRST_ID + (long)((unsigned long long)i * (unsigned long long)step % (unsigned long long)rows);
+        randomName(name);
+        fprintf(file, "%ld\t%s\t%s\t%.1f\n", id, name, randomProgramme(), randomMark());
+    }
+
+    int ok = !ferror(file);
+    if (fclose(file) != 0) ok = 0;
+    return ok;
+}
+
+
+// ---------------------------------------------------------------------
+// Measurement
+// ---------------------------------------------------------------------
+
+// Peak resident set size of the process in KB, or -1 if unknown
+static long peakRssKb() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return -1;
+    return (long)(counters.PeakWorkingSetSize / 1024);
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return -1;
+#ifdef __APPLE__
+    return (long)(usage.ru_maxrss / 1024);     // Bytes on macOS
+#else
+    return (long)usage.ru_maxrss;
+#endif
+#endif
+}
+
+
+static int samplesInit(Samples *samples, long capacity) {
+    samples->values = malloc((size_t)(capacity > 0 ? capacity : 1) * sizeof(double));
+    samples->count = 0;
+    samples->total = 0.0;
+    return samples->values != NULL;
+}
+
+
+static void samplesAdd(Samples *samples, double seconds) {
+    samples->values[samples->count++] = seconds;
+    samples->total += seconds;
+}
+
+
+static int compareDoubles(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+
+// Nearest-rank percentile of sorted samples
+static double percentile(const Samples *samples, int pct) {
+    long rank = (long)((pct * samples->count + 99) / 100);
+    if (rank < 1) rank = 1;
+    return samples->values[rank - 1];
+}
+
+
+/**
+ * report()
+ * -----------------------------------------
+ * Prints the JSON line of one operation and resets its samples.
+ *
+ * @param op   - operation name
+ * @param rows - records in the table while it ran
+ */
+static void report(const char *op, long rows, Samples *samples) {
+    if (samples->count == 0) return;
+    fflush(stdout);     // The engine's queued messages are written outside any timing
+    qsort(samples->values, (size_t)samples->count, sizeof(double), compareDoubles);
+    fprintf(results,
+            "{\"op\":\"%s\",\"rows\":%ld,\"count\":%ld,\"seconds\":%.6f,\"ops_per_sec\":%.1f,"
+            "\"p50_us\":%.3f,\"p99_us\":%.3f,\"peak_rss_kb\":%ld}\n",
+            op, rows, samples->count, samples->total,
+            samples->total > 0 ? samples->count / samples->total : 0.0,
+            percentile(samples, 50) * 1e6, percentile(samples, 99) * 1e6, peakRssKb());
+    fflush(results);
+    samples->count = 0;
+    samples->total = 0.0;
+}
+
+
+// Closes the table so the next openDB() reads the files again
+static void closeTable() {
+    freeDB();
+    dbLoaded = 0;
+    dbModified = 0;
+}
+
+
+// ---------------------------------------------------------------------
+// Benchmarks
+// ---------------------------------------------------------------------
+
+/**
+ * runBenchmarks()
+ * -----------------------------------------
+ * Loads the generated table and times each operation in turn. Records
+ * added by the insert run are the ones deleted later, so the table is
+ * back to its generated size for the whole-table operations.
+ *
+ * @return 0 on success, 1 if the table could not be loaded
+ */
+static int runBenchmarks(const BenchOptions *options) {
+    long rows = options->rows, ops = options->ops;
+    int repeat = options->repeat;
+    Samples samples;
+    if (!samplesInit(&samples, ops > repeat ? ops : repeat)) {
+        fprintf(stderr, "cms_bench: out of memory\n");
+        return 1;
+    }
+
+    double t;
+    for (int r = 0; r < repeat; r++) {
+        closeTable();
+        remove(DB_SNAPSHOT_PATH);
+        remove(DB_JOURNAL_PATH);
+        t = timerNow();
+        openDB();
+        samplesAdd(&samples, timerNow() - t);
+    }
+    report("load_text", rows, &samples);
+    if (!dbLoaded) {
+        fprintf(stderr, "cms_bench: the generated table could not be loaded\n");
+        free(samples.values);
+        return 1;
+    }
+
+    // Per-record operations on IDs just past the generated ones
+    char name[MAX_NAME];
+    long firstNew = BENCH_FIRST_ID + rows;
+    for (long i = 0; i < ops; i++) {
+        randomName(name);
+        const char *programme = randomProgramme();
+        float mark = randomMark();
+        t = timerNow();
+        insertDB((int)(firstNew + i), name, programme, mark, 0);
+        samplesAdd(&samples, timerNow() - t);
+    }
+    report("insert", rows, &samples);
+
+    for (long i = 0; i < ops; i++) {
+        int id = (int)(BENCH_FIRST_ID + randomBelow(rows));
+        t = timerNow();
+        queryDB(id);
+        samplesAdd(&samples, timerNow() - t);
+    }
+    report("query", rows + ops, &samples);
+
+    for (long i = 0; i < ops; i++) {
+        int id = (int)(BENCH_FIRST_ID + randomBelow(rows));
+        int rename = (i % 4 == 0);
+        if (rename) randomName(name);
+        float mark = randomMark();
+        t = timerNow();
+        updateDB(id, rename ? name : "", "", mark, 0);
+        samplesAdd(&samples, timerNow() - t);
+    }
+    report("update", rows + ops, &samples);
+
+    for (long i = 0; i < ops; i++) {
+        t = timerNow();
+        deleteDB((int)(firstNew + i), 1, 0);
+        samplesAdd(&samples, timerNow() - t);
+    }
+    report("delete", rows + ops, &samples);
+
+    long history = ops < UNDO_MAX_ACTIONS ? ops : UNDO_MAX_ACTIONS;
+    for (long i = 0; i < history; i++) {
+        t = timerNow();
+        undo();
+        samplesAdd(&samples, timerNow() - t);
+    }
+    report("undo", rows, &samples);
+
+    for (long i = 0; i < history; i++) {
+        t = timerNow();
+        redo();
+        samplesAdd(&samples, timerNow() - t);
+    }
+    report("redo", rows, &samples);
+
+    // Whole-table operations
+    SortKey byMark[1] = { { SORT_FIELD_MARK, 0 } };
+    ViewOptions view;
+    memset(&view, 0, sizeof(view));
+    for (int r = 0; r < repeat; r++) {
+        t = timerNow();
+        showView(byMark, 1, &view);
+        fflush(stdout);
+        samplesAdd(&samples, timerNow() - t);
+    }
+    report("show_sorted", rows, &samples);
+
+    for (int r = 0; r < repeat; r++) {
+        t = timerNow();
+        showSummary(NULL, 0);
+        fflush(stdout);
+        samplesAdd(&samples, timerNow() - t);
+    }
+    report("summary", rows, &samples);
+
+    for (int r = 0; r < repeat; r++) {
+        t = timerNow();
+        showSummary(NULL, 1);
+        fflush(stdout);
+        samplesAdd(&samples, timerNow() - t);
+    }
+    report("summary_percentiles", rows, &samples);
+
+    // SAVE after a single change (journal commit), then COMPACT (full rewrite)
+    Samples compact;
+    if (!samplesInit(&compact, repeat)) {
+        fprintf(stderr, "cms_bench: out of memory\n");
+        free(samples.values);
+        return 1;
+    }
+    for (int r = 0; r < repeat; r++) {
+        updateDB((int)(BENCH_FIRST_ID + randomBelow(rows)), "", "", randomMark(), 0);
+        t = timerNow();
+        saveDB();
+        samplesAdd(&samples, timerNow() - t);
+        t = timerNow();
+        compactDB();
+        samplesAdd(&compact, timerNow() - t);
+    }
+    report("save", rows, &samples);
+    report("compact", rows, &compact);
+    free(compact.values);
+
+    // COMPACT left a fresh snapshot next to the text file
+    for (int r = 0; r < repeat; r++) {
+        closeTable();
+        t = timerNow();
+        openDB();
+        samplesAdd(&samples, timerNow() - t);
+    }
+    report("load_snapshot", rows, &samples);
+
+    closeTable();
+    free(samples.values);
+    return 0;
+}
+
+
+// ---------------------------------------------------------------------
+// Entry point
+// ---------------------------------------------------------------------
+
+static void printUsage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [--rows N] [--ops N] [--repeat N] [--seed N] [--dir DIR] [--out FILE]\n"
+            "       %s --generate FILE [--rows N] [--seed N]\n"
+            "  --rows N        Records in the generated table (1000 .. %d, default %d)\n"
+            "  --ops N         Calls timed per insert/query/update/delete/undo/redo run (default %d)\n"
+            "  --repeat N      Runs of each load/show/summary/save operation (default %d)\n"
+            "  --seed N        Dataset seed; the same seed gives the same file (default 1)\n"
+            "  --dir DIR       Working directory; DIR/data is overwritten (default bench_run)\n"
+            "  --out FILE      Write the JSON lines to FILE instead of stdout\n"
+            "  --generate FILE Only write a generated database file and exit\n",
+            program, program, BENCH_MAX_ROWS, BENCH_DEFAULT_ROWS, BENCH_DEFAULT_OPS, BENCH_DEFAULT_REPEAT);
+}
+
+
+// Reads the value of a numeric option; 0 if it is missing or out of range
+static int readCount(int argc, char *argv[], int *i, long low, long high, long *value) {
+    if (*i + 1 >= argc) return 0;
+    char *end;
+    long parsed = strtol(argv[++*i], &end, 10);
+    if (*end != '\0' || parsed < low || parsed > high) return 0;
+    *value = parsed;
+    return 1;
+}
+
+
+int main(int argc, char *argv[]) {
+    BenchOptions options = { BENCH_DEFAULT_ROWS, BENCH_DEFAULT_OPS, BENCH_DEFAULT_REPEAT, 1, "bench_run", NULL, NULL };
+
+    for (int i = 1; i < argc; i++) {
+        long value = 0;
+        int ok = 1;
+        if (strcmp(argv[i], "--rows") == 0) {
+            ok = readCount(argc, argv, &i, 1000, BENCH_MAX_ROWS, &value);
+            options.rows = value;
+        }
+        else if (strcmp(argv[i], "--ops") == 0) {
+            ok = readCount(argc, argv, &i, 1, BENCH_MAX_ROWS, &value);
+            options.ops = value;
+        }
+        else if (strcmp(argv[i], "--repeat") == 0) {
+            ok = readCount(argc, argv, &i, 1, 1000, &value);
+            options.repeat = (int)value;
+        }
+        else if (strcmp(argv[i], "--seed") == 0) {
+            ok = readCount(argc, argv, &i, 0, 2147483647L, &value);
+            options.seed = (unsigned long long)value;
+        }
+        else if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc) options.dir = argv[++i];
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) options.out = argv[++i];
+        else if (strcmp(argv[i], "--generate") == 0 && i + 1 < argc) options.generate = argv[++i];
+        else ok = 0;
+
+        if (!ok) {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    rngState = options.seed * 0x9E3779B97F4A7C15ULL + 0x2545F4914F6CDD1DULL;
+    buildProgrammeWeights();
+
+    if (options.generate) {
+        if (!generateDataset(options.generate, options.rows)) {
+            fprintf(stderr, "cms_bench: cannot write \"%s\"\n", options.generate);
+            return 1;
+        }
+        return 0;
+    }
+
+    // Results keep the real stdout; the engine's messages go nowhere
+    results = options.out ? fopen(options.out, "w")
+                          : openDescriptor(dupDescriptor(streamDescriptor(stdout)), "w");
+    if (!results) {
+        fprintf(stderr, "cms_bench: cannot open the results output\n");
+        return 1;
+    }
+    if (!freopen(NULL_DEVICE, "w", stdout)) {
+        fprintf(stderr, "cms_bench: cannot redirect the engine output\n");
+        return 1;
+    }
+    setvbuf(stdout, NULL, _IOFBF, IO_BUFFER_SIZE);
+
+    makeDir(options.dir);
+    if (changeDir(options.dir) != 0) {
+        fprintf(stderr, "cms_bench: cannot use directory \"%s\"\n", options.dir);
+        return 1;
+    }
+    makeDir("data");
+
+    double started = timerNow();
+    if (!generateDataset(DB_FILE_PATH, options.rows)) {
+        fprintf(stderr, "cms_bench: cannot write \"%s/%s\"\n", options.dir, DB_FILE_PATH);
+        return 1;
+    }
+    fprintf(results, "{\"op\":\"generate\",\"rows\":%ld,\"bytes\":%lld,\"seconds\":%.6f}\n",
+            options.rows, fileSize(DB_FILE_PATH), timerNow() - started);
+
+    int status = runBenchmarks(&options);
+    fclose(results);
+    return status;
+}
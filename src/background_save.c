@@ -0,0 +1,153 @@
+/**
+ * Background Save
+ * --------------------------------------
+ * Writes the base file and binary snapshot on a worker thread, so that
+ * SAVE ASYNC and autosave return to the prompt straight away.
+ *
+ * The caller hands over a snapshotCapture() image of the table, taken
+ * between two commands. The thread reads nothing but that image, so the
+ * table can go on changing while the files are written; both are synced
+ * and renamed into place exactly as a foreground SAVE does. Whoever
+ * polls next collects the result and retires the journal.
+ *
+ * Authors: Team P4-1
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "headers/cms.h"
+#include "headers/background_save.h"
+#include "headers/file_io.h"
+#include "headers/table_render.h"
+#include "headers/thread.h"
+#include "headers/timer.h"
+
+// The save in progress; `done` is the only field both threads touch
+typedef struct BackgroundSave {
+    ThreadMutex lock;
+    int lockReady;
+    Thread thread;
+    int threaded;               // Running on `thread` (joined when collected)
+    int running;                // Started and not yet collected
+    int done;                   // Set by the save thread, under lock
+    double started;
+    SnapshotImage image;
+    BackgroundSaveResult result;
+} BackgroundSave;
+
+static BackgroundSave save = {0};
+
+
+/**
+ * writeText()
+ * -----------------------------------------
+ * Writes the image as the tab-separated base file: formatted into a
+ * buffer a chunk at a time, synced, then swapped in with the old file
+ * kept as the backup.
+ *
+ * @return 1 on success, 0 with result->error set on failure
+ */
+static int writeText(const SnapshotImage *image, BackgroundSaveResult *result) {
+    size_t n = image->header.recordCount, pc = image->header.programmeCount;
+    const char **programmes = malloc((pc ? pc : 1) * sizeof(char*));
+    char *buffer = malloc(SAVE_WRITE_CHUNK + RENDER_LINE_MAX);
+    FILE *file = programmes && buffer ? fopen(DB_TEMP_PATH, "w") : NULL;
+    if (!file) {
+        snprintf(result->error, sizeof(result->error), "%s",
+                 programmes && buffer ? "the staging file could not be created" : "out of memory");
+        free(programmes);
+        free(buffer);
+        return 0;
+    }
+
+    const char *programme = image->programmeHeap;
+    for (size_t code = 0; code < pc; code++) {
+        programmes[code] = programme;
+        programme += image->programmeLengths[code] + 1;
+    }
+
+    int written = fputs(DB_TEXT_HEADER, file) >= 0;
+    const char *name = image->nameHeap;
+    char *end = buffer;
+    for (size_t i = 0; i < n && written; i++) {
+        uint16_t code = image->programmes[i];
+        end = renderTsvLine(end, image->ids[i], name, image->nameLengths[i],
+                            programmes[code], image->programmeLengths[code], image->marks[i]);
+        name += image->nameLengths[i] + 1;
+        if ((size_t)(end - buffer) >= SAVE_WRITE_CHUNK || i + 1 == n) {
+            written = fwrite(buffer, 1, (size_t)(end - buffer), file) == (size_t)(end - buffer);
+            end = buffer;
+        }
+    }
+    free(programmes);
+    free(buffer);
+
+    if (!fileSync(file)) written = 0;
+    if (fclose(file) != 0) written = 0;
+    if (!written || !fileReplace(DB_TEMP_PATH, DB_FILE_PATH, DB_BACKUP_PATH)) {
+        remove(DB_TEMP_PATH);
+        snprintf(result->error, sizeof(result->error), "the database file could not be written");
+        return 0;
+    }
+    remove(DB_OFFSET_INDEX_PATH);       // Rebuilt by the next OPEN LAZY
+    return 1;
+}
+
+
+// Thread body: the text file, then the snapshot, then the result
+static void saveThread(void *arg) {
+    BackgroundSave *job = arg;
+    BackgroundSaveResult result;
+    memset(&result, 0, sizeof(result));
+    result.records = (long)job->image.header.recordCount;
+
+    result.ok = writeText(&job->image, &result);
+    if (result.ok && !snapshotWriteImage(&job->image, DB_SNAPSHOT_PATH, DB_SNAPSHOT_TEMP_PATH)) {
+        // The text file is authoritative; a stale snapshot must not outlive it
+        remove(DB_SNAPSHOT_PATH);
+        result.snapshotFailed = 1;
+    }
+    result.seconds = timerNow() - job->started;
+    snapshotRelease(&job->image);
+
+    mutexLock(&job->lock);
+    job->result = result;
+    job->done = 1;
+    mutexUnlock(&job->lock);
+}
+
+
+int backgroundSaveStart(SnapshotImage *image) {
+    if (save.running) return 0;
+    if (!save.lockReady) {
+        mutexInit(&save.lock);
+        save.lockReady = 1;
+    }
+
+    save.image = *image;
+    memset(image, 0, sizeof(*image));
+    save.started = timerNow();
+    save.done = 0;
+    save.running = 1;
+    save.threaded = threadStart(&save.thread, saveThread, &save);
+    if (!save.threaded) saveThread(&save);
+    return 1;
+}
+
+
+BackgroundSaveState backgroundSavePoll(int wait, BackgroundSaveResult *result) {
+    if (!save.running) return SAVE_IDLE;
+    if (!wait) {
+        mutexLock(&save.lock);
+        int done = save.done;
+        mutexUnlock(&save.lock);
+        if (!done) return SAVE_RUNNING;
+    }
+
+    if (save.threaded) threadJoin(&save.thread);
+    save.running = 0;
+    save.threaded = 0;
+    *result = save.result;
+    return SAVE_FINISHED;
+}
@@ -0,0 +1,230 @@
+/**
+ * Client Mode
+ * --------------------------------------
+ * `cms --connect [HOST:]PORT` sends commands read from stdin to a CMS
+ * server and prints the replies.
+ *
+ * - At a terminal it behaves like the local prompt: one command, then its
+ *   reply.
+ * - With a script on stdin it keeps up to CLIENT_PIPELINE_DEPTH commands
+ *   in flight, so a long script costs one round trip per window rather
+ *   than one per command. Blank lines and comments are not sent, and each
+ *   reply is echoed after its command the way --batch does.
+ *
+ * Authors: Team P4-1
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "headers/server.h"
+#include "headers/net.h"
+#include "headers/line_reader.h"
+#include "headers/file_io.h"
+#include "headers/timer.h"
+
+#ifdef _WIN32
+#include <io.h>
+#define isatty _isatty
+#define fileno _fileno
+#else
+#include <unistd.h>
+#endif
+
+// Buffered reads of the server's reply frames
+typedef struct ReplyReader {
+    NetSocket socket;
+    char buffer[SERVER_READ_CHUNK];
+    size_t start;
+    size_t end;
+} ReplyReader;
+
+// Outcome of reading one reply
+typedef enum {
+    REPLY_READ_OK,
+    REPLY_READ_FAILED,          // The command failed on the server
+    REPLY_READ_BYE,             // The server closed the session after QUIT
+    REPLY_READ_LOST             // The connection broke or the frame was malformed
+} ReplyResult;
+
+
+// Waits for more reply bytes; returns 0 if the connection ended
+static int fillReplies(ReplyReader *reader) {
+    if (reader->start < reader->end) return 1;
+    reader->start = reader->end = 0;
+    long received;
+    do {
+        received = netRecv(reader->socket, reader->buffer, sizeof(reader->buffer));
+    } while (received == NET_AGAIN);    // Only after an interrupted call on a blocking socket
+    if (received <= 0) return 0;
+    reader->end = (size_t)received;
+    return 1;
+}
+
+
+/**
+ * readReply()
+ * -----------------------------------------
+ * Reads one "<STATUS> <length>\n" frame and copies its output to stdout.
+ */
+static ReplyResult readReply(ReplyReader *reader) {
+    char header[32];
+    size_t used = 0;
+    while (1) {
+        if (!fillReplies(reader)) return REPLY_READ_LOST;
+        char c = reader->buffer[reader->start++];
+        if (c == '\n') break;
+        if (used == sizeof(header) - 1) return REPLY_READ_LOST;
+        header[used++] = c;
+    }
+    header[used] = '\0';
+
+    char status[16];
+    unsigned long length;
+    if (sscanf(header, "%15s %lu", status, &length) != 2) return REPLY_READ_LOST;
+
+    while (length > 0) {
+        if (!fillReplies(reader)) return REPLY_READ_LOST;
+        size_t chunk = reader->end - reader->start;
+        if (chunk > length) chunk = length;
+        fwrite(reader->buffer + reader->start, 1, chunk, stdout);
+        reader->start += chunk;
+        length -= chunk;
+    }
+
+    if (strcmp(status, REPLY_BYE) == 0) return REPLY_READ_BYE;
+    if (strcmp(status, REPLY_FAILED) == 0) return REPLY_READ_FAILED;
+    return strcmp(status, REPLY_OK) == 0 ? REPLY_READ_OK : REPLY_READ_LOST;
+}
+
+
+// Sends all of data on a blocking socket; returns 0 if the connection failed
+static int sendAll(NetSocket socket, const char *data, size_t length) {
+    while (length > 0) {
+        long sent = netSend(socket, data, length);
+        if (sent == NET_ERROR) return 0;
+        if (sent == NET_AGAIN) continue;
+        data += sent;
+        length -= (size_t)sent;
+    }
+    return 1;
+}
+
+
+/**
+ * runClient()
+ * -----------------------------------------
+ * Sends stdin to the server and prints the replies until input ends or
+ * the server says BYE.
+ *
+ * @param host - server address
+ * @param port - server TCP port
+ * @return 0 if every command succeeded, 1 if one failed, 2 if the
+ *         connection could not be made or broke
+ */
+int runClient(const char *host, int port) {
+    if (!netStartup()) {
+        printf("CMS: The network could not be started.\n");
+        return 2;
+    }
+    ReplyReader replies;
+    replies.socket = netConnect(host, port);
+    replies.start = replies.end = 0;
+    if (replies.socket == NET_INVALID) {
+        printf("CMS: Cannot connect to a CMS server on %s:%d.\n", host, port);
+        netCleanup();
+        return 2;
+    }
+
+    int interactive = isatty(fileno(stdin));
+    int window = interactive ? 1 : CLIENT_PIPELINE_DEPTH;
+    if (interactive) printf("CMS: Connected to %s:%d. Type QUIT to disconnect.\n", host, port);
+    else setvbuf(stdout, NULL, _IOFBF, IO_BUFFER_SIZE);
+
+    // Copies of the commands in flight, echoed in front of their replies
+    char *inFlight[CLIENT_PIPELINE_DEPTH];
+    int first = 0, outstanding = 0;
+    size_t outstandingBytes = 0;
+    long commands = 0, failed = 0;
+    ReplyResult result = REPLY_READ_OK;
+    LineReader *reader = lineReaderStdin();
+    double started = timerNow();
+    char *line;
+
+    while (1) {
+        if (interactive) {
+            printf("\n\nP4_1: ");
+            fflush(stdout);
+        }
+        line = lineReaderNext(reader, NULL);
+
+        if (line) {
+            const char *text = line;
+            while (isspace((unsigned char)*text)) text++;
+            if (!interactive && (*text == '\0' || *text == '#')) continue;
+
+            size_t length = strlen(text);
+            char *copy = malloc(length + 2);
+            if (!copy) {
+                printf("CMS: Memory allocation failed.\n");
+                break;
+            }
+            memcpy(copy, text, length);
+            copy[length] = '\n';
+            copy[length + 1] = '\0';
+            if (!sendAll(replies.socket, copy, length + 1)) {
+                free(copy);
+                result = REPLY_READ_LOST;
+                break;
+            }
+            copy[length] = '\0';
+            inFlight[(first + outstanding) % CLIENT_PIPELINE_DEPTH] = copy;
+            outstanding++;
+            outstandingBytes += length + 1;
+            commands++;
+
+            // Keep the window open until it is full of work
+            if (outstanding < window && outstandingBytes < SERVER_LINE_MAX) continue;
+        }
+        if (outstanding == 0) break;
+
+        // Collect one reply, or all of them once the input has ended
+        do {
+            char *command = inFlight[first];
+            if (!interactive) printf("\nP4_1: %s\n", command);
+            result = readReply(&replies);
+            outstandingBytes -= strlen(command) + 1;
+            free(command);
+            first = (first + 1) % CLIENT_PIPELINE_DEPTH;
+            outstanding--;
+            if (result == REPLY_READ_FAILED) failed++;
+            if (interactive) fflush(stdout);
+        } while (!line && outstanding > 0 && result != REPLY_READ_BYE && result != REPLY_READ_LOST);
+
+        if (result == REPLY_READ_BYE || result == REPLY_READ_LOST || !line) break;
+    }
+
+    double elapsed = timerNow() - started;
+    while (outstanding > 0) {       // Never answered: the server said BYE or went away
+        free(inFlight[first]);
+        first = (first + 1) % CLIENT_PIPELINE_DEPTH;
+        outstanding--;
+    }
+    if (reader->failed) printf("CMS: Fatal error reading input.\n");
+    if (result == REPLY_READ_LOST) printf("\nCMS: The connection to %s:%d was lost.\n", host, port);
+    if (!interactive) {
+        printf("\nCMS: Sent %ld command%s to %s:%d in %.3f seconds (%.0f commands/s), %ld failed.\n",
+               commands, commands == 1 ? "" : "s", host, port, elapsed,
+               elapsed > 0 ? commands / elapsed : 0.0, failed);
+    }
+    else {
+        printf("CMS: Disconnected from %s:%d.\n", host, port);
+    }
+
+    netClose(replies.socket);
+    netCleanup();
+    lineReaderFree(reader);
+    if (result == REPLY_READ_LOST) return 2;
+    return failed ? 1 : 0;
+}
@@ -3,7 +3,8 @@
  * --------------------------------------
  * This program maintains a student record database using:
  * - A linked list for sequential storage
- * - A hash table for fast ID-based lookup
+ * - An open-addressing hash index for fast ID-based lookup
+ * - AVL ordered indexes on ID and mark for sorted output
  * - Undo/redo stack to support reversible operations
  *
  * Features include inserting, updating, deleting, searching, sorting,
@@ -16,7 +17,23 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h> 
+#include <ctype.h>
+#include <math.h>
 #include "headers/cms.h"
+#include "headers/file_io.h"
+#include "headers/timer.h"
+#include "headers/pool.h"
+#include "headers/snapshot.h"
+#include "headers/journal.h"
+#include "headers/import.h"
+#include "headers/table_render.h"
+#include "headers/scan.h"
+#include "headers/column_kernels.h"
+#include "headers/stats.h"
+#include "headers/output.h"
+#include "headers/background_save.h"
+#include "headers/offset_index.h"
+#include "headers/shard.h"
 
 
 // ===============================
@@ -30,17 +47,174 @@ FILE *fptr = NULL;
 Node *head = NULL;
 Node *tail = NULL;
 
-// Hash table structure for constant-time search by student ID
-Node *hashTable[TABLE_SIZE] = {0};
+// ID index for constant-time search by student ID
+IdIndex idIndex = {0};
+
+// Ordered indexes behind SHOW ALL SORT BY. They are built on the first
+// sorted view and then maintained by every insert, update and delete.
+static int compareById(const Node *a, const Node *b);
+static int compareByMark(const Node *a, const Node *b);
+static int compareByGroup(const Node *a, const Node *b);
+static int compareByName(const Node *a, const Node *b);
+OrderIndex idOrder = ORDER_INDEX_INIT(ORDER_BY_ID, compareById);
+OrderIndex markOrder = ORDER_INDEX_INIT(ORDER_BY_MARK, compareByMark);
+OrderIndex groupOrder = ORDER_INDEX_INIT(ORDER_BY_GROUP, compareByGroup);
+static int ordersBuilt = 0;
+
+// Records by name for QUERY NAME=, built on the first name lookup
+OrderIndex nameOrder = ORDER_INDEX_INIT(ORDER_BY_NAME, compareByName);
+static int nameOrderBuilt = 0;
+static unsigned int nextSeq = 0;    // Insertion sequence handed to the next appended node
+
+// Running count and mark total of a set of records
+typedef struct SummaryStats {
+    size_t count;
+    double sum;                 // Exact for any realistic table: marks are floats
+} SummaryStats;
+
+// Aggregates behind SHOW SUMMARY, kept current by every list change:
+// the whole table, and each programme group (indexed by group code)
+static SummaryStats tableStats = {0};
+static SummaryStats groupStats[PROGRAMME_MAX_CODES];
+
+// Records per name / programme length, so a full-table view gets its
+// column widths without measuring every record first
+static size_t nameLengthCount[MAX_NAME];
+static size_t progLengthCount[MAX_PROGRAMME];
+
+// Dense copies of every listed record's ID and mark, for scans that touch
+// the whole table: a kernel streams 8 bytes per record instead of
+// visiting each node. Rows are in no particular order; a removed record's
+// row is refilled with the last row.
+typedef struct RecordColumns {
+    int *ids;
+    float *marks;
+    Node **nodes;               // Record of each row
+    size_t count;
+    size_t capacity;
+} RecordColumns;
+
+static RecordColumns columns = {0};
+
+// Bumped by every change to the records; a NEXT page is only valid for
+// the version its SHOW ALL was taken from
+static unsigned long dbVersion = 0;
+
+// Slab pools backing record nodes and undo/redo actions
+Pool nodePool = POOL_INIT(Node, NODE_SLAB_SIZE);
+Pool actionPool = POOL_INIT(Action, ACTION_SLAB_SIZE);
+
+// Packed name strings referenced by Node::nameOffset
+StringPool namePool = {0};
+
+// Everything that makes up a loaded table. RESTORE parks the table it
+// replaces in its undo entry instead of rereading it later, so undo and
+// redo of a RESTORE just swap the two tables.
+typedef struct TableState {
+    Node *head;
+    Node *tail;
+    IdIndex idIndex;
+    OrderIndex idOrder;
+    OrderIndex markOrder;
+    OrderIndex groupOrder;
+    int ordersBuilt;
+    OrderIndex nameOrder;
+    int nameOrderBuilt;
+    unsigned int nextSeq;
+    Pool nodePool;
+    StringPool namePool;
+    RecordColumns columns;
+    SummaryStats tableStats;
+    size_t nameLengthCount[MAX_NAME];
+    size_t progLengthCount[MAX_PROGRAMME];
+    SummaryStats groupStats[PROGRAMME_MAX_CODES];
+} TableState;
 
 // Flags to track database state
 int dbModified = 0;  // Tracks unsaved changes
 int dbLoaded = 0;    // Tracks whether a DB file has been loaded
 
+// Set when the table can no longer be described as base file + journal
+// (after RESTORE, or when the journal cannot be written); the next SAVE
+// then rewrites the base file instead of committing the journal
+static int baseStale = 0;
+
+// Changes since the last save, and when the first of them was made; they
+// decide when autosave runs
+static long changesSinceSave = 0;
+static double dirtySince = 0;
+
+// Autosave thresholds (0 = not used) set by AUTOSAVE
+static long autosaveChanges = 0;
+static long autosaveSeconds = 0;
+
+// The background save in progress. A save that committed the journal
+// before it started only rewrites the base file; otherwise the base file
+// it writes is the only copy of the changes it saves.
+static int asyncRunning = 0;
+static int asyncCommitted = 0;
+static long long asyncJournalOffset = 0;   // Journal size when the table was captured
+
+// Outcome of the last background save, for SHOW STATS
+static BackgroundSaveResult lastSave;
+static int lastSaveKnown = 0;
+
+// OPEN LAZY: the records stay in the mapped text file, found through the
+// offset index, until a command needs the whole table. Changes committed
+// to the journal since that file was written are held as the last entry
+// per ID, sorted by ID.
+typedef struct LazyChange {
+    StudentRecord record;
+    char type;                  // JOURNAL_UPSERT or JOURNAL_DELETE
+    size_t seq;                 // Position in the journal
+} LazyChange;
+
+static int lazyOpen = 0;
+static OffsetIndex lazyIndex;
+static LazyChange *lazyChanges = NULL;
+static size_t lazyChangeCount = 0;
+static size_t lazyChangeCapacity = 0;
+static size_t lazyRecords = 0;          // Records the table would load
+
+// Sharded table: the records are split by ID range into shard files
+// listed in the manifest, and each shard is loaded when a command first
+// needs it. Changes mark their shard dirty instead of being journaled.
+static int shardsOpen = 0;
+static ShardSet shardSet = {0};
+static const Shard *loadingShard = NULL;   // Shard whose file is being read
+
+static void closeLazy(void);
+static void markShardChanged(int id);
+static void markAllShards(void);
+static int openShards(void);
+static void finishBackgroundSave(int wait);
+static void describeAutosave(char *out, size_t size);
+
+// Records that the table no longer matches the saved files
+static void markModified() {
+    if (!dbModified) dirtySince = timerNow();
+    dbModified = 1;
+    changesSinceSave++;
+}
+
 // Undo/redo stack pointers
 Action *undoStack = NULL;
 Action *redoStack = NULL;
 
+// Oldest undo action, the first to go when the history is over its
+// limits, and what the history holds
+static Action *undoBottom = NULL;
+static size_t undoDepth = 0;
+static size_t historyBytes = 0;      // Both stacks
+
+// The transaction opened by BEGIN: its changes are collected here instead
+// of on the undo stack, and the save state at BEGIN is what ROLLBACK puts
+// back
+static Action *transaction = NULL;
+static int beganModified = 0;
+static long beganChanges = 0;
+static double beganDirtySince = 0;
+
 // Temporary variables for operations
 int id; 
 char name[MAX_NAME], programme[MAX_PROGRAMME]; 
@@ -48,832 +222,4238 @@ float mark;
 
 
 // ===============================
-// Hash Table Utility Functions
+// ID Index Utility Functions
 // ===============================
 
 
 /**
- * hash()
+ * findNode()
  * -----------------------------------------
- * Computes a hash index based on student ID.
- * 
- * @param id - student ID number
- * @return integer index within hash table bounds
+ * Searches for a student record by ID using the ID index.
+ *
+ * @param id - student ID to search for
+ * @return pointer to the matching record or NULL if not found
  */
-int hash(int id) {
-    return id % TABLE_SIZE;
+Node* findNode(int id) {
+    return indexFind(&idIndex, id);
 }
 
 
-/**
- * hashInsert()
- * -----------------------------------------
- * Inserts a node into the hash table for fast access by ID.
- *
- * @param node - pointer to the record being inserted
- */
-void hashInsert(Node *node) {
-    int index = hash(node->data.id);
-    // Insert at the beginning of the chain (chaining collision resolution)
-    node->hashNext = hashTable[index];
-    hashTable[index] = node;
+// Adds (delta = 1) or removes (delta = -1) a record's field lengths
+static void countLengths(const Node *node, int delta) {
+    size_t progLength = programmeLength(node->programme);
+    nameLengthCount[node->nameLength < MAX_NAME ? node->nameLength : MAX_NAME - 1] += delta;
+    progLengthCount[progLength < MAX_PROGRAMME ? progLength : MAX_PROGRAMME - 1] += delta;
+}
+
+
+// Makes room for one more row in the dense columns
+static int growColumns() {
+    if (columns.count < columns.capacity) return 1;
+    size_t capacity = columns.capacity ? columns.capacity * 2 : COLUMN_MIN_CAPACITY;
+
+    // Each array keeps its new block even if a later one fails; the
+    // capacity only moves once all three have grown
+    int *ids = realloc(columns.ids, capacity * sizeof(int));
+    if (ids) columns.ids = ids;
+    float *marks = realloc(columns.marks, capacity * sizeof(float));
+    if (marks) columns.marks = marks;
+    Node **nodes = realloc(columns.nodes, capacity * sizeof(Node*));
+    if (nodes) columns.nodes = nodes;
+    if (!ids || !marks || !nodes) return 0;
+    columns.capacity = capacity;
+    return 1;
 }
 
 
 /**
- * hashRemove()
+ * listAppend()
  * -----------------------------------------
- * Removes a record from the hash table by ID.
+ * Appends a node to the tail of the record list, preserving the
+ * insertion order used by SHOW ALL and SAVE, and gives it a row in the
+ * dense columns.
  *
- * @param id - ID of the record to remove
+ * @param node - record to append
+ * @return 1 on success, 0 if the columns could not grow (nothing changed)
  */
-void hashRemove(int id) {
-    int index = hash(id);
-    Node *cur = hashTable[index], *prev = NULL;
-
-    while (cur) {
-        if (cur->data.id == id) {
-            // Fix linking depending on position
-            if (prev) prev->next = cur->next;
-            else hashTable[index] = cur->next;
-            return;
-        }
-        prev = cur;
-        cur = cur->next;
+static int listAppend(Node *node) {
+    if (!growColumns()) return 0;
+    node->column = (unsigned int)columns.count++;
+    columns.ids[node->column] = node->id;
+    columns.marks[node->column] = node->mark;
+    columns.nodes[node->column] = node;
+
+    node->prev = tail;
+    node->next = NULL;
+    if (!head) head = node;
+    else tail->next = node;
+    tail = node;
+
+    node->seq = nextSeq++;
+    if (ordersBuilt) {
+        orderInsert(&idOrder, node);
+        orderInsert(&markOrder, node);
+        orderInsert(&groupOrder, node);
     }
+    if (nameOrderBuilt) orderInsert(&nameOrder, node);
+
+    SummaryStats *group = &groupStats[programmeGroup(node->programme)];
+    tableStats.count++;
+    tableStats.sum += node->mark;
+    group->count++;
+    group->sum += node->mark;
+    countLengths(node, 1);
+    dbVersion++;
+    return 1;
 }
 
 
 /**
- * findNode()
+ * listUnlink()
  * -----------------------------------------
- * Searches for a student record by ID using the hash table.
+ * Detaches a node from the record list in O(1) using its own back
+ * pointer, so no predecessor search is needed.
  *
- * @param id - student ID to search for
- * @return pointer to the matching record or NULL if not found
+ * @param node - record to unlink
  */
-Node* findNode(int id) {
-    int index = hash(id);
-    Node *cur = hashTable[index];
-    while (cur) {
-        if (cur->data.id == id) return cur;
-        cur = cur->next;
+static void listUnlink(Node *node) {
+    if (node->prev) node->prev->next = node->next;
+    else head = node->next;
+
+    if (node->next) node->next->prev = node->prev;
+    else tail = node->prev;
+
+    node->prev = node->next = NULL;
+
+    // Move the last column row into the freed one
+    Node *last = columns.nodes[--columns.count];
+    columns.ids[node->column] = last->id;
+    columns.marks[node->column] = last->mark;
+    columns.nodes[node->column] = last;
+    last->column = node->column;
+
+    if (ordersBuilt) {
+        orderRemove(&idOrder, node);
+        orderRemove(&markOrder, node);
+        orderRemove(&groupOrder, node);
     }
-    return NULL;
+    if (nameOrderBuilt) orderRemove(&nameOrder, node);
+
+    SummaryStats *group = &groupStats[programmeGroup(node->programme)];
+    tableStats.count--;
+    tableStats.sum -= node->mark;
+    group->count--;
+    group->sum -= node->mark;
+    countLengths(node, -1);
+    dbVersion++;
 }
 
 
-void printDeclaration() {
-    printf("\t\t\t\t\t\t\tDeclaration\t\t\t\t\t\t\n");
-    printf("SIT's policy on copying does not allow the students to copy source code as well as assessment solutions\n");
-    printf("from another person, AI, or other places. It is the students' responsibility to guarantee that their\n");
-    printf("assessment solutions are their own work. Meanwhile, the students must also ensure that their work is\n");
-    printf("not accessible by others. Where such plagiarism is detected, both of the assessments involved will\n");
-    printf("receive ZERO mark.\n\n");
-
-    printf("We hereby declare that:\n");
-    printf("We fully understand and agree to the abovementioned plagiarism policy.\n");
-    printf("We did not copy any code from others or from other places.\n");
-    printf("We did not share our codes with others or upload to any other places for public access and will not do that in the future.\n");
-    printf("We agree that our project will receive Zero mark if there is any plagiarism detected.\n");
-    printf("We agree that we will not disclose any information or material of the group project to others or upload to any other places for public access.\n");
-    printf("We agree that we did not copy any code directly from AI generated sources.\n\n");
-
-    printf("Declared by: P4-1\n");
-    printf("Team members:\n");
-    printf("\t1. Chew Shu Wen\n");
-    printf("\t2. Adora Goh Shao Qi \n");
-    printf("\t3. Calson See Jia Jun\n");
-    printf("\t4. Au Myat Yupar Aung\n");
-    printf("\t5. Chung Kai Sheng Desmond\n");
-    printf("Date: 25/11/2025\n");
-}
-
-
-// Push a new action to the undo stack and clear redo stack
-void pushUndo(Action *action) {
-    action->next = undoStack; // Attach action to top of undo stack
-    undoStack = action;
-
-    // User made a new change → redo stack becomes invalid → clear redo history
-    while (redoStack) {
-        Action *tmp = redoStack;
-        redoStack = redoStack->next;
-        free(tmp);
-    }
+// ID order: IDs are unique
+static int compareById(const Node *a, const Node *b) {
+    return (a->id > b->id) - (a->id < b->id);
 }
 
 
-// Undo the most recent action performed by the user
-void undo() {
-    if (!undoStack) { // Nothing to revert
-        printf("CMS: Nothing to undo.\n");
-        return;
-    }
+// Mark order: equal marks keep insertion order, which is what a stable
+// sort of the list produces (descending walks reverse it, as before)
+static int compareByMark(const Node *a, const Node *b) {
+    if (a->mark != b->mark) return a->mark > b->mark ? 1 : -1;
+    return (a->seq > b->seq) - (a->seq < b->seq);
+}
 
-    Action *action = undoStack;     // Take latest recorded action
-    undoStack = undoStack->next;    // Pop from undo stack
 
-    // Reverse user action depending on type
-    switch (action->type) {
-        case INSERT_OP:   // Undo insert → delete record
-            deleteDB(action->newData.id, 1, 1);
-            printf("CMS: UNDO -> Undid INSERT (ID %d).\n", action->newData.id);
-            break;
-        case UPDATE_OP:   // Undo update → restore previous values
-            updateDB(action->oldData.id,
-                     action->oldData.name,
-                     action->oldData.programme,
-                     action->oldData.mark,
-                     1);
-            printf("CMS: UNDO -> Undid UPDATE on (ID %d).\n", action->newData.id);
-            break;
-        case DELETE_OP:   // Undo delete → re-insert deleted record
-            insertDB(action->oldData.id,
-                     action->oldData.name,
-                     action->oldData.programme,
-                     action->oldData.mark,
-                     1);
-            printf("CMS: UNDO -> Undid DELETE (ID %d).\n", action->oldData.id);
-            break;
-        case RESTORE_OP:  // Undo restore → reload previous version
-            loadDB("./data/P4_1-CMS.txt");
-            printf("CMS: UNDO -> Undid RESTORE operation.\n");
-            break;            
-    }
-    // Move undone action to redo stack
-    action->next = redoStack;
-    redoStack = action;
+// Group order: records of one programme group together, by mark within it
+static int compareByGroup(const Node *a, const Node *b) {
+    ProgCode groupA = programmeGroup(a->programme), groupB = programmeGroup(b->programme);
+    if (groupA != groupB) return groupA > groupB ? 1 : -1;
+    return compareByMark(a, b);
 }
 
 
-// Redo the last undone action
-void redo() {
-    if (!redoStack) { // Nothing available to redo
-        printf("CMS: Nothing to redo.\n");
-        return;
+// Compares two names without regard to letter case, like strcmp()
+static int compareFolded(const char *a, const char *b) {
+    for (;; a++, b++) {
+        int x = tolower((unsigned char)*a), y = tolower((unsigned char)*b);
+        if (x != y || !x) return (x > y) - (x < y);
     }
+}
 
-    Action *action = redoStack;    // Take most recent redo item
-    redoStack = redoStack->next;
 
-    switch (action->type) {
-        case INSERT_OP:
-            insertDB(action->newData.id,
-                     action->newData.name,
-                     action->newData.programme,
-                     action->newData.mark,
-                     1);
-            printf("CMS: REDO -> Redid INSERT (ID %d).\n", action->newData.id);
-            break;
-        case UPDATE_OP:
-            updateDB(action->newData.id,
-                     action->newData.name,
-                     action->newData.programme,
-                     action->newData.mark,
-                     1);
-            printf("CMS: REDO -> Redid UPDATE on (ID %d).\n", action->newData.id);
-            break;
-        case DELETE_OP:
-            deleteDB(action->oldData.id, 1, 1);
-            printf("CMS: REDO -> Redid DELETE (ID %d).\n", action->oldData.id);
-            break;
-        case RESTORE_OP:
-            restoreDB(1); 
-            printf("CMS: REDO -> Redid RESTORE operation.\n");
-            break;            
-    }
-    // Return action back to undo stack
-    action->next = undoStack;
-    undoStack = action;
+// Name order: names in any letter case sort together, IDs break ties
+static int compareByName(const Node *a, const Node *b) {
+    int order = compareFolded(nodeName(a), nodeName(b));
+    return order ? order : compareById(a, b);
 }
 
 
-// Open and load main dataset file only once
-void openDB() {
-    if (dbLoaded) {
-        printf("CMS: The database file \"P4_1-CMS.txt\" has already been opened.\n");
-        return;
+/**
+ * buildOrders()
+ * -----------------------------------------
+ * Builds the ordered indexes the first time a sorted view is requested:
+ * the records are radix-sorted once per index and linked into balanced
+ * trees, which is far cheaper than inserting them one by one. From then
+ * on every change keeps the trees up to date.
+ *
+ * @return 1 if the indexes are ready, 0 if memory allocation failed
+ */
+static int buildOrders() {
+    if (ordersBuilt) return 1;
+
+    // Equal marks stay in list order, matching compareByMark()'s tie-break
+    static const SortKey byId = { SORT_FIELD_ID, 1 };
+    static const SortKey byMark = { SORT_FIELD_MARK, 1 };
+    size_t count = idIndex.count;
+
+    Node **sorted = sortRecords(head, count, &byId, 1);
+    if (!sorted) return 0;
+    orderBuild(&idOrder, sorted, count);
+
+    sorted = sortRecords(head, count, &byMark, 1);
+    if (!sorted) {
+        orderClear(&idOrder);
+        return 0;
+    }
+    orderBuild(&markOrder, sorted, count);
+
+    // Stable counting sort of the mark order by programme group; the group
+    // sizes are already known from groupStats
+    Node **grouped = malloc((count ? count : 1) * sizeof(Node*));
+    size_t *start = malloc((programmeCount() + 1) * sizeof(size_t));
+    if (!grouped || !start) {
+        free(grouped);
+        free(start);
+        orderClear(&idOrder);
+        orderClear(&markOrder);
+        return 0;
+    }
+    size_t offset = 0;
+    for (size_t g = 0; g < programmeCount(); g++) {
+        start[g] = offset;
+        offset += groupStats[g].count;
     }
+    for (size_t i = 0; i < count; i++) {
+        grouped[start[programmeGroup(sorted[i]->programme)]++] = sorted[i];
+    }
+    orderBuild(&groupOrder, grouped, count);
+    free(grouped);
+    free(start);
 
-    loadDB("./data/P4_1-CMS.txt");
+    ordersBuilt = 1;
+    return 1;
 }
 
 
-// Load database from file into memory and hash table
-void loadDB(const char *filename) {
-    freeDB();  // Clear old memory before loading new data
-
-    // Reset hash table
-    for (int i = 0; i < TABLE_SIZE; i++) {
-        hashTable[i] = NULL;
+// A record's sort key for building the name index: the first 16
+// case-folded bytes of its name, packed into two integers, decide nearly
+// every comparison, and the rest are settled without touching the node
+typedef struct NameSortEntry {
+    unsigned long long key[2];
+    int id;
+    unsigned short length;      // Node::nameLength
+    Node *node;
+} NameSortEntry;
+
+
+// qsort() order of NameSortEntry, the same as compareByName()
+static int compareNameEntries(const void *a, const void *b) {
+    const NameSortEntry *x = a, *y = b;
+    if (x->key[0] != y->key[0]) return x->key[0] > y->key[0] ? 1 : -1;
+    if (x->key[1] != y->key[1]) return x->key[1] > y->key[1] ? 1 : -1;
+    if (x->length > NAME_SORT_KEY_BYTES && y->length > NAME_SORT_KEY_BYTES) {
+        int order = compareFolded(nodeName(x->node) + NAME_SORT_KEY_BYTES, nodeName(y->node) + NAME_SORT_KEY_BYTES);
+        if (order) return order;
     }
-
-    FILE *file = fopen(filename, "r");
-    if (!file) {
-        printf("CMS: Could not open file \"%s\".\n", filename);
-        dbLoaded = 0;
-        return;
+    else if (x->length != y->length) {  // The shorter name is a prefix of the longer
+        return x->length > y->length ? 1 : -1;
     }
+    return (x->id > y->id) - (x->id < y->id);
+}
 
-    char line[MAX_LINE];
-
-    while (fgets(line, sizeof(line), file)) {
-        line[strcspn(line, "\r\n")] = 0;
-
-        // Skip header lines
-        if (strstr(line, "Database Name: P4_1-CMS") ||
-            strstr(line, "Authors: P4-1") ||
-            strstr(line, "Table Name: StudentRecords") ||
-            strstr(line, "ID\tName\tProgramme\tMark") ||
-            strlen(line) == 0) {
-            continue;
-        }
-
-        // Split values on TAB delimiter
-        char *ptr = line;
-        char *fields[4] = {NULL, NULL, NULL, NULL};
-        for (int i = 0; i < 4; i++) {
-            fields[i] = ptr;
-            char *tabPos = strchr(ptr, '\t');
-            if (tabPos) {
-                *tabPos = '\0';
-                ptr = tabPos + 1;
-            } else {
-                ptr += strlen(ptr);
-            }
-        }      
-
-        // Create new record node in memory
-        Node *newNode = malloc(sizeof(Node));
-        if (!newNode) {
-            printf("CMS: Memory allocation failed during load.\n");
-            fclose(file);
-            freeDB();
-            return;
-        }
 
-         // Assign parsed values
-        newNode->data.id = fields[0] && strlen(fields[0]) > 0 ? atoi(fields[0]) : 0;
-        strcpy(newNode->data.name, fields[1] ? fields[1] : "");
-        strcpy(newNode->data.programme, fields[2] ? fields[2] : "");
-        newNode->data.mark = fields[3] && strlen(fields[3]) > 0 ? atof(fields[3]) : 0.0f;
-        newNode->next = NULL;
-        newNode->hashNext = NULL;
+/**
+ * buildNameOrder()
+ * -----------------------------------------
+ * Builds the name index the first time a name lookup needs it, from one
+ * sort of the records. Every change keeps it up to date afterwards.
+ *
+ * @return 1 if the index is ready, 0 if memory allocation failed
+ */
+static int buildNameOrder() {
+    if (nameOrderBuilt) return 1;
+    size_t count = idIndex.count;
+    NameSortEntry *entries = malloc((count ? count : 1) * sizeof(NameSortEntry));
+    Node **sorted = malloc((count ? count : 1) * sizeof(Node*));
+    if (!entries || !sorted) {
+        free(entries);
+        free(sorted);
+        return 0;
+    }
 
-        // Append into linked list
-        if (!head) head = tail = newNode;
-        else {
-            tail->next = newNode;
-            tail = newNode;
+    size_t i = 0;
+    for (Node *node = head; node; node = node->next, i++) {
+        NameSortEntry *entry = &entries[i];
+        const char *name = nodeName(node);
+        entry->id = node->id;
+        entry->length = node->nameLength;
+        entry->node = node;
+        entry->key[0] = entry->key[1] = 0;
+        for (int b = 0; b < NAME_SORT_KEY_BYTES; b++) {
+            unsigned char c = b < node->nameLength ? (unsigned char)tolower((unsigned char)name[b]) : 0;
+            entry->key[b / 8] = entry->key[b / 8] << 8 | c;
         }
-        hashInsert(newNode);  // Store in hash table
     }
-    fclose(file);
-    dbLoaded = 1;
+    qsort(entries, count, sizeof(NameSortEntry), compareNameEntries);
+    for (i = 0; i < count; i++) sorted[i] = entries[i].node;
+    free(entries);
+    orderBuild(&nameOrder, sorted, count);
+    free(sorted);
 
-    printf("CMS: The database file \"P4_1-CMS.txt\" is successfully opened.\n");
+    nameOrderBuilt = 1;
+    return 1;
 }
 
 
-// Print records in formatted table layout (supports multi-line wrapping)
-void printNodeList(Node* list, const char *headerMsg) {
-    if (!list) {
-        printf("CMS: No records to display.\n");
-        return;
-    }
-
-    // Discover longest field values for dynamic alignment
-    int max_name_len = 4;
-    int max_prog_len = 9;
-    Node* temp = list;
-    while (temp) {
-        int nameLen = strlen(temp->data.name);
-        int progLen = strlen(temp->data.programme);
-        if (nameLen > max_name_len) max_name_len = nameLen;
-        if (progLen > max_prog_len) max_prog_len = progLen;
-        temp = temp->next;
-    }
-
-    // Set final display width limits
-    int display_name_width = max_name_len + 2;
-    int display_prog_width = max_prog_len + 2;
-
-    if (display_name_width > NAME_WIDTH + 2) display_name_width = NAME_WIDTH + 2;
-    if (display_prog_width > PROG_WIDTH + 2) display_prog_width = PROG_WIDTH + 2;
-    if (display_name_width < 6) display_name_width = 6;
-    if (display_prog_width < 11) display_prog_width = 11;
+// Gets the table ready for adding or removing count records at once. If
+// that is a large share of the table, the ordered indexes are dropped and
+// rebuilt the next time a view or lookup needs them, which beats updating
+// them row by row.
+static void prepareBulkChange(size_t count) {
+    if (count * 100 <= idIndex.count * BULK_REBUILD_PCT) return;
+    orderClear(&idOrder);
+    orderClear(&markOrder);
+    orderClear(&groupOrder);
+    orderClear(&nameOrder);
+    ordersBuilt = 0;
+    nameOrderBuilt = 0;
+}
 
-    // Print table header
-    printf("%s\n", headerMsg);
-    printf("%-8s %-*s %-*s %-5s\n",
-           "ID",
-           display_name_width, "Name",
-           display_prog_width, "Programme",
-           "Mark");
 
-    // Output each record (multi-line wrapping supported)
-    Node* curr = list;
-    while (curr) {
-        int nameLen = strlen(curr->data.name);
-        int progLen = strlen(curr->data.programme);
-        int lines_name = (nameLen > 0) ? (nameLen + NAME_WIDTH - 1) / NAME_WIDTH : 1;
-        int lines_prog = (progLen > 0) ? (progLen + PROG_WIDTH - 1) / PROG_WIDTH : 1;
-        int lines = (lines_name > lines_prog) ? lines_name : lines_prog;
+// Changes a record's mark, moving it within the mark-keyed indexes and
+// adjusting the running totals
+static void setNodeMark(Node *node, float mark) {
+    if (ordersBuilt) {
+        orderRemove(&markOrder, node);
+        orderRemove(&groupOrder, node);
+    }
 
-        for (int i = 0; i < lines; i++) {
-            if (i == 0) printf("%-8d ", curr->data.id);
-            else printf("%-8s ", "");
+    SummaryStats *group = &groupStats[programmeGroup(node->programme)];
+    tableStats.sum += (double)mark - node->mark;
+    group->sum += (double)mark - node->mark;
+    node->mark = mark;
+    columns.marks[node->column] = mark;
 
-            if (i * NAME_WIDTH < nameLen)
-                printf("%-*.*s ", display_name_width, NAME_WIDTH, curr->data.name + i * NAME_WIDTH);
-            else
-                printf("%-*s ", display_name_width, "");
+    if (ordersBuilt) {
+        orderInsert(&markOrder, node);
+        orderInsert(&groupOrder, node);
+    }
+    dbVersion++;
+}
 
-            if (i * PROG_WIDTH < progLen)
-                printf("%-*.*s ", display_prog_width, PROG_WIDTH, curr->data.programme + i * PROG_WIDTH);
-            else
-                printf("%-*s ", display_prog_width, "");
 
-            if (i == 0) printf("%.1f", curr->data.mark);
-            printf("\n");
-        }
-        curr = curr->next;
+// Changes a record's programme, moving it to its new group's aggregates
+static void setNodeProgramme(Node *node, ProgCode code) {
+    ProgCode oldGroup = programmeGroup(node->programme);
+    ProgCode newGroup = programmeGroup(code);
+    countLengths(node, -1);
+    dbVersion++;
+    if (oldGroup == newGroup) {
+        node->programme = code;
+        countLengths(node, 1);
+        return;
     }
+
+    if (ordersBuilt) orderRemove(&groupOrder, node);
+    groupStats[oldGroup].count--;
+    groupStats[oldGroup].sum -= node->mark;
+    node->programme = code;
+    groupStats[newGroup].count++;
+    groupStats[newGroup].sum += node->mark;
+    if (ordersBuilt) orderInsert(&groupOrder, node);
+    countLengths(node, 1);
 }
 
 
-void showDB() {
-    printNodeList(head, "CMS: Here are all the records found in the table \"StudentRecords\".");
+/**
+ * setNodeName()
+ * -----------------------------------------
+ * Copies a name into namePool and points the node at it.
+ *
+ * @return 1 on success, 0 if memory allocation failed
+ */
+static int setNodeName(Node *node, const char *name, size_t len) {
+    unsigned int offset = stringPoolAdd(&namePool, name, len);
+    if (offset == STRING_POOL_NONE) return 0;
+    node->nameOffset = offset;
+    node->nameLength = (unsigned short)len;
+    return 1;
 }
 
 
-// Create an independent duplicate of the linked list (used before sorting)
-Node* cloneList(Node* original) {
-    if (!original) return NULL;
-
-    Node* newHead = NULL;
-    Node* tail = NULL;
+// Renames a record that is already in the list, releasing its old name
+// and moving it within the name index
+static int renameNode(Node *node, const char *name, size_t len) {
+    unsigned short oldLength = node->nameLength;
+    countLengths(node, -1);
+    if (nameOrderBuilt) orderRemove(&nameOrder, node);
+    int renamed = setNodeName(node, name, len);
+    if (renamed) stringPoolRelease(&namePool, oldLength);
+    if (nameOrderBuilt) orderInsert(&nameOrder, node);
+    countLengths(node, 1);
+    dbVersion++;
+    return renamed;
+}
 
-    while (original) {
-        Node* newNode = malloc(sizeof(Node));
-        newNode->data = original->data;
-        newNode->next = NULL;
 
-        if (!newHead)
-            newHead = tail = newNode;
-        else {
-            tail->next = newNode;
-            tail = newNode;
+/**
+ * compactNames()
+ * -----------------------------------------
+ * Rebuilds namePool from the names still referenced by records once
+ * released (updated or deleted) names make up over half of it.
+ */
+static void compactNames() {
+    if (namePool.garbage < NAME_POOL_COMPACT_MIN || namePool.garbage * 2 < namePool.used) return;
+
+    StringPool compacted = {0};
+    for (Node *node = head; node; node = node->next) {
+        unsigned int offset = stringPoolAdd(&compacted, nodeName(node), node->nameLength);
+        if (offset == STRING_POOL_NONE) { // Keep the old pool if memory is short
+            stringPoolFree(&compacted);
+            return;
         }
-
-        original = original->next;
+        node->nameOffset = offset;
     }
+    stringPoolFree(&namePool);
+    namePool = compacted;
+}
+
 
-    return newHead;
+// Expands a compact node into a full StudentRecord copy
+void nodeToRecord(const Node *node, StudentRecord *record) {
+    record->id = node->id;
+    memcpy(record->name, nodeName(node), (size_t)node->nameLength + 1);
+    strcpy(record->programme, nodeProgramme(node));
+    record->mark = node->mark;
 }
 
 
-// Merge two sorted lists based on ID or mark, ascending or descending
-static Node* mergeSorted(Node* list1, Node* list2, int sortByID, int ascending) {
-    if (!list1) return list2;
-    if (!list2) return list1;
+/**
+ * clearRecords()
+ * -----------------------------------------
+ * Discards every record in O(number of slabs): the node pool is dropped
+ * wholesale and the list and ID index are reset. Undo/redo history is
+ * kept, since it stores record copies rather than node pointers.
+ */
+static void clearRecords() {
+    poolReset(&nodePool);
+    stringPoolReset(&namePool);
+    indexClear(&idIndex);
+    orderClear(&idOrder);
+    orderClear(&markOrder);
+    orderClear(&groupOrder);
+    orderClear(&nameOrder);
+    ordersBuilt = 0;
+    nameOrderBuilt = 0;
+    memset(groupStats, 0, programmeCount() * sizeof(SummaryStats));
+    tableStats.count = 0;
+    tableStats.sum = 0.0;
+    memset(nameLengthCount, 0, sizeof(nameLengthCount));
+    memset(progLengthCount, 0, sizeof(progLengthCount));
+    columns.count = 0;
+    dbVersion++;
+    nextSeq = 0;
+    head = NULL;
+    tail = NULL;
+}
 
-    Node* mergedHead = NULL;
 
-    int compare = 0;
-    if (sortByID) {
-        compare = list1->data.id - list2->data.id;
-    } 
-    else {
-        if (list1->data.mark > list2->data.mark) compare = 1;
-        else if (list1->data.mark < list2->data.mark) compare = -1;
-        else compare = 0;
-    }
+// Exchanges two values of the given type
+#define SWAP_VALUES(type, a, b) do { type swap_ = (a); (a) = (b); (b) = swap_; } while (0)
 
-    if ((ascending && compare <= 0) || (!ascending && compare > 0)) {
-        mergedHead = list1;
-        mergedHead->next = mergeSorted(list1->next, list2, sortByID, ascending);
-    } 
-    else {
-        mergedHead = list2;
-        mergedHead->next = mergeSorted(list1, list2->next, sortByID, ascending);
+/**
+ * swapTable()
+ * -----------------------------------------
+ * Exchanges the loaded table with a parked one in O(1) of the record
+ * count: only the roots of the list, indexes, pools and columns move.
+ * Programme codes are shared by every table, so the per-group totals
+ * only need swapping for the codes handed out so far.
+ */
+static void swapTable(TableState *other) {
+    SWAP_VALUES(Node*, head, other->head);
+    SWAP_VALUES(Node*, tail, other->tail);
+    SWAP_VALUES(IdIndex, idIndex, other->idIndex);
+    SWAP_VALUES(OrderIndex, idOrder, other->idOrder);
+    SWAP_VALUES(OrderIndex, markOrder, other->markOrder);
+    SWAP_VALUES(OrderIndex, groupOrder, other->groupOrder);
+    SWAP_VALUES(int, ordersBuilt, other->ordersBuilt);
+    SWAP_VALUES(OrderIndex, nameOrder, other->nameOrder);
+    SWAP_VALUES(int, nameOrderBuilt, other->nameOrderBuilt);
+    SWAP_VALUES(unsigned int, nextSeq, other->nextSeq);
+    SWAP_VALUES(Pool, nodePool, other->nodePool);
+    SWAP_VALUES(StringPool, namePool, other->namePool);
+    SWAP_VALUES(RecordColumns, columns, other->columns);
+    SWAP_VALUES(SummaryStats, tableStats, other->tableStats);
+    for (size_t i = 0; i < MAX_NAME; i++) SWAP_VALUES(size_t, nameLengthCount[i], other->nameLengthCount[i]);
+    for (size_t i = 0; i < MAX_PROGRAMME; i++) SWAP_VALUES(size_t, progLengthCount[i], other->progLengthCount[i]);
+    for (size_t code = 0; code < programmeCount(); code++) {
+        SWAP_VALUES(SummaryStats, groupStats[code], other->groupStats[code]);
     }
-    return mergedHead;
+    dbVersion++;
 }
 
 
-// Merge sort implementation optimized for linked list structure
-static Node* mergeSort(Node* head, int sortByID, int ascending) {
-    if (!head || !head->next) return head;
+// Creates an empty parked table, or returns NULL if memory ran out
+static TableState *newTable() {
+    TableState *table = calloc(1, sizeof(TableState));
+    if (!table) return NULL;
+    OrderIndex ids = ORDER_INDEX_INIT(ORDER_BY_ID, compareById);
+    OrderIndex marks = ORDER_INDEX_INIT(ORDER_BY_MARK, compareByMark);
+    OrderIndex groups = ORDER_INDEX_INIT(ORDER_BY_GROUP, compareByGroup);
+    OrderIndex names = ORDER_INDEX_INIT(ORDER_BY_NAME, compareByName);
+    Pool nodes = POOL_INIT(Node, NODE_SLAB_SIZE);
+    table->idOrder = ids;
+    table->markOrder = marks;
+    table->groupOrder = groups;
+    table->nameOrder = names;
+    table->nodePool = nodes;
+    return table;
+}
 
-    Node* slow = head;
-    Node* fast = head->next;
-    while (fast && fast->next) {
-        slow = slow->next;
-        fast = fast->next->next;
-    }
 
-    Node* middle = slow->next;
-    slow->next = NULL;
+// Releases a parked table and every record in it
+static void freeTable(TableState *table) {
+    if (!table) return;
+    poolReset(&table->nodePool);
+    stringPoolFree(&table->namePool);
+    indexFree(&table->idIndex);
+    free(table->columns.ids);
+    free(table->columns.marks);
+    free(table->columns.nodes);
+    free(table);
+}
 
-    Node* leftSorted = mergeSort(head, sortByID, ascending);
-    Node* rightSorted = mergeSort(middle, sortByID, ascending);
 
-    return mergeSorted(leftSorted, rightSorted, sortByID, ascending);
+// Memory held by a parked table
+static size_t tableBytes(const TableState *table) {
+    return sizeof(TableState)
+         + poolBytesReserved(&table->nodePool)
+         + table->namePool.capacity
+         + table->idIndex.capacity * sizeof(IndexSlot)
+         + table->columns.capacity * (sizeof(int) + sizeof(float) + sizeof(Node*));
 }
 
 
-// Show all records sorted by ID or mark
-void showDBSorted(int sortByID, int ascending) {
-    if (!head) {
-        printf("CMS: No records to display.\n");
-        return;
-    }
 
-    Node* tempList = cloneList(head);
-    Node* sortedHead = mergeSort(tempList, sortByID, ascending);
 
-    char headerMsg[150];
-    if (sortByID) {
-        snprintf(headerMsg, sizeof(headerMsg),
-                 "CMS: Here are all the records sorted by ID %s from the table \"StudentRecords\".",
-                 ascending ? "ASC" : "DESC");
-    } else {
-        snprintf(headerMsg, sizeof(headerMsg),
-                 "CMS: Here are all the records sorted by mark %s from the table \"StudentRecords\".",
-                 ascending ? "ASC" : "DESC");
+/**
+ * addRecord()
+ * -----------------------------------------
+ * Creates a record node and links it into the ID index and the list.
+ *
+ * @return the new node, or NULL if memory allocation failed
+ */
+static Node *addRecord(int id, const char *name, const char *programme, float mark) {
+    Node *node = poolAlloc(&nodePool);
+    if (!node) return NULL;
+
+    node->id = id;
+    node->mark = mark;
+    node->programme = programmeIntern(programme, strlen(programme));
+    if (node->programme == PROGRAMME_NONE || !setNodeName(node, name, strlen(name))) {
+        poolFree(&nodePool, node);
+        return NULL;
     }
 
-    printNodeList(sortedHead, headerMsg);
+    if (indexInsert(&idIndex, node) != 1) {
+        stringPoolRelease(&namePool, node->nameLength);
+        poolFree(&nodePool, node);
+        return NULL;
+    }
 
-    while (sortedHead) {
-        Node* temp = sortedHead;
-        sortedHead = sortedHead->next;
-        free(temp);
+    if (!listAppend(node)) {
+        indexRemove(&idIndex, id);
+        stringPoolRelease(&namePool, node->nameLength);
+        poolFree(&nodePool, node);
+        return NULL;
     }
+    return node;
 }
 
 
-// Compute and display statistics such as: total count,
-// average score, highest and lowest marks (with names)
-void showSummary(const char *programmeFilter) {
-    if (!head) {
-        printf("CMS: No records to display.\n");
-        return;
-    }
-
-    int total = 0;
-    float sum = 0.0f;
-    float maxMark = -1.0f, minMark = 101.0f;
-    struct Node *current = head;
+// Unlinks a record from the list and ID index and frees it
+static void removeRecord(Node *node) {
+    listUnlink(node);
+    indexRemove(&idIndex, node->id);
+    stringPoolRelease(&namePool, node->nameLength);
+    poolFree(&nodePool, node);
+    compactNames();
+}
 
-    while (current) {
-        if (!programmeFilter || strcasecmp(current->data.programme, programmeFilter) == 0) {
-            float mark = current->data.mark;
-            if (mark > maxMark) maxMark = mark;
-            if (mark < minMark) minMark = mark;
-            sum += mark;
-            total++;
-        }
-        current = current->next;
-    }
 
-    if (total == 0) {
-        if (programmeFilter)
-            printf("CMS: No matching records found for programme '%s'.\n", programmeFilter);
-        else
-            printf("CMS: No records found.\n");
+// Appends a change to the journal; if that fails the next SAVE rewrites
+// the base file instead, so the change is still persisted. A sharded
+// table has no journal and marks the record's shard to be written.
+// Changes inside a transaction are journaled by COMMIT.
+static void journalChange(char type, const Node *node) {
+    if (shardsOpen) {
+        markShardChanged(node->id);
         return;
     }
+    if (baseStale || transaction) return;
 
-    printf("CMS: Here are summary statistics from the table \"StudentRecords\"");
-    if (programmeFilter) printf(" (Programme: %s)", programmeFilter);
-    printf(".\n");
+    StudentRecord record;
+    nodeToRecord(node, &record);
+    if (!journalAppend(type, &record)) baseStale = 1;
+}
 
-    printf("Total students: %d\n", total);
 
-    printf("Average mark: %.2f\n", sum / total);
+// Applies one replayed journal entry: UPSERT inserts or overwrites the
+// whole record, DELETE removes it if present
+static void applyJournalEntry(char type, const StudentRecord *record) {
+    Node *node = findNode(record->id);
 
-    // Print highest mark students
-    printf("\nHighest mark: %.1f\n", maxMark);
-    int count = 1;
-    current = head;
-    while (current) {
-        if ((!programmeFilter || strcasecmp(current->data.programme, programmeFilter) == 0)
-            && current->data.mark == maxMark) {
-            printf("%d. %s (ID: %d)\n", count++, current->data.name, current->data.id);
-        }
-        current = current->next;
+    if (type == JOURNAL_DELETE) {
+        if (node) removeRecord(node);
+        return;
     }
-    
-    // Print lowest mark students
-    printf("\nLowest mark: %.1f\n", minMark);
-    count = 1;
-    current = head;
-    while (current) {
-        if ((!programmeFilter || strcasecmp(current->data.programme, programmeFilter) == 0)
-            && current->data.mark == minMark) {
-            printf("%d. %s (ID: %d)\n", count++, current->data.name, current->data.id);
+    if (!node) {
+        if (!addRecord(record->id, record->name, record->programme, record->mark)) {
+            outputPrintf("CMS: Memory allocation failed while replaying the journal.\n");
         }
-        current = current->next;
-    }
-}
-
-
-// Inserts a new student record into both the linked list and hash table.
-// If the operation is user-initiated (not from undo/redo), it is recorded
-// for reversal and user feedback is displayed.
-void insertDB(int newID, char *newName, char *newProgramme, float newMark, int isUndoRedo) {
-    // Prevent duplicate records
-    if (findNode(newID)) {
-        if (!isUndoRedo) printf("CMS: Record with ID=%d already exists.\n", newID);
         return;
     }
 
-    // Allocate space for a new node
-    Node *newNode = malloc(sizeof(Node)); // Allocate memory for new node
-    if (!newNode) {
-        printf("CMS: Memory allocation failed.\n");
-        return;
+    size_t nameLength = strlen(record->name);
+    if (nameLength != node->nameLength || memcmp(nodeName(node), record->name, nameLength) != 0) {
+        renameNode(node, record->name, nameLength);
     }
+    ProgCode code = programmeIntern(record->programme, strlen(record->programme));
+    if (code != PROGRAMME_NONE) setNodeProgramme(node, code);
+    if (node->mark != record->mark) setNodeMark(node, record->mark);
+}
 
-    // Populate record fields
-    newNode->data.id = newID;
-    strcpy(newNode->data.name, newName ? newName : "");
-    strcpy(newNode->data.programme, newProgramme ? newProgramme : "");
-    newNode->data.mark = newMark;
-    newNode->next = NULL;
-    newNode->hashNext = NULL;
 
-    // Append to linked list (tail insertion)
-    if (!head) head = tail = newNode;
-    else {
-        tail->next = newNode;
-        tail = newNode;
-    }
+static void freeBatch(RecordBatch *batch);
 
-    // Add record to hash table
-    hashInsert(newNode);
+/**
+ * captureBatch()
+ * -----------------------------------------
+ * Copies count consecutive records, starting at first, into a batch.
+ *
+ * @return the batch, or NULL if memory allocation failed
+ */
+static RecordBatch *captureBatch(Node *first, size_t count) {
+    RecordBatch *batch = calloc(1, sizeof(RecordBatch));
+    if (!batch) return NULL;
+
+    size_t nameBytes = 0;
+    Node *node = first;
+    for (size_t i = 0; i < count && node; i++, node = node->next) nameBytes += node->nameLength + 1u;
+
+    batch->ids = malloc(count * sizeof(int));
+    batch->marks = malloc(count * sizeof(float));
+    batch->programmes = malloc(count * sizeof(ProgCode));
+    batch->nameOffsets = malloc(count * sizeof(unsigned int));
+    batch->names = malloc(nameBytes ? nameBytes : 1);
+    if (!batch->ids || !batch->marks || !batch->programmes || !batch->nameOffsets || !batch->names) {
+        freeBatch(batch);
+        return NULL;
+    }
 
-    // Record action for undo stack 
-    if (!isUndoRedo) {
-        Action *action = malloc(sizeof(Action));
-        action->type = INSERT_OP;
-        action->newData = newNode->data;
-        pushUndo(action);
-        printf("CMS: Record with ID=%d inserted.\n", newID);
+    size_t offset = 0;
+    node = first;
+    for (size_t i = 0; i < count && node; i++, node = node->next) {
+        batch->ids[i] = node->id;
+        batch->marks[i] = node->mark;
+        batch->programmes[i] = node->programme;
+        batch->nameOffsets[i] = (unsigned int)offset;
+        memcpy(batch->names + offset, nodeName(node), node->nameLength + 1u);
+        offset += node->nameLength + 1u;
+        batch->count++;
     }
+    return batch;
+}
 
-    dbModified = 1;
+
+// Releases a batch and its columns
+static void freeBatch(RecordBatch *batch) {
+    if (!batch) return;
+    free(batch->ids);
+    free(batch->marks);
+    free(batch->programmes);
+    free(batch->nameOffsets);
+    free(batch->names);
+    free(batch);
 }
 
 
-// Searches for a record by ID and prints it in formatted table output.
-// A temporary single-node list is used for reuse of print formatting logic.
-void queryDB(int id) {
-    Node *node = findNode(id);
-    if (!node) {
-        printf("CMS: The record with ID=%d does not exist.\n", id);
-        return;
-    }
+// Takes a blank action from the pool, or NULL if memory ran out
+static Action *newAction(ActionType type, int id) {
+    Action *action = poolAlloc(&actionPool);
+    if (!action) return NULL;
+    memset(action, 0, sizeof(Action));
+    action->type = type;
+    action->id = id;
+    return action;
+}
 
-    // Create a temporary wrapper so printNodeList() can format properly
-    Node tempNode;
-    tempNode.data = node->data;
-    tempNode.next = NULL;
 
-    printf("CMS: The record with ID=%d is found in the data table.\n", id);
-    printNodeList(&tempNode, "");
+// Heap copy of a record's name, or NULL if memory ran out
+static char *copyName(const Node *node) {
+    char *copy = malloc(node->nameLength + 1u);
+    if (copy) memcpy(copy, nodeName(node), node->nameLength + 1u);
+    return copy;
 }
 
 
-// Modifies an existing record (name, programme, or mark). Changes are tracked
-// so undo/redo can revert modifications when needed.
-void updateDB(int id, char *name, char *programme, float mark, int isUndoRedo) {
-    Node *record = findNode(id);
-    if (!record) {
-        if (!isUndoRedo) printf("CMS: The record with ID=%d does not exist.\n", id);
-        return;
+// Memory an action holds, with its names, batch or parked table
+static size_t actionBytes(const Action *action) {
+    size_t bytes = sizeof(Action);
+    if (action->oldName) bytes += strlen(action->oldName) + 1;
+    if (action->newName) bytes += strlen(action->newName) + 1;
+    if (action->batch) {
+        const RecordBatch *batch = action->batch;
+        size_t names = batch->count ? batch->nameOffsets[batch->count - 1] : 0;
+        if (batch->count) names += strlen(batch->names + names) + 1;
+        bytes += sizeof(RecordBatch) + names
+               + batch->count * (sizeof(int) + sizeof(float) + sizeof(ProgCode) + sizeof(unsigned int));
     }
+    if (action->table) bytes += tableBytes(action->table);
+    for (const Action *step = action->steps; step; step = step->next) bytes += actionBytes(step);
+    return bytes;
+}
 
-    Action *action = NULL;
-    // Prepare undo entry only if initiated by user    
-    if (!isUndoRedo) {
-        action = malloc(sizeof(Action));
-        action->type = UPDATE_OP;
-        action->oldData = record->data;
-        action->newData = record->data;
+
+// Returns an action to the pool, with everything it owns
+static void freeAction(Action *action) {
+    historyBytes -= action->bytes;
+    free(action->oldName);
+    free(action->newName);
+    freeBatch(action->batch);
+    freeTable(action->table);
+    while (action->steps) {
+        Action *step = action->steps;     // Not charged on its own: bytes is 0
+        action->steps = step->next;
+        freeAction(step);
     }
+    poolFree(&actionPool, action);
+}
 
-    // Apply updates selectively
-    if (name && strlen(name) > 0) strcpy(record->data.name, name);
-    if (programme && strlen(programme) > 0) strcpy(record->data.programme, programme);
-    if (mark >= 0.0f) record->data.mark = mark;  
 
-    // Finalize undo stack if applicable
-    if (action) {
-        action->newData = record->data;
-        pushUndo(action);
-        if (!isUndoRedo) printf("CMS: The record with ID=%d is successfully updated.\n", id);
+// Puts an action on top of the undo or redo stack
+static void stackPush(Action **stack, Action *action) {
+    action->next = *stack;
+    action->prev = NULL;
+    if (*stack) (*stack)->prev = action;
+    *stack = action;
+    if (stack == &undoStack) {
+        if (!action->next) undoBottom = action;
+        undoDepth++;
     }
-
-    dbModified = 1;
 }
 
 
-// Removes a record from both the linked list and hash table.
-// If user-triggered, the action is stored so it can be undone.
-int deleteDB(int id, int confirm, int isUndoRedo) {
-    Node *current = head;
-    Node *prev = NULL;
-
-    // Find node to delete
-    while (current && current->data.id != id) {
-        prev = current;
-        current = current->next;
+// Takes the top action off a non-empty stack
+static Action *stackPop(Action **stack) {
+    Action *action = *stack;
+    *stack = action->next;
+    if (*stack) (*stack)->prev = NULL;
+    action->next = NULL;
+    if (stack == &undoStack) {
+        if (!undoStack) undoBottom = NULL;
+        undoDepth--;
     }
+    return action;
+}
 
-    if (!current) return 0; // Not found
-    if (!confirm) return 1; // Preview mode (for DELETE confirmation)
 
-    if (!isUndoRedo) {
-        Action *action = malloc(sizeof(Action));
-        action->type = DELETE_OP;
-        action->oldData = current->data;
-        pushUndo(action);
+// Drops the oldest undo steps while the history is over UNDO_MAX_ACTIONS
+// or UNDO_MAX_BYTES; the newest step always stays
+static void trimHistory() {
+    while (undoBottom && undoBottom != undoStack
+           && (undoDepth > UNDO_MAX_ACTIONS || historyBytes > UNDO_MAX_BYTES)) {
+        Action *oldest = undoBottom;
+        undoBottom = oldest->prev;
+        undoBottom->next = NULL;
+        undoDepth--;
+        freeAction(oldest);
     }
+}
+
 
-    // Remove from linked list
-    if (!prev) head = current->next;
-    else prev->next = current->next;
+// Re-charges a RESTORE step after its swap: the parked table changed
+static void recountAction(Action *action) {
+    historyBytes -= action->bytes;
+    action->bytes = actionBytes(action);
+    historyBytes += action->bytes;
+}
 
-    if (current == tail) tail = prev;
 
-    // Remove from hash table & free memory
-    hashRemove(id);
-    free(current);
+/**
+ * applyUpdate()
+ * -----------------------------------------
+ * Sets the fields an UPDATE changed to their old (undo) or new (redo)
+ * values. Fields the UPDATE left alone are not touched.
+ *
+ * @param useNew - 1 for the new values, 0 for the old ones
+ */
+static void applyUpdate(const Action *action, int useNew) {
+    Node *node = findNode(action->id);
+    if (!node) return;
+
+    if (action->changed & ACTION_NAME) {
+        const char *name = useNew ? action->newName : action->oldName;
+        if (!renameNode(node, name, strlen(name))) outputPrintf("CMS: Memory allocation failed.\n");
+        else compactNames();
+    }
+    if (action->changed & ACTION_PROGRAMME) setNodeProgramme(node, useNew ? action->newProgramme : action->oldProgramme);
+    if (action->changed & ACTION_MARK) setNodeMark(node, useNew ? action->newMark : action->oldMark);
+    journalChange(JOURNAL_UPSERT, node);
+    markModified();
+}
 
-    if (!isUndoRedo) printf("CMS: The record with ID=%d is successfully deleted.\n", id);
 
-    dbModified = 1;
-    return 1;
+// Swaps the loaded table with the one a RESTORE step parked (undo and
+// redo of RESTORE). Neither matches base file + journal afterwards.
+static void swapRestore(Action *action) {
+    swapTable(action->table);
+    recountAction(action);
+    baseStale = 1;
+    if (shardsOpen) markAllShards();
+    markModified();
 }
 
 
-// Saves the in-memory database to a file, but only if changes exist.
-// Prevents unnecessary overwrites and preserves backup integrity.
-void saveDB() {
-    if (!dbLoaded) {
-        printf("CMS: No database loaded. Nothing to save.\n");
-        return;
+// Removes the records of a batch that are still in the table (undo of IMPORT)
+static void removeBatch(const RecordBatch *batch) {
+    prepareBulkChange(batch->count);
+    for (size_t i = 0; i < batch->count; i++) {
+        Node *node = findNode(batch->ids[i]);
+        if (!node) continue;
+        journalChange(JOURNAL_DELETE, node);
+        removeRecord(node);
     }
+    markModified();
+}
 
-    // Read current file contents dynamically
-    FILE *original = fopen("./data/P4_1-CMS.txt", "r");
-    char *fileContent = NULL;
-    long fileLen = 0;
-
-    if (original) {
-        int ch;
-        while ((ch = fgetc(original)) != EOF) {
-            char *newPtr = realloc(fileContent, fileLen + 2);
-            if (!newPtr) {
-                free(fileContent);
-                fclose(original);
-                printf("CMS: Memory allocation failed during file comparison.\n");
-                return;
-            }
-            fileContent = newPtr;
-            fileContent[fileLen++] = ch;
-            fileContent[fileLen] = '\0';
-        }
-        fclose(original);
-    }
-
-    // Build current memory representation dynamically
-    char *memContent = NULL;
-    long memLen = 0;
-
-    // Add headers exactly as written during save
-    const char *header =
-        "Database Name: P4_1-CMS\n"
-        "Authors: P4-1\n\n"
-        "Table Name: StudentRecords\n"
-        "ID\tName\tProgramme\tMark\n";
-
-    for (const char *p = header; *p; p++) {
-        char *newPtr = realloc(memContent, memLen + 2);
-        if (!newPtr) {
-            free(fileContent);
-            free(memContent);
-            printf("CMS: Memory allocation failed while preparing save buffer.\n");
-            return;
+
+// Adds the records of a batch back (redo of IMPORT); IDs that were taken
+// in the meantime are left alone
+static void addBatch(const RecordBatch *batch) {
+    prepareBulkChange(batch->count);
+    indexReserve(&idIndex, idIndex.count + batch->count);
+    for (size_t i = 0; i < batch->count; i++) {
+        if (findNode(batch->ids[i])) continue;
+        Node *node = addRecord(batch->ids[i], batch->names + batch->nameOffsets[i],
+                               programmeName(batch->programmes[i]), batch->marks[i]);
+        if (!node) {
+            outputPrintf("CMS: Memory allocation failed while re-adding imported records.\n");
+            break;
         }
-        memContent = newPtr;
-        memContent[memLen++] = *p;
-        memContent[memLen] = '\0';
+        journalChange(JOURNAL_UPSERT, node);
     }
+    markModified();
+}
 
-    // Append all records from linked list
-    Node *current = head;
-    char line[256];
-
-    while (current) {
-        snprintf(line, sizeof(line), "%d\t%s\t%s\t%.1f\n",
-                 current->data.id,
-                 current->data.name,
-                 current->data.programme,
-                 current->data.mark);
-
-        for (char *p = line; *p; p++) {
-            char *newPtr = realloc(memContent, memLen + 2);
-            if (!newPtr) {
-                free(fileContent);
-                free(memContent);
-                printf("CMS: Memory allocation failed while writing memory comparison.\n");
-                return;
+
+void printDeclaration() {
+    outputPrintf("\t\t\t\t\t\t\tDeclaration\t\t\t\t\t\t\n");
+    outputPrintf("SIT's policy on copying does not allow the students to copy source code as well as assessment solutions\n");
+    outputPrintf("from another person, AI, or other places. It is the students' responsibility to guarantee that their\n");
+    outputPrintf("assessment solutions are their own work. Meanwhile, the students must also ensure that their work is\n");
+    outputPrintf("not accessible by others. Where such plagiarism is detected, both of the assessments involved will\n");
+    outputPrintf("receive ZERO mark.\n\n");
+
+    outputPrintf("We hereby declare that:\n");
+    outputPrintf("We fully understand and agree to the abovementioned plagiarism policy.\n");
+    outputPrintf("We did not copy any code from others or from other places.\n");
+    outputPrintf("We did not share our codes with others or upload to any other places for public access and will not do that in the future.\n");
+    outputPrintf("We agree that our project will receive Zero mark if there is any plagiarism detected.\n");
+    outputPrintf("We agree that we will not disclose any information or material of the group project to others or upload to any other places for public access.\n");
+    outputPrintf("We agree that we did not copy any code directly from AI generated sources.\n\n");
+
+    outputPrintf("Declared by: P4-1\n");
+    outputPrintf("Team members:\n");
+    outputPrintf("\t1. Chew Shu Wen\n");
+    outputPrintf("\t2. Adora Goh Shao Qi \n");
+    outputPrintf("\t3. Calson See Jia Jun\n");
+    outputPrintf("\t4. Au Myat Yupar Aung\n");
+    outputPrintf("\t5. Chung Kai Sheng Desmond\n");
+    outputPrintf("Date: 25/11/2025\n");
+}
+
+
+// Push a new action to the undo stack and clear redo stack; the oldest
+// steps are dropped if the history grows past its limits. Inside a
+// transaction the action becomes one of its steps instead.
+void pushUndo(Action *action) {
+    if (transaction) {
+        action->next = transaction->steps;
+        action->prev = NULL;
+        if (transaction->steps) transaction->steps->prev = action;
+        transaction->steps = action;
+        transaction->stepCount++;
+        prepareBulkChange(transaction->stepCount);  // A large batch rebuilds the ordered indexes once
+        return;
+    }
+
+    // User made a new change → redo stack becomes invalid → clear redo history
+    while (redoStack) freeAction(stackPop(&redoStack));
+
+    action->bytes = actionBytes(action);
+    historyBytes += action->bytes;
+    stackPush(&undoStack, action);  // Attach action to top of undo stack
+    trimHistory();
+}
+
+
+static void undoAction(Action *action, int quiet);
+static void redoAction(Action *action, int quiet);
+
+// Undoes the steps of a transaction, newest first
+static void undoSteps(Action *action) {
+    prepareBulkChange(action->stepCount);
+    for (Action *step = action->steps; step; step = step->next) undoAction(step, 1);
+}
+
+
+// Redoes the steps of a transaction, oldest first
+static void redoSteps(Action *action) {
+    prepareBulkChange(action->stepCount);
+    Action *step = action->steps;
+    while (step && step->next) step = step->next;
+    for (; step; step = step->prev) redoAction(step, 1);
+}
+
+
+// Reverses one action; the steps of a transaction are reversed quietly
+static void undoAction(Action *action, int quiet) {
+    switch (action->type) {
+        case INSERT_OP:   // Undo insert → delete record
+            deleteDB(action->id, 1, 1);
+            if (!quiet) outputPrintf("CMS: UNDO -> Undid INSERT (ID %d).\n", action->id);
+            break;
+        case UPDATE_OP:   // Undo update → restore the changed fields
+            applyUpdate(action, 0);
+            if (!quiet) outputPrintf("CMS: UNDO -> Undid UPDATE on (ID %d).\n", action->id);
+            break;
+        case DELETE_OP:   // Undo delete → re-insert deleted record
+            insertDB(action->id,
+                     action->oldName,
+                     programmeName(action->oldProgramme),
+                     action->oldMark,
+                     1);
+            if (!quiet) outputPrintf("CMS: UNDO -> Undid DELETE (ID %d).\n", action->id);
+            break;
+        case RESTORE_OP:  // Undo restore → swap the table from before it back in
+            swapRestore(action);
+            if (!quiet) outputPrintf("CMS: UNDO -> Undid RESTORE operation.\n");
+            break;            
+        case IMPORT_OP:   // Undo import → remove every imported record
+            removeBatch(action->batch);
+            if (!quiet) outputPrintf("CMS: UNDO -> Undid IMPORT (%d records).\n", (int)action->batch->count);
+            break;
+        case TRANSACTION_OP:  // Undo transaction → undo each of its changes
+            undoSteps(action);
+            if (!quiet) outputPrintf("CMS: UNDO -> Undid TRANSACTION (%d changes).\n", (int)action->stepCount);
+            break;
+    }
+}
+
+
+// Applies one action again; the steps of a transaction quietly
+static void redoAction(Action *action, int quiet) {
+    switch (action->type) {
+        case INSERT_OP:
+            insertDB(action->id,
+                     action->newName,
+                     programmeName(action->newProgramme),
+                     action->newMark,
+                     1);
+            if (!quiet) outputPrintf("CMS: REDO -> Redid INSERT (ID %d).\n", action->id);
+            break;
+        case UPDATE_OP:
+            applyUpdate(action, 1);
+            if (!quiet) outputPrintf("CMS: REDO -> Redid UPDATE on (ID %d).\n", action->id);
+            break;
+        case DELETE_OP:
+            deleteDB(action->id, 1, 1);
+            if (!quiet) outputPrintf("CMS: REDO -> Redid DELETE (ID %d).\n", action->id);
+            break;
+        case RESTORE_OP:
+            swapRestore(action);
+            if (!quiet) outputPrintf("CMS: REDO -> Redid RESTORE operation.\n");
+            break;            
+        case IMPORT_OP:
+            addBatch(action->batch);
+            if (!quiet) outputPrintf("CMS: REDO -> Redid IMPORT (%d records).\n", (int)action->batch->count);
+            break;
+        case TRANSACTION_OP:
+            redoSteps(action);
+            if (!quiet) outputPrintf("CMS: REDO -> Redid TRANSACTION (%d changes).\n", (int)action->stepCount);
+            break;
+    }
+}
+
+
+// Undo the most recent action performed by the user
+int undo() {
+    if (!undoStack) { // Nothing to revert
+        outputPrintf("CMS: Nothing to undo.\n");
+        return 0;
+    }
+
+    Action *action = stackPop(&undoStack);  // Take latest recorded action
+    undoAction(action, 0);                  // Reverse user action depending on type
+
+    // Move undone action to redo stack
+    stackPush(&redoStack, action);
+    return 1;
+}
+
+
+// Redo the last undone action
+int redo() {
+    if (!redoStack) { // Nothing available to redo
+        outputPrintf("CMS: Nothing to redo.\n");
+        return 0;
+    }
+
+    Action *action = stackPop(&redoStack);  // Take most recent redo item
+    redoAction(action, 0);
+
+    // Return action back to undo stack
+    stackPush(&undoStack, action);
+    return 1;
+}
+
+
+// ===============================
+// Transactions
+// ===============================
+
+// Opens a transaction: the changes that follow are applied as usual but
+// collected into one undo step, and only journaled at COMMIT
+int beginDB(void) {
+    if (transaction) {
+        outputPrintf("CMS: A transaction is already open. COMMIT or ROLLBACK it first.\n");
+        return 0;
+    }
+    transaction = newAction(TRANSACTION_OP, 0);
+    if (!transaction) {
+        outputPrintf("CMS: Memory allocation failed for the transaction.\n");
+        return 0;
+    }
+    beganModified = dbModified;
+    beganChanges = changesSinceSave;
+    beganDirtySince = dirtySince;
+    outputPrintf("CMS: Transaction started. Changes are applied as they come; COMMIT keeps them, ROLLBACK undoes them all.\n");
+    return 1;
+}
+
+
+static int compareInts(const void *a, const void *b) {
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+
+/**
+ * journalTransaction()
+ * -----------------------------------------
+ * Journals a committed transaction: one entry per record it touched, with
+ * the record as it is now (or a DELETE if it is gone), however many times
+ * the record changed in between. The entries go out back to back and
+ * become durable with the next SAVE's commit marker, like any other change.
+ */
+static void journalTransaction(const Action *action) {
+    if (shardsOpen || baseStale) return;    // Shards were marked as the changes were made
+
+    int *ids = malloc(action->stepCount * sizeof(int));
+    if (!ids) {
+        baseStale = 1;      // The next SAVE rewrites the base file instead
+        return;
+    }
+    size_t count = 0;
+    for (const Action *step = action->steps; step; step = step->next) ids[count++] = step->id;
+    qsort(ids, count, sizeof(int), compareInts);
+
+    for (size_t i = 0; i < count; i++) {
+        if (i > 0 && ids[i] == ids[i - 1]) continue;
+        StudentRecord record;
+        Node *node = findNode(ids[i]);
+        if (node) nodeToRecord(node, &record);
+        else {
+            memset(&record, 0, sizeof(record));
+            record.id = ids[i];
+        }
+        if (!journalAppend(node ? JOURNAL_UPSERT : JOURNAL_DELETE, &record)) {
+            baseStale = 1;
+            break;
+        }
+    }
+    free(ids);
+}
+
+
+// Closes the transaction, keeping its changes as one undo step
+int commitDB(void) {
+    if (!transaction) {
+        outputPrintf("CMS: No transaction is open. Use BEGIN to start one.\n");
+        return 0;
+    }
+    Action *action = transaction;
+    transaction = NULL;
+
+    if (action->stepCount == 0) {
+        freeAction(action);
+        outputPrintf("CMS: Transaction committed (no changes).\n");
+        return 1;
+    }
+    journalTransaction(action);
+    pushUndo(action);
+    outputPrintf("CMS: Transaction committed: %d change%s, undone together by one UNDO.\n",
+                 (int)action->stepCount, action->stepCount == 1 ? "" : "s");
+    return 1;
+}
+
+
+// Closes the transaction, undoing every change made in it
+int rollbackDB(void) {
+    if (!transaction) {
+        outputPrintf("CMS: No transaction is open. Nothing to roll back.\n");
+        return 0;
+    }
+    undoSteps(transaction);     // Still open, so none of this is journaled
+    size_t steps = transaction->stepCount;
+    freeAction(transaction);
+    transaction = NULL;
+
+    dbModified = beganModified;
+    changesSinceSave = beganChanges;
+    dirtySince = beganDirtySince;
+    outputPrintf("CMS: Transaction rolled back: %d change%s undone.\n", (int)steps, steps == 1 ? "" : "s");
+    return 1;
+}
+
+
+int dbInTransaction(void) {
+    return transaction != NULL;
+}
+
+
+/**
+ * loadSnapshot()
+ * -----------------------------------------
+ * Replaces the in-memory table with the contents of a binary snapshot.
+ * Columns are copied straight into nodes and the name heap is handed to
+ * namePool without copying individual strings.
+ *
+ * @param path - snapshot file
+ * @return 1 on success, 0 if the snapshot is invalid or memory ran out
+ *         (the table is left empty and the caller falls back to text)
+ */
+static int loadSnapshot(const char *path) {
+    double started = timerNow();
+    SnapshotImage image;
+    if (!snapshotRead(path, &image)) return 0;
+
+    clearRecords();
+    size_t count = image.header.recordCount;
+    size_t programmes = image.header.programmeCount;
+
+    // Map the snapshot's programme table onto dictionary codes
+    ProgCode *codes = malloc((programmes ? programmes : 1) * sizeof(ProgCode));
+    int ok = codes != NULL;
+    const char *text = image.programmeHeap;
+    for (size_t i = 0; ok && i < programmes; i++) {
+        codes[i] = programmeIntern(text, image.programmeLengths[i]);
+        if (codes[i] == PROGRAMME_NONE) ok = 0;
+        text += image.programmeLengths[i] + 1;
+    }
+
+    if (ok && count > idIndex.capacity * INDEX_MAX_LOAD_PCT / 100) {
+        indexFree(&idIndex);
+        ok = indexInit(&idIndex, count);
+    }
+
+    unsigned int nameOffset = 0;
+    for (size_t i = 0; ok && i < count; i++) {
+        Node *node = poolAlloc(&nodePool);
+        if (!node) {
+            ok = 0;
+            break;
+        }
+        node->id = image.ids[i];
+        node->mark = image.marks[i];
+        node->programme = codes[image.programmes[i]];
+        node->nameOffset = nameOffset;
+        node->nameLength = image.nameLengths[i];
+        nameOffset += (unsigned int)node->nameLength + 1;
+
+        if (indexInsert(&idIndex, node) != 1) { // Duplicate ID: snapshot is corrupt
+            poolFree(&nodePool, node);
+            ok = 0;
+            break;
+        }
+        if (!listAppend(node)) {
+            ok = 0;     // clearRecords() below drops the indexed node with the rest
+            break;
+        }
+    }
+    free(codes);
+
+    if (!ok) {
+        snapshotRelease(&image);
+        clearRecords();
+        return 0;
+    }
+
+    // Move the name heap to the front of the read buffer and keep it as namePool
+    size_t heapSize = image.header.nameHeapSize;
+    memmove(image.buffer, image.nameHeap, heapSize);
+    char *heap = realloc(image.buffer, heapSize ? heapSize : 1);
+    stringPoolAdopt(&namePool, heap ? heap : image.buffer, heapSize);
+
+    dbLoaded = 1;
+    double elapsed = timerNow() - started;
+    double megabytes = (double)image.bufferSize / (1024.0 * 1024.0);
+    outputPrintf("CMS: The database file \"P4_1-CMS.txt\" is successfully opened.\n");
+    outputPrintf("CMS: Loaded %zu records from snapshot (%.2f MB in %.3f s, %.1f MB/s).\n",
+                 count, megabytes, elapsed, elapsed > 0 ? megabytes / elapsed : 0.0);
+    return 1;
+}
+
+
+/**
+ * loadBase()
+ * -----------------------------------------
+ * Loads the base file written by the last full save, preferring the
+ * binary snapshot when it is at least as new as the text file (SAVE
+ * writes it right after the text). A hand-edited text file is newer and
+ * therefore wins.
+ */
+static void loadBase() {
+    long long textTime = fileModTime(DB_FILE_PATH);
+    long long snapshotTime = fileModTime(DB_SNAPSHOT_PATH);
+
+    if (snapshotTime >= 0 && snapshotTime >= textTime) {
+        if (loadSnapshot(DB_SNAPSHOT_PATH)) return;
+        outputPrintf("CMS: Snapshot \"P4_1-CMS.cms\" is damaged or unreadable. Loading the text file instead.\n");
+    }
+    loadDB(DB_FILE_PATH);
+}
+
+
+/**
+ * loadSaved()
+ * -----------------------------------------
+ * Loads the latest saved state: the base file plus every change committed
+ * to the journal since. Uncommitted journal entries are dropped and the
+ * journal stays open for the changes that follow.
+ */
+static void loadSaved() {
+    loadBase();
+    if (!dbLoaded) return;
+
+    baseStale = 0;
+    int applied = journalOpen(DB_JOURNAL_PATH, applyJournalEntry);
+    if (applied < 0) {
+        outputPrintf("CMS: WARNING: Journal \"P4_1-CMS.jnl\" is damaged or unreadable. Changes saved since the last full save may be missing.\n");
+        baseStale = 1;
+    }
+    else if (applied > 0) {
+        int commits = journalCommits();
+        outputPrintf("CMS: Replayed %d journal entr%s from %d save%s.\n",
+                     applied, applied == 1 ? "y" : "ies", commits, commits == 1 ? "" : "s");
+    }
+}
+
+
+// Open and load main dataset file only once. Returns 0 if nothing could
+// be loaded; a repeated OPEN is a harmless no-op.
+int openDB() {
+    if (dbLoaded) {
+        outputPrintf("CMS: The database file \"P4_1-CMS.txt\" has already been opened.\n");
+        return 1;
+    }
+
+    int sharded = openShards();
+    if (sharded >= 0) return sharded;
+    loadSaved();
+    return dbLoaded;
+}
+
+
+// Header lines written by saveDB() ahead of the records
+static const char *headerLines[] = {
+    "Database Name: P4_1-CMS",
+    "Authors: P4-1",
+    "Table Name: StudentRecords",
+    "ID\tName\tProgramme\tMark"
+};
+
+
+/**
+ * isHeaderLine()
+ * -----------------------------------------
+ * Checks whether a line is one of the file header lines (or blank).
+ * Only consulted until the column header row has been passed.
+ *
+ * @return 1 if the line belongs to the header, 0 otherwise
+ */
+static int isHeaderLine(const char *line, size_t len) {
+    if (len == 0) return 1;
+    for (int i = 0; i < 4; i++) {
+        if (strstr(line, headerLines[i])) return 1;
+    }
+    return 0;
+}
+
+
+/**
+ * parseIntField() / parseMarkField()
+ * -----------------------------------------
+ * Fast in-place conversions with the same results as atoi()/atof() for
+ * the plain decimal values SAVE writes. Anything unusual in a mark
+ * (exponents, many digits) falls back to atof().
+ */
+static int parseIntField(const char *str) {
+    while (*str == ' ') str++;
+    int negative = (*str == '-');
+    if (*str == '-' || *str == '+') str++;
+
+    int value = 0;
+    while (*str >= '0' && *str <= '9') value = value * 10 + (*str++ - '0');
+    return negative ? -value : value;
+}
+
+static float parseMarkField(const char *str) {
+    const char *p = str;
+    long long mantissa = 0;
+    int digits = 0, decimals = 0, negative = 0;
+
+    if (*p == '-' || *p == '+') negative = (*p++ == '-');
+    while (*p >= '0' && *p <= '9' && digits < 15) {
+        mantissa = mantissa * 10 + (*p++ - '0');
+        digits++;
+    }
+    if (*p == '.') {
+        p++;
+        while (*p >= '0' && *p <= '9' && digits < 15) {
+            mantissa = mantissa * 10 + (*p++ - '0');
+            digits++;
+            decimals++;
+        }
+    }
+    if (*p != '\0' || digits == 0) return (float)atof(str);
+
+    static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+                                    1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15};
+    double value = (double)mantissa / powers[decimals];
+    return (float)(negative ? -value : value);
+}
+
+
+/**
+ * loadDiagnostic()
+ * -----------------------------------------
+ * Reports a skipped data line. Only the first LOAD_MAX_DIAGNOSTICS are
+ * printed so a badly damaged file cannot flood the terminal.
+ */
+static void loadDiagnostic(long *skipped, long lineNo, const char *reason) {
+    if (++(*skipped) <= LOAD_MAX_DIAGNOSTICS) {
+        outputPrintf("CMS: Skipped line %ld: %s.\n", lineNo, reason);
+    }
+}
+
+
+// Splits a data line in place on its TABs into ID, name, programme and
+// mark; missing fields are empty and the mark takes the rest of the line
+static void splitRecordLine(char *line, size_t len, char *fields[4], size_t lengths[4]) {
+    char *ptr = line, *end = line + len;
+    for (int i = 0; i < 4; i++) {
+        fields[i] = "";
+        lengths[i] = 0;
+    }
+    for (int i = 0; i < 4 && ptr <= end; i++) {
+        char *tabPos = memchr(ptr, '\t', (size_t)(end - ptr));
+        if (!tabPos || i == 3) tabPos = end;
+        *tabPos = '\0';
+        fields[i] = ptr;
+        lengths[i] = (size_t)(tabPos - ptr);
+        ptr = tabPos + 1;
+    }
+}
+
+
+/**
+ * loadRecordLine()
+ * -----------------------------------------
+ * Splits one TAB-separated data line in place and appends the record.
+ *
+ * @param line - NUL-terminated line without its line ending (modified)
+ * @param len  - length of the line
+ * @return 1 if a record was added, 0 if the line was skipped,
+ *         -1 on memory allocation failure
+ */
+static int loadRecordLine(char *line, size_t len, long lineNo, long *skipped) {
+    char *fields[4];
+    size_t lengths[4];
+    splitRecordLine(line, len, fields, lengths);
+
+    int recordId = lengths[0] > 0 ? parseIntField(fields[0]) : 0;
+    if (loadingShard && shardKeyOf(&shardSet, recordId) != loadingShard->key) {
+        loadDiagnostic(skipped, lineNo, "ID belongs to another shard");
+        return 0;
+    }
+    if (lengths[1] >= MAX_NAME) {
+        loadDiagnostic(skipped, lineNo, "name is too long");
+        return 0;
+    }
+    if (lengths[2] >= MAX_PROGRAMME) {
+        loadDiagnostic(skipped, lineNo, "programme is too long");
+        return 0;
+    }
+
+    // Create new record node in memory
+    Node *newNode = poolAlloc(&nodePool);
+    if (!newNode) return -1;
+
+    // Assign parsed values (name pooled, programme interned)
+    newNode->id = recordId;
+    newNode->mark = lengths[3] > 0 ? parseMarkField(fields[3]) : 0.0f;
+    newNode->programme = programmeIntern(fields[2], lengths[2]);
+    if (newNode->programme == PROGRAMME_NONE || !setNodeName(newNode, fields[1], lengths[1])) {
+        poolFree(&nodePool, newNode);
+        return -1;
+    }
+
+    // Store in ID index (rejects IDs already loaded in the same probe)
+    int indexed = indexInsert(&idIndex, newNode);
+    if (indexed <= 0) {
+        stringPoolRelease(&namePool, newNode->nameLength);
+        poolFree(&nodePool, newNode);
+        if (indexed == 0) return -1;
+        loadDiagnostic(skipped, lineNo, "duplicate ID");
+        return 0;
+    }
+
+    // Append into linked list
+    if (!listAppend(newNode)) {
+        indexRemove(&idIndex, newNode->id);
+        stringPoolRelease(&namePool, newNode->nameLength);
+        poolFree(&nodePool, newNode);
+        return -1;
+    }
+    return 1;
+}
+
+
+/**
+ * readRecordFile()
+ * -----------------------------------------
+ * Reads an open database file in large blocks and appends its records,
+ * parsing each line in place; only the lines before the column header row
+ * are checked as header text.
+ *
+ * @return 1 when the whole file was read, 0 if memory ran out part way
+ */
+static int readRecordFile(FILE *file, long *records, long *skipped, long long *bytesRead) {
+    char *block = malloc(IO_BUFFER_SIZE + 1);
+    if (!block) return 0;
+
+    long lineNo = 0;
+    int inHeader = 1;       // Still inside the leading header lines
+    int discarding = 0;     // Skipping the tail of an over-long line
+    int failed = 0;
+    size_t have = 0;
+    int atEOF = 0;
+
+    while (!failed && (!atEOF || have > 0)) {
+        if (!atEOF) {
+            size_t n = fread(block + have, 1, IO_BUFFER_SIZE - have, file);
+            if (n == 0) atEOF = 1;
+            have += n;
+            *bytesRead += (long long)n;
+        }
+
+        char *p = block, *end = block + have;
+        while (p < end) {
+            char *nl = memchr(p, '\n', (size_t)(end - p));
+            if (!nl) {
+                if (!atEOF) break;  // Incomplete line: wait for next block
+                nl = end;           // Final line without a newline
+            }
+
+            size_t len = (size_t)(nl - p);
+            char *line = p;
+            p = nl + (nl < end);
+            line[len] = '\0';
+
+            if (discarding) {       // Remainder of a line already reported
+                discarding = 0;
+                continue;
+            }
+
+            lineNo++;
+            if (len > 0 && line[len - 1] == '\r') line[--len] = '\0';
+
+            if (inHeader) {
+                if (strcmp(line, headerLines[3]) == 0) {
+                    inHeader = 0;
+                    continue;
+                }
+                if (isHeaderLine(line, len)) continue;
+                inHeader = 0;       // Headerless file: first data row
+            }
+
+            if (len == 0) continue;
+            if (len >= MAX_LINE) {
+                loadDiagnostic(skipped, lineNo, "line exceeds maximum length");
+                continue;
+            }
+            int added = loadRecordLine(line, len, lineNo, skipped);
+            if (added < 0) {
+                failed = 1;
+                break;
+            }
+            *records += added;
+        }
+
+        // Carry the unfinished line over to the front of the block
+        size_t remaining = (size_t)(end - p);
+        if (!failed && remaining == IO_BUFFER_SIZE) {
+            // A single line fills the whole block: report and drop it
+            lineNo++;
+            loadDiagnostic(skipped, lineNo, "line exceeds maximum length");
+            discarding = 1;
+            remaining = 0;
+        }
+        memmove(block, p, remaining);
+        have = remaining;
+    }
+
+    free(block);
+    return !failed;
+}
+
+
+// Load database from file into memory and ID index.
+void loadDB(const char *filename) {
+    clearRecords();  // Drop the old record arena before loading new data
+
+    FILE *file = fopen(filename, "rb");
+    if (!file) {
+        outputPrintf("CMS: Could not open file \"%s\".\n", filename);
+        dbLoaded = 0;
+        return;
+    }
+
+    // Size the ID index up front from the file length (rows are rarely
+    // shorter than LOAD_MIN_ROW_BYTES) so it is not rehashed while loading
+    if (fseek(file, 0, SEEK_END) == 0) {
+        long fileSize = ftell(file);
+        if (fileSize > 0 && (size_t)fileSize / LOAD_MIN_ROW_BYTES > idIndex.capacity) {
+            indexFree(&idIndex);
+            indexInit(&idIndex, (size_t)fileSize / LOAD_MIN_ROW_BYTES);
+        }
+        rewind(file);
+    }
+
+    double started = timerNow();
+    long records = 0, skipped = 0;
+    long long bytesRead = 0;
+    int complete = readRecordFile(file, &records, &skipped, &bytesRead);
+    fclose(file);
+
+    if (!complete) {
+        outputPrintf("CMS: Memory allocation failed during load.\n");
+        clearRecords();
+        dbLoaded = 0;
+        return;
+    }
+    dbLoaded = 1;
+
+    outputPrintf("CMS: The database file \"P4_1-CMS.txt\" is successfully opened.\n");
+
+    if (skipped > LOAD_MAX_DIAGNOSTICS) {
+        outputPrintf("CMS: %ld further malformed lines were skipped.\n", skipped - LOAD_MAX_DIAGNOSTICS);
+    }
+    double elapsed = timerNow() - started;
+    double megabytes = (double)bytesRead / (1024.0 * 1024.0);
+    outputPrintf("CMS: Loaded %ld records (%.2f MB in %.3f s, %.1f MB/s).\n",
+                 records, megabytes, elapsed, elapsed > 0 ? megabytes / elapsed : 0.0);
+}
+
+
+// Column layout for the longest name and programme that will be printed
+static TableLayout layoutFor(int maxNameLength, int maxProgLength, int tsv) {
+    TableLayout layout;
+    layout.nameWidth = maxNameLength + 2;
+    layout.progWidth = maxProgLength + 2;
+    layout.nameWrap = NAME_WIDTH;
+    layout.progWrap = PROG_WIDTH;
+    layout.tsv = tsv;
+
+    // Set final display width limits
+    if (layout.nameWidth > NAME_WIDTH + 2) layout.nameWidth = NAME_WIDTH + 2;
+    if (layout.progWidth > PROG_WIDTH + 2) layout.progWidth = PROG_WIDTH + 2;
+    if (layout.nameWidth < 6) layout.nameWidth = 6;
+    if (layout.progWidth < 11) layout.progWidth = 11;
+    return layout;
+}
+
+
+// Sizes the Name and Programme columns to the longest values in a list
+static TableLayout measureColumns(Node *list) {
+    // Discover longest field values for dynamic alignment
+    int max_name_len = 4;
+    int max_prog_len = 9;
+    Node* temp = list;
+    while (temp) {
+        int nameLen = temp->nameLength;
+        int progLen = (int)programmeLength(temp->programme);
+        if (nameLen > max_name_len) max_name_len = nameLen;
+        if (progLen > max_prog_len) max_prog_len = progLen;
+        temp = temp->next;
+    }
+    return layoutFor(max_name_len, max_prog_len, 0);
+}
+
+
+// Sizes the columns for the whole table from the length counts, without
+// walking the list
+static TableLayout tableColumns(int tsv) {
+    int maxName = MAX_NAME - 1;
+    int maxProg = MAX_PROGRAMME - 1;
+    while (maxName > 4 && !nameLengthCount[maxName]) maxName--;
+    while (maxProg > 9 && !progLengthCount[maxProg]) maxProg--;
+    return layoutFor(maxName, maxProg, tsv);
+}
+
+
+// Queues one record with the renderer
+static void renderNode(const TableLayout *layout, const Node *node) {
+    renderRow(layout, node->id, nodeName(node), node->nameLength,
+              nodeProgramme(node), programmeLength(node->programme), node->mark);
+}
+
+
+// Print records in formatted table layout (supports multi-line wrapping)
+void printNodeList(Node* list, const char *headerMsg) {
+    if (!list) {
+        outputPrintf("CMS: No records to display.\n");
+        return;
+    }
+
+    TableLayout layout = measureColumns(list);
+    renderHeader(&layout, headerMsg);
+    for (Node *curr = list; curr; curr = curr->next) {
+        renderNode(&layout, curr);
+    }
+    renderFlush();
+}
+
+
+// Walks the records of a view in display order
+typedef struct RowSource {
+    size_t total;               // Records in the view
+    Node **sorted;              // Several sort keys or a filter: ordered array
+    size_t index;
+    int useOrder;               // One sort key: walk of its ordered index
+    OrderCursor cursor;
+    Node *next;                 // Record the list or index walk returns next
+} RowSource;
+
+// The last SHOW ALL page, continued by NEXT
+struct PageState {
+    int active;
+    int ended;                  // The last page of a limited view has been shown
+    unsigned long version;      // dbVersion the position belongs to
+    SortKey keys[SORT_MAX_KEYS];
+    int keyCount;
+    ViewOptions options;        // offset is the first record of the next page
+    RowSource source;           // Positioned at that record (not for sorted arrays)
+};
+
+static PageState page = {0};
+
+
+// Returns the next record of a view, or NULL after the last one
+static Node *rowNext(RowSource *source) {
+    if (source->sorted) return source->index < source->total ? source->sorted[source->index++] : NULL;
+
+    Node *node = source->next;
+    if (node) source->next = source->useOrder ? orderNext(&source->cursor) : node->next;
+    return node;
+}
+
+
+// Record access path of a filtered view
+typedef enum {
+    SCAN_LIST,                  // Every record, in insertion order
+    SCAN_ID,                    // ID range of idOrder
+    SCAN_MARK,                  // Mark range of markOrder
+    SCAN_GROUP                  // Mark range of one programme group in groupOrder
+} ScanPath;
+
+// Records matched by the current filtered view
+static Node **matches = NULL;
+static size_t matchCapacity = 0;
+
+
+// Tests every condition of a filter; group is the programme group it
+// names, looked up once per view
+static int filterMatches(const RecordFilter *filter, ProgCode group, const Node *node) {
+    return node->id >= filter->minId && node->id <= filter->maxId
+        && node->mark >= filter->minMark && node->mark <= filter->maxMark
+        && (!filter->hasProgramme || programmeGroup(node->programme) == group);
+}
+
+
+static void findExtremes(ProgCode group, float *minMark, float *maxMark);  // Defined with showSummary()
+
+
+// Share of [low, high] that [from, to] covers, taking values as evenly spread
+static double rangeShare(double low, double high, double from, double to) {
+    if (from < low) from = low;
+    if (to > high) to = high;
+    if (to < from) return 0.0;
+    if (high <= low) return 1.0;
+    return (to - from) / (high - low);
+}
+
+
+/**
+ * planScan()
+ * -----------------------------------------
+ * Picks the access path expected to visit the fewest records. The size of
+ * an ID or mark range is estimated from the lowest and highest keys in
+ * its ordered index, and a programme group's size is known exactly. If
+ * every range covers most of the table, a plain list scan is cheaper.
+ */
+static ScanPath planScan(const RecordFilter *filter, ProgCode group) {
+    OrderCursor cursor;
+    double total = (double)idIndex.count;
+    double lowId = orderFirst(&cursor, &idOrder, 1)->id;
+    double highId = orderFirst(&cursor, &idOrder, 0)->id;
+    float lowMark, highMark;
+    findExtremes(PROGRAMME_NONE, &lowMark, &highMark);
+    double markShare = rangeShare(lowMark, highMark, filter->minMark, filter->maxMark);
+
+    ScanPath path = SCAN_LIST;
+    double best = total * WHERE_SCAN_PCT / 100.0;
+    double rows = total * rangeShare(lowId, highId, filter->minId, filter->maxId);
+    if (rows < best) {
+        path = SCAN_ID;
+        best = rows;
+    }
+    rows = total * markShare;
+    if (rows < best) {
+        path = SCAN_MARK;
+        best = rows;
+    }
+    if (filter->hasProgramme && groupStats[group].count * markShare <= best) path = SCAN_GROUP;
+    return path;
+}
+
+
+// Tells whether an index walk has gone past the end of its range
+static int pastRange(ScanPath path, const RecordFilter *filter, ProgCode group, const Node *node) {
+    switch (path) {
+        case SCAN_ID: return node->id > filter->maxId;
+        case SCAN_MARK: return node->mark > filter->maxMark;
+        case SCAN_GROUP: return programmeGroup(node->programme) != group || node->mark > filter->maxMark;
+        default: return 0;
+    }
+}
+
+
+// A filtered scan over the dense columns, one run of rows per task
+typedef struct FilterScan {
+    const RecordFilter *filter;
+    ProgCode group;
+    int tasks;
+    Node **found[SCAN_MAX_TASKS];       // Matches of each task, in row order
+    size_t foundCount[SCAN_MAX_TASKS];
+    int failed[SCAN_MAX_TASKS];
+} FilterScan;
+
+
+// Collects the matching records of one task's rows. The ID and mark
+// conditions are tested by the column kernel a block at a time; only the
+// rows it picks out are looked up for their programme.
+static void filterTask(void *arg, int task) {
+    FilterScan *scan = arg;
+    const RecordFilter *filter = scan->filter;
+    size_t first = scanSplit(columns.count, task, scan->tasks);
+    size_t last = scanSplit(columns.count, task + 1, scan->tasks);
+    unsigned int rows[COLUMN_SCAN_BLOCK];
+    Node **found = NULL;
+    size_t count = 0, capacity = 0;
+
+    for (size_t start = first; start < last; start += COLUMN_SCAN_BLOCK) {
+        size_t block = last - start < COLUMN_SCAN_BLOCK ? last - start : COLUMN_SCAN_BLOCK;
+        size_t hits = kernelSelectRange(columns.ids + start, columns.marks + start, block,
+                                        filter->minId, filter->maxId, filter->minMark, filter->maxMark, rows);
+        if (count + hits > capacity) {
+            while (count + hits > capacity) capacity = capacity ? capacity * 2 : 1024;
+            Node **grown = realloc(found, capacity * sizeof(Node*));
+            if (!grown) {
+                scan->failed[task] = 1;
+                break;
+            }
+            found = grown;
+        }
+        for (size_t h = 0; h < hits; h++) {
+            Node *node = columns.nodes[start + rows[h]];
+            found[count] = node;
+            count += !filter->hasProgramme || programmeGroup(node->programme) == scan->group;
+        }
+    }
+    scan->found[task] = found;
+    scan->foundCount[task] = count;
+}
+
+
+/**
+ * scanMatches()
+ * -----------------------------------------
+ * Filters every record through the dense columns, on several threads
+ * when the table is large: the rows are split between the tasks and each
+ * collects its own matches, which are then appended to matches in task
+ * order. Column rows are not in list order, so the caller sorts the result.
+ *
+ * @return number of matches, or -1 if memory allocation failed
+ */
+static long scanMatches(const RecordFilter *filter, ProgCode group, int tasks) {
+    FilterScan scan;
+    memset(&scan, 0, sizeof(scan));
+    scan.filter = filter;
+    scan.group = group;
+    scan.tasks = tasks;
+
+    scanRun(filterTask, &scan, tasks);
+
+    long total = 0;
+    int failed = 0;
+    for (int t = 0; t < tasks; t++) {
+        failed |= scan.failed[t];
+        total += (long)scan.foundCount[t];
+    }
+    if (!failed && (size_t)total > matchCapacity) {
+        Node **grown = realloc(matches, (size_t)total * sizeof(Node*));
+        if (grown) {
+            matches = grown;
+            matchCapacity = (size_t)total;
+        }
+        else failed = 1;
+    }
+
+    size_t count = 0;
+    for (int t = 0; t < tasks; t++) {
+        if (!failed) {
+            memcpy(matches + count, scan.found[t], scan.foundCount[t] * sizeof(Node*));
+            count += scan.foundCount[t];
+        }
+        free(scan.found[t]);
+    }
+    return failed ? -1 : total;
+}
+
+
+/**
+ * collectMatches()
+ * -----------------------------------------
+ * Gathers the records of a filtered view into matches and puts them in
+ * display order. The chosen index range is seeked to in O(log n) and
+ * walked only as far as it goes, so the cost follows the size of the
+ * range rather than the table. A plain scan of a large table runs on
+ * several threads (see scanMatches()). An index walk that already gives
+ * the requested order is kept (reversed for DESC); anything else is sorted.
+ *
+ * @return number of matches, or -1 if memory allocation failed
+ */
+static long collectMatches(const RecordFilter *filter, const SortKey *keys, int keyCount) {
+    ProgCode group = PROGRAMME_NONE;
+    if (filter->hasProgramme) {
+        group = programmeLookupGroup(filter->programme);
+        if (group == PROGRAMME_NONE) return 0;
+    }
+    if (filter->minId > filter->maxId || !(filter->minMark <= filter->maxMark)) return 0;
+    if (!buildOrders()) return -1;
+
+    ScanPath path = planScan(filter, group);
+    int tasks = path == SCAN_LIST ? scanTasks(idIndex.count) : 1;
+    Node probe = {0};
+    probe.id = filter->minId;
+    probe.mark = filter->minMark;
+    probe.programme = group;
+    probe.seq = 0;
+
+    OrderCursor cursor;
+    Node *node;
+    switch (path) {
+        case SCAN_ID: node = orderSeek(&cursor, &idOrder, &probe, 1); break;
+        case SCAN_MARK: node = orderSeek(&cursor, &markOrder, &probe, 1); break;
+        case SCAN_GROUP: node = orderSeek(&cursor, &groupOrder, &probe, 1); break;
+        default: node = head; break;
+    }
+
+    size_t count = 0;
+    if (tasks > 1) {
+        long found = scanMatches(filter, group, tasks);
+        if (found < 0) return -1;
+        count = (size_t)found;
+        node = NULL;
+    }
+    for (; node && !pastRange(path, filter, group, node);
+         node = path == SCAN_LIST ? node->next : orderNext(&cursor)) {
+        if (!filterMatches(filter, group, node)) continue;
+        if (count == matchCapacity) {
+            size_t capacity = matchCapacity ? matchCapacity * 2 : 1024;
+            Node **grown = realloc(matches, capacity * sizeof(Node*));
+            if (!grown) return -1;
+            matches = grown;
+            matchCapacity = capacity;
+        }
+        matches[count++] = node;
+    }
+
+    int ordered = (keyCount == 0 && path == SCAN_LIST && tasks == 1)
+               || (keyCount == 1 && path == SCAN_ID && keys[0].field == SORT_FIELD_ID)
+               || (keyCount == 1 && path == SCAN_MARK && keys[0].field == SORT_FIELD_MARK);
+    if (!ordered) {
+        if (!sortNodes(matches, count, keys, keyCount)) return -1;
+    }
+    else if (keyCount == 1 && !keys[0].ascending) {
+        for (size_t i = 0, j = count; i + 1 < j; i++, j--) {
+            Node *swap = matches[i];
+            matches[i] = matches[j - 1];
+            matches[j - 1] = swap;
+        }
+    }
+    return (long)count;
+}
+
+
+/**
+ * rowOpen()
+ * -----------------------------------------
+ * Positions a view at its offset-th record. Unsorted views follow the
+ * list, one sort key walks the matching ordered index and several keys
+ * go through the radix sorter. Filtered views collect their matches.
+ *
+ * @return 1 on success, 0 if memory allocation failed
+ */
+static int rowOpen(RowSource *source, const SortKey *keys, int keyCount, const ViewOptions *options) {
+    size_t offset = options->offset;
+    source->total = idIndex.count;
+    source->sorted = NULL;
+    source->index = 0;
+    source->useOrder = 0;
+    source->next = head;
+
+    if (options->where.active) {
+        long count = collectMatches(&options->where, keys, keyCount);
+        if (count < 0) return 0;
+        source->total = (size_t)count;
+        source->sorted = matches;
+        source->index = offset;
+        return 1;
+    }
+    if (keyCount > 1) {
+        source->sorted = sortRecords(head, idIndex.count, keys, keyCount);
+        source->index = offset;
+        return source->sorted != NULL;
+    }
+    if (keyCount == 1) {
+        if (!buildOrders()) return 0;
+        const OrderIndex *order = keys[0].field == SORT_FIELD_ID ? &idOrder : &markOrder;
+        source->useOrder = 1;
+        source->next = orderFirst(&source->cursor, order, keys[0].ascending);
+    }
+    for (size_t i = 0; i < offset && rowNext(source); i++);
+    return 1;
+}
+
+
+/**
+ * showPage()
+ * -----------------------------------------
+ * Prints the records of a view from options->offset on, at most
+ * options->limit of them (0 = no limit). When records are left over on a
+ * limited view the position is kept so NEXT can carry on from it.
+ */
+static void showPage(const SortKey *keys, int keyCount, const ViewOptions *options, RowSource *source) {
+    size_t total = source->total;
+    size_t offset = options->offset;
+    size_t shown = total - offset;
+    if (options->limit && options->limit < shown) shown = options->limit;
+    int paged = options->limit || offset;
+
+    char headerMsg[MAX_LINE + 200];
+    int length;
+    if (paged) {
+        length = snprintf(headerMsg, sizeof(headerMsg), "CMS: Here are records %d-%d of %d",
+                          (int)offset + 1, (int)(offset + shown), (int)total);
+    }
+    else {
+        length = snprintf(headerMsg, sizeof(headerMsg), "CMS: Here are all the records");
+    }
+    if (options->where.active) {
+        length += snprintf(headerMsg + length, sizeof(headerMsg) - length, " with %s", options->where.text);
+        if (length >= (int)sizeof(headerMsg)) length = (int)sizeof(headerMsg) - 1;
+    }
+    if (keyCount == 0) {
+        snprintf(headerMsg + length, sizeof(headerMsg) - length, " found in the table \"StudentRecords\".");
+    }
+    else {
+        length += snprintf(headerMsg + length, sizeof(headerMsg) - length, " sorted by");
+        for (int k = 0; k < keyCount; k++) {
+            length += snprintf(headerMsg + length, sizeof(headerMsg) - length, "%s %s %s",
+                               k ? "," : "",
+                               keys[k].field == SORT_FIELD_ID ? "ID" : "mark",
+                               keys[k].ascending ? "ASC" : "DESC");
+        }
+        snprintf(headerMsg + length, sizeof(headerMsg) - length, " from the table \"StudentRecords\".");
+    }
+
+    // Widths come from the whole table so every page lines up the same
+    TableLayout layout = tableColumns(options->tsv);
+    renderHeader(&layout, headerMsg);
+    for (size_t i = 0; i < shown; i++) renderNode(&layout, rowNext(source));
+    renderFlush();
+
+    page.active = 0;
+    page.ended = options->limit != 0;
+    if (!options->limit || offset + shown >= total) return;
+
+    page.active = 1;
+    page.version = dbVersion;
+    if (keyCount) memcpy(page.keys, keys, keyCount * sizeof(SortKey));
+    page.keyCount = keyCount;
+    page.options = *options;
+    page.options.offset = offset + shown;
+    page.source = *source;
+    size_t left = total - page.options.offset;
+    if (left > options->limit) left = options->limit;
+    outputPrintf("CMS: Type NEXT for the next %d record%s.\n", (int)left, left == 1 ? "" : "s");
+}
+
+
+/**
+ * showView()
+ * -----------------------------------------
+ * Shows all records, optionally ordered by one or more keys (e.g. MARK
+ * DESC then ID ASC) and optionally one page at a time. A single key is an
+ * in-order walk of its ordered index, so nothing is copied or sorted.
+ * Several keys go through the radix sorter. Records that tie on every
+ * key keep insertion order.
+ *
+ * @param keys     - most significant key first
+ * @param keyCount - 0 .. SORT_MAX_KEYS
+ * @param options  - LIMIT / OFFSET / TSV settings
+ */
+void showView(const SortKey *keys, int keyCount, const ViewOptions *options) {
+    page.active = 0;
+    page.ended = 0;
+    if (!head) {
+        outputPrintf("CMS: No records to display.\n");
+        return;
+    }
+
+    RowSource source;
+    if (!rowOpen(&source, keys, keyCount, options)) {
+        outputPrintf("CMS: Memory allocation failed while sorting.\n");
+        return;
+    }
+    if (source.total == 0) {
+        outputPrintf("CMS: No records match WHERE %s.\n", options->where.text);
+        return;
+    }
+    if (options->offset >= source.total) {
+        outputPrintf("CMS: OFFSET %d is past the last record (the %s has %d records).\n",
+                     (int)options->offset, options->where.active ? "result" : "table", (int)source.total);
+        return;
+    }
+    showPage(keys, keyCount, options, &source);
+}
+
+
+/**
+ * showNext()
+ * -----------------------------------------
+ * Prints the page after the last one shown by SHOW ALL ... LIMIT n. The
+ * saved position is reused unless the view needs its sorted array
+ * rebuilt; any change to the records since then ends the paging.
+ *
+ * @return 1 if a page was printed, 0 otherwise
+ */
+int showNext() {
+    if (!page.active) {
+        if (page.ended) outputPrintf("CMS: There are no more records. The last page has already been shown.\n");
+        else outputPrintf("CMS: There is no page to continue. Use SHOW ALL ... LIMIT n first.\n");
+        return 0;
+    }
+    if (page.version != dbVersion) {
+        page.active = 0;
+        page.ended = 0;
+        outputPrintf("CMS: The records have changed since the last page. Please run SHOW ALL again.\n");
+        return 0;
+    }
+
+    PageState current = page;
+    if (current.source.sorted &&
+        !rowOpen(&current.source, current.keys, current.keyCount, &current.options)) {
+        outputPrintf("CMS: Memory allocation failed while sorting.\n");
+        return 0;
+    }
+    showPage(current.keys, current.keyCount, &current.options, &current.source);
+    return 1;
+}
+
+
+// Creates an empty paging position, or returns NULL if memory ran out
+PageState *pageStateNew(void) {
+    return calloc(1, sizeof(PageState));
+}
+
+
+// Exchanges the paging position NEXT continues with another one
+void pageStateSwap(PageState *other) {
+    PageState swap = page;
+    page = *other;
+    *other = swap;
+}
+
+
+void pageStateFree(PageState *state) {
+    free(state);
+}
+
+
+// Forgets a paging position, as a SHOW ALL without LIMIT does
+void pageStateClear(PageState *state) {
+    memset(state, 0, sizeof(PageState));
+}
+
+
+/**
+ * prepareSnapshotRead()
+ * -----------------------------------------
+ * Builds the ordered indexes before the server forks a snapshot reader
+ * for a read-only command. Whatever a reader builds is lost when it
+ * exits, so otherwise every sorted view or summary of a fresh table
+ * would sort the whole table again.
+ */
+void prepareSnapshotRead(void) {
+    buildOrders();      // Out of memory: the reader tries again and reports it
+}
+
+
+/**
+ * findExtremes()
+ * -----------------------------------------
+ * Looks up the lowest and highest marks of the whole table (group is
+ * PROGRAMME_NONE) or of one programme group, from the ends of the
+ * matching ordered index.
+ */
+static void findExtremes(ProgCode group, float *minMark, float *maxMark) {
+    OrderCursor cursor;
+    if (group == PROGRAMME_NONE) {
+        *minMark = orderFirst(&cursor, &markOrder, 1)->mark;
+        *maxMark = orderFirst(&cursor, &markOrder, 0)->mark;
+        return;
+    }
+
+    // Probes sorting before and after every record of the group
+    Node probe = {0};
+    probe.programme = group;
+    probe.mark = -INFINITY;
+    probe.seq = 0;
+    *minMark = orderSeek(&cursor, &groupOrder, &probe, 1)->mark;
+    probe.mark = INFINITY;
+    probe.seq = (unsigned int)-1;
+    *maxMark = orderSeek(&cursor, &groupOrder, &probe, 0)->mark;
+}
+
+
+// Prints, in insertion order, every record of the table or group whose
+// mark equals the given extreme
+static void printMarkHolders(ProgCode group, float mark) {
+    Node probe = {0};
+    probe.programme = group == PROGRAMME_NONE ? 0 : group;
+    probe.mark = mark;
+    probe.seq = 0;
+
+    // Equal marks are ordered by insertion sequence within the index
+    const OrderIndex *order = group == PROGRAMME_NONE ? &markOrder : &groupOrder;
+    OrderCursor cursor;
+    int count = 1;
+    for (Node *node = orderSeek(&cursor, order, &probe, 1); node; node = orderNext(&cursor)) {
+        if (node->mark != mark) break;
+        if (group != PROGRAMME_NONE && programmeGroup(node->programme) != group) break;
+        outputPrintf("%d. %s (ID: %d)\n", count++, nodeName(node), node->id);
+    }
+}
+
+
+// Percentiles listed by SHOW SUMMARY ... PERCENTILES
+static const struct {
+    int level;
+    const char *label;
+} percentileRows[] = {
+    {10, "10th percentile"},
+    {25, "25th percentile"},
+    {50, "Median mark"},
+    {75, "75th percentile"},
+    {90, "90th percentile"},
+};
+
+#define PERCENTILE_ROWS (int)(sizeof(percentileRows) / sizeof(percentileRows[0]))
+
+// Spread of a set of marks
+typedef struct MarkDistribution {
+    double deviation;                       // Population standard deviation
+    double percentiles[PERCENTILE_ROWS];    // Interpolated between the closest ranks
+} MarkDistribution;
+
+
+// One pass over unsorted marks: each task bins its share and sums its
+// squared deviations
+typedef struct StatsScan {
+    const float *values;
+    size_t count;
+    double mean;
+    float low;
+    float scale;
+    int tasks;
+    size_t *counts;                         // PERCENTILE_BINS per task
+    double deviation[SCAN_MAX_TASKS];
+} StatsScan;
+
+
+static void statsTask(void *arg, int task) {
+    StatsScan *scan = arg;
+    size_t first = scanSplit(scan->count, task, scan->tasks);
+    size_t last = scanSplit(scan->count, task + 1, scan->tasks);
+    kernelHistogram(scan->values + first, last - first, scan->low, scan->scale,
+                    PERCENTILE_BINS, scan->counts + (size_t)task * PERCENTILE_BINS);
+    scan->deviation[task] = kernelSquaredDeviation(scan->values + first, last - first, scan->mean);
+}
+
+
+static int compareFloats(const void *a, const void *b) {
+    float x = *(const float*)a, y = *(const float*)b;
+    return (x > y) - (x < y);
+}
+
+
+/**
+ * rankValues()
+ * -----------------------------------------
+ * Finds the values at several ranks of unsorted marks from their
+ * histogram. Bins only ever grow with the value, so the rank-th value
+ * lies in the bin where the running count passes the rank; the values of
+ * just those bins are gathered and sorted.
+ *
+ * @param counts - histogram of values: bins bins of kernelHistogram(low, scale)
+ * @param ranks  - 0-based ranks in ascending order
+ * @return 1 on success, 0 if memory allocation failed, -1 if the gathered
+ *         values disagree with the histogram
+ */
+static int rankValues(const float *values, size_t count, float low, float scale, int bins,
+                      const size_t *counts, const size_t *ranks, int rankCount, float *out) {
+    unsigned char *wanted = calloc((size_t)bins, 1);
+    int *rankBin = malloc((size_t)rankCount * sizeof(int));
+    size_t *below = malloc((size_t)rankCount * sizeof(size_t));
+    if (!wanted || !rankBin || !below) {
+        free(wanted);
+        free(rankBin);
+        free(below);
+        return 0;
+    }
+
+    // The bin of each rank, and how many values lie in lower bins
+    size_t passed = 0, gathered = 0;
+    int bin = 0;
+    for (int r = 0; r < rankCount; r++) {
+        while (passed + counts[bin] <= ranks[r]) passed += counts[bin++];
+        if (!wanted[bin]) gathered += counts[bin];
+        wanted[bin] = 1;
+        rankBin[r] = bin;
+        below[r] = passed;
+    }
+
+    float *picked = malloc((gathered + 1) * sizeof(float));    // The gather kernel stores one past the end
+    int result = picked != NULL;
+    if (picked && kernelGatherBins(values, count, low, scale, bins, wanted, picked) != gathered) result = -1;
+    if (result == 1) {
+        qsort(picked, gathered, sizeof(float), compareFloats);
+
+        // Wanted bins sit in picked in bin order
+        size_t start = 0;
+        int at = 0;
+        for (int r = 0; r < rankCount; r++) {
+            for (; at < rankBin[r]; at++) {
+                if (wanted[at]) start += counts[at];
+            }
+            out[r] = picked[start + ranks[r] - below[r]];
+        }
+    }
+    free(picked);
+    free(wanted);
+    free(rankBin);
+    free(below);
+    return result;
+}
+
+
+/**
+ * markDistribution()
+ * -----------------------------------------
+ * Works out the standard deviation and the percentiles of a set of
+ * marks. Sorted marks are read off at their ranks; unsorted ones (the
+ * table's mark column) take one kernel pass that bins them and sums the
+ * squared deviations, on several threads when there are many, and one
+ * more that gathers the few bins holding the wanted ranks.
+ *
+ * @param values - marks, ascending if sorted is set
+ * @param mean   - their average, from the running totals
+ * @return 1 on success, 0 if memory allocation failed
+ */
+static int markDistribution(const float *values, size_t count, int sorted, double mean,
+                            float minMark, float maxMark, MarkDistribution *out) {
+    size_t ranks[2 * PERCENTILE_ROWS];
+    float ranked[2 * PERCENTILE_ROWS];
+    for (int p = 0; p < PERCENTILE_ROWS; p++) {
+        double position = percentileRows[p].level / 100.0 * (double)(count - 1);
+        ranks[2 * p] = (size_t)position;
+        ranks[2 * p + 1] = ranks[2 * p] + 1 < count ? ranks[2 * p] + 1 : ranks[2 * p];
+    }
+
+    double squares = 0.0;
+    if (sorted) {
+        squares = kernelSquaredDeviation(values, count, mean);
+        for (int r = 0; r < 2 * PERCENTILE_ROWS; r++) ranked[r] = values[ranks[r]];
+    } else {
+        StatsScan scan;
+        memset(&scan, 0, sizeof(scan));
+        scan.values = values;
+        scan.count = count;
+        scan.mean = mean;
+        scan.low = minMark;
+        scan.scale = maxMark > minMark ? (float)(PERCENTILE_BINS / ((double)maxMark - minMark)) : 0.0f;
+        scan.tasks = scanTasks(count);
+        scan.counts = calloc((size_t)scan.tasks * PERCENTILE_BINS, sizeof(size_t));
+        if (!scan.counts) return 0;
+
+        scanRun(statsTask, &scan, scan.tasks);
+        for (int t = 0; t < scan.tasks; t++) {
+            squares += scan.deviation[t];
+            if (t == 0) continue;
+            for (int b = 0; b < PERCENTILE_BINS; b++) scan.counts[b] += scan.counts[(size_t)t * PERCENTILE_BINS + b];
+        }
+
+        int found = rankValues(values, count, scan.low, scan.scale, PERCENTILE_BINS,
+                               scan.counts, ranks, 2 * PERCENTILE_ROWS, ranked);
+        if (found < 0) {
+            // Should never happen; gather everything as one bin instead
+            size_t all = count;
+            found = rankValues(values, count, scan.low, 0.0f, 1, &all, ranks, 2 * PERCENTILE_ROWS, ranked);
+        }
+        free(scan.counts);
+        if (found != 1) return 0;
+    }
+
+    out->deviation = sqrt(squares / (double)count);
+    for (int p = 0; p < PERCENTILE_ROWS; p++) {
+        double position = percentileRows[p].level / 100.0 * (double)(count - 1);
+        double fraction = position - (double)ranks[2 * p];
+        out->percentiles[p] = ranked[2 * p] + ((double)ranked[2 * p + 1] - ranked[2 * p]) * fraction;
+    }
+    return 1;
+}
+
+
+/**
+ * printDistribution()
+ * -----------------------------------------
+ * Prints the standard deviation and percentiles of the whole table
+ * (group is PROGRAMME_NONE) or of one programme group. The table's marks
+ * come straight from the mark column; a group's are read in order from
+ * its range of groupOrder.
+ *
+ * @return 1 on success, 0 if memory allocation failed
+ */
+static int printDistribution(ProgCode group, const SummaryStats *stats, float minMark, float maxMark) {
+    MarkDistribution spread;
+    double mean = stats->sum / stats->count;
+    int ok;
+    if (group == PROGRAMME_NONE) {
+        ok = markDistribution(columns.marks, columns.count, 0, mean, minMark, maxMark, &spread);
+    } else {
+        float *marks = malloc(stats->count * sizeof(float));
+        if (!marks) return 0;
+
+        Node probe = {0};
+        probe.programme = group;
+        probe.mark = -INFINITY;
+        probe.seq = 0;
+        OrderCursor cursor;
+        size_t count = 0;
+        for (Node *node = orderSeek(&cursor, &groupOrder, &probe, 1); node && count < stats->count;
+             node = orderNext(&cursor)) {
+            marks[count++] = node->mark;
+        }
+        ok = markDistribution(marks, count, 1, mean, minMark, maxMark, &spread);
+        free(marks);
+    }
+    if (!ok) return 0;
+
+    outputPrintf("\nStandard deviation: %.2f\n", spread.deviation);
+    for (int p = 0; p < PERCENTILE_ROWS; p++) {
+        outputPrintf("%s: %.2f\n", percentileRows[p].label, spread.percentiles[p]);
+    }
+    return 1;
+}
+
+
+// Compute and display statistics such as: total count,
+// average score, highest and lowest marks (with names).
+// Counts and totals are maintained as records change and the extremes
+// come from the ordered indexes, so only the output costs time.
+// With percentiles set, the standard deviation and percentiles follow.
+void showSummary(const char *programmeFilter, int percentiles) {
+    if (!head) {
+        outputPrintf("CMS: No records to display.\n");
+        return;
+    }
+
+    // Resolve the filter to its programme group once; rows then compare
+    // 2-byte codes instead of strings
+    ProgCode group = programmeFilter ? programmeLookupGroup(programmeFilter) : PROGRAMME_NONE;
+    if (programmeFilter && group == PROGRAMME_NONE) {
+        outputPrintf("CMS: No matching records found for programme '%s'.\n", programmeFilter);
+        return;
+    }
+
+    const SummaryStats *stats = programmeFilter ? &groupStats[group] : &tableStats;
+    if (stats->count == 0) {
+        if (programmeFilter)
+            outputPrintf("CMS: No matching records found for programme '%s'.\n", programmeFilter);
+        else
+            outputPrintf("CMS: No records found.\n");
+        return;
+    }
+    if (!buildOrders()) {
+        outputPrintf("CMS: Memory allocation failed while summarising.\n");
+        return;
+    }
+
+    float maxMark, minMark;
+    findExtremes(group, &minMark, &maxMark);
+
+    outputPrintf("CMS: Here are summary statistics from the table \"StudentRecords\"");
+    if (programmeFilter) outputPrintf(" (Programme: %s)", programmeFilter);
+    outputPrintf(".\n");
+
+    outputPrintf("Total students: %d\n", (int)stats->count);
+
+    outputPrintf("Average mark: %.2f\n", stats->sum / stats->count);
+
+    // Print highest mark students
+    outputPrintf("\nHighest mark: %.1f\n", maxMark);
+    printMarkHolders(group, maxMark);
+    
+    // Print lowest mark students
+    outputPrintf("\nLowest mark: %.1f\n", minMark);
+    printMarkHolders(group, minMark);
+
+    if (percentiles && !printDistribution(group, stats, minMark, maxMark)) {
+        outputPrintf("CMS: Memory allocation failed while computing percentiles.\n");
+    }
+}
+
+
+// Orders programme groups by name for SHOW SUMMARY BY PROGRAMME
+static int compareGroupNames(const void *a, const void *b) {
+    return strcasecmp(programmeName(*(const ProgCode*)a), programmeName(*(const ProgCode*)b));
+}
+
+
+// Shows count, average, highest and lowest mark of every programme group
+// in one table, followed by the totals for the whole table
+void showSummaryByProgramme() {
+    if (!head) {
+        outputPrintf("CMS: No records to display.\n");
+        return;
+    }
+    if (!buildOrders()) {
+        outputPrintf("CMS: Memory allocation failed while summarising.\n");
+        return;
+    }
+
+    // Collect the groups that currently have records
+    size_t codes = programmeCount(), groups = 0;
+    ProgCode *list = malloc((codes ? codes : 1) * sizeof(ProgCode));
+    if (!list) {
+        outputPrintf("CMS: Memory allocation failed while summarising.\n");
+        return;
+    }
+    int width = 14;     // Fits the "All programmes" row
+    for (size_t code = 0; code < codes; code++) {
+        if (groupStats[code].count == 0) continue;
+        list[groups++] = (ProgCode)code;
+        int length = (int)programmeLength((ProgCode)code);
+        if (length > width) width = length;
+    }
+    if (width > PROG_WIDTH) width = PROG_WIDTH;
+    qsort(list, groups, sizeof(ProgCode), compareGroupNames);
+
+    outputPrintf("CMS: Here are summary statistics by programme from the table \"StudentRecords\".\n");
+    outputPrintf("%-*s %8s %8s %8s %8s\n", width, "Programme", "Students", "Average", "Highest", "Lowest");
+    for (size_t i = 0; i < groups; i++) {
+        float minMark, maxMark;
+        const SummaryStats *stats = &groupStats[list[i]];
+        findExtremes(list[i], &minMark, &maxMark);
+        outputPrintf("%-*.*s %8d %8.2f %8.1f %8.1f\n", width, PROG_WIDTH, programmeName(list[i]),
+                     (int)stats->count, stats->sum / stats->count, maxMark, minMark);
+    }
+
+    float minMark, maxMark;
+    findExtremes(PROGRAMME_NONE, &minMark, &maxMark);
+    outputPrintf("%-*s %8d %8.2f %8.1f %8.1f\n", width, "All programmes",
+                 (int)tableStats.count, tableStats.sum / tableStats.count, maxMark, minMark);
+    free(list);
+}
+
+
+// A SHOW TOP / SHOW BOTTOM request
+typedef struct RankedView {
+    int highest;                // TOP: highest first; BOTTOM: lowest first
+    SortField field;
+    ProgCode group;             // PROGRAMME_NONE for the whole table
+} RankedView;
+
+
+// Whether a ranks ahead of b. Equal marks go by insertion order, as
+// SHOW SUMMARY lists them; IDs never tie.
+static int ranksAhead(const RankedView *view, const Node *a, const Node *b) {
+    if (view->field == SORT_FIELD_ID) return view->highest ? a->id > b->id : a->id < b->id;
+    if (a->mark != b->mark) return view->highest ? a->mark > b->mark : a->mark < b->mark;
+    return a->seq < b->seq;
+}
+
+
+// Restores the heap below slot, whose root is the record ranked last
+static void rankSiftDown(const RankedView *view, Node **heap, size_t count, size_t slot) {
+    while (1) {
+        size_t child = slot * 2 + 1;
+        if (child >= count) return;
+        if (child + 1 < count && ranksAhead(view, heap[child], heap[child + 1])) child++;
+        if (!ranksAhead(view, heap[slot], heap[child])) return;
+        Node *swap = heap[slot];
+        heap[slot] = heap[child];
+        heap[child] = swap;
+        slot = child;
+    }
+}
+
+
+static void rankSiftUp(const RankedView *view, Node **heap, size_t slot) {
+    while (slot > 0) {
+        size_t parent = (slot - 1) / 2;
+        if (!ranksAhead(view, heap[parent], heap[slot])) return;
+        Node *swap = heap[slot];
+        heap[slot] = heap[parent];
+        heap[parent] = swap;
+        slot = parent;
+    }
+}
+
+
+// Orders tied records by insertion sequence
+static int compareSeq(const void *a, const void *b) {
+    unsigned int x = (*(Node* const*)a)->seq, y = (*(Node* const*)b)->seq;
+    return (x > y) - (x < y);
+}
+
+
+// Appends a record to a growable row array; 0 if out of memory
+static int appendRow(Node ***rows, size_t *count, size_t *capacity, Node *node) {
+    if (*count == *capacity) {
+        size_t grown = *capacity ? *capacity * 2 : 16;
+        Node **bigger = realloc(*rows, grown * sizeof(Node*));
+        if (!bigger) return 0;
+        *rows = bigger;
+        *capacity = grown;
+    }
+    (*rows)[(*count)++] = node;
+    return 1;
+}
+
+
+/**
+ * rankByHeap()
+ * -----------------------------------------
+ * One pass over the ID/mark columns keeping the best `wanted` records in a
+ * heap whose root is the one ranked last, so most records are turned away
+ * by comparing their mark or ID with the root's. Records turned away with
+ * the root's mark, and roots pushed out by a record with that same mark,
+ * are kept as ties; they are forgotten once the root's mark moves on.
+ *
+ * @param rows - receives the heap (best first) followed by the ties; it
+ *               has room for `wanted` records and grows for ties
+ * @return the number of rows, or -1 if out of memory
+ */
+static long rankByHeap(const RankedView *view, size_t wanted, Node ***rows, size_t *capacity) {
+    Node **heap = *rows;
+    size_t count = 0;
+    Node **ties = NULL;
+    size_t tieCount = 0, tieCapacity = 0;
+    int byMark = view->field == SORT_FIELD_MARK;
+
+    for (size_t i = 0; i < columns.count; i++) {
+        if (count == wanted) {
+            const Node *root = heap[0];
+            // Clearly behind the root: no need to look at the record
+            if (byMark ? (view->highest ? columns.marks[i] < root->mark : columns.marks[i] > root->mark)
+                       : (view->highest ? columns.ids[i] < root->id : columns.ids[i] > root->id)) {
+                continue;
+            }
+        }
+        Node *node = columns.nodes[i];
+        if (view->group != PROGRAMME_NONE && programmeGroup(node->programme) != view->group) continue;
+
+        if (count < wanted) {
+            heap[count++] = node;
+            rankSiftUp(view, heap, count - 1);
+            continue;
+        }
+        Node *root = heap[0];
+        if (!ranksAhead(view, node, root)) {
+            // Level with the root on mark but later in insertion order
+            if (byMark && node->mark == root->mark && !appendRow(&ties, &tieCount, &tieCapacity, node)) {
+                free(ties);
+                return -1;
+            }
+            continue;
+        }
+        heap[0] = node;
+        rankSiftDown(view, heap, count, 0);
+        if (byMark && root->mark == heap[0]->mark) {
+            if (!appendRow(&ties, &tieCount, &tieCapacity, root)) {
+                free(ties);
+                return -1;
+            }
+        }
+        else {
+            tieCount = 0;       // The last place moved to a better mark
+        }
+    }
+
+    // Pop the root to the end until the heap is sorted best first
+    for (size_t end = count; end > 1; end--) {
+        Node *swap = heap[0];
+        heap[0] = heap[end - 1];
+        heap[end - 1] = swap;
+        rankSiftDown(view, heap, end - 1, 0);
+    }
+
+    if (tieCount > 0) {
+        qsort(ties, tieCount, sizeof(Node*), compareSeq);
+        Node **grown = realloc(*rows, (count + tieCount) * sizeof(Node*));
+        if (!grown) {
+            free(ties);
+            return -1;
+        }
+        memcpy(grown + count, ties, tieCount * sizeof(Node*));
+        *rows = grown;
+        *capacity = count + tieCount;
+    }
+    free(ties);
+    return (long)(count + tieCount);
+}
+
+
+/**
+ * rankByIndex()
+ * -----------------------------------------
+ * Reads the rows off the end of an ordered index that is already built:
+ * the first `wanted` records, then any more with the same mark as the
+ * last of them. A descending walk meets equal marks latest first, so
+ * each run of equal marks is turned round afterwards.
+ *
+ * @return the number of rows, or -1 if out of memory
+ */
+static long rankByIndex(const RankedView *view, size_t wanted, Node ***rows, size_t *capacity) {
+    OrderCursor cursor;
+    Node *node;
+    if (view->group == PROGRAMME_NONE) {
+        node = orderFirst(&cursor, view->field == SORT_FIELD_ID ? &idOrder : &markOrder, !view->highest);
+    }
+    else {
+        // Probe sorting before (or after) every record of the group
+        Node probe = {0};
+        probe.programme = view->group;
+        probe.mark = view->highest ? INFINITY : -INFINITY;
+        probe.seq = view->highest ? (unsigned int)-1 : 0;
+        node = orderSeek(&cursor, &groupOrder, &probe, !view->highest);
+    }
+
+    size_t count = 0;
+    for (; node; node = orderNext(&cursor)) {
+        if (view->group != PROGRAMME_NONE && programmeGroup(node->programme) != view->group) break;
+        if (count >= wanted && (view->field == SORT_FIELD_ID || node->mark != (*rows)[count - 1]->mark)) break;
+        if (!appendRow(rows, &count, capacity, node)) return -1;
+    }
+
+    if (view->field == SORT_FIELD_MARK && view->highest) {
+        for (size_t start = 0; start < count; ) {
+            size_t end = start + 1;
+            while (end < count && (*rows)[end]->mark == (*rows)[start]->mark) end++;
+            for (size_t a = start, b = end - 1; a < b; a++, b--) {
+                Node *swap = (*rows)[a];
+                (*rows)[a] = (*rows)[b];
+                (*rows)[b] = swap;
+            }
+            start = end;
+        }
+    }
+    return (long)count;
+}
+
+
+/**
+ * showRanked()
+ * -----------------------------------------
+ * Prints the n records with the highest (SHOW TOP) or lowest (SHOW
+ * BOTTOM) mark or ID, optionally within one programme. Records tied on
+ * mark with the last place are all listed, in insertion order, the way
+ * SHOW SUMMARY lists the holders of a mark. An ordered index that is
+ * already built answers directly; otherwise a heap of n records is kept
+ * over one pass of the ID/mark columns, with no full sort.
+ *
+ * @param highest - 1 for SHOW TOP, 0 for SHOW BOTTOM
+ * @param count   - records wanted (at least 1)
+ * @param field   - SORT_FIELD_MARK or SORT_FIELD_ID
+ */
+void showRanked(int highest, size_t count, SortField field, const char *programmeFilter) {
+    RankedView view = { highest, field, PROGRAMME_NONE };
+    if (programmeFilter) {
+        view.group = programmeLookupGroup(programmeFilter);
+        if (view.group == PROGRAMME_NONE || groupStats[view.group].count == 0) {
+            outputPrintf("CMS: No matching records found for programme '%s'.\n", programmeFilter);
+            return;
+        }
+    }
+    size_t available = programmeFilter ? groupStats[view.group].count : tableStats.count;
+    if (available == 0) {
+        outputPrintf("CMS: No records to display.\n");
+        return;
+    }
+    size_t wanted = count < available ? count : available;
+
+    size_t capacity = wanted;
+    Node **rows = malloc(capacity * sizeof(Node*));
+    long rowCount = -1;
+    if (rows) {
+        // The ID index cannot pick out one programme, so that case scans
+        int indexed = ordersBuilt && (field == SORT_FIELD_MARK || view.group == PROGRAMME_NONE);
+        rowCount = indexed ? rankByIndex(&view, wanted, &rows, &capacity)
+                           : rankByHeap(&view, wanted, &rows, &capacity);
+    }
+    if (rowCount < 0) {
+        free(rows);
+        outputPrintf("CMS: Memory allocation failed while ranking the records.\n");
+        return;
+    }
+
+    char headerMsg[MAX_LINE + 200];
+    int length = snprintf(headerMsg, sizeof(headerMsg), "CMS: Here are the %s %d records by %s from the table \"StudentRecords\"",
+                          highest ? "top" : "bottom", (int)wanted, field == SORT_FIELD_ID ? "ID" : "mark");
+    if (programmeFilter) length += snprintf(headerMsg + length, sizeof(headerMsg) - length, " (Programme: %s)", programmeFilter);
+    if (length < (int)sizeof(headerMsg)) snprintf(headerMsg + length, sizeof(headerMsg) - length, ".");
+
+    int maxName = 4, maxProg = 9;
+    for (long i = 0; i < rowCount; i++) {
+        int progLength = (int)programmeLength(rows[i]->programme);
+        if (rows[i]->nameLength > maxName) maxName = rows[i]->nameLength;
+        if (progLength > maxProg) maxProg = progLength;
+    }
+    TableLayout layout = layoutFor(maxName, maxProg, 0);
+    renderHeader(&layout, headerMsg);
+    for (long i = 0; i < rowCount; i++) renderNode(&layout, rows[i]);
+    renderFlush();
+
+    long tied = rowCount - (long)wanted;
+    if (tied > 0) {
+        outputPrintf("CMS: %ld more record%s tied on the last mark (%.1f) %s listed as well.\n",
+                     tied, tied == 1 ? "" : "s", rows[rowCount - 1]->mark, tied == 1 ? "is" : "are");
+    }
+    free(rows);
+}
+
+
+// Height of an ordered index, 0 while it is empty
+static int orderHeight(const OrderIndex *index) {
+    return index->root ? index->root->orderHeight[index->slot] : 0;
+}
+
+
+/**
+ * showStats()
+ * -----------------------------------------
+ * Prints the health of the in-memory table for SHOW STATS and the stats
+ * dump file: memory per structure and per record, ID index load and
+ * probe lengths, ordered index heights, undo/redo history, and the
+ * command latency table.
+ */
+void showStats(void) {
+    size_t records = idIndex.count;
+    size_t nodeBytes = poolBytesReserved(&nodePool);
+    size_t indexBytes = idIndex.capacity * sizeof(IndexSlot);
+    size_t columnBytes = columns.capacity * (sizeof(int) + sizeof(float) + sizeof(Node*));
+    size_t programmeTotal = programmeBytes();
+    size_t total = nodeBytes + namePool.capacity + indexBytes + columnBytes + programmeTotal;
+
+    renderFlush();
+    outputPrintf("CMS: Here are the runtime statistics of the table \"StudentRecords\".\n");
+    outputPrintf("Records: %d\n", (int)records);
+    if (lazyOpen) {
+        outputPrintf("Lazy open: %d records served from the mapped file (%.2f MB) and offset index (%.2f MB), %d journal changes in memory\n",
+                     (int)lazyRecords, lazyIndex.text.size / 1048576.0,
+                     lazyIndex.count * sizeof(uint64_t) / 1048576.0, (int)lazyChangeCount);
+    }
+    if (shardsOpen) {
+        int loaded = 0, dirty = 0;
+        for (size_t i = 0; i < shardSet.count; i++) {
+            loaded += shardSet.shards[i].loaded;
+            dirty += shardSet.shards[i].dirty;
+        }
+        outputPrintf("Shards: %d of %d IDs each, %d loaded, %d with unsaved changes\n",
+                     (int)shardSet.count, shardSet.span, loaded, dirty);
+    }
+    outputPrintf("Memory: %.2f MB, %.1f bytes per record\n",
+                 total / 1048576.0, records ? (double)total / records : 0.0);
+    outputPrintf("  Record nodes: %.2f MB (%d in use)\n", nodeBytes / 1048576.0, (int)nodePool.inUse);
+    outputPrintf("  Names: %.2f MB (%.2f MB used, %.2f MB released)\n",
+                 namePool.capacity / 1048576.0, namePool.used / 1048576.0, namePool.garbage / 1048576.0);
+    outputPrintf("  ID index: %.2f MB\n", indexBytes / 1048576.0);
+    outputPrintf("  ID/mark columns: %.2f MB\n", columnBytes / 1048576.0);
+    outputPrintf("  Programmes: %.1f KB (%d codes)\n", programmeTotal / 1024.0, (int)programmeCount());
+
+    IndexProbeStats probes;
+    indexProbeStats(&idIndex, &probes);
+    outputPrintf("ID index: %d of %d slots used, load factor %.2f (grows above %.2f)\n",
+                 (int)idIndex.count, (int)idIndex.capacity,
+                 idIndex.capacity ? (double)idIndex.count / idIndex.capacity : 0.0, INDEX_MAX_LOAD_PCT / 100.0);
+    outputPrintf("  Probe length: %.2f on average, %d at most\n", probes.average, (int)probes.longest);
+
+    if (ordersBuilt) {
+        outputPrintf("Ordered indexes: height %d (ID), %d (mark), %d (programme)\n",
+                     orderHeight(&idOrder), orderHeight(&markOrder), orderHeight(&groupOrder));
+    }
+    else {
+        outputPrintf("Ordered indexes: not built yet (built by the first sorted or filtered view)\n");
+    }
+    if (nameOrderBuilt) outputPrintf("Name index: height %d\n", orderHeight(&nameOrder));
+    else outputPrintf("Name index: not built yet (built by the first QUERY NAME=)\n");
+
+    size_t redoDepth = 0;
+    for (const Action *action = redoStack; action; action = action->next) redoDepth++;
+    outputPrintf("Undo history: %d undo and %d redo steps, %.2f MB (limits %d steps, %d MB)\n",
+                 (int)undoDepth, (int)redoDepth, historyBytes / 1048576.0,
+                 UNDO_MAX_ACTIONS, (int)(UNDO_MAX_BYTES / (1024 * 1024)));
+    outputPrintf("  Action pool: %.2f MB reserved\n", poolBytesReserved(&actionPool) / 1048576.0);
+
+    if (asyncRunning) outputPrintf("Background save: running\n");
+    else if (!lastSaveKnown) outputPrintf("Background save: none yet\n");
+    else if (lastSave.ok) {
+        outputPrintf("Background save: last one finished in %.3f seconds (%d records)\n",
+                     lastSave.seconds, (int)lastSave.records);
+    }
+    else outputPrintf("Background save: last one failed (%s)\n", lastSave.error);
+    if (!autosaveChanges && !autosaveSeconds) outputPrintf("  Autosave: off\n");
+    else {
+        char rule[96];
+        describeAutosave(rule, sizeof(rule));
+        outputPrintf("  Autosave: %s\n", rule);
+    }
+
+    outputPrintf("\n");
+    statsPrint();
+}
+
+
+// Inserts a new student record into both the linked list and ID index.
+// If the operation is user-initiated (not from undo/redo), it is recorded
+// for reversal and user feedback is displayed.
+int insertDB(int newID, const char *newName, const char *newProgramme, float newMark, int isUndoRedo) {
+    // Prevent duplicate records
+    if (findNode(newID)) {
+        if (!isUndoRedo) outputPrintf("CMS: Record with ID=%d already exists.\n", newID);
+        return 0;
+    }
+
+    // Add to the ID index and the tail of the linked list
+    Node *newNode = addRecord(newID, newName ? newName : "", newProgramme ? newProgramme : "", newMark);
+    if (!newNode) {
+        outputPrintf("CMS: Memory allocation failed.\n");
+        return 0;
+    }
+    journalChange(JOURNAL_UPSERT, newNode);
+
+    // Record action for undo stack 
+    if (!isUndoRedo) {
+        Action *action = newAction(INSERT_OP, newID);
+        if (action && (action->newName = copyName(newNode)) != NULL) {
+            action->newProgramme = newNode->programme;
+            action->newMark = newNode->mark;
+            pushUndo(action);
+        }
+        else if (action) poolFree(&actionPool, action);
+        outputPrintf("CMS: Record with ID=%d inserted.\n", newID);
+    }
+
+    markModified();
+    return 1;
+}
+
+
+// ===============================
+// ID-Range Shards
+// ===============================
+
+// Marks the shard of a changed record to be written by the next SAVE
+static void markShardChanged(int id) {
+    Shard *shard = shardAdd(&shardSet, shardKeyOf(&shardSet, id));
+    if (shard) shard->dirty = 1;
+    else outputPrintf("CMS: Memory allocation failed. The change to ID=%d cannot be saved.\n", id);
+}
+
+
+// Marks every shard to be written (after the table was swapped wholesale)
+static void markAllShards(void) {
+    for (size_t i = 0; i < shardSet.count; i++) shardSet.shards[i].dirty = 1;
+}
+
+
+/**
+ * readShardFile()
+ * -----------------------------------------
+ * Adds the records of one shard file to the table. Lines whose ID is
+ * outside the shard's range are skipped, so that a record can only ever
+ * be loaded from the shard it is saved to.
+ *
+ * @param path - the shard's file or its backup; a missing file is an
+ *               empty shard
+ * @return the records added, or -1 if memory ran out
+ */
+static long readShardFile(Shard *shard, const char *path) {
+    shard->loaded = 1;
+    FILE *file = fopen(path, "rb");
+    if (!file) return 0;
+    if (shard->records > 0) indexReserve(&idIndex, idIndex.count + (size_t)shard->records);
+
+    long records = 0, skipped = 0;
+    long long bytesRead = 0;
+    loadingShard = shard;
+    int complete = readRecordFile(file, &records, &skipped, &bytesRead);
+    loadingShard = NULL;
+    fclose(file);
+
+    if (skipped > LOAD_MAX_DIAGNOSTICS) {
+        outputPrintf("CMS: %ld further malformed lines were skipped.\n", skipped - LOAD_MAX_DIAGNOSTICS);
+    }
+    if (!complete) {
+        outputPrintf("CMS: Memory allocation failed during load.\n");
+        return -1;
+    }
+    dbVersion++;
+    return records;
+}
+
+
+// Loads the shard an ID belongs to, if it is not in memory yet
+static int loadShardOf(int id) {
+    Shard *shard = shardsOpen ? shardFind(&shardSet, shardKeyOf(&shardSet, id)) : NULL;
+    if (!shard || shard->loaded) return 1;
+
+    char path[SHARD_PATH_MAX];
+    shardPath(shard->key, ".txt", path, sizeof(path));
+    double started = timerNow();
+    long records = readShardFile(shard, path);
+    if (records < 0) return 0;
+    outputPrintf("CMS: Loaded shard \"P4_1-CMS-%d.txt\" (%ld records in %.3f s).\n",
+                 shard->key, records, timerNow() - started);
+    return 1;
+}
+
+
+// Loads every shard that is not in memory yet, in ID order
+static int loadAllShards(void) {
+    double started = timerNow();
+    int loaded = 0;
+    long records = 0;
+    for (size_t i = 0; i < shardSet.count; i++) {
+        Shard *shard = &shardSet.shards[i];
+        if (shard->loaded) continue;
+
+        char path[SHARD_PATH_MAX];
+        shardPath(shard->key, ".txt", path, sizeof(path));
+        long added = readShardFile(shard, path);
+        if (added < 0) return 0;
+        records += added;
+        loaded++;
+    }
+    if (loaded > 0) {
+        outputPrintf("CMS: Loaded %d shard%s (%ld records in %.3f s).\n",
+                     loaded, loaded == 1 ? "" : "s", records, timerNow() - started);
+    }
+    return 1;
+}
+
+
+/**
+ * openShards()
+ * -----------------------------------------
+ * Opens a sharded table from its manifest. No shard is read yet: each is
+ * loaded when a command first needs it.
+ *
+ * @return 1 if the table is open, 0 if the manifest is damaged, -1 if
+ *         the table is not sharded
+ */
+static int openShards(void) {
+    int status = shardManifestRead(&shardSet, DB_SHARD_MANIFEST_PATH);
+    if (status == 0) return -1;
+    if (status < 0) {
+        outputPrintf("CMS: The shard list \"P4_1-CMS.shards\" is damaged or unreadable.\n");
+        return 0;
+    }
+
+    long records = 0;
+    for (size_t i = 0; i < shardSet.count; i++) records += shardSet.shards[i].records;
+    shardsOpen = 1;
+    dbLoaded = 1;
+    outputPrintf("CMS: The sharded database \"P4_1-CMS\" is successfully opened (%d shard%s, %ld records, %d IDs per shard).\n",
+                 (int)shardSet.count, shardSet.count == 1 ? "" : "s", records, shardSet.span);
+    outputPrintf("CMS: Each shard is loaded when a command first needs it.\n");
+    return 1;
+}
+
+
+/**
+ * writeShard()
+ * -----------------------------------------
+ * Writes one shard's records as its text file: a synced temp file renamed
+ * into place, with the old file kept as the shard's backup.
+ */
+static int writeShard(const Shard *shard, Node **nodes, size_t count) {
+    char path[SHARD_PATH_MAX], tempPath[SHARD_PATH_MAX], backupPath[SHARD_PATH_MAX];
+    shardPath(shard->key, ".txt", path, sizeof(path));
+    shardPath(shard->key, ".tmp", tempPath, sizeof(tempPath));
+    shardPath(shard->key, ".bak", backupPath, sizeof(backupPath));
+
+    char *buffer = malloc(SAVE_WRITE_CHUNK + RENDER_LINE_MAX);
+    FILE *file = buffer ? fopen(tempPath, "w") : NULL;
+    if (!file) {
+        free(buffer);
+        return 0;
+    }
+
+    int written = fputs(DB_TEXT_HEADER, file) >= 0;
+    char *end = buffer;
+    for (size_t i = 0; i < count && written; i++) {
+        const Node *node = nodes[i];
+        end = renderTsvLine(end, node->id, nodeName(node), node->nameLength,
+                            nodeProgramme(node), programmeLength(node->programme), node->mark);
+        if ((size_t)(end - buffer) >= SAVE_WRITE_CHUNK || i + 1 == count) {
+            written = fwrite(buffer, 1, (size_t)(end - buffer), file) == (size_t)(end - buffer);
+            end = buffer;
+        }
+    }
+    free(buffer);
+
+    if (!fileSync(file)) written = 0;
+    if (fclose(file) != 0) written = 0;
+    if (written && !fileExists(path)) remove(backupPath);  // Not this shard's previous version
+    if (!written || !fileReplace(tempPath, path, backupPath)) {
+        remove(tempPath);
+        return 0;
+    }
+    return 1;
+}
+
+
+/**
+ * saveShards()
+ * -----------------------------------------
+ * Writes the shards changed since they were last written, then the
+ * manifest. The records of those shards are gathered in one pass over the
+ * list, keeping list order within each shard; clean shards are not read
+ * or written at all.
+ *
+ * @return the number of shards written, or -1 if any could not be
+ */
+static int saveShards(void) {
+    size_t count = shardSet.count;
+    size_t *first = calloc(count + 1, sizeof(size_t));
+    Node **nodes = malloc((idIndex.count ? idIndex.count : 1) * sizeof(Node*));
+    if (!first || !nodes) {
+        free(first);
+        free(nodes);
+        outputPrintf("CMS: Memory allocation failed. The database was not saved.\n");
+        return -1;
+    }
+
+    // Count the records of each dirty shard, then place them by shard
+    for (int pass = 0; pass < 2; pass++) {
+        int lastKey = 0;
+        Shard *shard = NULL;
+        for (Node *node = head; node; node = node->next) {
+            int key = shardKeyOf(&shardSet, node->id);
+            if (!shard || key != lastKey) {
+                shard = shardFind(&shardSet, key);
+                lastKey = key;
+            }
+            if (!shard || !shard->dirty || !shard->loaded) continue;
+            size_t slot = (size_t)(shard - shardSet.shards);
+            if (pass == 0) first[slot + 1]++;
+            else nodes[first[slot]++] = node;
+        }
+        if (pass == 0) {
+            for (size_t i = 0; i < count; i++) first[i + 1] += first[i];
+        }
+        else {
+            for (size_t i = count; i > 0; i--) first[i] = first[i - 1];    // Back to each shard's start
+            first[0] = 0;
+        }
+    }
+
+    // A shard written for the first time is listed before its file exists,
+    // so that it is never missing from the manifest
+    int unlisted = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (shardSet.shards[i].dirty && shardSet.shards[i].generation == 0) unlisted = 1;
+    }
+    int ok = !unlisted || shardManifestWrite(&shardSet, DB_SHARD_MANIFEST_PATH);
+
+    long generation = shardSet.generation + 1;
+    int written = 0;
+    for (size_t i = 0; ok && i < count; i++) {
+        Shard *shard = &shardSet.shards[i];
+        if (!shard->dirty || !shard->loaded) continue;
+        size_t records = first[i + 1] - first[i];
+        if (!writeShard(shard, nodes + first[i], records)) {
+            outputPrintf("CMS: Error saving shard \"P4_1-CMS-%d.txt\".\n", shard->key);
+            ok = 0;
+            break;
+        }
+        shard->generation = generation;
+        shard->records = (long)records;
+        shard->dirty = 0;
+        written++;
+    }
+    free(first);
+    free(nodes);
+
+    if (written > 0) shardSet.generation = generation;
+    if ((written > 0 || !ok) && !shardManifestWrite(&shardSet, DB_SHARD_MANIFEST_PATH)) {
+        outputPrintf("CMS: Error saving the shard list \"P4_1-CMS.shards\".\n");
+        ok = 0;
+    }
+    return ok ? written : -1;
+}
+
+
+/**
+ * shardDB()
+ * -----------------------------------------
+ * Splits the loaded table by ID range into shard files (SHARD). From then
+ * on OPEN reads the manifest instead of P4_1-CMS.txt, which is left as it
+ * was; its journal's unsaved entries are in the shards and are dropped.
+ *
+ * @return 1 if the table is sharded afterwards, 0 otherwise
+ */
+int shardDB(void) {
+    if (shardsOpen) {
+        outputPrintf("CMS: The table is already sharded (%d IDs per shard).\n", shardSet.span);
+        return 1;
+    }
+    finishBackgroundSave(1);
+
+    shardSet.span = SHARD_ID_SPAN;
+    for (Node *node = head; node; node = node->next) {
+        Shard *shard = shardAdd(&shardSet, shardKeyOf(&shardSet, node->id));
+        if (!shard) {
+            shardSetFree(&shardSet);
+            outputPrintf("CMS: Memory allocation failed. The table was not sharded.\n");
+            return 0;
+        }
+        shard->dirty = 1;
+    }
+
+    shardsOpen = 1;
+    if (saveShards() < 0) {
+        shardsOpen = 0;
+        shardSetFree(&shardSet);
+        remove(DB_SHARD_MANIFEST_PATH);     // OPEN keeps reading P4_1-CMS.txt
+        return 0;
+    }
+    journalClose();
+    dbModified = 0;
+    changesSinceSave = 0;
+    outputPrintf("CMS: Split %d records into %d shard file%s by ID range (%d IDs per shard).\n",
+                 (int)idIndex.count, (int)shardSet.count, shardSet.count == 1 ? "" : "s", shardSet.span);
+    outputPrintf("CMS: OPEN reads \"P4_1-CMS.shards\" from now on; \"P4_1-CMS.txt\" is no longer updated.\n");
+    return 1;
+}
+
+
+// Whether the latest save left a backup of any shard it wrote
+static int shardBackupsExist(void) {
+    for (size_t i = 0; i < shardSet.count; i++) {
+        const Shard *shard = &shardSet.shards[i];
+        if (shard->generation == 0 || shard->generation != shardSet.generation) continue;
+        char path[SHARD_PATH_MAX];
+        shardPath(shard->key, ".bak", path, sizeof(path));
+        if (fileExists(path)) return 1;
+    }
+    return 0;
+}
+
+
+/**
+ * loadPreviousShards()
+ * -----------------------------------------
+ * Loads the version of a sharded table from before the latest SAVE into
+ * the (empty) table: the backups of the shards that save wrote, and the
+ * current files of the rest. The restored shards are marked to be written.
+ */
+static void loadPreviousShards(void) {
+    long records = 0;
+    int restored = 0;
+    for (size_t i = 0; i < shardSet.count; i++) {
+        Shard *shard = &shardSet.shards[i];
+        int previous = shard->generation > 0 && shard->generation == shardSet.generation;
+        char path[SHARD_PATH_MAX];
+        shardPath(shard->key, previous ? ".bak" : ".txt", path, sizeof(path));
+
+        long added = readShardFile(shard, path);
+        if (added > 0) records += added;
+        if (previous) {
+            shard->dirty = 1;
+            restored++;
+        }
+    }
+    outputPrintf("CMS: Loaded %ld records from %d shard%s, %d of them from backups.\n",
+                 records, (int)shardSet.count, shardSet.count == 1 ? "" : "s", restored);
+}
+
+
+// Brings in what a command on one ID needs: the ID's shard of a sharded
+// table, or the whole of a lazily opened one
+int loadRecordDB(int id) {
+    if (lazyOpen) return materializeDB();
+    return loadShardOf(id);
+}
+
+
+// Whether every record is in memory (not opened lazily, no shard left to load)
+int dbComplete(void) {
+    if (lazyOpen) return 0;
+    for (size_t i = 0; shardsOpen && i < shardSet.count; i++) {
+        if (!shardSet.shards[i].loaded) return 0;
+    }
+    return 1;
+}
+
+
+// ===============================
+// Lazy Open
+// ===============================
+
+// Header parsing state of the offset index scan
+typedef struct LazyScan {
+    int inHeader;
+} LazyScan;
+
+
+// Copies a mapped line and splits it like loadRecordLine(); 0 if too long
+static int splitMappedLine(const char *line, size_t len, char *copy, char *fields[4], size_t lengths[4]) {
+    if (len >= MAX_LINE) return 0;
+    memcpy(copy, line, len);
+    copy[len] = '\0';
+    splitRecordLine(copy, len, fields, lengths);
+    return 1;
+}
+
+
+/**
+ * keepLazyLine()
+ * -----------------------------------------
+ * OffsetLineFn for the offset index scan: applies the loader's rules
+ * (header lines, blank and over-long lines, name and programme lengths)
+ * so the index holds exactly the lines loadDB() would keep.
+ */
+static int keepLazyLine(void *state, const char *line, size_t len, int *id) {
+    LazyScan *scan = state;
+    char copy[MAX_LINE];
+    char *fields[4];
+    size_t lengths[4];
+
+    if (scan->inHeader) {
+        if (len >= MAX_LINE) return 0;
+        memcpy(copy, line, len);
+        copy[len] = '\0';
+        if (strcmp(copy, headerLines[3]) == 0) {
+            scan->inHeader = 0;
+            return 0;
+        }
+        if (isHeaderLine(copy, len)) return 0;
+        scan->inHeader = 0;     // Headerless file: first data row
+    }
+
+    if (len == 0 || !splitMappedLine(line, len, copy, fields, lengths)) return 0;
+    if (lengths[1] >= MAX_NAME || lengths[2] >= MAX_PROGRAMME) return 0;
+    *id = lengths[0] > 0 ? parseIntField(fields[0]) : 0;
+    return 1;
+}
+
+
+// JournalApplyFn collecting the committed changes of a lazy open
+static void collectLazyChange(char type, const StudentRecord *record) {
+    if (lazyChangeCount == lazyChangeCapacity) {
+        size_t capacity = lazyChangeCapacity ? lazyChangeCapacity * 2 : 256;
+        LazyChange *grown = realloc(lazyChanges, capacity * sizeof(LazyChange));
+        if (!grown) {
+            lazyChangeCapacity = SIZE_MAX;     // Reported once replay is over
+            return;
+        }
+        lazyChanges = grown;
+        lazyChangeCapacity = capacity;
+    }
+    LazyChange *change = &lazyChanges[lazyChangeCount];
+    change->record = *record;
+    change->type = type;
+    change->seq = lazyChangeCount++;
+}
+
+static int compareLazyChanges(const void *a, const void *b) {
+    const LazyChange *x = a, *y = b;
+    if (x->record.id != y->record.id) return x->record.id < y->record.id ? -1 : 1;
+    return x->seq < y->seq ? -1 : (x->seq > y->seq);
+}
+
+
+// Keeps the last journal entry of each ID, sorted by ID; 0 if replay ran
+// out of memory
+static int sortLazyChanges(void) {
+    if (lazyChangeCapacity == SIZE_MAX) return 0;
+    if (lazyChangeCount > 1) qsort(lazyChanges, lazyChangeCount, sizeof(LazyChange), compareLazyChanges);
+    size_t kept = 0;
+    for (size_t i = 0; i < lazyChangeCount; i++) {
+        if (kept > 0 && lazyChanges[kept - 1].record.id == lazyChanges[i].record.id) kept--;
+        lazyChanges[kept++] = lazyChanges[i];
+    }
+    lazyChangeCount = kept;
+    return 1;
+}
+
+
+static const LazyChange *findLazyChange(int id) {
+    size_t low = 0, high = lazyChangeCount;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (lazyChanges[middle].record.id < id) low = middle + 1;
+        else high = middle;
+    }
+    return low < lazyChangeCount && lazyChanges[low].record.id == id ? &lazyChanges[low] : NULL;
+}
+
+
+/**
+ * findLazyRecord()
+ * -----------------------------------------
+ * Looks a record up without loading the table: the journal's changes
+ * first, then the offset index and the record's line in the mapped file.
+ *
+ * @return 1 if found (copied into record), 0 if there is no such record,
+ *         -1 if the index does not match the file
+ */
+static int findLazyRecord(int id, StudentRecord *record) {
+    const LazyChange *change = findLazyChange(id);
+    if (change) {
+        if (change->type == JOURNAL_DELETE) return 0;
+        *record = change->record;
+        return 1;
+    }
+
+    size_t len;
+    const char *line = offsetIndexFind(&lazyIndex, id, &len);
+    if (!line) return 0;
+
+    char copy[MAX_LINE];
+    char *fields[4];
+    size_t lengths[4];
+    if (!splitMappedLine(line, len, copy, fields, lengths)
+        || lengths[1] >= MAX_NAME || lengths[2] >= MAX_PROGRAMME
+        || (lengths[0] > 0 ? parseIntField(fields[0]) : 0) != id) {
+        return -1;
+    }
+    record->id = id;
+    memcpy(record->name, fields[1], lengths[1] + 1);
+    memcpy(record->programme, fields[2], lengths[2] + 1);
+    record->mark = lengths[3] > 0 ? parseMarkField(fields[3]) : 0.0f;
+    return 1;
+}
+
+
+/**
+ * openLazyDB()
+ * -----------------------------------------
+ * OPEN LAZY: maps the database file and its offset index (building the
+ * index first if the file has changed since), and reads the journal's
+ * committed changes. No record is loaded, so with a current index this
+ * takes about the same time for any table size. Falls back to a normal
+ * OPEN when the table cannot be served this way.
+ *
+ * @return 1 if a table is open afterwards, 0 otherwise
+ */
+int openLazyDB() {
+    if (dbLoaded) {
+        outputPrintf("CMS: The database file \"P4_1-CMS.txt\" has already been opened.\n");
+        return 1;
+    }
+    int sharded = openShards();     // Shards are always loaded lazily
+    if (sharded >= 0) return sharded;
+    if (fileSize(DB_JOURNAL_PATH) > LAZY_JOURNAL_MAX) {
+        outputPrintf("CMS: The journal holds too many changes to open lazily. Loading every record instead.\n");
+        return openDB();
+    }
+
+    double started = timerNow();
+    int status = offsetIndexOpen(&lazyIndex, DB_FILE_PATH, DB_OFFSET_INDEX_PATH);
+    if (status < 0) {
+        offsetIndexClose(&lazyIndex);
+        return openDB();        // Reports the missing file
+    }
+    if (status == 0) {
+        LazyScan scan = { 1 };
+        int saved;
+        if (!offsetIndexBuild(&lazyIndex, DB_OFFSET_INDEX_PATH, keepLazyLine, &scan, &saved)) {
+            offsetIndexClose(&lazyIndex);
+            outputPrintf("CMS: The offset index could not be built. Loading every record instead.\n");
+            return openDB();
+        }
+        if (!saved) outputPrintf("CMS: Warning: the offset index \"P4_1-CMS.idx\" could not be written. The next OPEN LAZY builds it again.\n");
+    }
+
+    if (journalReplay(DB_JOURNAL_PATH, -1, collectLazyChange) < 0 || !sortLazyChanges()) {
+        closeLazy();
+        return openDB();        // Reports the damaged journal, or loads without an overlay
+    }
+
+    lazyRecords = lazyIndex.count;
+    for (size_t i = 0; i < lazyChangeCount; i++) {
+        size_t len;
+        int inFile = offsetIndexFind(&lazyIndex, lazyChanges[i].record.id, &len) != NULL;
+        if (lazyChanges[i].type == JOURNAL_UPSERT && !inFile) lazyRecords++;
+        if (lazyChanges[i].type == JOURNAL_DELETE && inFile) lazyRecords--;
+    }
+    lazyOpen = 1;
+    dbLoaded = 1;
+    baseStale = 0;
+
+    outputPrintf("CMS: The database file \"P4_1-CMS.txt\" is successfully opened.\n");
+    outputPrintf("CMS: Opened %d records lazily (offset index %s in %.3f s). Records are loaded when a command needs more than QUERY ID=.\n",
+                 (int)lazyRecords, status ? "mapped" : "built", timerNow() - started);
+    return 1;
+}
+
+
+// Unmaps the lazily opened table and forgets its journal changes
+static void closeLazy(void) {
+    offsetIndexClose(&lazyIndex);
+    free(lazyChanges);
+    lazyChanges = NULL;
+    lazyChangeCount = lazyChangeCapacity = 0;
+    lazyOpen = 0;
+}
+
+
+/**
+ * materializeDB()
+ * -----------------------------------------
+ * Loads every record of a lazily opened table, the way OPEN would, or the
+ * shards of a sharded table not loaded yet, before a command that needs
+ * the whole table. Does nothing otherwise.
+ *
+ * @return 1 if the table is loaded, 0 if loading failed
+ */
+int materializeDB() {
+    if (shardsOpen) return loadAllShards();
+    if (!lazyOpen) return 1;
+    closeLazy();
+    dbLoaded = 0;
+    outputPrintf("CMS: Loading every record (the table was opened lazily).\n");
+    loadSaved();
+    return dbLoaded;
+}
+
+
+// QUERY ID= on a lazily opened table, printed exactly like queryDB()
+static int queryLazy(int id) {
+    StudentRecord record;
+    int found = findLazyRecord(id, &record);
+    if (found < 0) {
+        // The file no longer matches its index: fall back to the loaded table
+        if (!materializeDB()) return 0;
+        return queryDB(id);
+    }
+    if (!found) {
+        outputPrintf("CMS: The record with ID=%d does not exist.\n", id);
+        return 0;
+    }
+
+    size_t nameLength = strlen(record.name), progLength = strlen(record.programme);
+    TableLayout layout = layoutFor(nameLength > 4 ? (int)nameLength : 4, progLength > 9 ? (int)progLength : 9, 0);
+    outputPrintf("CMS: The record with ID=%d is found in the data table.\n", id);
+    renderHeader(&layout, "");
+    renderRow(&layout, record.id, record.name, nameLength, record.programme, progLength, record.mark);
+    renderFlush();
+    return 1;
+}
+
+
+// Searches for a record by ID and prints it in formatted table output.
+// A temporary single-node list is used for reuse of print formatting logic.
+int queryDB(int id) {
+    if (lazyOpen) return queryLazy(id);
+    if (!loadShardOf(id)) return 0;
+    Node *node = findNode(id);
+    if (!node) {
+        outputPrintf("CMS: The record with ID=%d does not exist.\n", id);
+        return 0;
+    }
+
+    // Create a temporary wrapper so printNodeList() can format properly
+    Node tempNode = *node;
+    tempNode.next = NULL;
+
+    outputPrintf("CMS: The record with ID=%d is found in the data table.\n", id);
+    printNodeList(&tempNode, "");
+    return 1;
+}
+
+
+// Orders a record's name against a lookup key, like compareByName()
+static int compareNameKey(const Node *node, const void *key) {
+    return compareFolded(nodeName(node), key);
+}
+
+
+// Whether a record's name equals text, or starts with it for a prefix
+// lookup, in any letter case
+static int nameMatches(const Node *node, const char *text, size_t length, int prefix) {
+    if (prefix ? node->nameLength < length : node->nameLength != length) return 0;
+    const char *name = nodeName(node);
+    for (size_t i = 0; i < length; i++) {
+        if (tolower((unsigned char)name[i]) != tolower((unsigned char)text[i])) return 0;
+    }
+    return 1;
+}
+
+
+/**
+ * queryNameDB()
+ * -----------------------------------------
+ * Prints every record whose name matches a pattern, in name then ID
+ * order. A pattern ending in '*' matches names starting with the rest of
+ * it; letter case is ignored either way. The matches are found by seeking
+ * in the name index, so a lookup costs O(log n) plus its matches.
+ *
+ * @param pattern - name, or name prefix followed by '*'
+ * @return 1 if at least one record matched, 0 otherwise
+ */
+int queryNameDB(const char *pattern) {
+    if (!buildNameOrder()) {
+        outputPrintf("CMS: Memory allocation failed.\n");
+        return 0;
+    }
+
+    char key[MAX_NAME];
+    size_t length = strlen(pattern);
+    int prefix = length > 0 && pattern[length - 1] == '*';
+    if (prefix) length--;
+    memcpy(key, pattern, length);
+    key[length] = '\0';
+
+    // First walk: count the matches and size the columns to them
+    OrderCursor cursor;
+    size_t matches = 0;
+    int maxName = 4, maxProg = 9;
+    for (Node *node = orderSeekKey(&cursor, &nameOrder, compareNameKey, key, 1);
+         node && nameMatches(node, key, length, prefix); node = orderNext(&cursor)) {
+        int progLength = (int)programmeLength(node->programme);
+        if (node->nameLength > maxName) maxName = node->nameLength;
+        if (progLength > maxProg) maxProg = progLength;
+        matches++;
+    }
+    if (!matches) {
+        outputPrintf("CMS: No record matching NAME=%s exists.\n", pattern);
+        return 0;
+    }
+
+    char header[MAX_LINE];
+    if (matches == 1) {
+        snprintf(header, sizeof(header), "CMS: 1 record matching NAME=%s is found in the data table.", pattern);
+    }
+    else {
+        snprintf(header, sizeof(header), "CMS: %d records matching NAME=%s are found in the data table.",
+                 (int)matches, pattern);
+    }
+
+    TableLayout layout = layoutFor(maxName, maxProg, 0);
+    renderHeader(&layout, header);
+    for (Node *node = orderSeekKey(&cursor, &nameOrder, compareNameKey, key, 1);
+         node && nameMatches(node, key, length, prefix); node = orderNext(&cursor)) {
+        renderNode(&layout, node);
+    }
+    renderFlush();
+    return 1;
+}
+
+
+// Modifies an existing record (name, programme, or mark). Changes are tracked
+// so undo/redo can revert modifications when needed.
+int updateDB(int id, const char *name, const char *programme, float mark, int isUndoRedo) {
+    Node *record = findNode(id);
+    if (!record) {
+        if (!isUndoRedo) outputPrintf("CMS: The record with ID=%d does not exist.\n", id);
+        return 0;
+    }
+
+    Action *action = NULL;
+    int renaming = name && strlen(name) > 0 && strcmp(name, nodeName(record)) != 0;
+    // Prepare undo entry only if initiated by user; the old name is only
+    // kept when it is about to change
+    if (!isUndoRedo) {
+        action = newAction(UPDATE_OP, id);
+        if (action) {
+            action->oldProgramme = record->programme;
+            action->oldMark = record->mark;
+            if (renaming && !(action->oldName = copyName(record))) {
+                poolFree(&actionPool, action);
+                action = NULL;
             }
-            memContent = newPtr;
-            memContent[memLen++] = *p;
-            memContent[memLen] = '\0';
         }
-        current = current->next;
     }
 
-    // Compare memory and file contents
-    if (fileContent && strcmp(fileContent, memContent) == 0) {
-        printf("CMS: No changes detected. Nothing to save.\n");
-        free(fileContent);
-        free(memContent);
-        return;
+    // Apply updates selectively
+    if (renaming) {
+        if (!renameNode(record, name, strlen(name))) {
+            outputPrintf("CMS: Memory allocation failed.\n");
+            if (action) {
+                free(action->oldName);
+                poolFree(&actionPool, action);
+            }
+            return 0;
+        }
+        compactNames();
+    }
+    if (programme && strlen(programme) > 0) {
+        ProgCode code = programmeIntern(programme, strlen(programme));
+        if (code != PROGRAMME_NONE) setNodeProgramme(record, code);
+    }
+    if (mark >= 0.0f) setNodeMark(record, mark);
+    journalChange(JOURNAL_UPSERT, record);
+
+    // Finalize undo stack if applicable: only the fields that changed are kept
+    if (action) {
+        if (renaming && (action->newName = copyName(record)) != NULL) action->changed |= ACTION_NAME;
+        if (record->programme != action->oldProgramme) action->changed |= ACTION_PROGRAMME;
+        if (record->mark != action->oldMark) action->changed |= ACTION_MARK;
+        action->newProgramme = record->programme;
+        action->newMark = record->mark;
+        if (!(action->changed & ACTION_NAME)) {
+            free(action->oldName);
+            action->oldName = NULL;
+        }
+        pushUndo(action);
+    }
+    if (!isUndoRedo) outputPrintf("CMS: The record with ID=%d is successfully updated.\n", id);
+
+    markModified();
+    return 1;
+}
+
+
+// Removes a record from both the linked list and ID index.
+// If user-triggered, the action is stored so it can be undone.
+int deleteDB(int id, int confirm, int isUndoRedo) {
+    // Locate node to delete through the ID index
+    Node *current = findNode(id);
+
+    if (!current) return 0; // Not found
+    if (!confirm) return 1; // Preview mode (for DELETE confirmation)
+
+    if (!isUndoRedo) {
+        Action *action = newAction(DELETE_OP, id);
+        if (action && (action->oldName = copyName(current)) != NULL) {
+            action->oldProgramme = current->programme;
+            action->oldMark = current->mark;
+            pushUndo(action);
+        }
+        else if (action) poolFree(&actionPool, action);
+    }
+
+    // Remove from linked list and ID index & free memory
+    journalChange(JOURNAL_DELETE, current);
+    removeRecord(current);
+
+    if (!isUndoRedo) outputPrintf("CMS: The record with ID=%d is successfully deleted.\n", id);
+
+    markModified();
+    return 1;
+}
+
+
+/**
+ * importDB()
+ * -----------------------------------------
+ * Adds every valid row of a TSV/CSV file as one change: the file is parsed
+ * on several threads, then the rows are committed in file order and
+ * recorded as a single undo entry. Rows that fail validation or clash with
+ * an existing ID are listed in "<path>.rejected".
+ *
+ * @param path - file to import
+ * @return 1 if the file was imported (even with some rejected rows),
+ *         0 if it could not be read or no row was accepted
+ */
+int importDB(const char *path) {
+    double started = timerNow();
+
+    ImportFile file;
+    int status = importParse(&file, path, &idIndex);
+    if (status == 0) {
+        outputPrintf("CMS: Could not open file \"%s\".\n", path);
+        return 0;
+    }
+    if (status < 0) {
+        outputPrintf("CMS: Memory allocation failed during import.\n");
+        return 0;
+    }
+
+    size_t rows = 0;
+    for (int c = 0; c < file.chunkCount; c++) rows += file.chunks[c].rowCount;
+    prepareBulkChange(rows);
+    indexReserve(&idIndex, idIndex.count + rows);
+
+    // Commit in file order. Parsing already rejected IDs in the table, so
+    // an ID found now was added by an earlier row of this file.
+    Node *first = NULL;
+    size_t imported = 0;
+    int failed = 0;
+    for (int c = 0; c < file.chunkCount && !failed; c++) {
+        ImportChunk *chunk = &file.chunks[c];
+        for (size_t r = 0; r < chunk->rowCount; r++) {
+            const ImportRow *row = &chunk->rows[r];
+            if (findNode(row->id)) {
+                importAddReject(&file, row, "duplicate ID earlier in the file");
+                continue;
+            }
+            Node *node = addRecord(row->id, row->name, row->programme, row->mark);
+            if (!node) {
+                failed = 1;
+                break;
+            }
+            journalChange(JOURNAL_UPSERT, node);
+            if (!first) first = node;
+            imported++;
+        }
+    }
+    if (failed) outputPrintf("CMS: Memory allocation failed during import. The rows read so far were kept.\n");
+
+    // One undo entry for the whole file
+    if (imported > 0) {
+        Action *action = newAction(IMPORT_OP, 0);
+        RecordBatch *batch = action ? captureBatch(first, imported) : NULL;
+        if (batch) {
+            action->batch = batch;
+            pushUndo(action);
+        }
+        else {
+            if (action) poolFree(&actionPool, action);
+            outputPrintf("CMS: Memory allocation failed for the IMPORT undo entry. The import cannot be undone.\n");
+        }
+        markModified();
+    }
+
+    // Rejected rows go to "<path>.rejected"; a stale report is removed
+    size_t rejected = importRejectCount(&file);
+    char rejectsPath[1024];
+    snprintf(rejectsPath, sizeof(rejectsPath), "%s%s", path, IMPORT_REJECTS_SUFFIX);
+    int reported = 0;
+    if (rejected > 0) reported = importWriteRejects(&file, rejectsPath);
+    else remove(rejectsPath);
+
+    double elapsed = timerNow() - started;
+    size_t processed = imported + rejected;
+    outputPrintf("CMS: Imported %d records from \"%s\" (%d rejected) in %.3f s, %.0f rows/s on %d thread%s.\n",
+                 (int)imported, path, (int)rejected, elapsed,
+                 elapsed > 0 ? processed / elapsed : 0.0, file.threads, file.threads == 1 ? "" : "s");
+    if (rejected > 0) {
+        if (reported) outputPrintf("CMS: Rejected rows are listed in \"%s\".\n", rejectsPath);
+        else outputPrintf("CMS: The rejected-rows file \"%s\" could not be written.\n", rejectsPath);
+    }
+
+    importFree(&file);
+    return imported > 0 || rejected == 0;
+}
+
+
+/**
+ * writeBase()
+ * -----------------------------------------
+ * Rewrites the base file from memory and retires the journal it absorbs.
+ * Records are streamed through a large buffer into a temp file, which is
+ * synced and then renamed over the database; the previous file becomes the
+ * backup by rename, so no copy of either version is held in memory.
+ *
+ * @return 1 on success, 0 if the database file could not be written
+ */
+// One round of SAVE formatting: consecutive records split between tasks
+typedef struct SaveScan {
+    Node **nodes;               // The round's records, in list order
+    size_t count;
+    int tasks;
+    char *text[SCAN_MAX_TASKS]; // Formatted lines of each task
+    size_t length[SCAN_MAX_TASKS];
+} SaveScan;
+
+
+// Formats one task's share of a SAVE round
+static void saveTask(void *arg, int task) {
+    SaveScan *scan = arg;
+    size_t first = scanSplit(scan->count, task, scan->tasks);
+    size_t last = scanSplit(scan->count, task + 1, scan->tasks);
+    char *out = scan->text[task];
+    for (size_t i = first; i < last; i++) {
+        const Node *node = scan->nodes[i];
+        out = renderTsvLine(out, node->id, nodeName(node), node->nameLength,
+                            nodeProgramme(node), programmeLength(node->programme), node->mark);
+    }
+    scan->length[task] = (size_t)(out - scan->text[task]);
+}
+
+
+/**
+ * writeRecords()
+ * -----------------------------------------
+ * Writes every record as a tab-separated line, in list order. Records are
+ * taken in rounds of SAVE_ROUND_RECORDS per task; on a large table the
+ * tasks of a round format their lines on the scan threads, and the lines
+ * are written in task order, so the file is the same either way.
+ *
+ * @return 1 if every line was written, 0 on a write error
+ */
+static int writeRecords(FILE *file) {
+    SaveScan scan;
+    memset(&scan, 0, sizeof(scan));
+    scan.tasks = scanTasks(idIndex.count);
+    size_t roundSize = (size_t)scan.tasks * SAVE_ROUND_RECORDS;
+    scan.nodes = malloc(roundSize * sizeof(Node*));
+    int ok = scan.nodes != NULL;
+    for (int t = 0; ok && t < scan.tasks; t++) {
+        scan.text[t] = malloc((size_t)SAVE_ROUND_RECORDS * RENDER_LINE_MAX);
+        ok = scan.text[t] != NULL;
+    }
+
+    // Short of memory: format record by record instead
+    if (!ok) {
+        for (Node *current = head; current; current = current->next) {
+            fprintf(file, "%d\t%s\t%s\t%.1f\n",
+                    current->id,
+                    nodeName(current),
+                    nodeProgramme(current),
+                    current->mark);
+        }
     }
 
-    // Proceed with actual saving
-    FILE *backup = fopen("./data/P4_1-CMS.bak", "w");
-    if (backup && fileContent) {
-        fputs(fileContent, backup);
-        fclose(backup);
+    int written = 1;
+    Node *current = head;
+    while (ok && current && written) {
+        scan.count = 0;
+        for (; current && scan.count < roundSize; current = current->next) scan.nodes[scan.count++] = current;
+
+        scanRun(saveTask, &scan, scan.tasks);
+        for (int t = 0; t < scan.tasks && written; t++) {
+            written = fwrite(scan.text[t], 1, scan.length[t], file) == scan.length[t];
+        }
     }
 
-    FILE *file = fopen("./data/P4_1-CMS.txt", "w");
+    for (int t = 0; t < scan.tasks; t++) free(scan.text[t]);
+    free(scan.nodes);
+    return written && !ferror(file);
+}
+
+
+static int writeBase() {
+    FILE *file = fopen(DB_TEMP_PATH, "w");
     if (!file) {
-        printf("CMS: Error saving the database file.\n");
-        free(fileContent);
-        free(memContent);
-        return;
+        outputPrintf("CMS: Error saving the database file.\n");
+        return 0;
     }
+    setvbuf(file, NULL, _IOFBF, IO_BUFFER_SIZE);
 
-    fputs(memContent, file);
-    fclose(file);
+    // Write headers exactly as the loader expects them
+    fputs(DB_TEXT_HEADER, file);
+
+    // Stream all records from linked list
+    int written = writeRecords(file);
+    if (!fileSync(file)) written = 0;
+    if (fclose(file) != 0) written = 0;
+
+    // Swap the new file into place, keeping the old one as the backup
+    if (!written || !fileReplace(DB_TEMP_PATH, DB_FILE_PATH, DB_BACKUP_PATH)) {
+        remove(DB_TEMP_PATH);
+        outputPrintf("CMS: Error saving the database file.\n");
+        return 0;
+    }
+    remove(DB_OFFSET_INDEX_PATH);       // Rebuilt by the next OPEN LAZY
 
-    free(fileContent);
-    free(memContent);
+    // Refresh the binary snapshot used for fast startup. The text file stays
+    // authoritative, so a stale snapshot is removed rather than left behind.
+    if (!snapshotWrite(DB_SNAPSHOT_PATH, DB_SNAPSHOT_TEMP_PATH)) {
+        remove(DB_SNAPSHOT_PATH);
+        outputPrintf("CMS: Warning: the binary snapshot could not be written. OPEN will read the text file.\n");
+    }
+
+    // The old journal now describes the backup file, so it moves with it.
+    // If this is interrupted the old journal is replayed over the new base,
+    // which is harmless because replay is idempotent.
+    baseStale = !journalRotate(DB_JOURNAL_BACKUP_PATH);
+    return 1;
+}
+
+
+// Saves the in-memory changes, but only if changes exist. Normally this
+// only commits the journal, costing the size of the changes; the base file
+// is rewritten when the journal has grown past half its size or after
+// RESTORE replaced the whole table.
+int saveDB() {
+    if (!dbLoaded) {
+        outputPrintf("CMS: No database loaded. Nothing to save.\n");
+        return 0;
+    }
+    finishBackgroundSave(1);
+
+    // Every mutation sets dbModified, so a clean flag means the file
+    // already matches memory
+    if (!dbModified) {
+        outputPrintf("CMS: No changes detected. Nothing to save.\n");
+        return 1;
+    }
+
+    if (shardsOpen) {
+        int written = saveShards();
+        if (written < 0) return 0;
+        dbModified = 0;
+        changesSinceSave = 0;
+        outputPrintf("CMS: The sharded database \"P4_1-CMS\" has been successfully saved (%d of %d shard%s written).\n",
+                     written, (int)shardSet.count, shardSet.count == 1 ? "" : "s");
+        return 1;
+    }
+
+    long long journalSize = journalBytes();
+    int compact = baseStale
+                  || (journalSize >= JOURNAL_COMPACT_MIN && journalSize * 2 >= fileSize(DB_FILE_PATH));
+
+    int saved = compact ? 0 : journalCommit();
+    if (!saved) saved = writeBase();    // Also the fallback when the journal cannot be synced
+    if (!saved) return 0;
 
     dbModified = 0;
-    printf("CMS: The database file \"P4_1-CMS.txt\" has been successfully saved.\n");
+    changesSinceSave = 0;
+    outputPrintf("CMS: The database file \"P4_1-CMS.txt\" has been successfully saved.\n");
+    return 1;
+}
+
+
+// Folds the journal into the base file without changing any records
+int compactDB() {
+    if (!dbLoaded) {
+        outputPrintf("CMS: No database loaded. Nothing to compact.\n");
+        return 0;
+    }
+    if (shardsOpen) {
+        outputPrintf("CMS: A sharded table has no journal. Nothing to compact.\n");
+        return 1;
+    }
+    finishBackgroundSave(1);
+    if (dbModified) {
+        outputPrintf("CMS: There are unsaved changes. SAVE or UNDO them before compacting.\n");
+        return 0;
+    }
+    if (!baseStale && journalCommits() == 0) {
+        outputPrintf("CMS: The journal is empty. Nothing to compact.\n");
+        return 1;
+    }
+
+    if (!writeBase()) return 0;
+    outputPrintf("CMS: The journal has been folded into \"P4_1-CMS.txt\".\n");
+    return 1;
+}
+
+
+// ===============================
+// Background Save
+// ===============================
+
+/**
+ * startBackgroundSave()
+ * -----------------------------------------
+ * Captures the table and hands it to the save thread. The journal is
+ * committed first when it can be, so the changes are durable before the
+ * base file is rewritten, and replaying that journal over either base
+ * gives the captured table. Changes made while the thread runs are
+ * journaled (uncommitted) as usual and stay unsaved.
+ *
+ * @param automatic - started by autosave rather than SAVE ASYNC
+ * @return 1 if the save was started, 0 otherwise
+ */
+static int startBackgroundSave(int automatic) {
+    SnapshotImage image;
+    if (!snapshotCapture(&image)) {
+        outputPrintf("CMS: Memory allocation failed. Use SAVE to save in the foreground.\n");
+        return 0;
+    }
+
+    asyncCommitted = !baseStale && journalCommit();
+    if (!asyncCommitted) baseStale = 1;     // Changes made meanwhile need the next full save
+    asyncJournalOffset = journalBytes();
+    if (asyncCommitted) dbModified = 0;
+    changesSinceSave = 0;
+    dirtySince = timerNow();
+
+    int records = (int)image.header.recordCount;
+    backgroundSaveStart(&image);
+    asyncRunning = 1;
+    outputPrintf("CMS: %s \"P4_1-CMS.txt\" in the background (%d records).\n",
+                 automatic ? "Autosave: saving" : "Saving", records);
+    return 1;
+}
+
+
+/**
+ * finishBackgroundSave()
+ * -----------------------------------------
+ * Collects a finished background save and reports it: the old journal is
+ * retired with the old base file, keeping the entries appended since the
+ * capture, and the table is clean again if it has not changed since.
+ *
+ * @param wait - wait for a running save instead of leaving it running
+ */
+static void finishBackgroundSave(int wait) {
+    BackgroundSaveResult result;
+    if (!asyncRunning || backgroundSavePoll(wait, &result) != SAVE_FINISHED) return;
+    asyncRunning = 0;
+    lastSave = result;
+    lastSaveKnown = 1;
+
+    if (!result.ok) {
+        outputPrintf("CMS: The background save of \"P4_1-CMS.txt\" failed: %s. %s\n", result.error,
+                     asyncCommitted ? "The changes it covered are safe in the journal."
+                                    : "Its changes are not saved; use SAVE to try again.");
+        return;
+    }
+
+    if (asyncCommitted) {
+        if (!baseStale) baseStale = !journalRotateFrom(DB_JOURNAL_BACKUP_PATH, asyncJournalOffset);
+    }
+    else if (journalRotate(DB_JOURNAL_BACKUP_PATH) && changesSinceSave == 0) {
+        baseStale = 0;      // Nothing was journaled meanwhile, and nothing changed
+    }
+    if (changesSinceSave == 0) dbModified = 0;
+
+    if (result.snapshotFailed) {
+        outputPrintf("CMS: Warning: the binary snapshot could not be written. OPEN will read the text file.\n");
+    }
+    outputPrintf("CMS: The background save of \"P4_1-CMS.txt\" finished in %.3f seconds (%d records).%s\n",
+                 result.seconds, (int)result.records,
+                 dbModified ? " Changes made since are not saved yet." : "");
+}
+
+
+// Starts a background save of the current table (SAVE ASYNC)
+int saveAsyncDB() {
+    if (!dbLoaded) {
+        outputPrintf("CMS: No database loaded. Nothing to save.\n");
+        return 0;
+    }
+    if (shardsOpen) return saveDB();    // Only the changed shards are written anyway
+    finishBackgroundSave(0);
+    if (asyncRunning) {
+        outputPrintf("CMS: A background save is already running. Try again when it has finished.\n");
+        return 0;
+    }
+    if (!dbModified) {
+        outputPrintf("CMS: No changes detected. Nothing to save.\n");
+        return 1;
+    }
+    return startBackgroundSave(0);
+}
+
+
+// Reports a finished background save and starts an autosave when one is
+// due. Called between commands.
+void saveTick(void) {
+    finishBackgroundSave(0);
+    if (!dbLoaded || !dbModified || asyncRunning || transaction) return;
+
+    int due = (autosaveChanges > 0 && changesSinceSave >= autosaveChanges)
+              || (autosaveSeconds > 0 && timerNow() - dirtySince >= autosaveSeconds);
+    if (due && shardsOpen) {
+        outputPrintf("CMS: Autosave: saving the changed shards.\n");
+        saveDB();
+    }
+    else if (due) startBackgroundSave(1);
 }
 
 
-// Loads the backup file into memory, replacing the current dataset.
-// The action is recorded unless triggered by undo/redo logic.
-void restoreDB(int isUndoRedo) {
-    FILE *backup = fopen("./data/P4_1-CMS.bak", "r");
-    if (!backup) {
-        printf("CMS: Backup file \"P4_1-CMS.bak\" does not exist. Cannot restore.\n");
+// Waits for a running background save and reports it
+void saveWait(void) {
+    finishBackgroundSave(1);
+}
+
+
+// Describes when autosave runs, e.g. "after 100 changes or 60 seconds"
+static void describeAutosave(char *out, size_t size) {
+    long changes = autosaveChanges, seconds = autosaveSeconds;
+    if (changes > 0 && seconds > 0) {
+        snprintf(out, size, "after %ld change%s or %ld second%s",
+                 changes, changes == 1 ? "" : "s", seconds, seconds == 1 ? "" : "s");
+    }
+    else if (changes > 0) snprintf(out, size, "after %ld change%s", changes, changes == 1 ? "" : "s");
+    else snprintf(out, size, "%ld second%s after a change", seconds, seconds == 1 ? "" : "s");
+}
+
+
+// Sets the autosave thresholds; 0 for both turns autosave off
+int setAutosave(long changes, long seconds) {
+    autosaveChanges = changes > 0 ? changes : 0;
+    autosaveSeconds = seconds > 0 ? seconds : 0;
+    if (!autosaveChanges && !autosaveSeconds) {
+        outputPrintf("CMS: Autosave is off.\n");
+        return 1;
+    }
+
+    char rule[96];
+    describeAutosave(rule, sizeof(rule));
+    outputPrintf("CMS: Autosave is on: the table is saved in the background %s.\n", rule);
+    return 1;
+}
+
+
+/**
+ * loadPrevious()
+ * -----------------------------------------
+ * Loads the version that was current before the latest SAVE. If that save
+ * went to the journal, it is the base file plus all but the last journal
+ * commit; otherwise it is the backup file plus the journal retired with it.
+ */
+static void loadPrevious() {
+    if (shardsOpen) {
+        loadPreviousShards();
         return;
     }
-    fclose(backup); 
+    int commits = journalCommits();
+    journalDiscard();
 
+    if (commits > 0) {
+        loadBase();
+        if (dbLoaded) journalReplay(DB_JOURNAL_PATH, commits - 1, applyJournalEntry);
+    }
+    else {
+        loadDB(DB_BACKUP_PATH);
+        if (dbLoaded) journalReplay(DB_JOURNAL_BACKUP_PATH, -1, applyJournalEntry);
+    }
+
+    // The table no longer matches base + journal until the next full save
+    baseStale = 1;
+}
+
+
+// Loads the previously saved version into memory, replacing the current
+// dataset. The action is recorded unless triggered by undo/redo logic.
+int restoreDB(int isUndoRedo) {
+    finishBackgroundSave(1);    // It may still be replacing the backup file
+    if (shardsOpen && !shardBackupsExist()) {
+        outputPrintf("CMS: The latest save left no shard backups. Cannot restore.\n");
+        return 0;
+    }
+    if (!shardsOpen && journalCommits() == 0 && !fileExists(DB_BACKUP_PATH)) {
+        outputPrintf("CMS: Backup file \"P4_1-CMS.bak\" does not exist. Cannot restore.\n");
+        return 0;
+    }
+
+    // Park the current table, unsaved changes and all, in the undo entry;
+    // the previous version is loaded into a fresh one
+    Action *action = NULL;
     if (!isUndoRedo) {
-        Action *action = malloc(sizeof(Action));
-        if (!action) {
-            printf("CMS: Memory allocation failed for RESTORE action.\n");
-            return;
+        action = newAction(RESTORE_OP, 0);
+        TableState *parked = action ? newTable() : NULL;
+        if (!parked) {
+            if (action) poolFree(&actionPool, action);
+            outputPrintf("CMS: Memory allocation failed for RESTORE action.\n");
+            return 0;
         }
-
-        action->type = RESTORE_OP;
-        pushUndo(action);
+        action->table = parked;
+        swapTable(parked);
     }
     
-    loadDB("./data/P4_1-CMS.bak"); // Load backup into memory
+    loadPrevious(); // Load the previous version into memory
+    if (action) pushUndo(action);   // Charged with the parked table's memory
     
     if (!isUndoRedo) {
-        printf("CMS: Database successfully restored from backup. Changes are not saved yet.\n");
+        outputPrintf("CMS: Database successfully restored from backup. Changes are not saved yet.\n");
     }
 
-    dbModified = 1; 
+    markModified();
+    return 1;
 }
 
 
-// Releases all dynamically allocated nodes from memory.
-// Called when loading a new DB or exiting the program.
+// Releases all dynamically allocated memory (records, ID index and the
+// undo/redo history). Called when exiting the program.
 void freeDB() {
-    struct Node *current = head; 
-    while (current != NULL) {
-        struct Node *nextNode = current->next; 
-        free(current); 
-        current = nextNode; 
-    }
-    head = NULL; 
+    finishBackgroundSave(1);
+    closeLazy();
+    shardSetFree(&shardSet);
+    shardsOpen = 0;
+    journalClose();     // Unsaved journal entries are dropped
+    clearRecords();
+    indexFree(&idIndex);
+
+    stringPoolFree(&namePool);
+    programmeFreeAll();
+
+    while (undoStack) freeAction(stackPop(&undoStack));
+    while (redoStack) freeAction(stackPop(&redoStack));
+    transaction = NULL;     // Its steps go with the action pool
+    poolReset(&actionPool);
+    sortFree();
+    scanShutdown();
+    free(matches);
+    matches = NULL;
+    matchCapacity = 0;
+    free(columns.ids);
+    free(columns.marks);
+    free(columns.nodes);
+    memset(&columns, 0, sizeof(columns));
 }
\ No newline at end of file
@@ -0,0 +1,638 @@
+/**
+ * Command Execution
+ * --------------------------------------
+ * Validates and runs CMS command lines, whether typed at the prompt or
+ * read from a script. Scripts come from `RUN FILE=<path>` or from the
+ * `--batch` command-line mode and are processed without prompts:
+ * - DELETE, RESTORE and QUIT are treated as confirmed
+ * - blank lines and lines starting with '#' are skipped
+ * - each command is echoed after "P4_1: " so the output reads like a session
+ * - a failing command stops the script or is counted, depending on policy
+ *
+ * Authors: Team P4-1
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "headers/cms.h"
+#include "headers/command.h"
+#include "headers/input_validation.h"
+#include "headers/line_reader.h"
+#include "headers/stats.h"
+#include "headers/timer.h"
+#include "headers/output.h"
+
+static int batchDepth = 0;      // Scripts currently running (RUN inside RUN)
+static double promptSeconds = 0.0;  // Time spent waiting for Y/N answers, left out of command timings
+
+
+/**
+ * confirm()
+ * -----------------------------------------
+ * Reads a Y/N answer at the prompt. The answer comes from the shared
+ * stdin reader, so it replaces the command line being run: callers must
+ * be done with their arguments before asking.
+ *
+ * @param fatalMsg   - printed if the answer cannot be read
+ * @param cancelMsg  - printed for "N"
+ * @param invalidMsg - printed for anything else, or at the end of input
+ * @return 1 for "Y", 0 otherwise
+ */
+static int confirm(const char *fatalMsg, const char *cancelMsg, const char *invalidMsg) {
+    outputPrintf("\nP4_1: ");
+    LineReader *reader = lineReaderStdin();
+    double asked = statsEnabled ? timerNow() : 0.0;
+    char *answer = lineReaderNext(reader, NULL);
+    if (statsEnabled) promptSeconds += timerNow() - asked;
+    if (answer == NULL && reader->failed) {
+        outputPrintf("%s\n", fatalMsg);
+        return 0;
+    }
+    if (answer == NULL) answer = "";
+
+    char *valid;
+    int confirmed = 0;
+    if ((valid = validateCommand(answer, "Y")) != NULL && *valid == '\0') {
+        confirmed = 1;
+    }
+    else if ((valid = validateCommand(answer, "N")) != NULL && *valid == '\0') {
+        outputPrintf("%s\n", cancelMsg);
+    }
+    else {
+        outputPrintf("%s\n", invalidMsg);
+    }
+    return confirmed;
+}
+
+
+// Returns 1 (after telling the user) if no database has been opened yet
+static int requireLoaded() {
+    if (dbLoaded) return 0;
+    outputPrintf("CMS: No records loaded. Open and load the database first.\n");
+    return 1;
+}
+
+
+/**
+ * parsePath()
+ * -----------------------------------------
+ * Reads the FILE=<path> argument of RUN and IMPORT. The path runs up to
+ * the given option (" ONERROR=..." for RUN) or the end of the line, so it
+ * may contain spaces.
+ *
+ * @param option - option allowed after the path, or NULL for none
+ * @param value  - receives the option's value, or NULL if it was not given
+ * @return 1 if a path was read, 0 if it is missing or too long
+ */
+static int parsePath(const char *args, const char *option, char *path, size_t size, const char **value) {
+    if (strncasecmp(args, "FILE=", 5) != 0 || args[5] == '\0' || isspace((unsigned char)args[5])) {
+        return 0;
+    }
+
+    const char *start = args + 5;
+    const char *end = start + strlen(start);
+    size_t optionLength = option ? strlen(option) : 0;
+    *value = NULL;
+
+    for (const char *p = start; option && *p; p++) {
+        if (isspace((unsigned char)*p) && strncasecmp(p + 1, option, optionLength) == 0) {
+            *value = p + 1 + optionLength;
+            end = p;
+            break;
+        }
+    }
+    while (end > start && isspace((unsigned char)end[-1])) end--;
+
+    size_t length = (size_t)(end - start);
+    if (length == 0 || length >= size) return 0;
+    memcpy(path, start, length);
+    path[length] = '\0';
+    return 1;
+}
+
+
+// Handles RUN FILE=<path> [ONERROR=STOP|CONTINUE]; COMMAND_OK if every
+// command of the script succeeded
+static CommandStatus runScript(const char *args) {
+    char path[1024];
+    const char *onError;
+    BatchPolicy policy = BATCH_STOP_ON_ERROR;
+
+    if (!parsePath(args, "ONERROR=", path, sizeof(path), &onError)) {
+        outputPrintf("CMS: Invalid RUN format. Use RUN FILE=<path> [ONERROR=STOP|CONTINUE].\n");
+        return COMMAND_FAILED;
+    }
+    if (onError) {
+        if (strcasecmp(onError, "CONTINUE") == 0) policy = BATCH_CONTINUE_ON_ERROR;
+        else if (strcasecmp(onError, "STOP") != 0) {
+            outputPrintf("CMS: Invalid ONERROR value. Use STOP or CONTINUE.\n");
+            return COMMAND_FAILED;
+        }
+    }
+
+    if (batchDepth >= BATCH_MAX_DEPTH) {
+        outputPrintf("CMS: RUN scripts can only be nested %d deep.\n", BATCH_MAX_DEPTH);
+        return COMMAND_FAILED;
+    }
+
+    FILE *script = fopen(path, "r");
+    if (!script) {
+        outputPrintf("CMS: Cannot open script \"%s\".\n", path);
+        return COMMAND_FAILED;
+    }
+
+    long failed = runBatch(script, path, policy, NULL);
+    fclose(script);
+    return failed ? COMMAND_FAILED : COMMAND_OK;
+}
+
+
+// ---------------------------------------------------------------------
+// Command handlers: args is the text after the command word, with the
+// leading spaces skipped
+// ---------------------------------------------------------------------
+
+// OPEN loads every record; OPEN LAZY leaves them in the file until needed
+static CommandStatus doOpen(const char *args, CommandArgs *cmd, int interactive) {
+    if (*args == '\0') return openDB() ? COMMAND_OK : COMMAND_FAILED;
+    if (strcasecmp(args, "LAZY") == 0) return openLazyDB() ? COMMAND_OK : COMMAND_FAILED;
+    outputPrintf("CMS: Invalid OPEN format. Use OPEN or OPEN LAZY.\n");
+    return COMMAND_FAILED;
+}
+
+
+// Every view but SHOW STATS needs the whole table
+static CommandStatus doShow(const char *args, CommandArgs *cmd, int interactive) {
+    if (strcasecmp(args, "STATS") != 0 && !materializeDB()) return COMMAND_FAILED;
+    return handleShow(args) ? COMMAND_OK : COMMAND_FAILED;
+}
+
+
+static CommandStatus doInsert(const char *args, CommandArgs *cmd, int interactive) {
+    if (!parseCommand(args, cmd, OPTIONAL_ALLOWED_EMPTY) || !loadRecordDB(cmd->id)) return COMMAND_FAILED;
+    return insertDB(cmd->id, cmd->name, cmd->programme, cmd->mark, 0) ? COMMAND_OK : COMMAND_FAILED;
+}
+
+
+// Fields left out of UPDATE keep their value; a negative mark tells
+// updateDB() not to touch the mark
+static CommandStatus doUpdate(const char *args, CommandArgs *cmd, int interactive) {
+    if (!parseCommand(args, cmd, OPTIONAL_REQUIRED) || !loadRecordDB(cmd->id)) return COMMAND_FAILED;
+    float mark = (cmd->provided & ARG_MARK) ? cmd->mark : -1.0f;
+    return updateDB(cmd->id, cmd->name, cmd->programme, mark, 0) ? COMMAND_OK : COMMAND_FAILED;
+}
+
+
+// Deletes after a Y/N confirmation at the prompt
+static CommandStatus doDelete(const char *args, CommandArgs *cmd, int interactive) {
+    if (!parseCommand(args, cmd, OPTIONAL_NONE) || !loadRecordDB(cmd->id)) return COMMAND_FAILED;
+
+    int deleteID = cmd->id;
+    if (!deleteDB(deleteID, 0, 0)) {
+        outputPrintf("CMS: The record with ID=%d does not exist.\n", deleteID);
+        return COMMAND_FAILED;
+    }
+    if (!interactive) return deleteDB(deleteID, 1, 0) ? COMMAND_OK : COMMAND_FAILED;
+
+    outputPrintf("CMS: Are you sure you want to delete record with ID=%d? Type \"Y\" to confirm or \"N\" to cancel.\n", deleteID);
+    if (confirm("CMS: Fatal error reading confirmation input. The deletion is cancelled.",
+                "CMS: The deletion is cancelled.",
+                "CMS: Invalid input. The deletion is cancelled.")) {
+        deleteDB(deleteID, 1, 0);
+    }
+    return COMMAND_OK;
+}
+
+
+static CommandStatus doQuery(const char *args, CommandArgs *cmd, int interactive) {
+    if (!parseCommand(args, cmd, OPTIONAL_LOOKUP)) return COMMAND_FAILED;
+    if (cmd->provided & ARG_NAME) {
+        if (!materializeDB()) return COMMAND_FAILED;
+        return queryNameDB(cmd->name) ? COMMAND_OK : COMMAND_FAILED;
+    }
+    return queryDB(cmd->id) ? COMMAND_OK : COMMAND_FAILED;
+}
+
+
+static CommandStatus doUndo(const char *args, CommandArgs *cmd, int interactive) {
+    return undo() ? COMMAND_OK : COMMAND_FAILED;
+}
+
+
+static CommandStatus doRedo(const char *args, CommandArgs *cmd, int interactive) {
+    return redo() ? COMMAND_OK : COMMAND_FAILED;
+}
+
+
+// SAVE writes in the foreground; SAVE ASYNC hands the work to a thread
+static CommandStatus doSave(const char *args, CommandArgs *cmd, int interactive) {
+    if (*args == '\0') return saveDB() ? COMMAND_OK : COMMAND_FAILED;
+    if (strcasecmp(args, "ASYNC") == 0) return saveAsyncDB() ? COMMAND_OK : COMMAND_FAILED;
+    outputPrintf("CMS: Invalid SAVE format. Use SAVE or SAVE ASYNC.\n");
+    return COMMAND_FAILED;
+}
+
+
+// Handles AUTOSAVE OFF | [CHANGES=<n>] [SECONDS=<t>]: background saves
+// after n changes, or t seconds after the first unsaved change
+static CommandStatus doAutosave(const char *args, CommandArgs *cmd, int interactive) {
+    if (strcasecmp(args, "OFF") == 0) return setAutosave(0, 0) ? COMMAND_OK : COMMAND_FAILED;
+
+    long changes = 0, seconds = 0;
+    const char *p = args;
+    int valid = *p != '\0';
+    while (valid && *p) {
+        long *target = strncasecmp(p, "CHANGES=", 8) == 0 ? &changes
+                       : strncasecmp(p, "SECONDS=", 8) == 0 ? &seconds : NULL;
+        char *end = NULL;
+        if (target) *target = strtol(p + 8, &end, 10);
+        valid = target && end != p + 8 && *target > 0 && (*end == '\0' || isspace((unsigned char)*end));
+        if (!valid) break;
+        p = end;
+        while (isspace((unsigned char)*p)) p++;
+    }
+    if (!valid) {
+        outputPrintf("CMS: Invalid AUTOSAVE format. Use AUTOSAVE OFF or AUTOSAVE CHANGES=<n> SECONDS=<t> (either or both).\n");
+        return COMMAND_FAILED;
+    }
+    return setAutosave(changes, seconds) ? COMMAND_OK : COMMAND_FAILED;
+}
+
+
+// Splits the table into ID-range shard files
+static CommandStatus doShard(const char *args, CommandArgs *cmd, int interactive) {
+    return shardDB() ? COMMAND_OK : COMMAND_FAILED;
+}
+
+
+static CommandStatus doCompact(const char *args, CommandArgs *cmd, int interactive) {
+    return compactDB() ? COMMAND_OK : COMMAND_FAILED;
+}
+
+
+static CommandStatus doNext(const char *args, CommandArgs *cmd, int interactive) {
+    return showNext() ? COMMAND_OK : COMMAND_FAILED;
+}
+
+
+// Reloads the backup after a Y/N confirmation at the prompt
+static CommandStatus doRestore(const char *args, CommandArgs *cmd, int interactive) {
+    if (!dbLoaded) {
+        outputPrintf("CMS: No records loaded. Open the database first.\n");
+        return COMMAND_FAILED;
+    }
+    if (!interactive) return restoreDB(0) ? COMMAND_OK : COMMAND_FAILED;
+
+    outputPrintf("CMS: WARNING: This will overwrite the current in-memory state with the backup file. Are you sure? Type \"Y\" to confirm or \"N\" to cancel.\n");
+    if (confirm("CMS: Fatal error reading confirmation input. Restore cancelled.",
+                "CMS: Restore operation cancelled.",
+                "CMS: Invalid input. Restore operation cancelled.")) {
+        restoreDB(0);
+    }
+    return COMMAND_OK;
+}
+
+
+// BEGIN / COMMIT / ROLLBACK group the changes between them into one step
+static CommandStatus doBegin(const char *args, CommandArgs *cmd, int interactive) {
+    return beginDB() ? COMMAND_OK : COMMAND_FAILED;
+}
+
+
+static CommandStatus doCommit(const char *args, CommandArgs *cmd, int interactive) {
+    return commitDB() ? COMMAND_OK : COMMAND_FAILED;
+}
+
+
+static CommandStatus doRollback(const char *args, CommandArgs *cmd, int interactive) {
+    return rollbackDB() ? COMMAND_OK : COMMAND_FAILED;
+}
+
+
+// Bulk-adds the rows of a TSV/CSV file
+static CommandStatus doImport(const char *args, CommandArgs *cmd, int interactive) {
+    char path[1024];
+    const char *unused;
+    if (!parsePath(args, NULL, path, sizeof(path), &unused)) {
+        outputPrintf("CMS: Invalid IMPORT format. Use IMPORT FILE=<path>.\n");
+        return COMMAND_FAILED;
+    }
+    return importDB(path) ? COMMAND_OK : COMMAND_FAILED;
+}
+
+
+static CommandStatus doRun(const char *args, CommandArgs *cmd, int interactive) {
+    return runScript(args);
+}
+
+
+// Quits, asking first at the prompt (with a warning if there are unsaved
+// changes)
+static CommandStatus doQuit(const char *args, CommandArgs *cmd, int interactive) {
+    if (*args != '\0') {
+        outputPrintf("CMS: Enter a valid command (QUIT takes no arguments).\n");
+        return COMMAND_FAILED;
+    }
+    if (!interactive) return COMMAND_QUIT;
+
+    saveWait();     // A background save may still turn out to cover the changes
+    if (dbInTransaction()) {
+        outputPrintf("CMS: WARNING: A transaction is open and none of its changes are saved. Are you sure you want to quit? Type \"Y\" to confirm or \"N\" to cancel.\n");
+    }
+    else if (dbLoaded && dbModified) {
+        outputPrintf("CMS: WARNING: You have unsaved changes. Are you sure you want to quit? Type \"Y\" to confirm or \"N\" to cancel.\n");
+    }
+    else {
+        outputPrintf("CMS: Are you sure you want to quit? There are no unsaved changes. Type \"Y\" to confirm or \"N\" to cancel.\n");
+    }
+
+    if (confirm("CMS: Fatal error reading confirmation input. Quit cancelled.",
+                "CMS: Quit operation cancelled.",
+                "CMS: Invalid input. Quit operation cancelled.")) {
+        return COMMAND_QUIT;
+    }
+    return COMMAND_OK;
+}
+
+
+// Handles STATS ON|OFF|RESET: switches command timing for SHOW STATS
+static CommandStatus doStats(const char *args, CommandArgs *cmd, int interactive) {
+    if (strcasecmp(args, "ON") == 0) {
+        statsEnabled = 1;
+        outputPrintf("CMS: Command timing is on.\n");
+    }
+    else if (strcasecmp(args, "OFF") == 0) {
+        statsEnabled = 0;
+        outputPrintf("CMS: Command timing is off.\n");
+    }
+    else if (strcasecmp(args, "RESET") == 0) {
+        statsReset();
+        outputPrintf("CMS: Command timings have been reset.\n");
+    }
+    else {
+        outputPrintf("CMS: Invalid STATS format. Use STATS ON, STATS OFF or STATS RESET.\n");
+        return COMMAND_FAILED;
+    }
+    return COMMAND_OK;
+}
+
+
+// ---------------------------------------------------------------------
+// Dispatch table
+// ---------------------------------------------------------------------
+
+#define CMD_NO_ARGS 1           // Anything after the word is "Enter a valid command."
+#define CMD_NEEDS_DB 2          // Refused until a database has been opened
+#define CMD_LAZY 4              // Runs without loading the whole of a lazily opened or sharded table first
+#define CMD_NO_TRANSACTION 8    // Refused between BEGIN and COMMIT/ROLLBACK
+
+typedef CommandStatus (*CommandFn)(const char *args, CommandArgs *cmd, int interactive);
+
+typedef struct CommandEntry {
+    const char *word;
+    CommandFn run;
+    int flags;
+} CommandEntry;
+
+static const CommandEntry commands[] = {
+    { "OPEN",    doOpen,    CMD_LAZY | CMD_NO_TRANSACTION },
+    { "SHOW",    doShow,    CMD_NEEDS_DB | CMD_LAZY },
+    { "INSERT",  doInsert,  CMD_NEEDS_DB | CMD_LAZY },
+    { "UPDATE",  doUpdate,  CMD_NEEDS_DB | CMD_LAZY },
+    { "DELETE",  doDelete,  CMD_NEEDS_DB | CMD_LAZY },
+    { "QUERY",   doQuery,   CMD_NEEDS_DB | CMD_LAZY },
+    { "UNDO",    doUndo,    CMD_NO_ARGS | CMD_NEEDS_DB | CMD_NO_TRANSACTION },
+    { "REDO",    doRedo,    CMD_NO_ARGS | CMD_NEEDS_DB | CMD_NO_TRANSACTION },
+    { "SAVE",    doSave,    CMD_NEEDS_DB | CMD_LAZY | CMD_NO_TRANSACTION },
+    { "COMPACT", doCompact, CMD_NO_ARGS | CMD_NEEDS_DB | CMD_NO_TRANSACTION },
+    { "SHARD",   doShard,   CMD_NO_ARGS | CMD_NEEDS_DB | CMD_NO_TRANSACTION },
+    { "NEXT",    doNext,    CMD_NO_ARGS | CMD_NEEDS_DB },
+    { "RESTORE", doRestore, CMD_NO_ARGS | CMD_NO_TRANSACTION },
+    { "IMPORT",  doImport,  CMD_NEEDS_DB | CMD_NO_TRANSACTION },
+    { "BEGIN",   doBegin,   CMD_NO_ARGS | CMD_NEEDS_DB | CMD_LAZY },
+    { "COMMIT",  doCommit,  CMD_NO_ARGS | CMD_LAZY },
+    { "ROLLBACK", doRollback, CMD_NO_ARGS | CMD_LAZY },
+    { "RUN",     doRun,     CMD_LAZY },
+    { "QUIT",    doQuit,    CMD_LAZY },
+    { "STATS",   doStats,   CMD_LAZY },
+    { "AUTOSAVE", doAutosave, CMD_LAZY },
+};
+
+#define COMMAND_COUNT ((int)(sizeof(commands) / sizeof(commands[0])))
+#define COMMAND_LONGEST 8       // Longest command word
+#define COMMAND_SLOTS 64        // Hash slots, a power of two
+
+// Command word hash -> index into commands + 1 (0 = empty slot)
+static unsigned char commandSlots[COMMAND_SLOTS];
+static int commandSlotsBuilt = 0;
+
+
+// Case-insensitive hash of a command word
+static unsigned int hashWord(const char *word, size_t length) {
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char)toupper((unsigned char)word[i])) * 16777619u;
+    }
+    return hash;
+}
+
+
+// Places every command word in the hash slots (linear probing)
+static void buildCommandSlots() {
+    for (int c = 0; c < COMMAND_COUNT; c++) {
+        unsigned int slot = hashWord(commands[c].word, strlen(commands[c].word)) & (COMMAND_SLOTS - 1);
+        while (commandSlots[slot]) slot = (slot + 1) & (COMMAND_SLOTS - 1);
+        commandSlots[slot] = (unsigned char)(c + 1);
+    }
+    commandSlotsBuilt = 1;
+}
+
+
+// Returns the command spelled by word (any case), or NULL
+static const CommandEntry *findCommand(const char *word, size_t length) {
+    if (length == 0 || length > COMMAND_LONGEST) return NULL;
+    if (!commandSlotsBuilt) buildCommandSlots();
+
+    unsigned int slot = hashWord(word, length) & (COMMAND_SLOTS - 1);
+    for (; commandSlots[slot]; slot = (slot + 1) & (COMMAND_SLOTS - 1)) {
+        const CommandEntry *entry = &commands[commandSlots[slot] - 1];
+        if (strlen(entry->word) == length && strncasecmp(word, entry->word, length) == 0) return entry;
+    }
+    return NULL;
+}
+
+
+// Looks up the command word of a line; *args is set to the text after it,
+// with the leading spaces skipped
+static const CommandEntry *lineCommand(const char *input, const char **args) {
+    const char *word = input;
+    while (*word && isspace((unsigned char)*word)) word++;
+
+    const char *end = word;
+    while (*end && !isspace((unsigned char)*end)) end++;
+    const CommandEntry *entry = findCommand(word, (size_t)(end - word));
+    while (*end && isspace((unsigned char)*end)) end++;
+    *args = end;
+    return entry;
+}
+
+
+/**
+ * executeCommand()
+ * -----------------------------------------
+ * Validates one command line and runs it against the database. The first
+ * word is looked up in a hash of the command words, so a line costs one
+ * lookup whichever command it is, and the arguments are parsed in place
+ * into a CommandArgs on the stack.
+ *
+ * @param input       - the command line
+ * @param interactive - 1 to ask for Y/N confirmations at the prompt,
+ *                      0 when running a script
+ * @return COMMAND_OK, COMMAND_FAILED, or COMMAND_QUIT once QUIT is confirmed
+ */
+CommandStatus executeCommand(const char *input, int interactive) {
+    const char *args;
+    const CommandEntry *entry = lineCommand(input, &args);
+    if (!entry) {
+        outputPrintf("CMS: Enter a valid command\n");
+        return COMMAND_FAILED;
+    }
+
+    if ((entry->flags & CMD_NO_ARGS) && *args != '\0') {
+        outputPrintf("CMS: Enter a valid command.\n");
+        return COMMAND_FAILED;
+    }
+    if ((entry->flags & CMD_NEEDS_DB) && requireLoaded()) return COMMAND_FAILED;
+    if ((entry->flags & CMD_NO_TRANSACTION) && dbInTransaction()) {
+        outputPrintf("CMS: %s cannot run inside a transaction. COMMIT or ROLLBACK it first.\n", entry->word);
+        return COMMAND_FAILED;
+    }
+    if (!(entry->flags & CMD_LAZY) && !materializeDB()) return COMMAND_FAILED;
+
+    CommandArgs cmd;
+    if (!statsEnabled) return entry->run(args, &cmd, interactive);
+
+    // Timed run; a nested RUN keeps its own prompt-free timing
+    double outerPrompt = promptSeconds;
+    promptSeconds = 0.0;
+    double started = timerNow();
+    CommandStatus status = entry->run(args, &cmd, interactive);
+    double elapsed = timerNow() - started - promptSeconds;
+    promptSeconds = outerPrompt;
+    statsRecord((int)(entry - commands), entry->word, elapsed > 0 ? elapsed : 0.0, status == COMMAND_FAILED);
+    return status;
+}
+
+
+/**
+ * runBatch()
+ * -----------------------------------------
+ * Executes a script line by line without prompts, then reports how many
+ * commands ran, how many failed and the throughput.
+ *
+ * @param stream - script to read until end of input
+ * @param source - name of the script, used in messages
+ * @param policy - BATCH_STOP_ON_ERROR ends the script at the first failure
+ * @param quit   - set to 1 if the script ended with QUIT (may be NULL)
+ * @return number of failed commands
+ */
+long runBatch(FILE *stream, const char *source, BatchPolicy policy, int *quit) {
+    long lineNo = 0, commands = 0, failed = 0;
+    int quitting = 0;
+    char *line;
+
+    // stdin keeps its shared reader; a script file gets one of its own
+    LineReader fileReader;
+    LineReader *reader = lineReaderStdin();
+    if (stream != stdin) {
+        lineReaderInit(&fileReader, stream);
+        reader = &fileReader;
+    }
+
+    batchDepth++;
+    double started = timerNow();
+
+    while ((line = lineReaderNext(reader, NULL)) != NULL) {
+        lineNo++;
+
+        const char *text = line;
+        while (isspace((unsigned char)*text)) text++;
+        if (*text == '\0' || *text == '#') {    // Blank line or comment
+            continue;
+        }
+
+        outputPrintf("\nP4_1: %s\n", text);
+        commands++;
+        CommandStatus status = executeCommand(text, 0);
+        saveTick();
+
+        if (status == COMMAND_QUIT) {
+            quitting = 1;
+            break;
+        }
+        if (status == COMMAND_FAILED) {
+            failed++;
+            if (policy == BATCH_STOP_ON_ERROR) {
+                outputPrintf("CMS: Stopping \"%s\" at line %ld after a failed command.\n", source, lineNo);
+                break;
+            }
+        }
+    }
+
+    double elapsed = timerNow() - started;
+    batchDepth--;
+    if (reader == &fileReader) lineReaderFree(&fileReader);
+
+    outputPrintf("\nCMS: Ran %ld command%s from \"%s\" in %.3f seconds (%.0f commands/s), %ld failed.\n",
+                 commands, commands == 1 ? "" : "s", source, elapsed,
+                 elapsed > 0 ? commands / elapsed : 0.0, failed);
+    outputFlush();
+
+    if (quit) *quit = quitting;
+    return failed;
+}
+
+
+// Whether text starts with word (any case) followed by a space or the end
+static int startsWithWord(const char *text, const char *word) {
+    size_t length = strlen(word);
+    return strncasecmp(text, word, length) == 0 && (text[length] == '\0' || isspace((unsigned char)text[length]));
+}
+
+
+/**
+ * commandIsSnapshotRead()
+ * -----------------------------------------
+ * Tells whether a line prints the whole table, the kind of read-only
+ * command the server runs in a snapshot reader: SHOW ALL, sorted or not,
+ * without LIMIT or WHERE. A limited view keeps a NEXT position that a
+ * reader could not hand back, and filters and summaries usually finish
+ * faster than a fork. Any doubt answers 0, which just runs the command
+ * in place.
+ *
+ * @param sorted - set to 1 if the view has SORT BY
+ */
+int commandIsSnapshotRead(const char *input, int *sorted) {
+    const char *args;
+    const CommandEntry *entry = lineCommand(input, &args);
+    if (!entry || entry->run != doShow || !dbLoaded || !startsWithWord(args, "ALL")) return 0;
+
+    *sorted = 0;
+    for (const char *p = args; *p; ) {
+        while (isspace((unsigned char)*p)) p++;
+        if (startsWithWord(p, "LIMIT") || startsWithWord(p, "WHERE")) return 0;
+        if (startsWithWord(p, "SORT")) *sorted = 1;
+        while (*p && !isspace((unsigned char)*p)) p++;
+    }
+    return 1;
+}
+
+
+void commandRecord(const char *input, double seconds, int failed) {
+    const char *args;
+    const CommandEntry *entry = lineCommand(input, &args);
+    if (!statsEnabled || !entry) return;
+    statsRecord((int)(entry - commands), entry->word, seconds, failed);
+}
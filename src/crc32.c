@@ -0,0 +1,50 @@
+/**
+ * CRC-32
+ * --------------------------------------
+ * IEEE 802.3 checksum shared by the binary snapshot and the journal to
+ * detect torn or corrupted data. Uses slicing-by-8 tables so checksumming
+ * keeps up with sequential reads.
+ *
+ * Authors: Team P4-1
+ */
+
+#include "headers/crc32.h"
+
+
+// Slicing-by-8 lookup tables: crcTable[0] is the classic byte table and
+// crcTable[k] advances a byte that sits k positions further back
+static uint32_t crcTable[8][256];
+static int crcReady = 0;
+
+static void crcInit() {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        crcTable[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int k = 1; k < 8; k++) {
+            crcTable[k][i] = (crcTable[k - 1][i] >> 8) ^ crcTable[0][crcTable[k - 1][i] & 0xFF];
+        }
+    }
+    crcReady = 1;
+}
+
+// Extends a running CRC (start with 0) over len bytes, 8 bytes per step
+uint32_t crc32Update(uint32_t crc, const void *data, size_t len) {
+    if (!crcReady) crcInit();
+    const unsigned char *p = data;
+    crc = ~crc;
+    while (len >= 8) {
+        uint32_t lo = crc ^ ((uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24);
+        uint32_t hi = (uint32_t)p[4] | (uint32_t)p[5] << 8 | (uint32_t)p[6] << 16 | (uint32_t)p[7] << 24;
+        crc = crcTable[7][lo & 0xFF] ^ crcTable[6][(lo >> 8) & 0xFF]
+            ^ crcTable[5][(lo >> 16) & 0xFF] ^ crcTable[4][lo >> 24]
+            ^ crcTable[3][hi & 0xFF] ^ crcTable[2][(hi >> 8) & 0xFF]
+            ^ crcTable[1][(hi >> 16) & 0xFF] ^ crcTable[0][hi >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len--) crc = crcTable[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
@@ -0,0 +1,216 @@
+/**
+ * File I/O Helpers
+ * --------------------------------------
+ * Small portability layer for durable file updates:
+ * - fileSync() pushes buffered data all the way to disk
+ * - fileReplace() swaps a freshly written temp file into place and keeps
+ *   the previous version as a backup, using renames instead of copies
+ * - fileMapOpen() maps a file read-only, so a lookup only pages in the
+ *   bytes it touches
+ *
+ * Authors: Team P4-1
+ */
+
+#include <stdio.h>
+#include <sys/stat.h>
+#include "headers/file_io.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+
+/**
+ * fileSync()
+ * -----------------------------------------
+ * Flushes the stdio buffer and asks the OS to commit the file to disk.
+ *
+ * @param file - open output stream
+ * @return 1 on success, 0 on any write or sync error
+ */
+int fileSync(FILE *file) {
+    if (fflush(file) != 0 || ferror(file)) return 0;
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+
+#ifndef _WIN32
+// Persists directory entries (renames) by syncing the containing directory
+static void syncParentDir(const char *path) {
+    char dir[512];
+    const char *slash = NULL;
+    for (const char *p = path; *p; p++) {
+        if (*p == '/') slash = p;
+    }
+    if (!slash) {
+        dir[0] = '.';
+        dir[1] = '\0';
+    }
+    else {
+        size_t len = (size_t)(slash - path);
+        if (len == 0) len = 1;
+        if (len >= sizeof(dir)) return;
+        for (size_t i = 0; i < len; i++) dir[i] = path[i];
+        dir[len] = '\0';
+    }
+
+    int fd = open(dir, O_RDONLY);
+    if (fd < 0) return;
+    fsync(fd);
+    close(fd);
+}
+#endif
+
+
+/**
+ * fileReplace()
+ * -----------------------------------------
+ * Installs tempPath as targetPath. When a backup path is given and the
+ * target already exists, the old target becomes the backup. No file
+ * contents are copied; at every point either the old or the new target
+ * is present under targetPath.
+ *
+ * @param tempPath   - fully written and synced replacement file
+ * @param targetPath - file to replace
+ * @param backupPath - where to keep the previous target (or NULL)
+ * @return 1 on success, 0 on failure
+ */
+int fileReplace(const char *tempPath, const char *targetPath, const char *backupPath) {
+#ifdef _WIN32
+    if (backupPath && fileExists(targetPath)) {
+        DeleteFileA(backupPath);
+        return ReplaceFileA(targetPath, tempPath, backupPath, 0, NULL, NULL) != 0;
+    }
+    return MoveFileExA(tempPath, targetPath,
+                       MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    if (backupPath && fileExists(targetPath)) {
+        // Hard link keeps the current target visible while the backup is made
+        unlink(backupPath);
+        if (link(targetPath, backupPath) != 0) return 0;
+    }
+    if (rename(tempPath, targetPath) != 0) return 0;
+    syncParentDir(targetPath);
+    return 1;
+#endif
+}
+
+
+// Returns 1 if the path exists and can be opened for reading
+int fileExists(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) return 0;
+    fclose(file);
+    return 1;
+}
+
+
+// Returns the last-modification time of a file, or -1 if it does not exist
+long long fileModTime(const char *path) {
+    struct stat info;
+    if (stat(path, &info) != 0) return -1;
+    return (long long)info.st_mtime;
+}
+
+
+// Returns the size of a file in bytes, or -1 if it does not exist
+long long fileSize(const char *path) {
+    struct stat info;
+    if (stat(path, &info) != 0) return -1;
+    return (long long)info.st_size;
+}
+
+
+// Cuts an open file down to size bytes (buffered output is flushed first)
+int fileTruncate(FILE *file, long long size) {
+    if (fflush(file) != 0) return 0;
+#ifdef _WIN32
+    return _chsize_s(_fileno(file), size) == 0;
+#else
+    return ftruncate(fileno(file), (off_t)size) == 0;
+#endif
+}
+
+
+/**
+ * fileMapOpen()
+ * -----------------------------------------
+ * Maps a whole file into memory for reading. An empty file maps to
+ * data == NULL with size 0.
+ *
+ * @param path - file to map
+ * @param map  - filled in on success; release with fileMapClose()
+ * @return 1 on success, 0 if the file is missing or cannot be mapped
+ */
+int fileMapOpen(const char *path, FileMap *map) {
+    map->data = NULL;
+    map->size = 0;
+    map->handle = NULL;
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return 0;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return 0;
+    }
+    if (size.QuadPart > 0) {
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        void *view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+        if (!view) {
+            if (mapping) CloseHandle(mapping);
+            CloseHandle(file);
+            return 0;
+        }
+        map->data = view;
+        map->handle = mapping;
+    }
+    map->size = (size_t)size.QuadPart;
+    CloseHandle(file);      // The mapping keeps the file open
+    return 1;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return 0;
+    }
+    if (info.st_size > 0) {
+        void *data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return 0;
+        }
+        map->data = data;
+    }
+    map->size = (size_t)info.st_size;
+    close(fd);              // The mapping stays valid without the descriptor
+    return 1;
+#endif
+}
+
+
+void fileMapClose(FileMap *map) {
+    if (map->data) {
+#ifdef _WIN32
+        UnmapViewOfFile((void*)map->data);
+        CloseHandle(map->handle);
+#else
+        munmap((void*)map->data, map->size);
+#endif
+    }
+    map->data = NULL;
+    map->size = 0;
+    map->handle = NULL;
+}
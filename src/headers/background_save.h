@@ -0,0 +1,44 @@
+#ifndef BACKGROUND_SAVE_H
+#define BACKGROUND_SAVE_H
+
+#include "snapshot.h"
+
+// =========================
+// Background Save Configuration
+// =========================
+#define SAVE_WRITE_CHUNK (1024 * 1024)          // Text bytes formatted per write by the save thread
+#define SAVE_ERROR_MAX 96                       // Room for the reason a background save failed
+
+// =========================
+// Data Structures
+// =========================
+
+// State of the background save, as seen by backgroundSavePoll()
+typedef enum {
+    SAVE_IDLE,                  // None started since the last result was collected
+    SAVE_RUNNING,
+    SAVE_FINISHED               // Finished; the result has been filled in
+} BackgroundSaveState;
+
+typedef struct BackgroundSaveResult {
+    int ok;
+    int snapshotFailed;         // The base file was written but the binary snapshot was not
+    long records;
+    double seconds;             // From backgroundSaveStart() to the end of the write
+    char error[SAVE_ERROR_MAX]; // Why it failed, when !ok
+} BackgroundSaveResult;
+
+// =========================
+// Function Prototypes
+// =========================
+
+// Writes a captured table as the base file and binary snapshot on a
+// worker thread (or right away if no thread can be started). Takes
+// ownership of the image. Returns 0 if a save is already running.
+int backgroundSaveStart(SnapshotImage *image);
+
+// Reports on the save started last; with wait set, waits for it to
+// finish. SAVE_FINISHED is returned once per save.
+BackgroundSaveState backgroundSavePoll(int wait, BackgroundSaveResult *result);
+
+#endif
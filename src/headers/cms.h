@@ -1,13 +1,55 @@
 #ifndef CMS_H
 #define CMS_H
 
+#include "id_index.h"
+#include "order_index.h"
+#include "record_sort.h"
+#include "pool.h"
+#include "string_pool.h"
+#include "programme_dict.h"
+
 // =========================
 // System Configuration Limits
 // =========================
 #define MAX_LINE 256            // Maximum length for input line parsing
 #define MAX_NAME 100            // Maximum character size for student name field
 #define MAX_PROGRAMME 100       // Maximum character size for programme field
-#define TABLE_SIZE 2003         // Hash table size (prime number improves distribution)
+#define LOAD_MAX_DIAGNOSTICS 10 // Skipped-line messages printed per load before summarising
+#define LOAD_MIN_ROW_BYTES 48   // Typical minimum bytes per data row, used to pre-size the ID index
+#define NODE_SLAB_SIZE 4096     // Record nodes allocated per pool slab
+#define NAME_POOL_COMPACT_MIN (1 << 20) // Released name bytes tolerated before compacting namePool
+#define ACTION_SLAB_SIZE 256    // Undo/redo actions allocated per pool slab
+#define JOURNAL_COMPACT_MIN (1 << 20)   // Journal bytes tolerated before SAVE folds it into the base file
+#define BULK_REBUILD_PCT 10     // Bulk changes above this share of the table rebuild the ordered indexes instead of updating them
+#define SAVE_ROUND_RECORDS 16384 // Records each SAVE formatting task handles per round
+#define WHERE_SCAN_PCT 50       // Filtered views expected to match more than this share of the table scan the list instead of an index
+#define COLUMN_MIN_CAPACITY 1024 // Rows the dense ID/mark columns start out with
+#define COLUMN_SCAN_BLOCK 4096  // Column rows tested per kernel call in a filtered scan
+#define PERCENTILE_BINS 4096    // Histogram bins used to locate percentile ranks
+#define NAME_SORT_KEY_BYTES 16  // Leading name bytes compared as integers while building the name index
+#define UNDO_MAX_ACTIONS 10000  // Undo steps kept; older ones are dropped first
+#define UNDO_MAX_BYTES (256u * 1024 * 1024) // Memory the undo/redo history may hold (the newest step is always kept)
+#define LAZY_JOURNAL_MAX (4 << 20) // Largest journal OPEN LAZY holds in memory; beyond it the table is loaded
+
+// =========================
+// Database Files
+// =========================
+#define DB_FILE_PATH "./data/P4_1-CMS.txt"      // Main tab-separated database file
+#define DB_BACKUP_PATH "./data/P4_1-CMS.bak"    // Previous version kept by SAVE
+#define DB_TEMP_PATH "./data/P4_1-CMS.tmp"      // Staging file written before the atomic swap
+#define DB_SNAPSHOT_PATH "./data/P4_1-CMS.cms"  // Binary snapshot preferred by OPEN when newer
+#define DB_SNAPSHOT_TEMP_PATH "./data/P4_1-CMS.cms.tmp"
+#define DB_JOURNAL_PATH "./data/P4_1-CMS.jnl"   // Changes saved since the base file was written
+#define DB_JOURNAL_BACKUP_PATH "./data/P4_1-CMS.jnl.bak" // Journal that goes with the backup file
+#define DB_OFFSET_INDEX_PATH "./data/P4_1-CMS.idx"  // ID -> line offset index read by OPEN LAZY
+#define DB_SHARD_MANIFEST_PATH "./data/P4_1-CMS.shards" // Shard list of a table split by SHARD
+#define DB_SHARD_PREFIX "./data/P4_1-CMS-"       // Shard files: prefix + key + ".txt" / ".bak"
+
+// Lines ahead of the records in the base file, exactly as the loader expects them
+#define DB_TEXT_HEADER "Database Name: P4_1-CMS\n" \
+                       "Authors: P4-1\n\n" \
+                       "Table Name: StudentRecords\n" \
+                       "ID\tName\tProgramme\tMark\n"
 
 // =========================
 // Display Formatting
@@ -27,42 +69,119 @@ typedef struct StudentRecord {
     float mark;
 } StudentRecord;
 
-// Linked list + hash table node used for storage, lookup, and traversal
+// Compact in-memory record, kept on a doubly linked list in insertion order
+// and indexed by ID in idIndex. The name lives in namePool and the programme
+// in the programme dictionary; read them through nodeName()/nodeProgramme().
+// The order links place it in the sorted indexes idOrder, markOrder,
+// groupOrder and nameOrder.
 typedef struct Node {
-    StudentRecord data;
-    struct Node *next;          // Linked list pointer
-    struct Node *hashNext;      // Hash table chaining pointer
+    int id;
+    float mark;
+    unsigned int nameOffset;    // Offset of the name in namePool
+    unsigned short nameLength;  // Cached strlen() of the name
+    ProgCode programme;         // Programme dictionary code
+    struct Node *prev;          // Previous record in insertion order
+    struct Node *next;          // Next record in insertion order
+    struct Node *orderLinks[ORDER_SLOTS][2];    // Children in each ordered index
+    unsigned int seq;           // Insertion sequence, breaks ties between equal marks
+    unsigned int column;        // Row of the record in the dense ID/mark columns
+    signed char orderHeight[ORDER_SLOTS];       // AVL subtree heights
 } Node;
 
+// Field accessors for the pooled strings of a node
+#define nodeName(node) stringPoolGet(&namePool, (node)->nameOffset)
+#define nodeProgramme(node) programmeName((node)->programme)
+
 // Enumeration to classify operation types for undo/redo tracking
 typedef enum {
     INSERT_OP,
     UPDATE_OP,
     DELETE_OP,
-    RESTORE_OP 
+    RESTORE_OP,
+    IMPORT_OP,
+    TRANSACTION_OP
 } ActionType;
 
-// Action structure stored in the undo/redo stacks to revert/reenact changes
+// Records added by one IMPORT, kept in column form so undo can remove them
+// and redo can add them back in one step
+typedef struct RecordBatch {
+    size_t count;
+    int *ids;
+    float *marks;
+    ProgCode *programmes;
+    unsigned int *nameOffsets;  // Into names
+    char *names;                // NUL-terminated names, back to back
+} RecordBatch;
+
+// Conditions of SHOW ALL WHERE, all of which must hold. Ranges are
+// inclusive and start out covering every value.
+typedef struct RecordFilter {
+    int active;                 // A WHERE clause was given
+    int minId, maxId;
+    float minMark, maxMark;
+    int hasProgramme;
+    char programme[MAX_PROGRAMME];  // Matched case-insensitively, like SHOW SUMMARY
+    char text[MAX_LINE];        // The conditions as typed, for the header line
+} RecordFilter;
+
+// Paging and format settings of SHOW ALL
+typedef struct ViewOptions {
+    size_t limit;               // Records per page; 0 shows everything from offset on
+    size_t offset;              // Records skipped before the first one shown
+    int tsv;                    // Tab-separated rows instead of the aligned table
+    RecordFilter where;
+} ViewOptions;
+
+// Fields an UPDATE_OP changed
+#define ACTION_NAME 1
+#define ACTION_PROGRAMME 2
+#define ACTION_MARK 4
+
+// Action structure stored in the undo/redo stacks to revert/reenact changes.
+// Only what the change needs is kept: INSERT_OP the new record, DELETE_OP
+// the old one, and UPDATE_OP the old and new values of the fields it
+// changed. Names are heap copies. A TRANSACTION_OP holds the steps of
+// one BEGIN ... COMMIT, undone and redone together.
 typedef struct Action {
     ActionType type;
-    StudentRecord oldData;
-    StudentRecord newData;
-    struct Action *next;
+    int id;
+    int changed;                // UPDATE_OP: ACTION_* flags
+    char *oldName;
+    char *newName;
+    ProgCode oldProgramme;
+    ProgCode newProgramme;
+    float oldMark;
+    float newMark;
+    RecordBatch *batch;         // IMPORT_OP only
+    struct TableState *table;   // RESTORE_OP: the table that is not loaded right now
+    struct Action *steps;       // TRANSACTION_OP: its changes, newest first (linked like a stack)
+    size_t stepCount;           // TRANSACTION_OP: number of steps
+    size_t bytes;               // Memory held by the action, counted against UNDO_MAX_BYTES
+    struct Action *next;        // Older action on the same stack
+    struct Action *prev;        // Newer action on the same stack
 } Action;
 
 // =========================
 // Global Variables
 // =========================
 extern FILE *fptr;                     // File pointer used for reading/writing database files
-extern Node *head;                     // Head of student linked list
+extern Node *head;                     // Head of student linked list (insertion order)
 extern Node *tail;                     // Tail pointer for fast insertions
-extern Node *hashTable[TABLE_SIZE];    // Hash table for fast student lookup
+extern IdIndex idIndex;                // Open-addressing index for fast student lookup by ID
+extern OrderIndex idOrder;             // Records sorted by ID
+extern OrderIndex markOrder;           // Records sorted by mark, then insertion order
+extern OrderIndex groupOrder;          // Records grouped by programme, then sorted by mark
+extern OrderIndex nameOrder;           // Records sorted by case-folded name, then ID
 extern int dbModified;                 // Flag indicating whether unsaved changes exist
 extern int dbLoaded;                   // Flag to ensure certain actions only happen after loading a DB
 
 extern Action *undoStack;              // Stack storing actions for undo functionality
 extern Action *redoStack;              // Stack storing reversed actions for redo functionality
 
+extern Pool nodePool;                  // Slab pool holding every record node
+extern Pool actionPool;                // Slab pool holding undo/redo actions
+extern StringPool namePool;            // Packed storage for record names
+
 // =========================
 // System Function Prototypes
 // =========================
@@ -72,27 +191,66 @@ void printDeclaration();
 
 // Undo/Redo management
 void pushUndo(Action *action);
-void undo();
-void redo();
+int undo();
+int redo();
+
+// Transactions: the changes between BEGIN and COMMIT become one undo step,
+// and ROLLBACK reverses all of them
+int beginDB(void);
+int commitDB(void);
+int rollbackDB(void);
+int dbInTransaction(void);              // 1 between BEGIN and COMMIT/ROLLBACK
 
 // Database file handling
-void openDB();
+int openDB();
+int openLazyDB();                       // OPEN LAZY: serves QUERY ID= from the mapped file
+int materializeDB();                    // Loads a lazily opened table or its unloaded shards; 1 if loaded
+int loadRecordDB(int id);               // Loads what a command on one ID needs; 1 if loaded
+int dbComplete(void);                   // 1 if every record is in memory
+int shardDB(void);                      // SHARD: splits the table into ID-range shard files
 void loadDB(const char *filename);
-void showDB();
 
 // Display functions
-void showDBSorted(int sortByID, int ascending);
-void showSummary(const char *programmeFilter);
+void showView(const SortKey *keys, int keyCount, const ViewOptions *options);
+int showNext();
+void showSummary(const char *programmeFilter, int percentiles);
+void showSummaryByProgramme();
+void showRanked(int highest, size_t count, SortField field, const char *programmeFilter);
+
+// Position of the last SHOW ALL page, continued by NEXT. The server keeps
+// one per connection and swaps it in while that connection's commands run.
+typedef struct PageState PageState;
+PageState *pageStateNew(void);
+void pageStateSwap(PageState *other);
+void pageStateFree(PageState *state);
+void pageStateClear(PageState *state);
+
+// Builds the lazily built indexes that snapshot readers would otherwise
+// each build again
+void prepareSnapshotRead(void);
+
+// Prints memory, index and undo health and the command latency table
+void showStats(void);
+
+// Expands a compact node into a full StudentRecord copy
+void nodeToRecord(const Node *node, StudentRecord *record);
 
 // Core CRUD operations
-void insertDB(int newID, char *newName, char *newProgramme, float newMark, int isUndoRedo);
-void queryDB(int id);
-void updateDB(int id, char *name, char *programme, float mark, int isUndoRedo);
+int insertDB(int newID, const char *newName, const char *newProgramme, float newMark, int isUndoRedo);
+int queryDB(int id);
+int queryNameDB(const char *pattern);   // Exact name, or prefix ending in '*'
+int updateDB(int id, const char *name, const char *programme, float mark, int isUndoRedo);
 int deleteDB(int id, int confirm, int isUndoRedo);
+int importDB(const char *path);
 
 // Save/Restore data operations
-void saveDB();
-void restoreDB(int isUndoRedo);
+int saveDB();
+int compactDB();
+int saveAsyncDB();                      // SAVE ASYNC: writes the files on a background thread
+int setAutosave(long changes, long seconds);
+void saveTick(void);                    // Between commands: reports a finished save, starts a due autosave
+void saveWait(void);                    // Waits for a background save to finish
+int restoreDB(int isUndoRedo);
 void freeDB();
 
 #endif
\ No newline at end of file
@@ -0,0 +1,30 @@
+#ifndef COLUMN_KERNELS_H
+#define COLUMN_KERNELS_H
+
+#include <stddef.h>
+
+// =========================
+// Function Prototypes
+// =========================
+
+// Writes the positions (0 .. count-1) of the rows with
+// minId <= id <= maxId and minMark <= mark <= maxMark to rows, in order,
+// and returns how many there are. rows needs room for count positions.
+size_t kernelSelectRange(const int *ids, const float *marks, size_t count,
+                         int minId, int maxId, float minMark, float maxMark, unsigned int *rows);
+
+// Adds every value to its bin of counts: (value - low) * scale, truncated
+// and clamped to 0 .. bins-1
+void kernelHistogram(const float *values, size_t count, float low, float scale,
+                     int bins, size_t *counts);
+
+// Copies, in order, the values whose kernelHistogram() bin is flagged in
+// wanted to out, and returns how many there are. out needs room for one
+// value more than that: every value is stored before it is counted.
+size_t kernelGatherBins(const float *values, size_t count, float low, float scale,
+                        int bins, const unsigned char *wanted, float *out);
+
+// Sum of (value - mean)^2, accumulated in double precision
+double kernelSquaredDeviation(const float *values, size_t count, double mean);
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#include <stdio.h>
+
+// =========================
+// Command Configuration
+// =========================
+#define BATCH_MAX_DEPTH 8               // RUN scripts nested deeper than this are refused
+
+// =========================
+// Data Structures
+// =========================
+
+// Outcome of one command line
+typedef enum {
+    COMMAND_OK,                 // Executed, or a no-op that left nothing to do
+    COMMAND_FAILED,             // Rejected by validation or by the engine
+    COMMAND_QUIT                // QUIT was confirmed
+} CommandStatus;
+
+// What a batch does when one of its commands fails
+typedef enum {
+    BATCH_STOP_ON_ERROR,
+    BATCH_CONTINUE_ON_ERROR
+} BatchPolicy;
+
+// =========================
+// Function Prototypes
+// =========================
+
+// Runs one command line. Interactive commands prompt for Y/N confirmation;
+// in scripts DELETE, RESTORE and QUIT go ahead without asking.
+CommandStatus executeCommand(const char *input, int interactive);
+
+// Runs every command of a script stream and prints its timing; source names
+// the stream in messages. Returns the number of failed commands and sets
+// *quit when the script ended with QUIT (quit may be NULL).
+long runBatch(FILE *stream, const char *source, BatchPolicy policy, int *quit);
+
+// Whether a command line is a whole-table SHOW ALL the server may run in
+// a snapshot reader; *sorted tells whether it has SORT BY
+int commandIsSnapshotRead(const char *input, int *sorted);
+
+// Adds a run of the line's command to the SHOW STATS timings, for commands
+// that ran in a snapshot reader process
+void commandRecord(const char *input, double seconds, int failed);
+
+#endif
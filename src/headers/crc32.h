@@ -0,0 +1,10 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Extends a running CRC-32 (start with 0) over len bytes
+uint32_t crc32Update(uint32_t crc, const void *data, size_t len);
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef FILE_IO_H
+#define FILE_IO_H
+
+#include <stdio.h>
+
+// =========================
+// File I/O Configuration
+// =========================
+#define IO_BUFFER_SIZE (1 << 20)    // 1 MiB stdio buffer for bulk reads/writes
+
+// =========================
+// Data Structures
+// =========================
+
+// A file mapped read-only into memory
+typedef struct FileMap {
+    const char *data;           // NULL for an empty file
+    size_t size;
+    void *handle;               // Windows file mapping object
+} FileMap;
+
+// =========================
+// Function Prototypes
+// =========================
+
+// Flush stdio buffers and force file contents to stable storage
+int fileSync(FILE *file);
+
+// Atomically move a fully written temp file over the target, turning the
+// previous target into the backup file (backup may be NULL)
+int fileReplace(const char *tempPath, const char *targetPath, const char *backupPath);
+
+// Returns 1 if the path exists and can be opened for reading
+int fileExists(const char *path);
+
+// Returns the last-modification time of a file, or -1 if it does not exist
+long long fileModTime(const char *path);
+
+// Returns the size of a file in bytes, or -1 if it does not exist
+long long fileSize(const char *path);
+
+// Cuts an open file down to size bytes
+int fileTruncate(FILE *file, long long size);
+
+// Maps a whole file for reading; returns 0 if it is missing or cannot be mapped
+int fileMapOpen(const char *path, FileMap *map);
+void fileMapClose(FileMap *map);
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef ID_INDEX_H
+#define ID_INDEX_H
+
+#include <stddef.h>
+
+// =========================
+// ID Index Configuration
+// =========================
+#define INDEX_INITIAL_CAPACITY 1024   // Starting slot count (must be a power of two)
+#define INDEX_MAX_LOAD_PCT 70         // Grow once more than 70% of slots are occupied
+
+struct Node;
+
+// =========================
+// Data Structures
+// =========================
+
+// One slot of the open-addressing table. The ID is kept inline so a probe
+// sequence can be compared without dereferencing the record itself.
+typedef struct IndexSlot {
+    int id;
+    struct Node *node;          // NULL marks an empty slot
+} IndexSlot;
+
+// Linear-probing hash index mapping student ID -> record node
+typedef struct IdIndex {
+    IndexSlot *slots;
+    size_t capacity;            // Always a power of two (or 0 before first use)
+    size_t count;               // Number of occupied slots
+} IdIndex;
+
+// How far lookups of the indexed IDs have to probe
+typedef struct IndexProbeStats {
+    size_t longest;             // Most slots examined to find one ID
+    double average;             // Slots examined per successful lookup
+} IndexProbeStats;
+
+// =========================
+// Function Prototypes
+// =========================
+int indexInit(IdIndex *index, size_t expected);
+void indexFree(IdIndex *index);
+void indexClear(IdIndex *index);
+int indexReserve(IdIndex *index, size_t expected);
+
+struct Node* indexFind(const IdIndex *index, int id);
+int indexInsert(IdIndex *index, struct Node *node);
+void indexRemove(IdIndex *index, int id);
+
+// Walks the whole table; meant for diagnostics, not for hot paths
+void indexProbeStats(const IdIndex *index, IndexProbeStats *stats);
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef IMPORT_H
+#define IMPORT_H
+
+#include <stddef.h>
+
+// =========================
+// Import Configuration
+// =========================
+#define IMPORT_MAX_THREADS 8            // Parser threads used for one file at most
+#define IMPORT_MIN_CHUNK_BYTES (256 * 1024) // Smallest slice of the file worth a thread of its own
+#define IMPORT_REJECTS_SUFFIX ".rejected"   // Appended to the import path for the rejected-rows report
+
+struct IdIndex;
+
+// =========================
+// Data Structures
+// =========================
+
+// One valid row, normalised like INSERT input (trimmed, Title Case). The
+// strings live in the parser's arena until importFree().
+typedef struct ImportRow {
+    int id;
+    float mark;
+    const char *name;
+    const char *programme;
+    long line;                  // 1-based line number in the file
+    size_t offset;              // Original line text, for the rejected-rows report
+    size_t length;
+} ImportRow;
+
+// One row that could not be imported
+typedef struct ImportReject {
+    long line;
+    size_t offset;
+    size_t length;
+    const char *reason;
+} ImportReject;
+
+// Rows and rejects found by one parser thread in its slice of the file
+typedef struct ImportChunk {
+    const char *begin, *end;    // Slice of the file, whole lines only
+    int first;                  // Slice starts at the top of the file
+    char delimiter;
+    const struct IdIndex *index;    // Probed read-only for IDs already present
+    char *arena;                // Normalised names and programmes
+    size_t arenaUsed;
+    ImportRow *rows;
+    size_t rowCount, rowCapacity;
+    ImportReject *rejects;
+    size_t rejectCount, rejectCapacity;
+    long lines;                 // Lines in the slice
+    int failed;                 // Ran out of memory
+} ImportChunk;
+
+// A parsed import file; rows and rejects are read chunk by chunk, in order
+typedef struct ImportFile {
+    char *data;
+    size_t size;
+    ImportChunk *chunks;
+    int chunkCount;
+    int threads;                // Threads that actually parsed the file
+    ImportReject *extra;        // Rejects added after parsing
+    size_t extraCount, extraCapacity;
+} ImportFile;
+
+// =========================
+// Function Prototypes
+// =========================
+
+// Reads a TAB- or comma-separated file and parses it on several threads.
+// Rows are validated like INSERT input and IDs already in index are
+// rejected; the index must not change until this returns. Returns 1 on
+// success, 0 if the file cannot be read and -1 if memory ran out.
+int importParse(ImportFile *file, const char *path, const struct IdIndex *index);
+
+// Adds a reject found after parsing (e.g. a duplicate within the file)
+int importAddReject(ImportFile *file, const ImportRow *row, const char *reason);
+
+// Writes every reject, in line order, as "Line<TAB>Reason<TAB>Row" lines
+int importWriteRejects(const ImportFile *file, const char *path);
+
+// Total rejects across all chunks
+size_t importRejectCount(const ImportFile *file);
+
+void importFree(ImportFile *file);
+
+#endif
@@ -1,16 +1,36 @@
 #ifndef INPUT_VALIDATION_H
 #define INPUT_VALIDATION_H
 
+#include <stdio.h>
+#include "cms.h"
+
 #define OPTIONAL_NONE 0
 #define OPTIONAL_REQUIRED 1
 #define OPTIONAL_ALLOWED_EMPTY 2
+#define OPTIONAL_LOOKUP 3       // QUERY: either ID or NAME
+
+// Bits of CommandArgs.provided: the fields given with a non-empty value
+#define ARG_ID 1
+#define ARG_NAME 2
+#define ARG_PROGRAMME 4
+#define ARG_MARK 8
+
+// Arguments of INSERT / UPDATE / DELETE / QUERY, filled in place by
+// parseCommand() so a command line needs no heap allocation
+typedef struct CommandArgs {
+    int id;
+    char name[MAX_NAME];            // Title Case, "" if not given
+    char programme[MAX_PROGRAMME];  // Title Case, "" if not given
+    float mark;                     // 0 if not given
+    int provided;                   // ARG_* bits
+} CommandArgs;
 
-char* readLine();
 char* validateCommand(const char *input, const char *cmd);
 void toTitleCase(char *str);
+int validateID(const char *id_str);
 int validateMark(const char *str);
 
-int parseCommand(const char *input, int *id, char *name, char *programme, float *mark, int optionalMode);
+int parseCommand(const char *input, CommandArgs *args, int optionalMode);
 int handleShow(const char *input);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,67 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdint.h>
+
+struct StudentRecord;
+
+// =========================
+// Journal Format
+// =========================
+#define JOURNAL_MAGIC "P4CMSJNL"        // First 8 bytes of every journal file
+#define JOURNAL_VERSION 1
+#define JOURNAL_BYTE_ORDER 0x01020304u
+
+// Entry types
+#define JOURNAL_UPSERT 'U'              // Full record after an INSERT or UPDATE
+#define JOURNAL_DELETE 'D'              // Record removed (only the ID is meaningful)
+#define JOURNAL_COMMIT 'C'              // Everything before this marker was saved
+
+// File header, followed by entries of the form
+//   JournalEntry, name[nameLength], programme[programmeLength], uint32 crc
+// where crc covers the entry header and both strings
+typedef struct JournalHeader {
+    char magic[8];
+    uint32_t byteOrder;
+    uint32_t version;
+} JournalHeader;
+
+typedef struct JournalEntry {
+    unsigned char type;
+    unsigned char nameLength;
+    unsigned char programmeLength;
+    unsigned char reserved;
+    int32_t id;
+    float mark;
+} JournalEntry;
+
+// Called once per replayed UPSERT or DELETE entry, in file order
+typedef void (*JournalApplyFn)(char type, const struct StudentRecord *record);
+
+// =========================
+// Function Prototypes
+// =========================
+
+// Replays the first maxCommits saves of a journal (-1 for all) without
+// opening it for writing; returns entries applied, 0 if missing, -1 if invalid
+int journalReplay(const char *path, int maxCommits, JournalApplyFn apply);
+
+// Replays every saved entry, drops anything after the last commit and keeps
+// the journal open for appending; returns entries applied or -1 if invalid
+int journalOpen(const char *path, JournalApplyFn apply);
+
+int journalAppend(char type, const struct StudentRecord *record);
+int journalCommit(void);            // Appends a commit marker and syncs to disk
+void journalDiscard(void);          // Forgets entries appended since the last commit
+int journalCommits(void);           // Commit markers in the open journal
+long long journalBytes(void);       // Size of the open journal
+
+// Moves the open journal to backupPath and starts an empty one in its place
+int journalRotate(const char *backupPath);
+
+// The same for a base written when the journal was keepFrom bytes long:
+// entries appended after that point carry over to the new journal
+int journalRotateFrom(const char *backupPath, long long keepFrom);
+void journalClose(void);
+
+#endif
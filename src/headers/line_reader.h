@@ -0,0 +1,46 @@
+#ifndef LINE_READER_H
+#define LINE_READER_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+// =========================
+// Reader Configuration
+// =========================
+#define LINE_READER_BLOCK (64 * 1024)   // Bytes requested from the OS per read; longer lines grow the buffer
+
+// =========================
+// Data Structures
+// =========================
+
+// Reads a stream in large blocks and hands out its lines in place
+typedef struct LineReader {
+    FILE *stream;               // Read through its file descriptor, not stdio
+    char *buffer;
+    size_t capacity;
+    size_t start;               // First unread byte
+    size_t end;                 // End of the bytes read so far
+    size_t scanned;             // Bytes from start already known to hold no newline
+    int atEnd;                  // The stream has no more data
+    int failed;                 // A read error or out of memory ended the stream
+} LineReader;
+
+// =========================
+// Function Prototypes
+// =========================
+
+void lineReaderInit(LineReader *reader, FILE *stream);
+
+// Returns the next line, NUL-terminated and without its "\n" or "\r\n",
+// or NULL at the end of the stream. The line lives in the reader's buffer
+// and stays valid until the next call on the same reader. length may be
+// NULL.
+char *lineReaderNext(LineReader *reader, size_t *length);
+
+void lineReaderFree(LineReader *reader);
+
+// The reader on stdin, shared by the prompt, confirmations and
+// --batch - so lines read ahead by one are never lost to another
+LineReader *lineReaderStdin(void);
+
+#endif
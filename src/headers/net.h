@@ -0,0 +1,61 @@
+#ifndef NET_H
+#define NET_H
+
+#include <stddef.h>
+
+// =========================
+// Network Configuration
+// =========================
+#define NET_DEFAULT_HOST "127.0.0.1"    // Address used when only a port is given
+#define NET_HOST_MAX 256                // Longest host name or address accepted
+#define NET_PEER_MAX 64                 // Room for a printed "address:port"
+
+#ifdef _WIN32
+#ifndef FD_SETSIZE
+#define FD_SETSIZE 1024                 // Winsock's default of 64 sockets is too few for a server
+#endif
+#include <winsock2.h>
+typedef SOCKET NetSocket;
+#define NET_INVALID INVALID_SOCKET
+#else
+#include <sys/select.h>
+typedef int NetSocket;
+#define NET_INVALID (-1)
+#endif
+
+// Results of netRecv() / netSend() besides a byte count
+#define NET_CLOSED 0                    // The peer closed the connection (netRecv only)
+#define NET_AGAIN (-1)                  // Nothing could be transferred without blocking
+#define NET_ERROR (-2)                  // The connection failed
+
+// =========================
+// Function Prototypes
+// =========================
+
+// Prepares the socket library (Winsock; ignores SIGPIPE elsewhere).
+// Returns 1 on success.
+int netStartup(void);
+void netCleanup(void);
+
+// Splits "[HOST:]PORT" into host (NET_DEFAULT_HOST if missing) and port.
+// Returns 1 if the port is a number from 1 to 65535.
+int netParseAddress(const char *text, char *host, size_t hostSize, int *port);
+
+// Listening / connected TCP sockets, or NET_INVALID on failure
+NetSocket netListen(const char *host, int port);
+NetSocket netConnect(const char *host, int port);
+
+// Accepts a pending connection and prints its address into peer;
+// NET_INVALID if there is none
+NetSocket netAccept(NetSocket listener, char *peer, size_t peerSize);
+
+// Makes reads and writes on the socket return NET_AGAIN instead of waiting
+int netSetNonBlocking(NetSocket socket);
+
+// Transfers up to length bytes; returns the count, or a NET_* result
+long netRecv(NetSocket socket, char *buffer, size_t length);
+long netSend(NetSocket socket, const char *data, size_t length);
+
+void netClose(NetSocket socket);
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef OFFSET_INDEX_H
+#define OFFSET_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "file_io.h"
+
+// =========================
+// Offset Index Format
+// =========================
+#define OFFSET_INDEX_MAGIC "P4CMSIDX"   // First 8 bytes of every offset index file
+#define OFFSET_INDEX_VERSION 1
+#define OFFSET_INDEX_BYTE_ORDER 0x01020304u
+
+// Fixed-size file header, followed by uint64 keys[count] in ascending
+// order. A key holds the ID (sign bit flipped, so keys sort like IDs) in
+// its high 32 bits and the byte offset of the record's line in the low 32,
+// so the text file may not exceed 4 GiB. The size and modification time
+// tie the index to one version of the text file.
+typedef struct OffsetIndexHeader {
+    char magic[8];
+    uint32_t byteOrder;
+    uint32_t version;
+    uint64_t textSize;
+    int64_t textModTime;
+    uint32_t count;
+    uint32_t reserved;
+} OffsetIndexHeader;
+
+// =========================
+// Data Structures
+// =========================
+
+// The text file and its ID -> line offset index, both mapped (or the keys
+// held in memory right after a build)
+typedef struct OffsetIndex {
+    FileMap text;
+    long long textModTime;
+    FileMap file;               // Mapped index file, when it was valid
+    const uint64_t *keys;
+    uint64_t *builtKeys;        // Owned keys after offsetIndexBuild()
+    size_t count;
+} OffsetIndex;
+
+// Decides whether the loader would keep a line of the text file (called
+// in file order, without the line break); sets *id and returns 1 if so
+typedef int (*OffsetLineFn)(void *state, const char *line, size_t length, int *id);
+
+// =========================
+// Function Prototypes
+// =========================
+
+// Maps the text file and, if indexPath holds an index of this very
+// version of it, that index. Returns 1 if the index is ready, 0 if it has
+// to be built, -1 if the text file cannot be mapped.
+int offsetIndexOpen(OffsetIndex *index, const char *textPath, const char *indexPath);
+
+// Scans the mapped text file and indexes the first line kept for each ID,
+// then writes the index to indexPath. Returns 0 if out of memory or the file
+// is too large; *saved is 0 if the index could not be written (it is
+// still usable for this session).
+int offsetIndexBuild(OffsetIndex *index, const char *indexPath, OffsetLineFn keep, void *state, int *saved);
+
+// Finds the line of a record (without its line break); NULL if the ID is
+// not indexed
+const char *offsetIndexFind(const OffsetIndex *index, int id, size_t *length);
+
+void offsetIndexClose(OffsetIndex *index);
+
+#endif
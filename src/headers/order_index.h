@@ -0,0 +1,65 @@
+#ifndef ORDER_INDEX_H
+#define ORDER_INDEX_H
+
+#include <stddef.h>
+
+// =========================
+// Ordered Index Configuration
+// =========================
+#define ORDER_BY_ID 0                 // Link set used by the ID-ordered index
+#define ORDER_BY_MARK 1               // Link set used by the (mark, insertion order) index
+#define ORDER_BY_GROUP 2              // Link set used by the (programme group, mark, insertion order) index
+#define ORDER_BY_NAME 3               // Link set used by the (case-folded name, ID) index
+#define ORDER_SLOTS 4                 // Link sets embedded in every Node
+#define ORDER_MAX_DEPTH 96            // AVL height bound for any realistic record count
+
+struct Node;
+
+// =========================
+// Data Structures
+// =========================
+
+// Intrusive AVL tree over record nodes. The child links and height live in
+// the node itself (Node::orderLinks[slot] / Node::orderHeight[slot]), so
+// inserting or removing a record never allocates.
+typedef struct OrderIndex {
+    struct Node *root;
+    int slot;                   // Link set of Node used by this tree
+    int (*compare)(const struct Node *a, const struct Node *b);  // Keys must be unique
+    size_t count;
+} OrderIndex;
+
+#define ORDER_INDEX_INIT(slot, compare) { NULL, (slot), (compare), 0 }
+
+// In-order traversal state; lives on the caller's stack
+typedef struct OrderCursor {
+    struct Node *stack[ORDER_MAX_DEPTH];
+    int depth;
+    int slot;
+    int ascending;
+} OrderCursor;
+
+// =========================
+// Function Prototypes
+// =========================
+void orderInsert(OrderIndex *index, struct Node *node);
+void orderRemove(OrderIndex *index, struct Node *node);
+void orderClear(OrderIndex *index);
+void orderBuild(OrderIndex *index, struct Node **sorted, size_t count);
+
+// Smallest (ascending) or largest (descending) node, then its successors
+struct Node* orderFirst(OrderCursor *cursor, const OrderIndex *index, int ascending);
+struct Node* orderNext(OrderCursor *cursor);
+
+// Starts a walk at the first node >= probe (ascending) or the last node
+// <= probe (descending), where probe is a node carrying only the key fields
+struct Node* orderSeek(OrderCursor *cursor, const OrderIndex *index, const struct Node *probe, int ascending);
+
+// Same as orderSeek(), for keys that cannot be put in a probe node:
+// compareKey(node, key) orders a node against the key like the tree's own
+// compare function would
+struct Node* orderSeekKey(OrderCursor *cursor, const OrderIndex *index,
+                          int (*compareKey)(const struct Node *node, const void *key),
+                          const void *key, int ascending);
+
+#endif
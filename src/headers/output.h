@@ -0,0 +1,46 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+// =========================
+// Output Configuration
+// =========================
+#define OUTPUT_MIN_CAPACITY 4096        // First allocation of a memory sink
+
+// =========================
+// Data Structures
+// =========================
+
+// Where engine messages and tables go. A sink with a file writes straight to
+// it; otherwise everything is collected in data, e.g. for a server reply.
+typedef struct OutputSink {
+    FILE *file;
+    char *data;
+    size_t length;
+    size_t capacity;
+    int failed;                 // Memory ran out; some output was dropped
+} OutputSink;
+
+// =========================
+// Function Prototypes
+// =========================
+
+// printf() / fwrite() to the current sink (stdout unless redirected)
+void outputPrintf(const char *format, ...);
+void outputWrite(const char *data, size_t length);
+
+// Flushes the current sink if it is a file
+void outputFlush(void);
+
+// Sends output to sink from now on (NULL = stdout); returns the previous one
+OutputSink *outputRedirect(OutputSink *sink);
+
+// Empties a memory sink, keeping its buffer
+void outputClear(OutputSink *sink);
+
+// Releases a memory sink's buffer
+void outputFree(OutputSink *sink);
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+
+// =========================
+// Pool Configuration
+// =========================
+#define POOL_ALIGN 16                    // Alignment of every pooled object
+#define POOL_ROUND(size) (((size) + POOL_ALIGN - 1) & ~(size_t)(POOL_ALIGN - 1))
+
+// Static initialiser for a pool of `count`-object slabs of the given type
+#define POOL_INIT(type, count) { POOL_ROUND(sizeof(type)), (count), NULL, NULL, 0, 0, 0 }
+
+// =========================
+// Data Structures
+// =========================
+
+// Header of one slab; the objects follow it in the same allocation
+typedef struct PoolSlab {
+    struct PoolSlab *next;      // Older slab
+    size_t used;                // Objects handed out from this slab so far
+} PoolSlab;
+
+// Fixed-size object allocator: objects are carved sequentially from large
+// slabs, recycled through a free list, and released all at once on reset
+typedef struct Pool {
+    size_t objectSize;          // Rounded object size in bytes
+    size_t perSlab;             // Objects per slab
+    PoolSlab *slabs;            // Newest slab first
+    void *freeList;             // Singly linked list of released objects
+    size_t slabCount;           // Number of slabs currently allocated
+    size_t inUse;               // Objects currently allocated
+    size_t peakInUse;           // Highest inUse since the last reset
+} Pool;
+
+// =========================
+// Function Prototypes
+// =========================
+void* poolAlloc(Pool *pool);
+void poolFree(Pool *pool, void *object);
+void poolReset(Pool *pool);
+
+size_t poolBytesInUse(const Pool *pool);
+size_t poolBytesReserved(const Pool *pool);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef PROGRAMME_DICT_H
+#define PROGRAMME_DICT_H
+
+#include <stddef.h>
+
+// =========================
+// Programme Dictionary Configuration
+// =========================
+#define PROGRAMME_NONE 0xFFFF           // Code returned when a name is unknown or cannot be interned
+#define PROGRAMME_MAX_CODES 0xFFFF      // Distinct programme spellings that can be interned
+
+// Small integer code standing for one distinct programme string
+typedef unsigned short ProgCode;
+
+// =========================
+// Function Prototypes
+// =========================
+
+// Returns the code for this exact spelling, adding it on first use
+ProgCode programmeIntern(const char *name, size_t len);
+
+// Finds the case-insensitive group of a programme name (PROGRAMME_NONE if never seen)
+ProgCode programmeLookupGroup(const char *name);
+
+const char* programmeName(ProgCode code);
+size_t programmeLength(ProgCode code);
+
+// Canonical code shared by all spellings that differ only in letter case
+ProgCode programmeGroup(ProgCode code);
+
+size_t programmeCount(void);
+size_t programmeBytes(void);
+void programmeFreeAll(void);
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef RECORD_SORT_H
+#define RECORD_SORT_H
+
+#include <stddef.h>
+
+// =========================
+// Sort Configuration
+// =========================
+#define SORT_MAX_KEYS 2                 // One key per sortable field
+
+struct Node;
+
+// =========================
+// Data Structures
+// =========================
+
+// Fields that SHOW ALL SORT BY can order on
+typedef enum {
+    SORT_FIELD_ID,
+    SORT_FIELD_MARK
+} SortField;
+
+// One "<field> ASC|DESC" clause of a sort specification
+typedef struct SortKey {
+    SortField field;
+    int ascending;
+} SortKey;
+
+// =========================
+// Function Prototypes
+// =========================
+
+// Returns the nodes of a list ordered by keys[0], then keys[1], ...; ties
+// keep list order. The array is owned by the sorter and reused by the next
+// call, so it stays valid only until then.
+struct Node** sortRecords(struct Node *list, size_t count, const SortKey *keys, int keyCount);
+
+// Reorders an array of nodes in place by keys[0], keys[1], ...; ties go by
+// insertion sequence like the ordered index walks (no keys: insertion
+// order). Returns 0 if out of memory.
+int sortNodes(struct Node **nodes, size_t count, const SortKey *keys, int keyCount);
+
+// Releases the sorter's reusable buffers
+void sortFree(void);
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <stddef.h>
+
+// =========================
+// Scan Configuration
+// =========================
+#define SCAN_MIN_RECORDS 100000     // Tables smaller than this are scanned on the calling thread
+#define SCAN_MIN_TASK 32768         // Records worth a task of their own
+#define SCAN_MAX_TASKS 32           // Tasks (and threads, counting the caller) per scan at most
+
+// =========================
+// Data Structures
+// =========================
+
+// Runs task number `task` (0 .. tasks-1) of a scan. A task only writes its
+// own slot of the job's partial results; the caller merges the slots in
+// task order afterwards, so the outcome never depends on thread timing.
+typedef void (*ScanTaskFn)(void *job, int task);
+
+// =========================
+// Function Prototypes
+// =========================
+
+// Number of tasks worth running over this many records (1 below
+// SCAN_MIN_RECORDS or on a single processor)
+int scanTasks(size_t records);
+
+// Runs tasks 0 .. tasks-1 of a job and returns once all have finished.
+// Task 0 runs on the calling thread and the rest on the worker pool,
+// which is started on first use.
+void scanRun(ScanTaskFn fn, void *job, int tasks);
+
+// Index of the first item of task `task` when count items are split
+// evenly into `tasks` runs
+size_t scanSplit(size_t count, int task, int tasks);
+
+// Stops the worker pool
+void scanShutdown(void);
+
+// Resets the pool in a process forked from a running one, which has none
+// of its worker threads
+void scanForkChild(void);
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+// =========================
+// Server Configuration
+// =========================
+#define SERVER_MAX_CLIENTS 500                  // Connections served at once; kept below FD_SETSIZE
+#define SERVER_READ_CHUNK (16 * 1024)           // Bytes read from a connection per recv()
+#define SERVER_LINE_MAX (64 * 1024)             // Longest command line a client may send
+#define SERVER_OUTPUT_HIGH (4 * 1024 * 1024)    // Unsent reply bytes above which a client's next commands wait
+#define SERVER_COMMANDS_PER_TURN 64             // Pipelined commands run for one client before serving the next
+#define SERVER_POLL_MS 1000                     // Longest wait in select(), so a stop request is noticed
+#define CLIENT_PIPELINE_DEPTH 64                // Commands a piped client sends ahead of their replies
+#define SERVER_MAX_READERS 8                    // Snapshot reader processes running at once
+#define SERVER_READER_MIN_RECORDS 100000        // Smaller tables run every command in place
+
+// Replies are framed so pipelined commands can be matched with their output:
+// a header line "<STATUS> <length>\n" followed by exactly length bytes of
+// the output the command printed. STATUS is OK, FAILED, or BYE for QUIT,
+// after which the server closes the connection.
+#define REPLY_OK "OK"
+#define REPLY_FAILED "FAILED"
+#define REPLY_BYE "BYE"
+
+// =========================
+// Function Prototypes
+// =========================
+
+// Opens the database and serves the command language to TCP clients on
+// host:port until interrupted. Returns the process exit status.
+int runServer(const char *host, int port);
+
+// Sends commands from stdin to a server and prints its replies: one at a
+// time at a terminal, pipelined when stdin is a file or pipe. Returns the
+// process exit status (non-zero if a command failed or the link broke).
+int runClient(const char *host, int port);
+
+#endif
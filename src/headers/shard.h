@@ -0,0 +1,64 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <stddef.h>
+
+// =========================
+// Shard Configuration
+// =========================
+#define SHARD_ID_SPAN 100000            // IDs per shard: one intake-year prefix of a 7-digit ID
+#define SHARD_MANIFEST_MAGIC "P4_1-CMS shards"
+#define SHARD_MANIFEST_VERSION 1
+#define SHARD_PATH_MAX 64               // Room for the path of one shard file
+
+// =========================
+// Data Structures
+// =========================
+
+// One ID range, stored in its own text file with its own backup.
+// `generation` is the save that last wrote the file, so RESTORE knows
+// which shards the latest save replaced.
+typedef struct Shard {
+    int key;                    // ID / span, rounded down
+    long generation;            // 0 until the shard has been written
+    long records;               // Records in the file when it was written
+    int loaded;                 // Records are in memory
+    int dirty;                  // Changed since the file was written
+} Shard;
+
+// Every shard of the table, sorted by key, as listed in the manifest
+typedef struct ShardSet {
+    Shard *shards;
+    size_t count;
+    size_t capacity;
+    int span;
+    long generation;            // The latest save
+} ShardSet;
+
+// =========================
+// Function Prototypes
+// =========================
+
+// Key of the shard holding an ID
+int shardKeyOf(const ShardSet *set, int id);
+
+// Path of a shard's file with the given extension (".txt", ".bak", ".tmp")
+void shardPath(int key, const char *extension, char *path, size_t size);
+
+// Finds a shard by key; NULL if the table has none for that range
+Shard *shardFind(ShardSet *set, int key);
+
+// Finds a shard or adds an empty one (loaded, clean, never written);
+// NULL if out of memory
+Shard *shardAdd(ShardSet *set, int key);
+
+// Reads the manifest. Returns 1 if it was read, 0 if there is none, -1 if
+// it is damaged; the set is empty unless it returns 1.
+int shardManifestRead(ShardSet *set, const char *path);
+
+// Writes the list of shards, via a synced temp file and rename
+int shardManifestWrite(const ShardSet *set, const char *path);
+
+void shardSetFree(ShardSet *set);
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// =========================
+// Snapshot Format
+// =========================
+#define SNAPSHOT_MAGIC "P4CMSSNP"       // First 8 bytes of every snapshot file
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_BYTE_ORDER 0x01020304u // Stored in writer byte order to detect foreign files
+
+// Fixed-size file header. The body follows in this order:
+//   int32   ids[recordCount]
+//   float   marks[recordCount]
+//   uint16  programmes[recordCount]       (index into the programme table)
+//   uint16  nameLengths[recordCount]
+//   uint16  programmeLengths[programmeCount]
+//   char    programmeHeap[programmeHeapSize]   (NUL-terminated, in table order)
+//   char    nameHeap[nameHeapSize]             (NUL-terminated, in record order)
+typedef struct SnapshotHeader {
+    char magic[8];
+    uint32_t byteOrder;
+    uint32_t version;
+    uint32_t recordCount;
+    uint32_t programmeCount;
+    uint32_t programmeHeapSize;
+    uint32_t nameHeapSize;
+    uint32_t checksum;                  // CRC-32 of the whole body
+    uint32_t reserved;
+} SnapshotHeader;
+
+// A snapshot read into memory; every pointer refers into `buffer`
+typedef struct SnapshotImage {
+    char *buffer;
+    size_t bufferSize;
+    SnapshotHeader header;
+    const int32_t *ids;
+    const float *marks;
+    const uint16_t *programmes;
+    const uint16_t *nameLengths;
+    const uint16_t *programmeLengths;
+    const char *programmeHeap;
+    char *nameHeap;
+} SnapshotImage;
+
+// =========================
+// Function Prototypes
+// =========================
+
+// Writes the current table to path (via a synced temp file and rename)
+int snapshotWrite(const char *path, const char *tempPath);
+
+// Copies the current table into memory in the file layout, and writes
+// such a copy out later (on any thread)
+int snapshotCapture(SnapshotImage *image);
+int snapshotWriteImage(SnapshotImage *image, const char *path, const char *tempPath);
+
+// Reads and validates a snapshot with a single read; 0 if missing or invalid
+int snapshotRead(const char *path, SnapshotImage *image);
+void snapshotRelease(SnapshotImage *image);
+
+#endif
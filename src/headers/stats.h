@@ -0,0 +1,54 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+
+// =========================
+// Stats Configuration
+// =========================
+#define STATS_SUB_BUCKET_BITS 4         // 16 buckets per power of two: latencies within about 6%
+#define STATS_MAX_NS_BITS 40            // Longest latency kept apart, about 18 minutes
+#define STATS_BUCKETS ((STATS_MAX_NS_BITS - STATS_SUB_BUCKET_BITS + 1) << STATS_SUB_BUCKET_BITS)
+#define STATS_MAX_COMMANDS 32           // Command slots (indexes of the dispatch table)
+#define STATS_DUMP_SECONDS 60           // Interval between periodic dumps to the stats file
+
+// =========================
+// Data Structures
+// =========================
+
+// Latencies of one command: a log-linear histogram over nanoseconds
+typedef struct CommandStats {
+    const char *name;                   // NULL until the command first ran
+    unsigned long long count;
+    unsigned long long failed;
+    double seconds;                     // Total time
+    double maxSeconds;
+    unsigned long long buckets[STATS_BUCKETS];
+} CommandStats;
+
+// Prints the rest of a report (index and memory health) into a dump
+typedef void (*StatsReportFn)(void);
+
+// =========================
+// Function Prototypes
+// =========================
+
+// Collection switch, tested once per command; 0 costs one branch
+extern int statsEnabled;
+
+// Adds one run of command slot `command` (0 .. STATS_MAX_COMMANDS-1)
+void statsRecord(int command, const char *name, double seconds, int failed);
+
+void statsReset(void);
+
+// Prints the per-command latency table
+void statsPrint(void);
+
+// Appends a report to path every STATS_DUMP_SECONDS while commands run,
+// and turns collection on. Returns 0 if the file cannot be opened.
+int statsDumpOpen(const char *path, StatsReportFn report);
+
+// Appends a final report and stops dumping
+void statsDumpClose(void);
+
+#endif
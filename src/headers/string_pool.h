@@ -0,0 +1,37 @@
+#ifndef STRING_POOL_H
+#define STRING_POOL_H
+
+#include <stddef.h>
+
+// =========================
+// String Pool Configuration
+// =========================
+#define STRING_POOL_INITIAL 4096        // Initial pool capacity in bytes
+#define STRING_POOL_NONE ((unsigned int)-1)
+
+// =========================
+// Data Structures
+// =========================
+
+// Append-only byte arena holding NUL-terminated strings, addressed by offset
+// so the arena can grow (and be compacted) without invalidating references
+typedef struct StringPool {
+    char *data;
+    size_t used;                        // Bytes handed out
+    size_t capacity;                    // Bytes allocated
+    size_t garbage;                     // Bytes belonging to released strings
+} StringPool;
+
+// =========================
+// Function Prototypes
+// =========================
+unsigned int stringPoolAdd(StringPool *pool, const char *str, size_t len);
+void stringPoolRelease(StringPool *pool, size_t len);
+void stringPoolReset(StringPool *pool);
+void stringPoolAdopt(StringPool *pool, char *data, size_t used);
+void stringPoolFree(StringPool *pool);
+
+// Resolves an offset returned by stringPoolAdd()
+#define stringPoolGet(pool, offset) ((pool)->data + (offset))
+
+#endif
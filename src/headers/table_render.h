@@ -0,0 +1,47 @@
+#ifndef TABLE_RENDER_H
+#define TABLE_RENDER_H
+
+#include <stddef.h>
+
+// =========================
+// Renderer Configuration
+// =========================
+#define RENDER_BUFFER_SIZE (256 * 1024)  // Formatted output collected before one fwrite()
+#define RENDER_ROW_MAX 1024              // Room reserved for one record, wrapped lines included
+#define RENDER_LINE_MAX 320              // Longest tab-separated record line
+
+// =========================
+// Data Structures
+// =========================
+
+// How the rows of one printed table are laid out
+typedef struct TableLayout {
+    int nameWidth;              // Column widths in table mode
+    int progWidth;
+    int nameWrap;               // Characters of a name / programme per table line
+    int progWrap;
+    int tsv;                    // Raw tab-separated rows, no padding or wrapping
+} TableLayout;
+
+// =========================
+// Function Prototypes
+// =========================
+
+// Queues the header message and the column titles
+void renderHeader(const TableLayout *layout, const char *headerMsg);
+
+// Queues one record; names and programmes longer than their wrap width
+// continue on extra lines in table mode
+void renderRow(const TableLayout *layout, int id, const char *name, size_t nameLength,
+               const char *programme, size_t progLength, float mark);
+
+// Formats one record as "id<TAB>name<TAB>programme<TAB>mark\n" (the mark
+// as "%.1f") into out, which needs RENDER_LINE_MAX bytes free. Safe to call
+// from several threads. Returns the end of the line.
+char *renderTsvLine(char *out, int id, const char *name, size_t nameLength,
+                    const char *programme, size_t progLength, float mark);
+
+// Writes everything queued to stdout; call before any other output
+void renderFlush(void);
+
+#endif
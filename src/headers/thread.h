@@ -0,0 +1,55 @@
+#ifndef THREAD_H
+#define THREAD_H
+
+#ifdef _WIN32
+typedef void *ThreadHandle;             // Win32 HANDLE
+typedef struct { void *lock; } ThreadMutex;     // Win32 SRWLOCK
+typedef struct { void *cond; } ThreadCond;      // Win32 CONDITION_VARIABLE
+#else
+#include <pthread.h>
+typedef pthread_t ThreadHandle;
+typedef pthread_mutex_t ThreadMutex;
+typedef pthread_cond_t ThreadCond;
+#endif
+
+// =========================
+// Data Structures
+// =========================
+
+// Function run by a worker thread
+typedef void (*ThreadFn)(void *arg);
+
+// One worker thread; lives with the caller until threadJoin()
+typedef struct Thread {
+    ThreadHandle handle;
+    ThreadFn fn;
+    void *arg;
+} Thread;
+
+// =========================
+// Function Prototypes
+// =========================
+
+// Starts fn(arg) on a new thread; returns 1 on success, 0 if it could not
+// be created (the caller can then run fn itself)
+int threadStart(Thread *thread, ThreadFn fn, void *arg);
+
+// Waits for a started thread to finish
+void threadJoin(Thread *thread);
+
+// Number of processors available to the program (at least 1)
+int threadCpuCount(void);
+
+// Mutual exclusion between threads
+void mutexInit(ThreadMutex *mutex);
+void mutexLock(ThreadMutex *mutex);
+void mutexUnlock(ThreadMutex *mutex);
+void mutexDestroy(ThreadMutex *mutex);
+
+// Condition variables; condWait() must be called with the mutex locked
+void condInit(ThreadCond *cond);
+void condWait(ThreadCond *cond, ThreadMutex *mutex);
+void condBroadcast(ThreadCond *cond);
+void condDestroy(ThreadCond *cond);
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+// Returns a monotonic timestamp in seconds, suitable for measuring intervals
+double timerNow(void);
+
+#endif
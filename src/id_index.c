@@ -0,0 +1,245 @@
+/**
+ * ID Index
+ * --------------------------------------
+ * Open-addressing hash index used to locate student records by ID.
+ *
+ * - Slots store the ID next to the node pointer, so probing touches a
+ *   single contiguous array instead of chasing chain pointers.
+ * - Linear probing over a power-of-two table; the table doubles once the
+ *   load factor passes INDEX_MAX_LOAD_PCT, keeping probe sequences short
+ *   regardless of how many records are loaded.
+ * - Deletion uses backward-shift so no tombstones accumulate.
+ *
+ * Authors: Team P4-1
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "headers/cms.h"
+#include "headers/id_index.h"
+
+
+/**
+ * mixID()
+ * -----------------------------------------
+ * Scrambles a student ID so that consecutive IDs (2301234, 2301235, ...)
+ * spread across the whole table rather than clustering in adjacent slots.
+ * Uses the MurmurHash3 32-bit finaliser.
+ *
+ * @param id - student ID number
+ * @return well-mixed 32-bit hash value
+ */
+static unsigned int mixID(int id) {
+    unsigned int h = (unsigned int)id;
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+
+/**
+ * indexInit()
+ * -----------------------------------------
+ * Allocates an empty index large enough to hold the expected number of
+ * records without resizing.
+ *
+ * @param index    - index to initialise
+ * @param expected - number of records expected (0 for default size)
+ * @return 1 on success, 0 if memory allocation failed
+ */
+int indexInit(IdIndex *index, size_t expected) {
+    size_t capacity = INDEX_INITIAL_CAPACITY;
+    while (capacity * INDEX_MAX_LOAD_PCT / 100 < expected) capacity <<= 1;
+
+    index->slots = calloc(capacity, sizeof(IndexSlot));
+    if (!index->slots) {
+        index->capacity = 0;
+        index->count = 0;
+        return 0;
+    }
+    index->capacity = capacity;
+    index->count = 0;
+    return 1;
+}
+
+
+// Releases all memory held by the index
+void indexFree(IdIndex *index) {
+    free(index->slots);
+    index->slots = NULL;
+    index->capacity = 0;
+    index->count = 0;
+}
+
+
+// Empties the index but keeps its current capacity for reuse
+void indexClear(IdIndex *index) {
+    if (index->slots) memset(index->slots, 0, index->capacity * sizeof(IndexSlot));
+    index->count = 0;
+}
+
+
+/**
+ * indexRehash()
+ * -----------------------------------------
+ * Moves every occupied slot into a new table of the given capacity.
+ *
+ * @return 1 on success, 0 if memory allocation failed (index unchanged)
+ */
+static int indexRehash(IdIndex *index, size_t newCapacity) {
+    IndexSlot *newSlots = calloc(newCapacity, sizeof(IndexSlot));
+    if (!newSlots) return 0;
+
+    size_t mask = newCapacity - 1;
+    for (size_t i = 0; i < index->capacity; i++) {
+        if (!index->slots[i].node) continue;
+        size_t pos = mixID(index->slots[i].id) & mask;
+        while (newSlots[pos].node) pos = (pos + 1) & mask;
+        newSlots[pos] = index->slots[i];
+    }
+
+    free(index->slots);
+    index->slots = newSlots;
+    index->capacity = newCapacity;
+    return 1;
+}
+
+
+// Doubles the table capacity
+static int indexGrow(IdIndex *index) {
+    return indexRehash(index, index->capacity ? index->capacity << 1 : INDEX_INITIAL_CAPACITY);
+}
+
+
+/**
+ * indexReserve()
+ * -----------------------------------------
+ * Sizes the table for a bulk insert in a single rehash, so adding up to
+ * `expected` records in total does not grow it step by step.
+ *
+ * @return 1 on success, 0 if memory allocation failed (index unchanged)
+ */
+int indexReserve(IdIndex *index, size_t expected) {
+    size_t capacity = index->capacity ? index->capacity : INDEX_INITIAL_CAPACITY;
+    while (capacity * INDEX_MAX_LOAD_PCT / 100 < expected) capacity <<= 1;
+    if (capacity == index->capacity) return 1;
+    return indexRehash(index, capacity);
+}
+
+
+/**
+ * indexFind()
+ * -----------------------------------------
+ * Looks up a record by student ID.
+ *
+ * @param id - student ID to search for
+ * @return pointer to the matching record or NULL if not found
+ */
+struct Node* indexFind(const IdIndex *index, int id) {
+    if (!index->capacity) return NULL;
+
+    size_t mask = index->capacity - 1;
+    size_t pos = mixID(id) & mask;
+    while (index->slots[pos].node) {
+        if (index->slots[pos].id == id) return index->slots[pos].node;
+        pos = (pos + 1) & mask;
+    }
+    return NULL;
+}
+
+
+/**
+ * indexInsert()
+ * -----------------------------------------
+ * Adds a record to the index, growing the table first if the insert would
+ * exceed the maximum load factor. The duplicate check happens in the same
+ * probe, so callers do not need a separate indexFind() beforehand.
+ *
+ * @param node - record to index (keyed by node->id)
+ * @return 1 on success, 0 if memory allocation failed,
+ *         -1 if the ID is already indexed (index unchanged)
+ */
+int indexInsert(IdIndex *index, struct Node *node) {
+    if ((index->count + 1) * 100 > index->capacity * INDEX_MAX_LOAD_PCT) {
+        if (!indexGrow(index)) return 0;
+    }
+
+    int id = node->id;
+    size_t mask = index->capacity - 1;
+    size_t pos = mixID(id) & mask;
+    while (index->slots[pos].node) {
+        if (index->slots[pos].id == id) return -1;
+        pos = (pos + 1) & mask;
+    }
+
+    index->slots[pos].id = id;
+    index->slots[pos].node = node;
+    index->count++;
+    return 1;
+}
+
+
+/**
+ * indexRemove()
+ * -----------------------------------------
+ * Removes a record from the index by ID. Entries that follow the freed slot
+ * in the same probe run are shifted back so later lookups never stop early.
+ *
+ * @param id - ID of the record to remove
+ */
+void indexRemove(IdIndex *index, int id) {
+    if (!index->capacity) return;
+
+    size_t mask = index->capacity - 1;
+    size_t pos = mixID(id) & mask;
+    while (index->slots[pos].node && index->slots[pos].id != id) {
+        pos = (pos + 1) & mask;
+    }
+    if (!index->slots[pos].node) return; // Not indexed
+
+    // Backward-shift deletion: pull up any entry whose home slot lies at or
+    // before the hole (cyclically), then continue from its old position.
+    size_t hole = pos;
+    size_t next = (hole + 1) & mask;
+    while (index->slots[next].node) {
+        size_t home = mixID(index->slots[next].id) & mask;
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            index->slots[hole] = index->slots[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+    index->slots[hole].node = NULL;
+    index->slots[hole].id = 0;
+    index->count--;
+}
+
+
+/**
+ * indexProbeStats()
+ * -----------------------------------------
+ * Measures the probe length of every indexed ID: the number of slots a
+ * lookup examines, counting from the ID's home slot to the slot holding it.
+ *
+ * @param stats - receives the longest and the average probe length
+ */
+void indexProbeStats(const IdIndex *index, IndexProbeStats *stats) {
+    stats->longest = 0;
+    stats->average = 0.0;
+    if (!index->count) return;
+
+    size_t mask = index->capacity - 1;
+    double total = 0.0;
+    for (size_t i = 0; i < index->capacity; i++) {
+        if (!index->slots[i].node) continue;
+        size_t home = mixID(index->slots[i].id) & mask;
+        size_t probes = ((i - home) & mask) + 1;
+        total += (double)probes;
+        if (probes > stats->longest) stats->longest = probes;
+    }
+    stats->average = total / (double)index->count;
+}
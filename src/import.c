@@ -0,0 +1,418 @@
+/**
+ * Bulk Import Parser
+ * --------------------------------------
+ * Parses enrolment files for IMPORT. The file is read in one go, cut into
+ * slices on line boundaries and each slice is parsed by its own thread:
+ * - TAB-separated or comma-separated (with "quoted, fields"), chosen from
+ *   the first line; a leading header row is skipped
+ * - rows are checked with the same rules as INSERT (validateID(),
+ *   validateMark(), length limits) and normalised to Title Case
+ * - IDs are probed in the ID index by the parser threads, so rows that
+ *   clash with the table are rejected before anything is committed
+ * The threads only read the file and the index and write their own slice
+ * state; committing the rows is left to the caller.
+ *
+ * Authors: Team P4-1
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "headers/cms.h"
+#include "headers/file_io.h"
+#include "headers/import.h"
+#include "headers/input_validation.h"
+#include "headers/thread.h"
+
+#define FIELD_TOO_LONG -2
+#define FIELD_MALFORMED -1
+
+
+// Appends to a growable array, doubling its capacity when full
+static int reserveOne(void **items, size_t *capacity, size_t count, size_t itemSize) {
+    if (count < *capacity) return 1;
+    size_t newCapacity = *capacity ? *capacity * 2 : 256;
+    void *grown = realloc(*items, newCapacity * itemSize);
+    if (!grown) return 0;
+    *items = grown;
+    *capacity = newCapacity;
+    return 1;
+}
+
+
+static void addReject(ImportChunk *chunk, long line, const char *text, size_t length, const char *reason) {
+    if (!reserveOne((void**)&chunk->rejects, &chunk->rejectCapacity, chunk->rejectCount, sizeof(ImportReject))) {
+        chunk->failed = 1;
+        return;
+    }
+    ImportReject *reject = &chunk->rejects[chunk->rejectCount++];
+    reject->line = line;
+    reject->offset = (size_t)(text - chunk->begin);
+    reject->length = length;
+    reject->reason = reason;
+}
+
+
+/**
+ * readField()
+ * -----------------------------------------
+ * Copies the next field of a line into out, trimmed of surrounding
+ * spaces. With a comma delimiter a field may be "quoted", with "" standing
+ * for a literal quote.
+ *
+ * @param cursor - position in the line; set to NULL after the last field
+ * @param out    - receives the NUL-terminated value (outSize bytes)
+ * @return length of the value, FIELD_TOO_LONG if it does not fit in out,
+ *         or FIELD_MALFORMED for an unterminated quote
+ */
+static int readField(const char **cursor, const char *end, char delimiter, char *out, size_t outSize) {
+    const char *p = *cursor;
+    size_t length = 0;
+    int tooLong = 0;
+
+    while (p < end && *p == ' ') p++;
+
+    if (delimiter == ',' && p < end && *p == '"') {
+        for (p++; ; p++) {
+            if (p >= end) return FIELD_MALFORMED;
+            if (*p == '"') {
+                if (p + 1 < end && p[1] == '"') p++;    // Escaped quote
+                else break;
+            }
+            if (length + 1 < outSize) out[length++] = *p;
+            else tooLong = 1;
+        }
+        p++;
+        while (p < end && *p == ' ') p++;
+        if (p < end && *p != delimiter) return FIELD_MALFORMED;
+    }
+    else {
+        const char *start = p;
+        while (p < end && *p != delimiter) p++;
+        const char *stop = p;
+        while (stop > start && stop[-1] == ' ') stop--;
+        length = (size_t)(stop - start);
+        if (length >= outSize) {
+            tooLong = 1;
+            length = 0;
+        }
+        else memcpy(out, start, length);
+    }
+
+    out[length] = '\0';
+    *cursor = (p < end) ? p + 1 : NULL;
+    return tooLong ? FIELD_TOO_LONG : (int)length;
+}
+
+
+/**
+ * parseLine()
+ * -----------------------------------------
+ * Validates one line and turns it into a row. The name and programme are
+ * written to the slice's arena; nothing is kept for a rejected line.
+ *
+ * @return 1 for a row, 0 if the line was rejected
+ */
+static int parseLine(ImportChunk *chunk, const char *line, size_t length, long lineNo) {
+    const char *end = line + length;
+    const char *cursor = line;
+    char idText[16], markText[MAX_LINE];
+    char *name = chunk->arena + chunk->arenaUsed;
+    const char *reason = NULL;
+    char *programme = NULL;
+    int fields = 0;
+
+    int idLength = readField(&cursor, end, chunk->delimiter, idText, sizeof(idText));
+    fields++;
+    int nameLength = 0, progLength = 0, markLength = 0;
+    if (cursor) {
+        nameLength = readField(&cursor, end, chunk->delimiter, name, MAX_NAME);
+        programme = name + (nameLength > 0 ? nameLength : 0) + 1;
+        fields++;
+    }
+    if (cursor) {
+        progLength = readField(&cursor, end, chunk->delimiter, programme, MAX_PROGRAMME);
+        fields++;
+    }
+    if (cursor) {
+        markLength = readField(&cursor, end, chunk->delimiter, markText, sizeof(markText));
+        fields++;
+    }
+
+    if (idLength == FIELD_MALFORMED || nameLength == FIELD_MALFORMED
+        || progLength == FIELD_MALFORMED || markLength == FIELD_MALFORMED) {
+        reason = "unterminated quoted field";
+    }
+    else if (fields < 4 || cursor) reason = "expected 4 fields (ID, Name, Programme, Mark)";
+    else if (idLength <= 0 || !validateID(idText)) reason = "ID must be 7 digits starting with '2'";
+    else if (nameLength == FIELD_TOO_LONG) reason = "name is too long";
+    else if (progLength == FIELD_TOO_LONG) reason = "programme is too long";
+    else if (markLength == FIELD_TOO_LONG || !validateMark(markText)) reason = "mark must be numeric";
+
+    float mark = 0.0f;
+    if (!reason) {
+        mark = markLength > 0 ? (float)atof(markText) : 0.0f;
+        if (mark < 0.0f || mark > 100.0f) reason = "mark must be between 0 - 100";
+    }
+    int id = reason ? 0 : atoi(idText);
+    if (!reason && indexFind(chunk->index, id)) reason = "ID already exists in the table";
+
+    if (reason) {
+        addReject(chunk, lineNo, line, length, reason);
+        return 0;
+    }
+
+    if (!reserveOne((void**)&chunk->rows, &chunk->rowCapacity, chunk->rowCount, sizeof(ImportRow))) {
+        chunk->failed = 1;
+        return 0;
+    }
+    toTitleCase(name);
+    toTitleCase(programme);
+    chunk->arenaUsed += (size_t)nameLength + (size_t)progLength + 2;
+
+    ImportRow *row = &chunk->rows[chunk->rowCount++];
+    row->id = id;
+    row->mark = mark;
+    row->name = name;
+    row->programme = programme;
+    row->line = lineNo;
+    row->offset = (size_t)(line - chunk->begin);
+    row->length = length;
+    return 1;
+}
+
+
+// Returns 1 if a line looks like a header row (its first field is not an ID)
+static int isHeaderRow(const char *line, size_t length) {
+    size_t i = 0;
+    while (i < length && (line[i] == ' ' || line[i] == '"')) i++;
+    return i == length || line[i] < '0' || line[i] > '9';
+}
+
+
+/**
+ * parseChunk()
+ * -----------------------------------------
+ * Thread body: parses every line of one slice. Line numbers are relative
+ * to the slice until importParse() offsets them.
+ */
+static void parseChunk(void *arg) {
+    ImportChunk *chunk = arg;
+    const char *p = chunk->begin;
+    int leading = chunk->first;     // Still before the first row of the file
+
+    // Names and programmes never need more room than the line they came from
+    chunk->arena = malloc((size_t)(chunk->end - chunk->begin) + 2);
+    if (!chunk->arena) {
+        chunk->failed = 1;
+        return;
+    }
+
+    while (p < chunk->end && !chunk->failed) {
+        const char *nl = memchr(p, '\n', (size_t)(chunk->end - p));
+        if (!nl) nl = chunk->end;
+        const char *line = p;
+        size_t length = (size_t)(nl - p);
+        p = nl + (nl < chunk->end);
+
+        chunk->lines++;
+        if (length > 0 && line[length - 1] == '\r') length--;
+
+        size_t blank = 0;
+        while (blank < length && (line[blank] == ' ' || line[blank] == '\t')) blank++;
+        if (blank == length) continue;
+
+        if (leading) {
+            if (isHeaderRow(line, length)) continue;
+            leading = 0;
+        }
+        parseLine(chunk, line, length, chunk->lines);
+    }
+}
+
+
+/**
+ * importParse()
+ * -----------------------------------------
+ * Loads a file and parses it with up to IMPORT_MAX_THREADS threads, one
+ * slice of at least IMPORT_MIN_CHUNK_BYTES each.
+ *
+ * @param file  - receives the parsed rows and rejects (importFree() after)
+ * @param path  - file to import
+ * @param index - ID index that rows are checked against
+ * @return 1 on success, 0 if the file cannot be read, -1 if out of memory
+ */
+int importParse(ImportFile *file, const char *path, const IdIndex *index) {
+    memset(file, 0, sizeof(*file));
+
+    long long size = fileSize(path);
+    FILE *input = size >= 0 ? fopen(path, "rb") : NULL;
+    if (!input) return 0;
+
+    file->data = malloc((size_t)size + 1);
+    if (!file->data) {
+        fclose(input);
+        return -1;
+    }
+    file->size = fread(file->data, 1, (size_t)size, input);
+    int readError = ferror(input);
+    fclose(input);
+    if (readError) {
+        importFree(file);
+        return 0;
+    }
+
+    const char *data = file->data, *end = file->data + file->size;
+
+    // Delimiter: TAB if the first line has one, comma otherwise
+    const char *firstEnd = memchr(data, '\n', file->size);
+    if (!firstEnd) firstEnd = end;
+    char delimiter = memchr(data, '\t', (size_t)(firstEnd - data)) ? '\t' : ',';
+
+    int chunks = threadCpuCount();
+    if (chunks > IMPORT_MAX_THREADS) chunks = IMPORT_MAX_THREADS;
+    if ((size_t)chunks > file->size / IMPORT_MIN_CHUNK_BYTES) chunks = (int)(file->size / IMPORT_MIN_CHUNK_BYTES);
+    if (chunks < 1) chunks = 1;
+
+    file->chunks = calloc((size_t)chunks, sizeof(ImportChunk));
+    Thread *threads = malloc((size_t)chunks * sizeof(Thread));
+    int *started = calloc((size_t)chunks, sizeof(int));
+    if (!file->chunks || !threads || !started) {
+        free(threads);
+        free(started);
+        importFree(file);
+        return -1;
+    }
+    file->chunkCount = chunks;
+
+    // Cut the file into slices that end just after a newline
+    const char *p = data;
+    for (int i = 0; i < chunks; i++) {
+        ImportChunk *chunk = &file->chunks[i];
+        const char *stop = (i == chunks - 1) ? end : data + file->size / (size_t)chunks * (size_t)(i + 1);
+        if (stop < p) stop = p;
+        if (stop < end) {
+            const char *nl = memchr(stop, '\n', (size_t)(end - stop));
+            stop = nl ? nl + 1 : end;
+        }
+        chunk->begin = p;
+        chunk->end = stop;
+        chunk->first = (i == 0);
+        chunk->delimiter = delimiter;
+        chunk->index = index;
+        p = stop;
+    }
+
+    // Slice 0 runs on this thread; the rest on workers (or here, if a
+    // thread cannot be created)
+    file->threads = 1;
+    for (int i = 1; i < chunks; i++) {
+        started[i] = threadStart(&threads[i], parseChunk, &file->chunks[i]);
+        file->threads += started[i];
+    }
+    parseChunk(&file->chunks[0]);
+    for (int i = 1; i < chunks; i++) {
+        if (started[i]) threadJoin(&threads[i]);
+        else parseChunk(&file->chunks[i]);
+    }
+    free(threads);
+    free(started);
+
+    // Turn slice-relative line numbers into file line numbers
+    long lineBase = 0;
+    for (int i = 0; i < chunks; i++) {
+        ImportChunk *chunk = &file->chunks[i];
+        if (chunk->failed) {
+            importFree(file);
+            return -1;
+        }
+        for (size_t r = 0; r < chunk->rowCount; r++) {
+            chunk->rows[r].line += lineBase;
+            chunk->rows[r].offset += (size_t)(chunk->begin - data);
+        }
+        for (size_t r = 0; r < chunk->rejectCount; r++) {
+            chunk->rejects[r].line += lineBase;
+            chunk->rejects[r].offset += (size_t)(chunk->begin - data);
+        }
+        lineBase += chunk->lines;
+    }
+    return 1;
+}
+
+
+int importAddReject(ImportFile *file, const ImportRow *row, const char *reason) {
+    if (!reserveOne((void**)&file->extra, &file->extraCapacity, file->extraCount, sizeof(ImportReject))) return 0;
+    ImportReject *reject = &file->extra[file->extraCount++];
+    reject->line = row->line;
+    reject->offset = row->offset;
+    reject->length = row->length;
+    reject->reason = reason;
+    return 1;
+}
+
+
+size_t importRejectCount(const ImportFile *file) {
+    size_t count = file->extraCount;
+    for (int i = 0; i < file->chunkCount; i++) count += file->chunks[i].rejectCount;
+    return count;
+}
+
+
+static int compareRejects(const void *a, const void *b) {
+    long lineA = ((const ImportReject*)a)->line, lineB = ((const ImportReject*)b)->line;
+    return (lineA > lineB) - (lineA < lineB);
+}
+
+
+/**
+ * importWriteRejects()
+ * -----------------------------------------
+ * Writes the rejected-rows report: a header line, then one line per
+ * rejected row with its line number, the reason and the row as it was.
+ *
+ * @return 1 on success, 0 if the report could not be written
+ */
+int importWriteRejects(const ImportFile *file, const char *path) {
+    size_t count = importRejectCount(file), n = 0;
+    ImportReject *all = malloc((count ? count : 1) * sizeof(ImportReject));
+    if (!all) return 0;
+
+    // Slices are in file order already; only the late rejects need merging
+    for (int i = 0; i < file->chunkCount; i++) {
+        if (!file->chunks[i].rejectCount) continue;
+        memcpy(all + n, file->chunks[i].rejects, file->chunks[i].rejectCount * sizeof(ImportReject));
+        n += file->chunks[i].rejectCount;
+    }
+    if (file->extraCount) {
+        memcpy(all + n, file->extra, file->extraCount * sizeof(ImportReject));
+        qsort(all, count, sizeof(ImportReject), compareRejects);
+    }
+
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        free(all);
+        return 0;
+    }
+    setvbuf(out, NULL, _IOFBF, IO_BUFFER_SIZE);
+
+    fputs("Line\tReason\tRow\n", out);
+    for (size_t i = 0; i < count; i++) {
+        fprintf(out, "%ld\t%s\t%.*s\n", all[i].line, all[i].reason,
+                (int)all[i].length, file->data + all[i].offset);
+    }
+    free(all);
+    return fclose(out) == 0;
+}
+
+
+void importFree(ImportFile *file) {
+    for (int i = 0; i < file->chunkCount; i++) {
+        free(file->chunks[i].arena);
+        free(file->chunks[i].rows);
+        free(file->chunks[i].rejects);
+    }
+    free(file->chunks);
+    free(file->extra);
+    free(file->data);
+    memset(file, 0, sizeof(*file));
+}
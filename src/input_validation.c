@@ -2,58 +2,14 @@
 #include <stdlib.h>
 #include <string.h> 
 #include <ctype.h>
+#include <limits.h>
+#include <math.h>
 #include "headers/input_validation.h"
 #include "headers/cms.h"
+#include "headers/output.h"
 
 
 
-/* -------------------------------------------------------------------------
-   readLine()
-   Reads an entire line from stdin safely, without fixed-size limits.
-   - Automatically expands buffer size as input grows.
-   - Stops reading on newline or EOF.
-   - Caller is responsible for freeing the returned string.
-   Returns: dynamically allocated null-terminated string OR NULL on failure.
----------------------------------------------------------------------------*/
-char* readLine() {
-    int buffer_size = 128;
-    char *buffer = (char*)malloc(buffer_size * sizeof(char));
-    if (!buffer) {
-        perror("Memory allocation failed");
-        return NULL;
-    }
-    
-    int position = 0;
-    int c;
-    
-    while (1) {
-        c = fgetc(stdin);
-
-        if (c == EOF || c == '\n') {
-            break;
-        }
-
-        // Resize buffer if needed
-        if (position >= buffer_size - 1) {
-            buffer_size *= 2; 
-            char *new_buffer = (char*)realloc(buffer, buffer_size * sizeof(char));
-            if (!new_buffer) {
-                free(buffer);
-                perror("Memory reallocation failed");
-                return NULL;
-            }
-            buffer = new_buffer;
-        }
-        
-        buffer[position++] = (char)c;
-    }
-
-    buffer[position] = '\0';
-
-    return buffer;
-}
-
-
 /* -------------------------------------------------------------------------
    validateCommand()
    Checks if an input string begins with the specified command (case-insensitive)
@@ -153,70 +109,76 @@ int validateMark(const char *str) {
 }
 
 
+/* -------------------------------------------------------------------------
+   matchKey()
+   Checks whether one of the command keys ID, NAME, PROGRAMME or MARK
+   starts at text (case-insensitive) and is followed by '=' or a space.
+   The keys all begin with a different letter, so the first character
+   picks the only candidate and most positions are rejected at once.
+   Returns: field index (0 = ID, 1 = NAME, 2 = PROGRAMME, 3 = MARK) OR -1.
+---------------------------------------------------------------------------*/
+static int matchKey(const char *text) {
+    static const char *const keys[] = {"ID", "NAME", "PROGRAMME", "MARK"};
+    static const int lengths[] = {2, 4, 9, 4};
+    int field;
+
+    switch (toupper((unsigned char)*text)) {
+        case 'I': field = 0; break;
+        case 'N': field = 1; break;
+        case 'P': field = 2; break;
+        case 'M': field = 3; break;
+        default: return -1;
+    }
+    if (strncasecmp(text, keys[field], lengths[field]) != 0) return -1;
+
+    unsigned char after = (unsigned char)text[lengths[field]];
+    return (after == '=' || isspace(after)) ? field : -1;
+}
+
+
 /* -------------------------------------------------------------------------
    parseCommand()
    Parses CMS command key-value pairs formatted as:
         ID=xxxx NAME=xxxx PROGRAMME=xxxx MARK=xx
    Features:
-   - Enforces required vs optional fields depending on command type.
+   - Enforces required vs optional fields depending on command type
+     (OPTIONAL_LOOKUP takes either ID or NAME, for QUERY).
    - Performs validation for ID, programme length, format, and mark boundaries.
    - Trims whitespace and rejects malformed formatting (duplicate fields, 
      missing '=', trailing spaces, invalid keys).
+   - Reads the input in one pass, without copying it: values go straight
+     into args, and args->provided records which fields were given.
    Returns: 1 if successfully parsed, 0 if invalid.
 ---------------------------------------------------------------------------*/
-int parseCommand(const char *input, int *id, char *name, char *programme, float *mark, int optionalMode) {
-    // Create a mutable copy of the input string for parsing
-    char *buf = strdup(input);
-    if (!buf) {
-        perror("Memory allocation failed for command parsing");
-        return 0;
-    }
-    
-    *id = -1;
-    if (name) name[0] = '\0';
-    if (programme) programme[0] = '\0';
-    if (mark) *mark = 0.0f;
-
-    const char *keys[] = {"ID", "NAME", "PROGRAMME", "MARK"};
-    const int keyCount = 4;
+int parseCommand(const char *input, CommandArgs *args, int optionalMode) {
+    static const int keyLengths[] = {2, 4, 9, 4};
 
-    int found[keyCount];
-    memset(found, 0, sizeof(found)); // Track which fields have already appeared
+    args->id = -1;
+    args->name[0] = '\0';
+    args->programme[0] = '\0';
+    args->mark = 0.0f;
+    args->provided = 0;
 
-    char *ptr = buf;
-
-    int optionalProvided = 0; // Flag to track if at least one optional field is present
+    int found = 0; // Bit per field that has already appeared
+    const char *ptr = input;
 
     while (*ptr) {
-        int fieldIndex = -1;
         // Identify which field starts at the current pointer
-        for (int i = 0; i < keyCount; i++) {
-            int len = strlen(keys[i]);
-            if (strncasecmp(ptr, keys[i], len) == 0) {
-                char after = ptr[len];
-                if (after == '=' || isspace(after)) {
-                    fieldIndex = i;
-                    break;
-                }
-            }
-        }
+        int fieldIndex = matchKey(ptr);
 
         if (fieldIndex == -1) {
-            printf("CMS: Invalid command. Unknown field or missing '='.\n");
-            free(buf);
+            outputPrintf("CMS: Invalid command. Unknown field or missing '='.\n");
             return 0;
         }
 
-        if (found[fieldIndex]) {
-            printf("CMS: Invalid command. Duplicate field.\n");
-            free(buf);
+        if (found & (1 << fieldIndex)) {
+            outputPrintf("CMS: Invalid command. Duplicate field.\n");
             return 0;
         }
-        found[fieldIndex] = 1;
+        found |= 1 << fieldIndex;
 
         // Ensure '=' immediately follows the field name
-        int keyLen = strlen(keys[fieldIndex]);
-        char *afterKey = ptr + keyLen;
+        const char *afterKey = ptr + keyLengths[fieldIndex];
         int spaces = 0;
         while (*afterKey && isspace((unsigned char)*afterKey)) {
             spaces++;
@@ -224,14 +186,12 @@ int parseCommand(const char *input, int *id, char *name, char *programme, float
         }
 
         if (*afterKey != '=') {
-            printf("CMS: Invalid command. Missing '='.\n");
-            free(buf);
+            outputPrintf("CMS: Invalid command. Missing '='.\n");
             return 0;
         }
 
         if (spaces > 0) {
-            printf("CMS: Invalid command. No space allowed before '='.\n");
-            free(buf);
+            outputPrintf("CMS: Invalid command. No space allowed before '='.\n");
             return 0;
         }
 
@@ -239,114 +199,92 @@ int parseCommand(const char *input, int *id, char *name, char *programme, float
         while (*ptr && isspace((unsigned char)*ptr)) ptr++; // Skip spaces after '='
 
         // Extract value for current field up to next key or end of string
-        char *valueStart = ptr;
-        while (*ptr) {
-            int isNextKey = 0;
-            for (int i = 0; i < keyCount; i++) {
-                int len = strlen(keys[i]);
-                if (strncasecmp(ptr, keys[i], len) == 0) {
-                    char after = ptr[len];
-                    if (after == '=' || isspace(after)) {
-                        isNextKey = 1;
-                        break;
-                    }
-                }
-            }
-            if (isNextKey) break;
-            ptr++;
-        }
+        const char *valueStart = ptr;
+        while (*ptr && matchKey(ptr) == -1) ptr++;
 
-        char *valueEnd = ptr;
+        const char *valueEnd = ptr;
         while (valueEnd > valueStart && isspace((unsigned char)*(valueEnd - 1)))
             valueEnd--;
 
-        int len = valueEnd - valueStart; // TRUE length of the value is calculated here.
-        
-        // Use a temporary buffer for validation and cap copy length to prevent overflow
-        char value[MAX_LINE] = {0}; 
-        
-        // Calculate safe copy length, preventing overflow in the temporary 'value' buffer
-        size_t copyLen = (size_t)len;
-        if (copyLen >= MAX_LINE) {
-            copyLen = MAX_LINE - 1; // Cap to buffer size - 1
-        }
-        
-        // Use safe copy length
-        strncpy(value, valueStart, copyLen);
-        value[copyLen] = '\0'; // Explicitly null-terminate the temporary buffer
+        size_t len = (size_t)(valueEnd - valueStart); // TRUE length of the value
 
         if (optionalMode == OPTIONAL_NONE && fieldIndex != 0) {
-            printf("CMS: Invalid command. Only ID allowed.\n");
-            free(buf);
+            outputPrintf("CMS: Invalid command. Only ID allowed.\n");
+            return 0;
+        }
+
+        if (optionalMode == OPTIONAL_LOOKUP && fieldIndex > 1) {
+            outputPrintf("CMS: Invalid command. Only ID or NAME allowed.\n");
             return 0;
         }
 
+        // ID and MARK are checked as strings; copy them out, capped to
+        // the line limit
+        char value[MAX_LINE];
+        if (fieldIndex == 0 || fieldIndex == 3) {
+            size_t copyLen = len < MAX_LINE ? len : MAX_LINE - 1;
+            memcpy(value, valueStart, copyLen);
+            value[copyLen] = '\0';
+        }
+
         // Validate and store the extracted field
         switch (fieldIndex) {
             case 0: // ID
                 if (len == 0) {
-                    printf("CMS: Missing required ID.\n");
-                    free(buf);
+                    outputPrintf("CMS: Missing required ID.\n");
                     return 0;
                 }
                 if (!validateID(value)) {
-                    printf("CMS: Invalid command. ID must be 7 digits starting with '2'.\n");
-                    free(buf);
+                    outputPrintf("CMS: Invalid command. ID must be 7 digits starting with '2'.\n");
                     return 0;
                 }
-                *id = atoi(value);
+                args->id = atoi(value);
+                args->provided |= ARG_ID;
                 break;
 
             case 1: // NAME
-                if (!name) { free(buf); return 0; }
                 if (len > 0) {
                     if (len >= MAX_NAME) {
-                        printf("CMS: Invalid command. Name is too long (Max %d characters).\n", MAX_NAME - 1);
-                        free(buf);
+                        outputPrintf("CMS: Invalid command. Name is too long (Max %d characters).\n", MAX_NAME - 1);
                         return 0;
                     }
 
-                    strncpy(name, value, MAX_NAME - 1); 
-                    name[MAX_NAME - 1] = '\0';
-                    toTitleCase(name);
-                    optionalProvided = 1;
+                    memcpy(args->name, valueStart, len);
+                    args->name[len] = '\0';
+                    toTitleCase(args->name);
+                    args->provided |= ARG_NAME;
                 }
                 break;
 
             case 2: // PROGRAMME      
-                if (!programme) { free(buf); return 0; }
                 if (len > 0) {
                     if (len >= MAX_PROGRAMME) {
-                        printf("CMS: Invalid command. Programme is too long (Max %d characters).\n", MAX_PROGRAMME - 1);
-                        free(buf);
+                        outputPrintf("CMS: Invalid command. Programme is too long (Max %d characters).\n", MAX_PROGRAMME - 1);
                         return 0;
                     }
 
-                    strncpy(programme, value, MAX_PROGRAMME - 1); 
-                    programme[MAX_PROGRAMME - 1] = '\0';
-                    toTitleCase(programme);
-                    optionalProvided = 1;
+                    memcpy(args->programme, valueStart, len);
+                    args->programme[len] = '\0';
+                    toTitleCase(args->programme);
+                    args->provided |= ARG_PROGRAMME;
                 }
                 break;
 
             case 3: // MARK            
-                if (!mark) { free(buf); return 0; }
                 if (len > 0) {
                     if (!validateMark(value)) {
-                        printf("CMS: Invalid command. Mark must be numeric.\n");
-                        free(buf); 
+                        outputPrintf("CMS: Invalid command. Mark must be numeric.\n");
                         return 0;
                     }
                     
                     float tempMark = atof(value);
                     if (tempMark < 0.0f || tempMark > 100.0f) {
-                        printf("CMS: Invalid command. Mark must be between 0 - 100.\n");
-                        free(buf); 
+                        outputPrintf("CMS: Invalid command. Mark must be between 0 - 100.\n");
                         return 0;
                     }
 
-                    *mark = tempMark;
-                    optionalProvided = 1;
+                    args->mark = tempMark;
+                    args->provided |= ARG_MARK;
                 }
                 break;
         }
@@ -354,54 +292,387 @@ int parseCommand(const char *input, int *id, char *name, char *programme, float
         while (*ptr && isspace((unsigned char)*ptr)) ptr++;
     }
 
-    if (*id == -1) { // ID is always required
-        printf("CMS: Missing required ID.\n");
-        free(buf);
+    if (optionalMode == OPTIONAL_LOOKUP) { // Exactly one of ID and NAME
+        if (args->id != -1 && (args->provided & ARG_NAME)) {
+            outputPrintf("CMS: Invalid command. Use either ID or NAME, not both.\n");
+            return 0;
+        }
+        if (args->id == -1 && !(args->provided & ARG_NAME)) {
+            outputPrintf("CMS: Missing required ID or NAME.\n");
+            return 0;
+        }
+        return 1;
+    }
+
+    if (args->id == -1) { // ID is always required otherwise
+        outputPrintf("CMS: Missing required ID.\n");
         return 0;
     }
 
-    if (optionalMode == OPTIONAL_REQUIRED && !optionalProvided) {
-        printf("CMS: At least one of NAME, PROGRAMME, or MARK must be provided for UPDATE.\n");
-        free(buf);
+    if (optionalMode == OPTIONAL_REQUIRED && !(args->provided & (ARG_NAME | ARG_PROGRAMME | ARG_MARK))) {
+        outputPrintf("CMS: At least one of NAME, PROGRAMME, or MARK must be provided for UPDATE.\n");
         return 0;
     }
 
-    free(buf);
     return 1;
 }
 
 
+/* -------------------------------------------------------------------------
+   parseCount()
+   Parses a whole number of records (digits only, at most 9 of them).
+   Returns: 1 if valid, 0 otherwise.
+---------------------------------------------------------------------------*/
+static int parseCount(const char *str, size_t *count) {
+    size_t length = str ? strlen(str) : 0;
+    if (length == 0 || length > 9) return 0;
+    for (size_t i = 0; i < length; i++) {
+        if (!isdigit((unsigned char)str[i])) return 0;
+    }
+    *count = (size_t)strtoul(str, NULL, 10);
+    return 1;
+}
+
+
+/* -------------------------------------------------------------------------
+   findKeyword()
+   Finds the first space-separated word of text that equals one of the
+   keywords (case-insensitive).
+   Returns: pointer to that word OR NULL if there is none.
+---------------------------------------------------------------------------*/
+static char* findKeyword(char *text, const char *const *keywords) {
+    if (!text) return NULL;
+    for (char *word = text; *word; ) {
+        while (*word == ' ') word++;
+        size_t length = strcspn(word, " ");
+        for (int k = 0; keywords[k]; k++) {
+            if (length == strlen(keywords[k]) && length > 0 && strncasecmp(word, keywords[k], length) == 0) {
+                return word;
+            }
+        }
+        word += length;
+    }
+    return NULL;
+}
+
+
+/* -------------------------------------------------------------------------
+   matchWord()
+   Checks whether text starts with word (case-insensitive) as a whole word,
+   i.e. not followed by another letter or digit.
+---------------------------------------------------------------------------*/
+static int matchWord(const char *text, const char *word) {
+    size_t length = strlen(word);
+    return strncasecmp(text, word, length) == 0 && !isalnum((unsigned char)text[length]);
+}
+
+
+/* -------------------------------------------------------------------------
+   readNumber()
+   Copies the next space-free word at *cursor into value (at most 31
+   characters) and moves the cursor past it.
+   Returns: 1 if a word was read, 0 if there is none or it is too long.
+---------------------------------------------------------------------------*/
+static int readNumber(const char **cursor, char *value) {
+    const char *p = *cursor;
+    while (*p == ' ') p++;
+    size_t length = strcspn(p, " ");
+    if (length == 0 || length > 31) return 0;
+    memcpy(value, p, length);
+    value[length] = '\0';
+    *cursor = p + length;
+    return 1;
+}
+
+
+/* -------------------------------------------------------------------------
+   parseCondition()
+   Parses one WHERE condition at *cursor and narrows the filter with it:
+   - ID|MARK (<|<=|>|>=|=) value
+   - ID|MARK BETWEEN low AND high
+   - PROGRAMME=value (may contain spaces, ends before " AND <field>")
+   Returns: 1 if valid, 0 on a syntax error (message printed).
+---------------------------------------------------------------------------*/
+static int parseCondition(const char **cursor, RecordFilter *filter) {
+    const char *p = *cursor;
+    while (*p == ' ') p++;
+
+    int isId = matchWord(p, "ID"), isMark = matchWord(p, "MARK");
+    if (matchWord(p, "PROGRAMME")) {
+        p += 9;
+        while (*p == ' ') p++;
+        if (*p != '=') {
+            outputPrintf("CMS: PROGRAMME only supports '=' in WHERE.\n");
+            return 0;
+        }
+        if (filter->hasProgramme) {
+            outputPrintf("CMS: PROGRAMME can only be used once in WHERE.\n");
+            return 0;
+        }
+        p++;
+        while (*p == ' ') p++;
+
+        // The value runs up to the next " AND <field>" or the end
+        const char *end = p;
+        while (*end) {
+            if (*end == ' ') {
+                const char *next = end;
+                while (*next == ' ') next++;
+                if (matchWord(next, "AND")) {
+                    next += 3;
+                    while (*next == ' ') next++;
+                    if (matchWord(next, "ID") || matchWord(next, "MARK") || matchWord(next, "PROGRAMME")) break;
+                }
+            }
+            end++;
+        }
+        size_t length = (size_t)(end - p);
+        while (length > 0 && p[length - 1] == ' ') length--;
+        if (length == 0) {
+            outputPrintf("CMS: PROGRAMME needs a value in WHERE.\n");
+            return 0;
+        }
+        if (length >= MAX_PROGRAMME) {
+            outputPrintf("CMS: Invalid command. Programme is too long (Max %d characters).\n", MAX_PROGRAMME - 1);
+            return 0;
+        }
+        memcpy(filter->programme, p, length);
+        filter->programme[length] = '\0';
+        filter->hasProgramme = 1;
+        *cursor = end;
+        return 1;
+    }
+    if (!isId && !isMark) {
+        outputPrintf("CMS: Invalid WHERE condition. Use ID, MARK or PROGRAMME.\n");
+        return 0;
+    }
+    p += isId ? 2 : 4;
+    while (*p == ' ') p++;
+
+    // Operator, then one value (two for BETWEEN)
+    char op[3] = "";
+    if (matchWord(p, "BETWEEN")) {
+        strcpy(op, "B");
+        p += 7;
+    }
+    else if ((p[0] == '<' || p[0] == '>') && p[1] == '=') {
+        op[0] = p[0];
+        op[1] = '=';
+        op[2] = '\0';
+        p += 2;
+    }
+    else if (p[0] == '<' || p[0] == '>' || p[0] == '=') {
+        op[0] = p[0];
+        op[1] = '\0';
+        p += 1;
+    }
+    else {
+        outputPrintf("CMS: Invalid WHERE operator. Use <, <=, >, >=, = or BETWEEN.\n");
+        return 0;
+    }
+
+    char low[32], high[32];
+    int ok = readNumber(&p, low);
+    if (ok && op[0] == 'B') {
+        while (*p == ' ') p++;
+        ok = matchWord(p, "AND");
+        if (ok) {
+            p += 3;
+            ok = readNumber(&p, high);
+        }
+    }
+    else {
+        strcpy(high, low);
+    }
+    if (!ok && op[0] == 'B') {
+        outputPrintf("CMS: Use BETWEEN <low> AND <high> in WHERE.\n");
+        return 0;
+    }
+
+    if (isId) {
+        size_t lowId = 0, highId = 0;
+        if (!ok || !parseCount(low, &lowId) || !parseCount(high, &highId)) {
+            outputPrintf("CMS: ID values in WHERE must be whole numbers.\n");
+            return 0;
+        }
+        long from = (long)lowId, to = (long)highId;
+        if (strcmp(op, "<") == 0) { from = filter->minId; to = (long)lowId - 1; }
+        else if (strcmp(op, "<=") == 0) from = filter->minId;
+        else if (strcmp(op, ">") == 0) { from = (long)lowId + 1; to = filter->maxId; }
+        else if (strcmp(op, ">=") == 0) to = filter->maxId;
+        if (from > filter->minId) filter->minId = (int)from;
+        if (to < filter->maxId) filter->maxId = (int)to;
+    }
+    else {
+        if (!ok || !validateMark(low) || !validateMark(high)) {
+            outputPrintf("CMS: MARK values in WHERE must be numbers.\n");
+            return 0;
+        }
+        float from = strtof(low, NULL), to = strtof(high, NULL);
+        if (strcmp(op, "<") == 0) { to = nextafterf(from, -INFINITY); from = -INFINITY; }
+        else if (strcmp(op, "<=") == 0) { to = from; from = -INFINITY; }
+        else if (strcmp(op, ">") == 0) { from = nextafterf(from, INFINITY); to = INFINITY; }
+        else if (strcmp(op, ">=") == 0) to = INFINITY;
+        if (from > filter->minMark) filter->minMark = from;
+        if (to < filter->maxMark) filter->maxMark = to;
+    }
+    *cursor = p;
+    return 1;
+}
+
+
+/* -------------------------------------------------------------------------
+   parseWhere()
+   Parses the conditions of SHOW ALL WHERE, joined by AND. Conditions on
+   the same field narrow each other (e.g. MARK >= 40 AND MARK < 50).
+   Returns: 1 if valid, 0 on a syntax error.
+---------------------------------------------------------------------------*/
+static int parseWhere(const char *text, RecordFilter *filter) {
+    filter->active = 1;
+    filter->minId = INT_MIN;
+    filter->maxId = INT_MAX;
+    filter->minMark = -INFINITY;
+    filter->maxMark = INFINITY;
+    filter->hasProgramme = 0;
+
+    // Keep the conditions as typed, single-spaced, for the header line
+    size_t length = 0;
+    for (const char *c = text; *c && length < sizeof(filter->text) - 1; c++) {
+        if (*c == ' ' && (length == 0 || filter->text[length - 1] == ' ')) continue;
+        filter->text[length++] = *c;
+    }
+    while (length > 0 && filter->text[length - 1] == ' ') length--;
+    filter->text[length] = '\0';
+    if (length == 0) {
+        outputPrintf("CMS: WHERE needs at least one condition.\n");
+        return 0;
+    }
+
+    const char *cursor = text;
+    while (1) {
+        if (!parseCondition(&cursor, filter)) return 0;
+        while (*cursor == ' ') cursor++;
+        if (*cursor == '\0') return 1;
+        if (!matchWord(cursor, "AND")) {
+            outputPrintf("CMS: Invalid trailing input.\n");
+            return 0;
+        }
+        cursor += 3;
+    }
+}
+
+
+/* -------------------------------------------------------------------------
+   parseViewOptions()
+   Splits the trailing [LIMIT n] [OFFSET m] [TSV] options (any order, each
+   at most once) off the text after SHOW ALL. The text is cut where the
+   first option starts, leaving any SORT BY clause in place.
+   Returns: 1 if the options are valid, 0 on a syntax error.
+---------------------------------------------------------------------------*/
+static int parseViewOptions(char *text, ViewOptions *options) {
+    static const char *const optionWords[] = { "LIMIT", "OFFSET", "TSV", NULL };
+    char *start = findKeyword(text, optionWords);
+    if (!start) return 1;
+
+    char *optionText = strdup(start);
+    if (!optionText) {
+        perror("Memory allocation failed for parseViewOptions");
+        return 0;
+    }
+    *start = '\0';
+
+    int hasLimit = 0, hasOffset = 0, ok = 1;
+    for (char *token = strtok(optionText, " "); ok && token; token = strtok(NULL, " ")) {
+        if (strcasecmp(token, "LIMIT") == 0 && !hasLimit) {
+            hasLimit = 1;
+            if (!parseCount(strtok(NULL, " "), &options->limit) || options->limit == 0) {
+                outputPrintf("CMS: LIMIT must be followed by a whole number above 0.\n");
+                ok = 0;
+            }
+        }
+        else if (strcasecmp(token, "OFFSET") == 0 && !hasOffset) {
+            hasOffset = 1;
+            if (!parseCount(strtok(NULL, " "), &options->offset)) {
+                outputPrintf("CMS: OFFSET must be followed by a whole number.\n");
+                ok = 0;
+            }
+        }
+        else if (strcasecmp(token, "TSV") == 0 && !options->tsv) {
+            options->tsv = 1;
+        }
+        else if (strcasecmp(token, "LIMIT") == 0 || strcasecmp(token, "OFFSET") == 0 ||
+                 strcasecmp(token, "TSV") == 0) {
+            outputPrintf("CMS: Each of LIMIT, OFFSET and TSV can only be used once.\n");
+            ok = 0;
+        }
+        else {
+            outputPrintf("CMS: Invalid trailing input.\n");
+            ok = 0;
+        }
+    }
+    free(optionText);
+    return ok;
+}
+
+
 /* -------------------------------------------------------------------------
    handleShow()
    Processes the SHOW command and its variations:
    - SHOW ALL
-   - SHOW ALL SORT BY (ID|MARK) [ASC|DESC]
-   - SHOW SUMMARY [PROGRAMME=value] 
+   - SHOW ALL SORT BY (ID|MARK) [ASC|DESC] [, (ID|MARK) [ASC|DESC]]
+   - SHOW ALL WHERE <conditions> [SORT BY ...]
+   - any of the above followed by [LIMIT n] [OFFSET m] [TSV]
+   - SHOW SUMMARY [PROGRAMME=value] [PERCENTILES]
+   - SHOW SUMMARY BY PROGRAMME
+   - SHOW TOP|BOTTOM n [BY MARK|ID] [PROGRAMME=value]
+   - SHOW STATS
    Performs syntax validation and delegates execution to display functions.
-   Returns: 1 after processing (not used as boolean result).
+   Returns: 1 if the command was valid and executed, 0 on a syntax error.
 ---------------------------------------------------------------------------*/
 int handleShow(const char *input) {
     char *buf = strdup(input);
     if (!buf) {
         perror("Memory allocation failed for handleShow");
-        return 1;
+        return 0;
     }
     
     // Extract first token to determine SHOW type
     char *token = strtok(buf, " ");
 
     if (!token) {
-        printf("CMS: Enter a valid SHOW command.\n");
+        outputPrintf("CMS: Enter a valid SHOW command.\n");
         free(buf);
-        return 1;
+        return 0;
     }
 
     // SHOW ALL with no extra options: display all records
     if (strcasecmp(token, "ALL") == 0) {
-        token = strtok(NULL, " ");
+        ViewOptions options;
+        memset(&options, 0, sizeof(options));
+        char *rest = strtok(NULL, "");
+        if (!parseViewOptions(rest, &options)) {
+            free(buf);
+            return 0;
+        }
+        token = rest ? strtok(rest, " ") : NULL;
+
+        // SHOW ALL WHERE <conditions> [SORT BY ...]
+        if (token && strcasecmp(token, "WHERE") == 0) {
+            static const char *const sortWords[] = { "SORT", NULL };
+            char *conditions = strtok(NULL, "");
+            char *sortClause = findKeyword(conditions, sortWords);
+            if (sortClause == conditions) conditions = "";
+            else if (sortClause) sortClause[-1] = '\0';
+
+            if (!parseWhere(conditions ? conditions : "", &options.where)) {
+                free(buf);
+                return 0;
+            }
+            token = sortClause ? strtok(sortClause, " ") : NULL;
+        }
 
         if (!token) {
-            showDB();
+            showView(NULL, 0, &options);
             free(buf);
             return 1;
         }
@@ -410,62 +681,88 @@ int handleShow(const char *input) {
         if (strcasecmp(token, "SORT") == 0) {
             token = strtok(NULL, " ");
             if (!token || strcasecmp(token, "BY") != 0) {
-                printf("CMS: Expected 'SORT BY'.\n");
+                outputPrintf("CMS: Expected 'SORT BY'.\n");
                 free(buf);
-                return 1;
+                return 0;
             }
 
-            // Determine sort field
-            token = strtok(NULL, " ");
-            if (!token) {
-                printf("CMS: Missing sort field (ID or MARK).\n");
-                free(buf);
-                return 1;
-            }
+            // Sort keys: "<field> [ASC|DESC]" clauses separated by commas,
+            // most significant first (e.g. MARK DESC, ID ASC)
+            char *clause = strtok(NULL, "");
+            SortKey keys[SORT_MAX_KEYS];
+            int keyCount = 0;
 
-            int sortByID;
-            if (strcasecmp(token, "ID") == 0) {
-                sortByID = 1;
-            }
-                
-            else if (strcasecmp(token, "MARK") == 0) {
-                sortByID = 0;
-            }
-                
-            else {
-                printf("CMS: Invalid sort field. Use ID or MARK.\n");
-                free(buf); 
-                return 1;
-            }
+            while (1) {
+                char *comma = clause ? strchr(clause, ',') : NULL;
+                if (comma) *comma = '\0';
 
-            // Determine sort order (optional)
-            token = strtok(NULL, " ");
-            int ascending = 1; // default ascending
+                // Determine sort field
+                token = clause ? strtok(clause, " ") : NULL;
+                if (!token) {
+                    outputPrintf("CMS: Missing sort field (ID or MARK).\n");
+                    free(buf);
+                    return 0;
+                }
 
-            if (token) {
-                if (strcasecmp(token, "DESC") == 0) ascending = 0;
-                else if (strcasecmp(token, "ASC") == 0) ascending = 1;
+                SortField field;
+                if (strcasecmp(token, "ID") == 0) {
+                    field = SORT_FIELD_ID;
+                }
+                    
+                else if (strcasecmp(token, "MARK") == 0) {
+                    field = SORT_FIELD_MARK;
+                }
+                    
                 else {
-                    printf("CMS: Invalid sort order. Use ASC or DESC.\n");
-                    free(buf);
-                    return 1;
+                    outputPrintf("CMS: Invalid sort field. Use ID or MARK.\n");
+                    free(buf); 
+                    return 0;
                 }
 
-                // Check for trailing invalid input
-                if ((token = strtok(NULL, " ")) != NULL) {
-                    printf("CMS: Invalid trailing input.\n");
-                    free(buf);
-                    return 1;
+                for (int k = 0; k < keyCount; k++) {
+                    if (keys[k].field == field) {
+                        outputPrintf("CMS: Each sort field can only be used once.\n");
+                        free(buf);
+                        return 0;
+                    }
                 }
+
+                // Determine sort order (optional)
+                token = strtok(NULL, " ");
+                int ascending = 1; // default ascending
+
+                if (token) {
+                    if (strcasecmp(token, "DESC") == 0) ascending = 0;
+                    else if (strcasecmp(token, "ASC") == 0) ascending = 1;
+                    else {
+                        outputPrintf("CMS: Invalid sort order. Use ASC or DESC.\n");
+                        free(buf);
+                        return 0;
+                    }
+
+                    // Check for trailing invalid input
+                    if ((token = strtok(NULL, " ")) != NULL) {
+                        outputPrintf("CMS: Invalid trailing input.\n");
+                        free(buf);
+                        return 0;
+                    }
+                }
+
+                keys[keyCount].field = field;
+                keys[keyCount].ascending = ascending;
+                keyCount++;
+
+                if (!comma) break;
+                clause = comma + 1;
             }
-            showDBSorted(sortByID, ascending);
+            showView(keys, keyCount, &options);
             free(buf);
             return 1;
         }
 
-        printf("CMS: Invalid SHOW ALL format.\n");
+        outputPrintf("CMS: Invalid SHOW ALL format.\n");
         free(buf);
-        return 1;
+        return 0;
     }
 
     // SHOW SUMMARY
@@ -474,6 +771,45 @@ int handleShow(const char *input) {
         int hasFilter = 0;                  // Flag to indicate if a filter was provided
 
         char *rest = strtok(NULL, ""); // Get the rest of the input after "SUMMARY" (entire remaining string)
+
+        // A trailing PERCENTILES adds the spread of the marks; cut it off
+        // so it is not read as part of a programme name
+        int percentiles = 0;
+        if (rest) {
+            char *end = rest + strlen(rest);
+            while (end > rest && isspace((unsigned char)*(end - 1))) end--;
+            size_t length = strlen("PERCENTILES");
+            char *word = end - length;
+            if ((size_t)(end - rest) >= length && strncasecmp(word, "PERCENTILES", length) == 0
+                && (word == rest || isspace((unsigned char)*(word - 1)))) {
+                *word = '\0';
+                percentiles = 1;
+            }
+        }
+
+        // SHOW SUMMARY BY PROGRAMME: one line per programme group
+        if (rest) {
+            char *ptr = rest;
+            while (*ptr && isspace((unsigned char)*ptr)) ptr++;
+            if (strncasecmp(ptr, "BY", 2) == 0 && (ptr[2] == '\0' || isspace((unsigned char)ptr[2]))) {
+                ptr += 2;
+                while (*ptr && isspace((unsigned char)*ptr)) ptr++;
+                if (strncasecmp(ptr, "PROGRAMME", 9) != 0) {
+                    outputPrintf("CMS: Invalid SHOW SUMMARY BY format. Use SHOW SUMMARY BY PROGRAMME.\n");
+                    free(buf);
+                    return 0;
+                }
+                ptr += 9;
+                while (*ptr && isspace((unsigned char)*ptr)) ptr++;
+                int valid = (*ptr == '\0') && !percentiles;
+                if (valid) showSummaryByProgramme();
+                else if (percentiles) outputPrintf("CMS: PERCENTILES cannot be combined with BY PROGRAMME.\n");
+                else outputPrintf("CMS: Invalid trailing input.\n");
+                free(buf);
+                return valid;
+            }
+        }
+
         if (rest) {
             char *ptr = rest;
 
@@ -485,16 +821,16 @@ int handleShow(const char *input) {
 
                 char *eq = strchr(ptr, '=');
                 if (!eq) { // '=' not found → invalid format
-                    printf("CMS: Invalid filter format. Use key=value.\n");
+                    outputPrintf("CMS: Invalid filter format. Use key=value.\n");
                     free(buf);
-                    return 1;
+                    return 0;
                 }
 
                 // Check for spaces immediately before '=' (not allowed)
                 if (*(eq - 1) == ' ' || *(eq - 1) == '\t') {
-                    printf("CMS: Invalid command. No space allowed before '='.\n");
+                    outputPrintf("CMS: Invalid command. No space allowed before '='.\n");
                     free(buf);
-                    return 1;
+                    return 0;
                 }
 
                 char *key = ptr;        // Key starts at current pointer
@@ -512,9 +848,9 @@ int handleShow(const char *input) {
                 // Process recognized filter key: PROGRAMME
                 if (strcasecmp(key, "PROGRAMME") == 0) {
                     if (strlen(value) >= MAX_PROGRAMME) {
-                        printf("CMS: Programme too long.\n");
+                        outputPrintf("CMS: Programme too long.\n");
                         free(buf);
-                        return 1;
+                        return 0;
                     }
                     // Copy value into programme buffer and ensure null-termination
                     strncpy(programme, value, MAX_PROGRAMME - 1);
@@ -522,19 +858,79 @@ int handleShow(const char *input) {
                     toTitleCase(programme); // Convert to title case
                     hasFilter = 1;          // Mark that a filter has been provided
                 } else {
-                    printf("CMS: Unknown filter key '%s'.\n", key);
+                    outputPrintf("CMS: Unknown filter key '%s'.\n", key);
                     free(buf);
-                    return 1;
+                    return 0;
                 }
                 // Move pointer to end of current value to continue parsing next key=value
                 ptr = valEnd;
             }
         }
-        showSummary(hasFilter ? programme : NULL);
+        showSummary(hasFilter ? programme : NULL, percentiles);
+        free(buf);
+        return 1;
+    }
+    // SHOW TOP|BOTTOM <n> [BY MARK|ID] [PROGRAMME=value]
+    if (strcasecmp(token, "TOP") == 0 || strcasecmp(token, "BOTTOM") == 0) {
+        int highest = strcasecmp(token, "TOP") == 0;
+        size_t count;
+        if (!parseCount(strtok(NULL, " "), &count) || count == 0) {
+            outputPrintf("CMS: SHOW %s must be followed by a whole number above 0.\n", highest ? "TOP" : "BOTTOM");
+            free(buf);
+            return 0;
+        }
+
+        SortField field = SORT_FIELD_MARK;
+        char *rest = strtok(NULL, "");
+        while (rest && isspace((unsigned char)*rest)) rest++;
+        if (rest && strncasecmp(rest, "BY", 2) == 0 && (rest[2] == '\0' || isspace((unsigned char)rest[2]))) {
+            rest += 2;
+            while (isspace((unsigned char)*rest)) rest++;
+            size_t length = strcspn(rest, " \t");
+            if (length == 2 && strncasecmp(rest, "ID", 2) == 0) field = SORT_FIELD_ID;
+            else if (length != 4 || strncasecmp(rest, "MARK", 4) != 0) {
+                outputPrintf("CMS: Invalid sort field. Use ID or MARK.\n");
+                free(buf);
+                return 0;
+            }
+            rest += length;
+            while (isspace((unsigned char)*rest)) rest++;
+        }
+
+        // The programme runs to the end of the line, so it may contain spaces
+        char programme[MAX_PROGRAMME] = "";
+        if (rest && *rest) {
+            if (strncasecmp(rest, "PROGRAMME=", 10) != 0) {
+                outputPrintf("CMS: Invalid trailing input.\n");
+                free(buf);
+                return 0;
+            }
+            char *value = rest + 10;
+            while (isspace((unsigned char)*value)) value++;
+            char *valEnd = value + strlen(value);
+            while (valEnd > value && isspace((unsigned char)*(valEnd - 1))) valEnd--;
+            *valEnd = '\0';
+            if (*value == '\0' || strlen(value) >= MAX_PROGRAMME) {
+                outputPrintf(*value ? "CMS: Programme too long.\n" : "CMS: Enter a programme after PROGRAMME=.\n");
+                free(buf);
+                return 0;
+            }
+            strcpy(programme, value);
+            toTitleCase(programme);
+        }
+        showRanked(highest, count, field, programme[0] ? programme : NULL);
         free(buf);
         return 1;
     }
-    printf("CMS: Unknown SHOW command.\n");
+    // SHOW STATS: table health and command timings
+    if (strcasecmp(token, "STATS") == 0) {
+        int valid = strtok(NULL, " ") == NULL;
+        if (valid) showStats();
+        else outputPrintf("CMS: Invalid trailing input.\n");
+        free(buf);
+        return valid;
+    }
+    outputPrintf("CMS: Unknown SHOW command.\n");
     free(buf);
-    return 1;
+    return 0;
 }
\ No newline at end of file
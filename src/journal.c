@@ -0,0 +1,384 @@
+/**
+ * Write-Ahead Journal
+ * --------------------------------------
+ * Append-only log of record changes kept next to the database file.
+ * INSERT, UPDATE and DELETE append one small entry; SAVE appends a commit
+ * marker and syncs, so saving costs the size of the changes rather than
+ * the size of the table. OPEN loads the base file and replays every entry
+ * up to the last commit marker; anything after it (changes that were
+ * never saved, or a write torn by a crash) is dropped.
+ *
+ * Entries carry whole records rather than field deltas, which makes replay
+ * idempotent: replaying a journal over a base that already contains it
+ * changes nothing. Compaction relies on this when it is interrupted
+ * between writing the new base and retiring the journal.
+ *
+ * Authors: Team P4-1
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "headers/cms.h"
+#include "headers/crc32.h"
+#include "headers/file_io.h"
+#include "headers/journal.h"
+
+static FILE *journalFile = NULL;        // Open journal, positioned at its end
+static const char *journalPath = NULL;
+static long long committedSize = 0;     // Bytes up to and including the last commit marker
+static int commitCount = 0;
+
+
+// ===============================
+// Reading
+// ===============================
+
+/**
+ * readJournal()
+ * -----------------------------------------
+ * Reads a whole journal into memory and checks its header.
+ *
+ * @return 1 on success, 0 if the file does not exist, -1 if it is not a
+ *         journal (or could not be read)
+ */
+static int readJournal(const char *path, char **buffer, size_t *size) {
+    long long length = fileSize(path);
+    if (length < 0) return 0;
+    if (length < (long long)sizeof(JournalHeader)) return -1;
+
+    FILE *file = fopen(path, "rb");
+    if (!file) return -1;
+
+    char *data = malloc((size_t)length);
+    size_t got = data ? fread(data, 1, (size_t)length, file) : 0;
+    fclose(file);
+
+    JournalHeader header;
+    if (got != (size_t)length) {
+        free(data);
+        return -1;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, JOURNAL_MAGIC, sizeof(header.magic)) != 0
+        || header.byteOrder != JOURNAL_BYTE_ORDER
+        || header.version != JOURNAL_VERSION) {
+        free(data);
+        return -1;
+    }
+
+    *buffer = data;
+    *size = (size_t)length;
+    return 1;
+}
+
+
+/**
+ * scanJournal()
+ * -----------------------------------------
+ * Walks the entries after the header until the end of the data or the
+ * first entry that is truncated or fails its checksum.
+ *
+ * @param maxCommits - stop after this many commit markers (-1 for no limit)
+ * @param limit      - apply only entries that end at or before this offset
+ * @param apply      - callback for UPSERT/DELETE entries (may be NULL)
+ * @param commits    - receives the number of commit markers passed
+ * @param applied    - receives the number of entries handed to apply
+ * @return offset just past the last commit marker passed (or the header)
+ */
+static size_t scanJournal(const char *buffer, size_t size, int maxCommits, size_t limit,
+                          JournalApplyFn apply, int *commits, int *applied) {
+    size_t offset = sizeof(JournalHeader);
+    size_t committed = offset;
+    *commits = 0;
+    *applied = 0;
+
+    while (maxCommits < 0 || *commits < maxCommits) {
+        JournalEntry entry;
+        if (size - offset < sizeof(entry) + sizeof(uint32_t)) break;
+        memcpy(&entry, buffer + offset, sizeof(entry));
+
+        size_t strings = (size_t)entry.nameLength + entry.programmeLength;
+        size_t length = sizeof(entry) + strings + sizeof(uint32_t);
+        if (size - offset < length
+            || entry.nameLength >= MAX_NAME || entry.programmeLength >= MAX_PROGRAMME) break;
+
+        uint32_t crc;
+        memcpy(&crc, buffer + offset + length - sizeof(crc), sizeof(crc));
+        if (crc32Update(0, buffer + offset, length - sizeof(crc)) != crc) break;
+
+        if (entry.type == JOURNAL_COMMIT) {
+            (*commits)++;
+            committed = offset + length;
+        }
+        else if (entry.type == JOURNAL_UPSERT || entry.type == JOURNAL_DELETE) {
+            if (apply && offset + length <= limit) {
+                StudentRecord record;
+                const char *text = buffer + offset + sizeof(entry);
+                record.id = entry.id;
+                record.mark = entry.mark;
+                memcpy(record.name, text, entry.nameLength);
+                record.name[entry.nameLength] = '\0';
+                memcpy(record.programme, text + entry.nameLength, entry.programmeLength);
+                record.programme[entry.programmeLength] = '\0';
+                apply((char)entry.type, &record);
+                (*applied)++;
+            }
+        }
+        else break;
+
+        offset += length;
+    }
+    return committed;
+}
+
+
+// Applies the saved part of a journal held in memory; returns the end of it
+static size_t replayBuffer(const char *buffer, size_t size, int maxCommits,
+                           JournalApplyFn apply, int *commits, int *applied) {
+    // First pass finds where the last wanted commit ends, so entries that
+    // were never committed are not applied
+    size_t committed = scanJournal(buffer, size, maxCommits, 0, NULL, commits, applied);
+    if (apply) scanJournal(buffer, size, maxCommits, committed, apply, commits, applied);
+    return committed;
+}
+
+
+/**
+ * journalReplay()
+ * -----------------------------------------
+ * Applies the first maxCommits saves recorded in a journal, leaving the
+ * file untouched. Used to rebuild earlier saved versions for RESTORE.
+ *
+ * @return entries applied, 0 if the journal does not exist, -1 if invalid
+ */
+int journalReplay(const char *path, int maxCommits, JournalApplyFn apply) {
+    char *buffer;
+    size_t size;
+    int status = readJournal(path, &buffer, &size);
+    if (status <= 0) return status;
+
+    int commits, applied;
+    replayBuffer(buffer, size, maxCommits, apply, &commits, &applied);
+    free(buffer);
+    return applied;
+}
+
+
+// ===============================
+// Writing
+// ===============================
+
+// Starts an empty journal at path and keeps it open
+static int createJournal(const char *path) {
+    FILE *file = fopen(path, "w+b");
+    if (!file) return 0;
+
+    JournalHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, JOURNAL_MAGIC, sizeof(header.magic));
+    header.byteOrder = JOURNAL_BYTE_ORDER;
+    header.version = JOURNAL_VERSION;
+
+    if (fwrite(&header, sizeof(header), 1, file) != 1 || !fileSync(file)) {
+        fclose(file);
+        remove(path);
+        return 0;
+    }
+
+    journalFile = file;
+    journalPath = path;
+    committedSize = sizeof(header);
+    commitCount = 0;
+    return 1;
+}
+
+
+/**
+ * journalOpen()
+ * -----------------------------------------
+ * Replays every saved entry of the journal at path, cuts off whatever
+ * follows the last commit marker and keeps the file open for appending.
+ * A missing journal is created empty.
+ *
+ * @return entries applied, or -1 if the file is not a valid journal (it is
+ *         left alone and nothing is open for appending)
+ */
+int journalOpen(const char *path, JournalApplyFn apply) {
+    journalClose();
+    journalPath = path;
+
+    char *buffer;
+    size_t size;
+    int status = readJournal(path, &buffer, &size);
+    if (status < 0) return -1;
+    if (status == 0) return createJournal(path) ? 0 : -1;
+
+    int commits, applied;
+    size_t committed = replayBuffer(buffer, size, -1, apply, &commits, &applied);
+    free(buffer);
+
+    FILE *file = fopen(path, "r+b");
+    if (!file) return -1;
+    if (committed < size && !fileTruncate(file, (long long)committed)) {
+        fclose(file);
+        return -1;
+    }
+    fseek(file, 0, SEEK_END);
+
+    journalFile = file;
+    journalPath = path;
+    committedSize = (long long)committed;
+    commitCount = commits;
+    return applied;
+}
+
+
+// Writes one entry (header, strings, checksum) at the end of the journal
+static int writeEntry(JournalEntry *entry, const char *name, const char *programme) {
+    char data[sizeof(JournalEntry) + MAX_NAME + MAX_PROGRAMME + sizeof(uint32_t)];
+    size_t length = sizeof(*entry);
+
+    memcpy(data, entry, sizeof(*entry));
+    memcpy(data + length, name, entry->nameLength);
+    length += entry->nameLength;
+    memcpy(data + length, programme, entry->programmeLength);
+    length += entry->programmeLength;
+
+    uint32_t crc = crc32Update(0, data, length);
+    memcpy(data + length, &crc, sizeof(crc));
+    length += sizeof(crc);
+
+    return fwrite(data, 1, length, journalFile) == length;
+}
+
+
+/**
+ * journalAppend()
+ * -----------------------------------------
+ * Records a change. The entry is buffered and only becomes durable (and
+ * visible to replay) once journalCommit() has run.
+ *
+ * @param type   - JOURNAL_UPSERT with the full new record, or JOURNAL_DELETE
+ * @param record - record after the change (only the ID is used for DELETE)
+ * @return 1 on success, 0 if no journal is open or the write failed
+ */
+int journalAppend(char type, const StudentRecord *record) {
+    if (!journalFile) return 0;
+
+    JournalEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.type = (unsigned char)type;
+    entry.id = record->id;
+    entry.mark = record->mark;
+
+    const char *name = "", *programme = "";
+    if (type == JOURNAL_UPSERT) {
+        name = record->name;
+        programme = record->programme;
+        entry.nameLength = (unsigned char)strlen(name);
+        entry.programmeLength = (unsigned char)strlen(programme);
+    }
+    return writeEntry(&entry, name, programme);
+}
+
+
+// Appends a commit marker and syncs, making every appended entry durable
+int journalCommit(void) {
+    if (!journalFile) return 0;
+
+    JournalEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.type = JOURNAL_COMMIT;
+    entry.id = commitCount + 1;
+
+    if (!writeEntry(&entry, "", "") || !fileSync(journalFile)) {
+        journalDiscard(); // Leave the file ending at the previous commit
+        return 0;
+    }
+    committedSize = ftell(journalFile);
+    commitCount++;
+    return 1;
+}
+
+
+// Truncates the journal back to its last commit marker
+void journalDiscard(void) {
+    if (!journalFile) return;
+    fileTruncate(journalFile, committedSize);
+    fseek(journalFile, 0, SEEK_END);
+}
+
+
+int journalCommits(void) {
+    return commitCount;
+}
+
+
+long long journalBytes(void) {
+    if (!journalFile) return 0;
+    fflush(journalFile);
+    return ftell(journalFile);
+}
+
+
+/**
+ * journalRotate()
+ * -----------------------------------------
+ * Retires the current journal once its contents are part of a freshly
+ * written base file: it becomes backupPath (pairing with the base file's
+ * own backup) and an empty journal takes its place.
+ *
+ * @return 1 on success, 0 if the new journal could not be created
+ */
+int journalRotate(const char *backupPath) {
+    const char *path = journalPath;
+    if (!path) return 0;
+    journalClose();
+
+    if (fileExists(path)) {
+        if (!fileReplace(path, backupPath, NULL)) return 0;
+    }
+    else {
+        remove(backupPath);
+    }
+    return createJournal(path);
+}
+
+
+/**
+ * journalRotateFrom()
+ * -----------------------------------------
+ * journalRotate() for a base file written from a copy of the table taken
+ * when the journal was keepFrom bytes long. The entries appended since
+ * (changes made while the base was being written, none of them committed
+ * yet) are not part of that base, so they move to the new journal.
+ *
+ * @return 1 on success, 0 if the new journal could not be written
+ */
+int journalRotateFrom(const char *backupPath, long long keepFrom) {
+    if (!journalFile) return 0;
+    long long end = journalBytes();
+    size_t length = end > keepFrom ? (size_t)(end - keepFrom) : 0;
+    char *kept = malloc(length ? length : 1);
+    if (!kept) return 0;
+
+    int ok = fseek(journalFile, (long)keepFrom, SEEK_SET) == 0
+             && fread(kept, 1, length, journalFile) == length;
+    fseek(journalFile, 0, SEEK_END);
+    ok = ok && journalRotate(backupPath)
+         && fwrite(kept, 1, length, journalFile) == length;
+    free(kept);
+    return ok;
+}
+
+
+// Drops unsaved entries and closes the journal
+void journalClose(void) {
+    if (!journalFile) return;
+    journalDiscard();
+    fclose(journalFile);
+    journalFile = NULL;
+    committedSize = 0;
+    commitCount = 0;
+}
@@ -0,0 +1,143 @@
+/**
+ * Line Reader
+ * --------------------------------------
+ * Splits command input into lines for the prompt, Y/N confirmations,
+ * --batch and RUN scripts:
+ * - the stream is read from its file descriptor a block at a time, so a
+ *   terminal still returns each line as soon as it is typed while a pipe
+ *   or file is read LINE_READER_BLOCK bytes per call
+ * - lines are found with memchr() and handed out as views into one
+ *   persistent buffer; nothing is allocated per line
+ * - a trailing carriage return is dropped, so CRLF scripts work anywhere
+ *
+ * Authors: Team P4-1
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "headers/line_reader.h"
+
+#ifdef _WIN32
+#include <io.h>
+#define readDescriptor(fd, data, size) _read((fd), (data), (unsigned int)(size))
+#define streamDescriptor _fileno
+#else
+#include <unistd.h>
+#define readDescriptor(fd, data, size) read((fd), (data), (size))
+#define streamDescriptor fileno
+#endif
+
+
+static LineReader stdinReader;
+static int stdinReaderReady = 0;
+
+
+void lineReaderInit(LineReader *reader, FILE *stream) {
+    memset(reader, 0, sizeof(*reader));
+    reader->stream = stream;
+}
+
+
+void lineReaderFree(LineReader *reader) {
+    free(reader->buffer);
+    reader->buffer = NULL;
+    reader->capacity = 0;
+    reader->start = reader->end = reader->scanned = 0;
+}
+
+
+LineReader *lineReaderStdin(void) {
+    if (!stdinReaderReady) {
+        lineReaderInit(&stdinReader, stdin);
+        stdinReaderReady = 1;
+    }
+    return &stdinReader;
+}
+
+
+/**
+ * refill()
+ * -----------------------------------------
+ * Moves the unread bytes to the front of the buffer, grows it if an
+ * unfinished line already fills it, and reads the next block. One byte
+ * is always kept free for the terminator of a final line.
+ *
+ * @return 1 if bytes were added, 0 at the end of the stream or on failure
+ */
+static int refill(LineReader *reader) {
+    if (reader->start > 0) {
+        memmove(reader->buffer, reader->buffer + reader->start, reader->end - reader->start);
+        reader->end -= reader->start;
+        reader->start = 0;
+    }
+
+    if (reader->capacity - reader->end < LINE_READER_BLOCK + 1) {
+        size_t newCapacity = reader->capacity ? reader->capacity * 2 : LINE_READER_BLOCK + 1;
+        while (newCapacity - reader->end < LINE_READER_BLOCK + 1) newCapacity *= 2;
+        char *grown = realloc(reader->buffer, newCapacity);
+        if (!grown) {
+            reader->failed = 1;
+            reader->atEnd = 1;
+            return 0;
+        }
+        reader->buffer = grown;
+        reader->capacity = newCapacity;
+    }
+
+    // Like stdio, show any pending prompt before waiting on stdin
+    if (reader->stream == stdin) fflush(stdout);
+
+    long got;
+    do {
+        got = (long)readDescriptor(streamDescriptor(reader->stream), reader->buffer + reader->end,
+                                   LINE_READER_BLOCK);
+    } while (got < 0 && errno == EINTR);
+
+    if (got <= 0) {
+        if (got < 0) reader->failed = 1;
+        reader->atEnd = 1;
+        return 0;
+    }
+    reader->end += (size_t)got;
+    return 1;
+}
+
+
+char *lineReaderNext(LineReader *reader, size_t *length) {
+    while (1) {
+        if (!reader->buffer) {          // Nothing read yet
+            if (reader->atEnd || !refill(reader)) return NULL;
+            continue;
+        }
+
+        char *line = reader->buffer + reader->start;
+        size_t unread = reader->end - reader->start;
+        char *newline = unread > reader->scanned
+                        ? memchr(line + reader->scanned, '\n', unread - reader->scanned) : NULL;
+
+        size_t len;
+        if (newline) {
+            len = (size_t)(newline - line);
+            reader->start += len + 1;
+        }
+        else if (!reader->atEnd) {
+            reader->scanned = unread;
+            refill(reader);
+            continue;
+        }
+        else if (unread > 0) {
+            len = unread;               // Final line without a newline
+            reader->start = reader->end;
+        }
+        else {
+            return NULL;
+        }
+
+        reader->scanned = 0;
+        if (len > 0 && line[len - 1] == '\r') len--;
+        line[len] = '\0';
+        if (length) *length = len;
+        return line;
+    }
+}
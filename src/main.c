@@ -1,236 +1,142 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "headers/cms.h"
+#include "headers/command.h"
+#include "headers/file_io.h"
 #include "headers/input_validation.h"
+#include "headers/line_reader.h"
+#include "headers/net.h"
+#include "headers/server.h"
+#include "headers/stats.h"
+
+
+// Prints the command-line options
+static void printUsage(const char *program) {
+    printf("Usage: %s [--batch [FILE|-]] [--continue-on-error] [--stats] [--stats-dump FILE]\n"
+           "       %s --serve [HOST:]PORT [--stats] [--stats-dump FILE]\n"
+           "       %s --connect [HOST:]PORT\n"
+           "  --batch              Run commands from FILE (or stdin) without prompts\n"
+           "  --continue-on-error  Keep going after a failed command (default: stop)\n"
+           "  --stats              Time every command from the start (see SHOW STATS)\n"
+           "  --stats-dump FILE    Also append the SHOW STATS report to FILE every %d seconds and on exit\n"
+           "  --serve              Share the database with TCP clients (host defaults to %s)\n"
+           "  --connect            Send commands from stdin to a CMS server\n",
+           program, program, program, STATS_DUMP_SECONDS, NET_DEFAULT_HOST);
+}
+
+
+/**
+ * runBatchMode()
+ * -----------------------------------------
+ * Non-interactive entry point for scripted runs: stdout is fully buffered,
+ * nothing asks for confirmation and the exit status tells whether every
+ * command succeeded.
+ *
+ * @param path   - script file, or NULL / "-" for stdin
+ * @param policy - what to do when a command fails
+ * @return process exit status (0 if no command failed)
+ */
+static int runBatchMode(const char *path, BatchPolicy policy) {
+    setvbuf(stdout, NULL, _IOFBF, IO_BUFFER_SIZE);
+
+    int fromStdin = (path == NULL || strcmp(path, "-") == 0);
+    FILE *script = fromStdin ? stdin : fopen(path, "r");
+    if (!script) {
+        printf("CMS: Cannot open script \"%s\".\n", path);
+        return 1;
+    }
 
+    long failed = runBatch(script, fromStdin ? "stdin" : path, policy, NULL);
+    if (!fromStdin) fclose(script);
 
-int main() {
-    printDeclaration();
-
-    char *input = NULL; // User input buffer
-    char *valid;        // Pointer to validated command substring
-
-    int newID, deleteID, queryID;
-    char newName[MAX_NAME], newProgramme[MAX_PROGRAMME];
-    float newMark;
-
-    while (1) {
-        printf("\n\nP4_1: ");
-        
-        input = readLine();
-        
-        if (input == NULL) {
-            printf("CMS: Fatal error reading input.\n");
-            break; 
+    saveWait();
+    if (dbLoaded && dbModified) {
+        printf("CMS: WARNING: The batch ended with unsaved changes. They have been discarded.\n");
+    }
+    statsDumpClose();
+    freeDB();
+    lineReaderFree(lineReaderStdin());
+    return failed ? 1 : 0;
+}
+
+
+int main(int argc, char *argv[]) {
+    int batch = 0;
+    const char *script = NULL;
+    BatchPolicy policy = BATCH_STOP_ON_ERROR;
+    const char *serveAddress = NULL, *connectAddress = NULL;   // "[HOST:]PORT" arguments
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--batch") == 0) {
+            batch = 1;
+            if (i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0) script = argv[++i];
         }
-        
-        // Process OPEN command
-        if ((valid = validateCommand(input, "OPEN")) != NULL) {
-            if (*valid != '\0') {
-                printf("CMS: Enter a valid command.\n");
-            } 
-            else {
-                openDB();
-            }
+        else if (strcmp(argv[i], "--continue-on-error") == 0) {
+            policy = BATCH_CONTINUE_ON_ERROR;
         }
-        
-        // Process SHOW commands
-        else if ((valid = validateCommand(input, "SHOW")) != NULL) {
-            if (!dbLoaded) {
-                printf("CMS: No records loaded. Open and load the database first.\n");
-            } 
-            else {
-                handleShow(valid);
-            }
+        else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+            serveAddress = argv[++i];
         }
-        
-        // Process INSERT command
-        else if ((valid = validateCommand(input, "INSERT")) != NULL) {
-            if (!dbLoaded) {
-                printf("CMS: No records loaded. Open and load the database first.\n");
-            } else {
-                
-                if (parseCommand(valid, &newID, newName, newProgramme, &newMark, OPTIONAL_ALLOWED_EMPTY)) {
-                    insertDB(newID, newName, newProgramme, newMark, 0);
-                }
-            }
+        else if (strcmp(argv[i], "--connect") == 0 && i + 1 < argc) {
+            connectAddress = argv[++i];
         }
-
-        // Process UPDATE command
-        else if ((valid = validateCommand(input, "UPDATE")) != NULL) {
-            if (!dbLoaded) {
-                printf("CMS: No records loaded. Open and load the database first.\n");
-                free(input);
-                input = NULL;
-                continue;
-            }
-            if (parseCommand(valid, &newID, newName, newProgramme, &newMark, OPTIONAL_REQUIRED)) {
-                updateDB(newID, newName, newProgramme, newMark, 0);
-            }
+        else if (strcmp(argv[i], "--stats") == 0) {
+            statsEnabled = 1;
         }
-
-        // Process DELETE command with confirmation
-        else if ((valid = validateCommand(input, "DELETE")) != NULL) {
-            if (!dbLoaded) {
-                printf("CMS: No records loaded. Open and load the database first.\n");
-            } 
-            else if (parseCommand(valid, &deleteID, NULL, NULL, NULL, OPTIONAL_NONE)) {
-                if (!deleteDB(deleteID, 0, 0)) {
-                    printf("CMS: The record with ID=%d does not exist.\n", deleteID);
-                } 
-                else {
-                    printf("CMS: Are you sure you want to delete record with ID=%d? Type \"Y\" to confirm or \"N\" to cancel.\n", deleteID);
-                    printf("\nP4_1: ");
-                    
-                    char *confirm_input = readLine(); 
-
-                    if (confirm_input == NULL) {
-                        printf("CMS: Fatal error reading confirmation input. The deletion is cancelled.\n");
-                    } 
-                    else {
-                        if ((valid = validateCommand(confirm_input, "Y")) != NULL && *valid == '\0') {
-                            deleteDB(deleteID, 1, 0);  
-                        } 
-                        else if ((valid = validateCommand(confirm_input, "N")) != NULL && *valid == '\0') {
-                            printf("CMS: The deletion is cancelled.\n");  
-                        } 
-                        else {
-                            printf("CMS: Invalid input. The deletion is cancelled.\n");
-                        }
-                        
-                        free(confirm_input);
-                    }
-                }
+        else if (strcmp(argv[i], "--stats-dump") == 0 && i + 1 < argc) {
+            if (!statsDumpOpen(argv[++i], showStats)) {
+                printf("CMS: Cannot open stats file \"%s\".\n", argv[i]);
+                return 2;
             }
         }
-        
-        // Process QUERY command
-        else if ((valid = validateCommand(input, "QUERY")) != NULL) {
-            if (!dbLoaded) {
-                printf("CMS: No records loaded. Open and load the database first.\n");
-            } 
-            else if (parseCommand(valid, &queryID, NULL, NULL, NULL, OPTIONAL_NONE)) {
-                queryDB(queryID);
-            }
+        else {
+            printUsage(argv[0]);
+            return 2;
         }
+    }
 
-        // Process UNDO command
-        else if ((valid = validateCommand(input, "UNDO")) != NULL) {
-            if (*valid != '\0') {
-                printf("CMS: Enter a valid command.\n");
-            } 
-            else if (!dbLoaded) {
-                printf("CMS: No records loaded. Open and load the database first.\n");
-            } 
-            else {
-                undo();
-            } 
-        } 
-
-        // Process REDO command
-        else if ((valid = validateCommand(input, "REDO")) != NULL) {
-            if (*valid != '\0') {
-                printf("CMS: Enter a valid command.\n");
-            } 
-            else if (!dbLoaded) {
-                printf("CMS: No records loaded. Open and load the database first.\n");
-            } 
-            else {
-                redo();
-            } 
+    if (serveAddress || connectAddress) {
+        char host[NET_HOST_MAX];
+        int port;
+        if ((serveAddress && (connectAddress || batch)) || !netParseAddress(serveAddress ? serveAddress : connectAddress, host, sizeof(host), &port)) {
+            printUsage(argv[0]);
+            return 2;
         }
+        if (connectAddress) return runClient(host, port);
 
-        // Process SAVE command
-        else if ((valid = validateCommand(input, "SAVE")) != NULL) {
-            if (*valid != '\0') {
-                printf("CMS: Enter a valid command.\n");
-            } 
-            else if (!dbLoaded) {
-                printf("CMS: No records loaded. Open and load the database first.\n");
-            } 
-            else {
-                saveDB();
-            }
-        }
+        int status = runServer(host, port);
+        statsDumpClose();
+        freeDB();
+        return status;
+    }
 
-        // Process RESTORE command with confirmation
-        else if ((valid = validateCommand(input, "RESTORE")) != NULL) {
-            if (*valid != '\0') {
-                printf("CMS: Enter a valid command.\n");
-            } 
-            if (!dbLoaded) {
-                printf("CMS: No records loaded. Open the database first.\n");
-            } 
-            else {
-                printf("CMS: WARNING: This will overwrite the current in-memory state with the backup file. Are you sure? Type \"Y\" to confirm or \"N\" to cancel.\n");
-                printf("\nP4_1: ");
-
-                char *confirm_input = readLine();
-
-                if (confirm_input == NULL) {
-                    printf("CMS: Fatal error reading confirmation input. Restore cancelled.\n");
-                } 
-                else {
-                    if ((valid = validateCommand(confirm_input, "Y")) != NULL && *valid == '\0') {
-                        restoreDB(0); 
-                    } 
-                    else if ((valid = validateCommand(confirm_input, "N")) != NULL && *valid == '\0') {
-                        printf("CMS: Restore operation cancelled.\n");
-                    } 
-                    else {
-                        printf("CMS: Invalid input. Restore operation cancelled.\n");
-                    }
-                    free(confirm_input);
-                }
-            }
-        }        
-
-        // Process QUIT command with confirmation if unsaved changes exist
-        else if ((valid = validateCommand(input, "QUIT")) != NULL) {
-            if (*valid != '\0') {
-                printf("CMS: Enter a valid command (QUIT takes no arguments).\n");
-            } 
-            else {
-                if (dbLoaded && dbModified) {
-                    printf("CMS: WARNING: You have unsaved changes. Are you sure you want to quit? Type \"Y\" to confirm or \"N\" to cancel.\n");
-                } 
-                else {
-                    printf("CMS: Are you sure you want to quit? There are no unsaved changes. Type \"Y\" to confirm or \"N\" to cancel.\n");
-                }
-
-                printf("\nP4_1: ");
-                char *confirm_input = readLine();
-
-                if (confirm_input == NULL) {
-                    printf("CMS: Fatal error reading confirmation input. Quit cancelled.\n");
-                }
-                else {
-                    if ((valid = validateCommand(confirm_input, "Y")) != NULL && *valid == '\0') {
-                        free(confirm_input);
-                        free(input);
-                        input = NULL;
-                        break; 
-                    }
-                    else if ((valid = validateCommand(confirm_input, "N")) != NULL && *valid == '\0') {
-                        printf("CMS: Quit operation cancelled.\n");
-                    }
-                    else {
-                        printf("CMS: Invalid input. Quit operation cancelled.\n");
-                    }
-                    free(confirm_input);
-                }
-            }
-        }
+    if (batch) return runBatchMode(script, policy);
 
-        else {
-            printf("CMS: Enter a valid command\n");
+    printDeclaration();
+
+    LineReader *reader = lineReaderStdin();
+    char *input = NULL; // Current line, held in the reader's buffer
+
+    while (1) {
+        saveTick();     // Reports a finished background save before the prompt
+        printf("\n\nP4_1: ");
+
+        input = lineReaderNext(reader, NULL);
+
+        if (input == NULL) {
+            if (reader->failed) printf("CMS: Fatal error reading input.\n");
+            break;
         }
 
-        free(input); // Free buffer before next iteration
-        input = NULL;
+        CommandStatus status = executeCommand(input, 1);
+
+        if (status == COMMAND_QUIT) break;
     }
 
+    statsDumpClose();
     freeDB(); // Free all database memory
+    lineReaderFree(reader);
     printf("CMS: Exiting program.\n");
     return 0;
-}
\ No newline at end of file
+}
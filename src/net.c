@@ -0,0 +1,212 @@
+/**
+ * Network Sockets
+ * --------------------------------------
+ * Minimal portability layer over TCP sockets for the server and client
+ * modes: Winsock on Windows, BSD sockets elsewhere. Host names are resolved
+ * with getaddrinfo(), so IPv4 and IPv6 addresses both work.
+ *
+ * Every socket gets TCP_NODELAY: commands and replies are small and sent
+ * as soon as they are complete, and waiting to coalesce them would add
+ * milliseconds to each round trip.
+ *
+ * Authors: Team P4-1
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "headers/net.h"
+
+#ifdef _WIN32
+#include <ws2tcpip.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "ws2_32.lib")
+#endif
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#endif
+
+
+int netStartup(void) {
+#ifdef _WIN32
+    WSADATA data;
+    return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+#else
+    signal(SIGPIPE, SIG_IGN);   // A client that goes away must not end the process
+    return 1;
+#endif
+}
+
+
+void netCleanup(void) {
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+
+int netParseAddress(const char *text, char *host, size_t hostSize, int *port) {
+    const char *colon = strrchr(text, ':');
+    const char *digits = colon ? colon + 1 : text;
+    size_t hostLength = colon ? (size_t)(colon - text) : 0;
+
+    if (*digits == '\0' || strlen(digits) > 5) return 0;
+    for (const char *p = digits; *p; p++) {
+        if (!isdigit((unsigned char)*p)) return 0;
+    }
+    *port = atoi(digits);
+    if (*port < 1 || *port > 65535) return 0;
+
+    // "[::1]:5000" style brackets around an IPv6 address
+    if (hostLength >= 2 && text[0] == '[' && text[hostLength - 1] == ']') {
+        text++;
+        hostLength -= 2;
+    }
+    if (hostLength == 0) {
+        snprintf(host, hostSize, "%s", NET_DEFAULT_HOST);
+        return 1;
+    }
+    if (hostLength >= hostSize) return 0;
+    memcpy(host, text, hostLength);
+    host[hostLength] = '\0';
+    return 1;
+}
+
+
+// Turns off Nagle's algorithm on a connected socket
+static void setNoDelay(NetSocket socket) {
+    int on = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&on, sizeof(on));
+}
+
+
+// Resolves host:port for a listening (passive) or connecting socket
+static struct addrinfo *resolve(const char *host, int port, int passive) {
+    struct addrinfo hints, *found = NULL;
+    char service[8];
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = passive ? AI_PASSIVE : 0;
+    snprintf(service, sizeof(service), "%d", port);
+    if (getaddrinfo(host, service, &hints, &found) != 0) return NULL;
+    return found;
+}
+
+
+/**
+ * netListen()
+ * -----------------------------------------
+ * Opens a listening socket on the first address host resolves to that
+ * can be bound. The port can be reused straight after a restart.
+ *
+ * @return the socket, or NET_INVALID if none could be opened
+ */
+NetSocket netListen(const char *host, int port) {
+    struct addrinfo *found = resolve(host, port, 1);
+    NetSocket listener = NET_INVALID;
+    for (struct addrinfo *entry = found; entry && listener == NET_INVALID; entry = entry->ai_next) {
+        listener = socket(entry->ai_family, entry->ai_socktype, entry->ai_protocol);
+        if (listener == NET_INVALID) continue;
+        int on = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on));
+        if (bind(listener, entry->ai_addr, (int)entry->ai_addrlen) != 0 || listen(listener, SOMAXCONN) != 0) {
+            netClose(listener);
+            listener = NET_INVALID;
+        }
+    }
+    if (found) freeaddrinfo(found);
+    return listener;
+}
+
+
+NetSocket netConnect(const char *host, int port) {
+    struct addrinfo *found = resolve(host, port, 0);
+    NetSocket connection = NET_INVALID;
+    for (struct addrinfo *entry = found; entry && connection == NET_INVALID; entry = entry->ai_next) {
+        connection = socket(entry->ai_family, entry->ai_socktype, entry->ai_protocol);
+        if (connection == NET_INVALID) continue;
+        if (connect(connection, entry->ai_addr, (int)entry->ai_addrlen) != 0) {
+            netClose(connection);
+            connection = NET_INVALID;
+        }
+    }
+    if (found) freeaddrinfo(found);
+    if (connection != NET_INVALID) setNoDelay(connection);
+    return connection;
+}
+
+
+NetSocket netAccept(NetSocket listener, char *peer, size_t peerSize) {
+    struct sockaddr_storage address;
+    socklen_t length = sizeof(address);
+    NetSocket connection = accept(listener, (struct sockaddr*)&address, &length);
+    if (connection == NET_INVALID) return NET_INVALID;
+    setNoDelay(connection);
+
+    char host[NI_MAXHOST], service[NI_MAXSERV];
+    if (getnameinfo((struct sockaddr*)&address, length, host, sizeof(host), service, sizeof(service),
+                    NI_NUMERICHOST | NI_NUMERICSERV) == 0) {
+        snprintf(peer, peerSize, "%s:%s", host, service);
+    }
+    else {
+        snprintf(peer, peerSize, "unknown");
+    }
+    return connection;
+}
+
+
+int netSetNonBlocking(NetSocket socket) {
+#ifdef _WIN32
+    u_long on = 1;
+    return ioctlsocket(socket, FIONBIO, &on) == 0;
+#else
+    int flags = fcntl(socket, F_GETFL, 0);
+    return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+
+// Whether the last failed call only would have blocked (or was interrupted)
+static int wouldBlock(void) {
+#ifdef _WIN32
+    int error = WSAGetLastError();
+    return error == WSAEWOULDBLOCK || error == WSAEINTR;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+
+long netRecv(NetSocket socket, char *buffer, size_t length) {
+    long received = (long)recv(socket, buffer, (int)length, 0);
+    if (received > 0) return received;
+    if (received == 0) return NET_CLOSED;
+    return wouldBlock() ? NET_AGAIN : NET_ERROR;
+}
+
+
+long netSend(NetSocket socket, const char *data, size_t length) {
+    long sent = (long)send(socket, data, (int)length, 0);
+    if (sent >= 0) return sent == 0 ? NET_AGAIN : sent;
+    return wouldBlock() ? NET_AGAIN : NET_ERROR;
+}
+
+
+void netClose(NetSocket socket) {
+#ifdef _WIN32
+    closesocket(socket);
+#else
+    close(socket);
+#endif
+}
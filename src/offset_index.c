@@ -0,0 +1,207 @@
+/**
+ * Offset Index
+ * --------------------------------------
+ * Sorted ID -> line offset index over the tab-separated database file,
+ * kept next to it as P4_1-CMS.idx. With the text file and the index both
+ * mapped, finding a record is a binary search over the index and one
+ * line of text, and opening costs about the same whatever the table size;
+ * only the pages a lookup touches are read.
+ *
+ * The index is built by one pass over the text file and is rebuilt
+ * whenever that file's size or modification time no longer match the ones
+ * recorded in its header.
+ *
+ * Authors: Team P4-1
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "headers/offset_index.h"
+
+#define OFFSET_INDEX_TEMP_SUFFIX ".tmp"
+
+
+// Key of an ID: the sign bit flipped so unsigned order matches ID order
+static uint64_t keyOf(int id, uint32_t offset) {
+    return ((uint64_t)((uint32_t)id ^ 0x80000000u) << 32) | offset;
+}
+
+
+/**
+ * offsetIndexOpen()
+ * -----------------------------------------
+ * Maps the text file, then checks the index file: magic, version, byte
+ * order, size, and the text file's size and time recorded in it. The
+ * keys themselves are not read, so this costs the same for any table.
+ */
+int offsetIndexOpen(OffsetIndex *index, const char *textPath, const char *indexPath) {
+    memset(index, 0, sizeof(*index));
+    if (!fileMapOpen(textPath, &index->text)) return -1;
+    index->textModTime = fileModTime(textPath);
+
+    if (!fileMapOpen(indexPath, &index->file)) return 0;
+    OffsetIndexHeader header;
+    int valid = index->file.size >= sizeof(header);
+    if (valid) {
+        memcpy(&header, index->file.data, sizeof(header));
+        valid = memcmp(header.magic, OFFSET_INDEX_MAGIC, sizeof(header.magic)) == 0
+                && header.byteOrder == OFFSET_INDEX_BYTE_ORDER
+                && header.version == OFFSET_INDEX_VERSION
+                && header.textSize == (uint64_t)index->text.size
+                && header.textModTime == (int64_t)index->textModTime
+                && index->file.size == sizeof(header) + (size_t)header.count * sizeof(uint64_t);
+    }
+    if (!valid) {
+        fileMapClose(&index->file);
+        return 0;
+    }
+    index->keys = (const uint64_t*)(index->file.data + sizeof(header));
+    index->count = header.count;
+    return 1;
+}
+
+
+// Sorts keys with an LSD radix sort, one byte per pass; passes over a byte
+// that every key shares (most of the ID's high bytes) are skipped
+static int sortKeys(uint64_t *keys, size_t count) {
+    uint64_t *spare = malloc((count ? count : 1) * sizeof(uint64_t));
+    if (!spare) return 0;
+
+    uint64_t *from = keys, *to = spare;
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t counts[256] = {0};
+        for (size_t i = 0; i < count; i++) counts[(from[i] >> shift) & 0xFF]++;
+        if (count == 0 || counts[(from[0] >> shift) & 0xFF] == count) continue;
+
+        size_t position = 0;
+        for (int b = 0; b < 256; b++) {
+            size_t n = counts[b];
+            counts[b] = position;
+            position += n;
+        }
+        for (size_t i = 0; i < count; i++) to[counts[(from[i] >> shift) & 0xFF]++] = from[i];
+        uint64_t *swap = from;
+        from = to;
+        to = swap;
+    }
+    if (from != keys) memcpy(keys, from, count * sizeof(uint64_t));
+    free(spare);
+    return 1;
+}
+
+
+// Writes the keys as the index file, via a synced temp file and rename
+static int writeIndex(const OffsetIndex *index, const char *indexPath) {
+    char tempPath[1024];
+    snprintf(tempPath, sizeof(tempPath), "%s%s", indexPath, OFFSET_INDEX_TEMP_SUFFIX);
+
+    OffsetIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, OFFSET_INDEX_MAGIC, sizeof(header.magic));
+    header.byteOrder = OFFSET_INDEX_BYTE_ORDER;
+    header.version = OFFSET_INDEX_VERSION;
+    header.textSize = (uint64_t)index->text.size;
+    header.textModTime = (int64_t)index->textModTime;
+    header.count = (uint32_t)index->count;
+
+    FILE *file = fopen(tempPath, "wb");
+    if (!file) return 0;
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1
+             && fwrite(index->keys, sizeof(uint64_t), index->count, file) == index->count
+             && fileSync(file);
+    if (fclose(file) != 0) ok = 0;
+    if (!ok || !fileReplace(tempPath, indexPath, NULL)) {
+        remove(tempPath);
+        return 0;
+    }
+    return 1;
+}
+
+
+/**
+ * offsetIndexBuild()
+ * -----------------------------------------
+ * Indexes every line the loader would keep. Lines are split the way the
+ * loader splits them; when an ID appears more than once only its first
+ * line is kept, as the loader rejects the later ones as duplicates.
+ */
+int offsetIndexBuild(OffsetIndex *index, const char *indexPath, OffsetLineFn keep, void *state, int *saved) {
+    *saved = 0;
+    const char *data = index->text.data, *end = data + index->text.size;
+    if (index->text.size > UINT32_MAX) return 0;
+
+    size_t capacity = 1024, count = 0;
+    uint64_t *keys = malloc(capacity * sizeof(uint64_t));
+    if (!keys) return 0;
+
+    for (const char *p = data; p < end; ) {
+        const char *nl = memchr(p, '\n', (size_t)(end - p));
+        if (!nl) nl = end;
+        size_t length = (size_t)(nl - p);
+        if (length > 0 && p[length - 1] == '\r') length--;
+
+        int id;
+        if (keep(state, p, length, &id)) {
+            if (count == capacity) {
+                uint64_t *grown = realloc(keys, capacity * 2 * sizeof(uint64_t));
+                if (!grown) {
+                    free(keys);
+                    return 0;
+                }
+                keys = grown;
+                capacity *= 2;
+            }
+            keys[count++] = keyOf(id, (uint32_t)(p - data));
+        }
+        if (nl == end) break;
+        p = nl + 1;
+    }
+
+    // Sorting brings each ID's lines together in file order; keep the first
+    if (!sortKeys(keys, count)) {
+        free(keys);
+        return 0;
+    }
+    size_t unique = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (unique == 0 || (keys[i] >> 32) != (keys[unique - 1] >> 32)) keys[unique++] = keys[i];
+    }
+
+    fileMapClose(&index->file);
+    free(index->builtKeys);
+    index->builtKeys = keys;
+    index->keys = keys;
+    index->count = unique;
+    *saved = writeIndex(index, indexPath);
+    return 1;
+}
+
+
+const char *offsetIndexFind(const OffsetIndex *index, int id, size_t *length) {
+    uint64_t wanted = keyOf(id, 0) >> 32;
+    size_t low = 0, high = index->count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if ((index->keys[middle] >> 32) < wanted) low = middle + 1;
+        else high = middle;
+    }
+    if (low == index->count || (index->keys[low] >> 32) != wanted) return NULL;
+
+    size_t offset = (size_t)(index->keys[low] & 0xFFFFFFFFu);
+    if (offset >= index->text.size || (offset > 0 && index->text.data[offset - 1] != '\n')) return NULL;
+    const char *line = index->text.data + offset;
+    const char *nl = memchr(line, '\n', index->text.size - offset);
+    size_t len = nl ? (size_t)(nl - line) : index->text.size - offset;
+    if (len > 0 && line[len - 1] == '\r') len--;
+    *length = len;
+    return line;
+}
+
+
+void offsetIndexClose(OffsetIndex *index) {
+    fileMapClose(&index->text);
+    fileMapClose(&index->file);
+    free(index->builtKeys);
+    memset(index, 0, sizeof(*index));
+}
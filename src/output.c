@@ -0,0 +1,107 @@
+/**
+ * Output Sink
+ * --------------------------------------
+ * Every message and table the engine prints goes through outputPrintf()
+ * and outputWrite(), which write to the current sink:
+ * - stdout, for the prompt, batch mode and RUN scripts
+ * - another file, e.g. the --stats-dump file
+ * - a growing memory buffer, so the server can capture the output of one
+ *   command and send it to the client that issued it
+ *
+ * Authors: Team P4-1
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include "headers/output.h"
+
+static OutputSink *current = NULL;      // NULL = stdout
+
+
+// Makes room for extra more bytes in a memory sink
+static int reserve(OutputSink *sink, size_t extra) {
+    if (sink->length + extra <= sink->capacity) return 1;
+    size_t capacity = sink->capacity ? sink->capacity : OUTPUT_MIN_CAPACITY;
+    while (capacity < sink->length + extra) capacity *= 2;
+    char *data = realloc(sink->data, capacity);
+    if (!data) {
+        sink->failed = 1;
+        return 0;
+    }
+    sink->data = data;
+    sink->capacity = capacity;
+    return 1;
+}
+
+
+void outputWrite(const char *data, size_t length) {
+    if (!current || current->file) {
+        fwrite(data, 1, length, current ? current->file : stdout);
+        return;
+    }
+    if (!reserve(current, length)) return;
+    memcpy(current->data + current->length, data, length);
+    current->length += length;
+}
+
+
+/**
+ * outputPrintf()
+ * -----------------------------------------
+ * printf() to the current sink. A memory sink formats straight into its
+ * free space, growing and formatting again only when that was too short.
+ */
+void outputPrintf(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    if (!current || current->file) {
+        vfprintf(current ? current->file : stdout, format, args);
+        va_end(args);
+        return;
+    }
+
+    va_list again;
+    va_copy(again, args);
+    size_t room = current->capacity - current->length;
+    int needed = vsnprintf(room ? current->data + current->length : NULL, room, format, args);
+    if (needed >= 0 && (size_t)needed >= room) {
+        if (reserve(current, (size_t)needed + 1)) {
+            vsnprintf(current->data + current->length, (size_t)needed + 1, format, again);
+        }
+        else {
+            needed = -1;
+        }
+    }
+    if (needed > 0) current->length += (size_t)needed;
+    va_end(again);
+    va_end(args);
+}
+
+
+void outputFlush(void) {
+    if (!current) fflush(stdout);
+    else if (current->file) fflush(current->file);
+}
+
+
+OutputSink *outputRedirect(OutputSink *sink) {
+    OutputSink *previous = current;
+    current = sink;
+    return previous;
+}
+
+
+void outputClear(OutputSink *sink) {
+    sink->length = 0;
+    sink->failed = 0;
+}
+
+
+void outputFree(OutputSink *sink) {
+    free(sink->data);
+    sink->data = NULL;
+    sink->length = sink->capacity = 0;
+    sink->failed = 0;
+}
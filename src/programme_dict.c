@@ -0,0 +1,217 @@
+/**
+ * Programme Dictionary
+ * --------------------------------------
+ * Interns programme names into small integer codes. A few dozen distinct
+ * programmes are shared by every record, so each record stores a 2-byte
+ * code instead of its own copy of the string.
+ *
+ * Two hash tables are kept over the same entries:
+ * - exact spelling -> code (used when storing records)
+ * - case-folded spelling -> group code (used by PROGRAMME= filters,
+ *   which match case-insensitively)
+ *
+ * Codes are never reused, so they stay valid across reloads.
+ *
+ * Authors: Team P4-1
+ */
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include "headers/programme_dict.h"
+#include "headers/string_pool.h"
+
+#define DICT_INITIAL_SLOTS 64           // Hash slots per table (power of two)
+
+// One interned programme spelling
+typedef struct ProgrammeEntry {
+    unsigned int offset;                // Position of the name in dictStrings
+    unsigned short length;
+    ProgCode group;                     // First code seen with the same case-folded name
+} ProgrammeEntry;
+
+static ProgrammeEntry *entries = NULL;
+static size_t entryCount = 0, entryCapacity = 0;
+static StringPool dictStrings = {0};
+
+// Open-addressing tables holding codes (PROGRAMME_NONE marks an empty slot)
+static ProgCode *exactSlots = NULL, *foldedSlots = NULL;
+static size_t slotCount = 0;
+
+
+// FNV-1a hash; folds letter case when requested
+static unsigned int hashName(const char *name, size_t len, int fold) {
+    unsigned int h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)name[i];
+        h ^= fold ? (unsigned char)tolower(c) : c;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+
+// Compares a stored entry with a candidate spelling
+static int entryMatches(ProgCode code, const char *name, size_t len, int fold) {
+    const ProgrammeEntry *entry = &entries[code];
+    if (entry->length != len) return 0;
+    const char *stored = stringPoolGet(&dictStrings, entry->offset);
+    if (!fold) return memcmp(stored, name, len) == 0;
+    for (size_t i = 0; i < len; i++) {
+        if (tolower((unsigned char)stored[i]) != tolower((unsigned char)name[i])) return 0;
+    }
+    return 1;
+}
+
+
+/**
+ * probe()
+ * -----------------------------------------
+ * Finds the slot holding a matching entry, or the empty slot where it
+ * would be inserted.
+ */
+static size_t probe(const ProgCode *slots, const char *name, size_t len, int fold) {
+    size_t mask = slotCount - 1;
+    size_t pos = hashName(name, len, fold) & mask;
+    while (slots[pos] != PROGRAMME_NONE && !entryMatches(slots[pos], name, len, fold)) {
+        pos = (pos + 1) & mask;
+    }
+    return pos;
+}
+
+
+// Rebuilds both hash tables with twice as many slots
+static int growSlots() {
+    size_t newCount = slotCount ? slotCount << 1 : DICT_INITIAL_SLOTS;
+    ProgCode *newExact = malloc(newCount * sizeof(ProgCode));
+    ProgCode *newFolded = malloc(newCount * sizeof(ProgCode));
+    if (!newExact || !newFolded) {
+        free(newExact);
+        free(newFolded);
+        return 0;
+    }
+    memset(newExact, 0xFF, newCount * sizeof(ProgCode));
+    memset(newFolded, 0xFF, newCount * sizeof(ProgCode));
+
+    free(exactSlots);
+    free(foldedSlots);
+    exactSlots = newExact;
+    foldedSlots = newFolded;
+    slotCount = newCount;
+
+    for (size_t code = 0; code < entryCount; code++) {
+        const char *name = stringPoolGet(&dictStrings, entries[code].offset);
+        size_t len = entries[code].length;
+        exactSlots[probe(exactSlots, name, len, 0)] = (ProgCode)code;
+        if (entries[code].group == code) {
+            foldedSlots[probe(foldedSlots, name, len, 1)] = (ProgCode)code;
+        }
+    }
+    return 1;
+}
+
+
+/**
+ * programmeIntern()
+ * -----------------------------------------
+ * Looks up an exact programme spelling and adds it if it is new.
+ *
+ * @param name - programme characters (need not be NUL-terminated)
+ * @param len  - number of characters
+ * @return programme code, or PROGRAMME_NONE if the dictionary is full
+ *         or memory allocation failed
+ */
+ProgCode programmeIntern(const char *name, size_t len) {
+    if (slotCount) {
+        ProgCode existing = exactSlots[probe(exactSlots, name, len, 0)];
+        if (existing != PROGRAMME_NONE) return existing;
+    }
+    if (entryCount >= PROGRAMME_MAX_CODES) return PROGRAMME_NONE;
+
+    // Keep both tables at most half full
+    if ((entryCount + 1) * 2 > slotCount && !growSlots()) return PROGRAMME_NONE;
+
+    if (entryCount == entryCapacity) {
+        size_t newCapacity = entryCapacity ? entryCapacity * 2 : 32;
+        ProgrammeEntry *newEntries = realloc(entries, newCapacity * sizeof(ProgrammeEntry));
+        if (!newEntries) return PROGRAMME_NONE;
+        entries = newEntries;
+        entryCapacity = newCapacity;
+    }
+
+    unsigned int offset = stringPoolAdd(&dictStrings, name, len);
+    if (offset == STRING_POOL_NONE) return PROGRAMME_NONE;
+
+    ProgCode code = (ProgCode)entryCount++;
+    entries[code].offset = offset;
+    entries[code].length = (unsigned short)len;
+
+    // Join an existing case-insensitive group or start a new one
+    size_t folded = probe(foldedSlots, name, len, 1);
+    if (foldedSlots[folded] != PROGRAMME_NONE) {
+        entries[code].group = foldedSlots[folded];
+    }
+    else {
+        entries[code].group = code;
+        foldedSlots[folded] = code;
+    }
+    exactSlots[probe(exactSlots, name, len, 0)] = code;
+    return code;
+}
+
+
+/**
+ * programmeLookupGroup()
+ * -----------------------------------------
+ * Resolves a filter value to the group of programmes it matches
+ * case-insensitively, without adding anything to the dictionary.
+ *
+ * @return group code, or PROGRAMME_NONE if no record uses that programme
+ */
+ProgCode programmeLookupGroup(const char *name) {
+    if (!slotCount) return PROGRAMME_NONE;
+    return foldedSlots[probe(foldedSlots, name, strlen(name), 1)];
+}
+
+
+// Returns the NUL-terminated spelling of a code
+const char* programmeName(ProgCode code) {
+    return stringPoolGet(&dictStrings, entries[code].offset);
+}
+
+
+// Returns the length of a code's spelling
+size_t programmeLength(ProgCode code) {
+    return entries[code].length;
+}
+
+
+// Returns the canonical code of a code's case-insensitive group
+ProgCode programmeGroup(ProgCode code) {
+    return entries[code].group;
+}
+
+
+// Number of distinct spellings interned so far
+size_t programmeCount(void) {
+    return entryCount;
+}
+
+
+// Bytes held by the dictionary (entries, strings and hash tables)
+size_t programmeBytes(void) {
+    return entryCapacity * sizeof(ProgrammeEntry) + dictStrings.capacity
+           + 2 * slotCount * sizeof(ProgCode);
+}
+
+
+// Releases the whole dictionary (invalidates all codes)
+void programmeFreeAll(void) {
+    free(entries);
+    free(exactSlots);
+    free(foldedSlots);
+    entries = NULL;
+    exactSlots = foldedSlots = NULL;
+    entryCount = entryCapacity = slotCount = 0;
+    stringPoolFree(&dictStrings);
+}
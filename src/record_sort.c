@@ -0,0 +1,203 @@
+/**
+ * Record Sort
+ * --------------------------------------
+ * Sort engine for multi-key sorted views and for building the ordered
+ * indexes. Every key is mapped to an order-preserving unsigned integer and
+ * the keys are packed into one 64-bit value per record, so a single LSD
+ * radix sort handles any key and direction combination:
+ * - no comparisons, no recursion, linear time in the number of records
+ * - stable, so records with equal keys stay in list (insertion) order
+ * - byte passes where every record has the same digit are skipped
+ *   (7-digit IDs never need their top byte sorted)
+ * - work buffers are kept between calls, so repeated views do not allocate
+ *
+ * Authors: Team P4-1
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "headers/cms.h"
+#include "headers/record_sort.h"
+
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_PASSES (64 / RADIX_BITS)
+
+// Packed sort key next to the record it belongs to
+typedef struct SortEntry {
+    uint64_t key;
+    Node *node;
+} SortEntry;
+
+static SortEntry *entries = NULL;       // Radix ping-pong buffers
+static SortEntry *scratch = NULL;
+static Node **sorted = NULL;            // Result handed back to the caller
+static size_t capacity = 0;
+
+
+// Grows the work buffers to hold count records
+static int reserve(size_t count) {
+    if (count <= capacity) return 1;
+
+    size_t newCapacity = capacity ? capacity : 1024;
+    while (newCapacity < count) newCapacity <<= 1;
+
+    SortEntry *newEntries = malloc(newCapacity * sizeof(SortEntry));
+    SortEntry *newScratch = malloc(newCapacity * sizeof(SortEntry));
+    Node **newSorted = malloc(newCapacity * sizeof(Node*));
+    if (!newEntries || !newScratch || !newSorted) {
+        free(newEntries);
+        free(newScratch);
+        free(newSorted);
+        return 0;
+    }
+
+    sortFree();
+    entries = newEntries;
+    scratch = newScratch;
+    sorted = newSorted;
+    capacity = newCapacity;
+    return 1;
+}
+
+
+/**
+ * fieldKey()
+ * -----------------------------------------
+ * Maps a field to an unsigned value with the same ordering, inverted for
+ * descending keys.
+ * - IDs: flipping the sign bit orders signed values as unsigned
+ * - marks: IEEE floats order like integers once negative values have all
+ *   bits flipped and non-negative values have the sign bit set
+ */
+static uint32_t fieldKey(const Node *node, const SortKey *key) {
+    uint32_t value;
+    if (key->field == SORT_FIELD_ID) {
+        value = (uint32_t)node->id ^ 0x80000000u;
+    }
+    else {
+        float mark = node->mark + 0.0f;     // Folds -0.0 into 0.0
+        memcpy(&value, &mark, sizeof(value));
+        value = (value & 0x80000000u) ? ~value : value | 0x80000000u;
+    }
+    return key->ascending ? value : ~value;
+}
+
+
+/**
+ * radixSort()
+ * -----------------------------------------
+ * Sorts the first n entries by key and copies their nodes, in order,
+ * to out. Stable, so entries with equal keys keep their order.
+ */
+static void radixSort(size_t n, Node **out) {
+    // One pass over the data fills the histograms of every digit
+    static size_t counts[RADIX_PASSES][RADIX_BUCKETS];
+    memset(counts, 0, sizeof(counts));
+    for (size_t i = 0; i < n; i++) {
+        uint64_t key = entries[i].key;
+        for (int pass = 0; pass < RADIX_PASSES; pass++) {
+            counts[pass][(key >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1)]++;
+        }
+    }
+
+    SortEntry *from = entries, *to = scratch;
+    for (int pass = 0; pass < RADIX_PASSES; pass++) {
+        size_t *bucket = counts[pass];
+        int shift = pass * RADIX_BITS;
+
+        // Every record shares this digit: the pass would not move anything
+        if (n == 0 || bucket[(from[0].key >> shift) & (RADIX_BUCKETS - 1)] == n) continue;
+
+        size_t offset = 0;
+        for (int b = 0; b < RADIX_BUCKETS; b++) {
+            size_t c = bucket[b];
+            bucket[b] = offset;
+            offset += c;
+        }
+        for (size_t i = 0; i < n; i++) {
+            to[bucket[(from[i].key >> shift) & (RADIX_BUCKETS - 1)]++] = from[i];
+        }
+
+        SortEntry *swap = from;
+        from = to;
+        to = swap;
+    }
+
+    for (size_t i = 0; i < n; i++) out[i] = from[i].node;
+}
+
+
+/**
+ * sortRecords()
+ * -----------------------------------------
+ * Orders the records of a list by up to SORT_MAX_KEYS keys.
+ *
+ * @param list     - first record (walked through next pointers)
+ * @param count    - number of records in the list
+ * @param keys     - most significant key first
+ * @param keyCount - 1 .. SORT_MAX_KEYS
+ * @return sorted node pointers (owned by this module), or NULL if out of memory
+ */
+Node** sortRecords(Node *list, size_t count, const SortKey *keys, int keyCount) {
+    if (!reserve(count ? count : 1)) return NULL;
+
+    // Pack the keys: the first key takes the high 32 bits
+    size_t n = 0;
+    for (Node *node = list; node && n < count; node = node->next) {
+        uint64_t key = 0;
+        for (int k = 0; k < keyCount; k++) key = (key << 32) | fieldKey(node, &keys[k]);
+        entries[n].key = key;
+        entries[n].node = node;
+        n++;
+    }
+
+    radixSort(n, sorted);
+    return sorted;
+}
+
+
+/**
+ * sortNodes()
+ * -----------------------------------------
+ * Orders an array of records in place, for views that collect only some
+ * records. Ties are broken by insertion sequence, ascending unless the
+ * first key is descending, which is the order the ordered index walks
+ * give. With no keys the records return to insertion order.
+ *
+ * @param nodes    - records to reorder
+ * @param count    - number of records
+ * @param keys     - most significant key first
+ * @param keyCount - 0 .. SORT_MAX_KEYS
+ * @return 1 on success, 0 if out of memory
+ */
+int sortNodes(Node **nodes, size_t count, const SortKey *keys, int keyCount) {
+    if (!reserve(count ? count : 1)) return 0;
+
+    // Two keys always include the unique ID, so only one key needs the
+    // sequence below it
+    int descending = keyCount > 0 && !keys[0].ascending;
+    for (size_t i = 0; i < count; i++) {
+        uint64_t key = 0;
+        for (int k = 0; k < keyCount; k++) key = (key << 32) | fieldKey(nodes[i], &keys[k]);
+        if (keyCount < 2) key = (key << 32) | (uint32_t)(descending ? ~nodes[i]->seq : nodes[i]->seq);
+        entries[i].key = key;
+        entries[i].node = nodes[i];
+    }
+
+    radixSort(count, nodes);
+    return 1;
+}
+
+
+// Releases the reusable buffers
+void sortFree(void) {
+    free(entries);
+    free(scratch);
+    free(sorted);
+    entries = scratch = NULL;
+    sorted = NULL;
+    capacity = 0;
+}
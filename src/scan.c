@@ -0,0 +1,164 @@
+/**
+ * Parallel Scan
+ * --------------------------------------
+ * A small pool of long-lived worker threads for scans over large tables.
+ * A scan is split into numbered tasks; each task writes only its own
+ * partial result and the caller merges the partials in task order, so
+ * the output is the same however the threads are scheduled.
+ *
+ * - Workers are started on the first parallel scan and then sleep on a
+ *   condition variable between scans, so a scan costs no thread creation.
+ * - Task 0 always runs on the calling thread; if a worker cannot be
+ *   started, its tasks run on the calling thread too.
+ *
+ * Authors: Team P4-1
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "headers/scan.h"
+#include "headers/thread.h"
+
+
+// The scan being run and the pool working on it
+typedef struct ScanPool {
+    ThreadMutex lock;
+    ThreadCond wake;            // A new scan was posted, or the pool is stopping
+    ThreadCond done;            // The last worker task of a scan finished
+    Thread workers[SCAN_MAX_TASKS - 1];
+    int workerCount;            // Worker w runs task w + 1
+    int started;
+    int stopping;
+    unsigned long generation;   // Bumped for every posted scan
+    ScanTaskFn fn;
+    void *job;
+    int tasks;
+    int pending;                // Worker tasks of the current scan still running
+} ScanPool;
+
+static ScanPool pool = {0};
+
+// Worker number handed to each thread
+static int workerIds[SCAN_MAX_TASKS - 1];
+
+
+// Body of one pool thread: waits for a scan, runs its task, repeats
+static void workerMain(void *arg) {
+    int task = *(int*)arg + 1;
+    unsigned long seen = 0;
+
+    mutexLock(&pool.lock);
+    while (1) {
+        while (!pool.stopping && pool.generation == seen) condWait(&pool.wake, &pool.lock);
+        if (pool.stopping) break;
+        seen = pool.generation;
+        if (task >= pool.tasks) continue;
+
+        ScanTaskFn fn = pool.fn;
+        void *job = pool.job;
+        mutexUnlock(&pool.lock);
+        fn(job, task);
+        mutexLock(&pool.lock);
+
+        if (--pool.pending == 0) condBroadcast(&pool.done);
+    }
+    mutexUnlock(&pool.lock);
+}
+
+
+// Starts the worker threads the first time a parallel scan runs
+static void startPool() {
+    if (pool.started) return;
+    mutexInit(&pool.lock);
+    condInit(&pool.wake);
+    condInit(&pool.done);
+    pool.started = 1;
+
+    int wanted = threadCpuCount() - 1;
+    if (wanted > SCAN_MAX_TASKS - 1) wanted = SCAN_MAX_TASKS - 1;
+    for (int w = 0; w < wanted; w++) {
+        workerIds[pool.workerCount] = pool.workerCount;
+        if (!threadStart(&pool.workers[pool.workerCount], workerMain, &workerIds[pool.workerCount])) break;
+        pool.workerCount++;
+    }
+}
+
+
+int scanTasks(size_t records) {
+    if (records < SCAN_MIN_RECORDS) return 1;
+    size_t tasks = records / SCAN_MIN_TASK;
+    int cpus = threadCpuCount();
+    if (tasks > (size_t)cpus) tasks = (size_t)cpus;
+    if (tasks > SCAN_MAX_TASKS) tasks = SCAN_MAX_TASKS;
+    return tasks > 1 ? (int)tasks : 1;
+}
+
+
+size_t scanSplit(size_t count, int task, int tasks) {
+    return (size_t)((unsigned long long)count * (unsigned long long)task / (unsigned long long)tasks);
+}
+
+
+/**
+ * scanRun()
+ * -----------------------------------------
+ * Posts a scan to the pool, runs task 0 (and any task without a worker)
+ * here, and waits for the workers to finish theirs.
+ *
+ * @param fn    - task body
+ * @param job   - shared, read-only scan description plus per-task slots
+ * @param tasks - 1 .. SCAN_MAX_TASKS
+ */
+void scanRun(ScanTaskFn fn, void *job, int tasks) {
+    if (tasks > 1) startPool();
+
+    int parallel = tasks > 1 && pool.workerCount > 0;
+    int remote = 0;
+    if (parallel) {
+        remote = tasks - 1 < pool.workerCount ? tasks - 1 : pool.workerCount;
+        mutexLock(&pool.lock);
+        pool.fn = fn;
+        pool.job = job;
+        pool.tasks = remote + 1;
+        pool.pending = remote;
+        pool.generation++;
+        condBroadcast(&pool.wake);
+        mutexUnlock(&pool.lock);
+    }
+
+    // Task 0, plus the tasks beyond the workers available
+    fn(job, 0);
+    for (int task = remote + 1; task < tasks; task++) fn(job, task);
+
+    if (parallel) {
+        mutexLock(&pool.lock);
+        while (pool.pending > 0) condWait(&pool.done, &pool.lock);
+        mutexUnlock(&pool.lock);
+    }
+}
+
+
+void scanShutdown(void) {
+    if (!pool.started) return;
+
+    mutexLock(&pool.lock);
+    pool.stopping = 1;
+    condBroadcast(&pool.wake);
+    mutexUnlock(&pool.lock);
+    for (int w = 0; w < pool.workerCount; w++) threadJoin(&pool.workers[w]);
+
+    condDestroy(&pool.wake);
+    condDestroy(&pool.done);
+    mutexDestroy(&pool.lock);
+    pool.started = 0;
+    pool.stopping = 0;
+    pool.workerCount = 0;
+    pool.generation = 0;        // New workers start out having seen generation 0
+}
+
+
+// The workers stay behind in the parent; a worker may even have held the
+// lock at the fork. The child starts afresh with its own pool if it scans.
+void scanForkChild(void) {
+    memset(&pool, 0, sizeof(pool));
+}
@@ -0,0 +1,580 @@
+/**
+ * Server Mode
+ * --------------------------------------
+ * Serves the CMS command language to many TCP clients from one in-memory
+ * database (`cms --serve [HOST:]PORT`), so staff share one table instead
+ * of each process loading, and later overwriting, its own copy.
+ *
+ * - One select() loop serves every connection. The engine stays single
+ *   threaded: commands from different clients run one after another and
+ *   never interleave.
+ * - Clients may pipeline commands. Complete lines run in order and their
+ *   framed replies (see server.h) are queued; at most
+ *   SERVER_COMMANDS_PER_TURN run before the other clients get a turn.
+ * - A client whose unsent replies pass SERVER_OUTPUT_HIGH has its further
+ *   commands held until it reads them.
+ * - Commands run as in a script: DELETE and RESTORE need no confirmation.
+ *   NEXT continues the client's own last page; the undo/redo history is
+ *   shared by everyone.
+ * - SHOW ALL without LIMIT or WHERE, whose cost grows with the table, runs
+ *   in a snapshot reader on large tables: a forked process that sees the
+ *   table exactly as it was when the command came up, because the kernel
+ *   copies a page only when the server writes to it afterwards. Writers
+ *   carry on meanwhile, and readers run on as many cores as there are.
+ *   The client's later commands wait for the reply, which the server
+ *   forwards in order. Windows has no fork(), so there every command runs
+ *   in place.
+ * - A client that sends BEGIN has the table to itself until its COMMIT or
+ *   ROLLBACK: the other clients' commands wait, so nobody sees or changes
+ *   half a transaction. Disconnecting rolls it back.
+ *
+ * Authors: Team P4-1
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include "headers/server.h"
+#include "headers/net.h"
+#include "headers/cms.h"
+#include "headers/command.h"
+#include "headers/output.h"
+#include "headers/table_render.h"
+#include "headers/timer.h"
+
+#ifndef _WIN32
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <errno.h>
+#include "headers/scan.h"
+#include "headers/stats.h"
+#endif
+
+// A forked process running one client's read-only command
+typedef struct SnapshotReader {
+    long pid;                   // 0 when none is running
+    int pipe;                   // Read end; the reader writes one reply frame
+    size_t received;            // Frame bytes forwarded so far
+    int failed;                 // The frame is a FAILED reply
+    double started;
+    char *line;                 // The command, for the SHOW STATS timings
+} SnapshotReader;
+
+// One client connection
+typedef struct Connection {
+    NetSocket socket;
+    char peer[NET_PEER_MAX];
+    char *input;                // Received bytes that have not run yet
+    size_t inputStart;          // First byte of the next command line
+    size_t inputLength;
+    size_t inputCapacity;
+    OutputSink replies;         // Framed replies; the engine writes into it
+    size_t sent;                // Bytes of replies already sent
+    int peerDone;               // The client has sent everything it will send
+    int closing;                // Close once the replies are sent
+    PageState *page;            // This client's NEXT position
+    SnapshotReader reader;      // Running this client's current command, if any
+} Connection;
+
+static Connection *clients[SERVER_MAX_CLIENTS];
+static int clientCount = 0;
+static int readerCount = 0;
+static Connection *transactionClient = NULL;   // Owner of the open transaction
+static NetSocket listener = NET_INVALID;
+static volatile sig_atomic_t stopRequested = 0;
+
+
+static void onStopSignal(int signalNumber) {
+    (void)signalNumber;
+    stopRequested = 1;
+}
+
+
+// Reply bytes the client has not received yet
+static size_t unsent(const Connection *client) {
+    return client->replies.length - client->sent;
+}
+
+
+// Appends a whole reply frame that the engine did not print
+static void queueReply(Connection *client, const char *status, const char *message) {
+    OutputSink *previous = outputRedirect(&client->replies);
+    outputPrintf("%s %d\n%s", status, (int)strlen(message), message);
+    outputRedirect(previous);
+}
+
+
+/**
+ * frameReply()
+ * -----------------------------------------
+ * Turns the output a command printed into replies->data from start on
+ * into a reply frame by slotting its header in front.
+ *
+ * @return 0 if memory ran out (the output is dropped)
+ */
+static int frameReply(OutputSink *replies, size_t start, CommandStatus status) {
+    const char *word = status == COMMAND_QUIT ? REPLY_BYE : status == COMMAND_FAILED ? REPLY_FAILED : REPLY_OK;
+    char header[32];
+    size_t body = replies->length - start;
+    int headerLength = snprintf(header, sizeof(header), "%s %lu\n", word, (unsigned long)body);
+    OutputSink *previous = outputRedirect(replies);
+    outputWrite(header, (size_t)headerLength);     // Grows the buffer; moved into place below
+    outputRedirect(previous);
+    if (replies->failed) {
+        replies->length = start;
+        return 0;
+    }
+    memmove(replies->data + start + headerLength, replies->data + start, body);
+    memcpy(replies->data + start, header, (size_t)headerLength);
+    return 1;
+}
+
+
+#ifndef _WIN32
+
+// Writes all of data to a pipe; returns 0 if the reading end went away
+static int writeAll(int fd, const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return 0;
+        data += written;
+        length -= (size_t)written;
+    }
+    return 1;
+}
+
+
+// Body of a snapshot reader: runs the command and writes its reply
+// frame to the pipe. Everything else it inherited belongs to the server.
+static void runReader(const char *line, int output) {
+    for (int i = 0; i < clientCount; i++) {
+        netClose(clients[i]->socket);
+        if (clients[i]->reader.pid) close(clients[i]->reader.pipe);
+    }
+    netClose(listener);
+    scanForkChild();
+    statsEnabled = 0;           // The server times the reader instead
+
+    OutputSink reply = { NULL, NULL, 0, 0, 0 };
+    outputRedirect(&reply);
+    CommandStatus status = executeCommand(line, 0);
+    renderFlush();
+    outputRedirect(NULL);
+    if (reply.failed) {
+        outputClear(&reply);
+        outputRedirect(&reply);
+        outputPrintf("CMS: The reply was too large to buffer.\n");
+        outputRedirect(NULL);
+        status = COMMAND_FAILED;
+    }
+    int ok = !reply.failed && frameReply(&reply, 0, status) && writeAll(output, reply.data, reply.length);
+    _exit(ok ? 0 : 1);
+}
+
+
+/**
+ * startReader()
+ * -----------------------------------------
+ * Forks a snapshot reader for a whole-table view of a large table.
+ * For a sorted view the ordered indexes are built first, so the reader
+ * inherits them. While records are still to be loaded (a lazy or sharded
+ * table) the command runs in place, so they are loaded only once.
+ *
+ * @return 1 if the reader runs the command, 0 if it should run in place
+ */
+static int startReader(Connection *client, const char *line) {
+    int sorted;
+    if (readerCount >= SERVER_MAX_READERS || idIndex.count < SERVER_READER_MIN_RECORDS ||
+        !dbComplete() || !commandIsSnapshotRead(line, &sorted)) {
+        return 0;
+    }
+
+    SnapshotReader *reader = &client->reader;
+    int ends[2];
+    reader->line = strdup(line);
+    if (!reader->line) return 0;
+    if (pipe(ends) != 0) {
+        free(reader->line);
+        return 0;
+    }
+    if (ends[0] >= FD_SETSIZE) {
+        close(ends[0]);
+        close(ends[1]);
+        free(reader->line);
+        return 0;
+    }
+
+    if (sorted) prepareSnapshotRead();
+    outputFlush();              // Nothing buffered for stdout is left to copy
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(ends[0]);
+        close(ends[1]);
+        free(reader->line);
+        return 0;
+    }
+    if (pid == 0) {
+        close(ends[0]);
+        runReader(line, ends[1]);
+    }
+
+    close(ends[1]);
+    reader->pid = (long)pid;
+    reader->pipe = ends[0];
+    reader->received = 0;
+    reader->failed = 0;
+    reader->started = timerNow();
+    readerCount++;
+    return 1;
+}
+
+
+// Reaps a reader; returns 1 if it exited after writing its whole reply
+static int endReader(SnapshotReader *reader, int cancel) {
+    int status = 0;
+    if (cancel) kill((pid_t)reader->pid, SIGKILL);
+    close(reader->pipe);
+    while (waitpid((pid_t)reader->pid, &status, 0) < 0 && errno == EINTR);
+    free(reader->line);
+    reader->line = NULL;
+    reader->pid = 0;
+    readerCount--;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+
+/**
+ * readReader()
+ * -----------------------------------------
+ * Forwards what a client's reader has written into the client's replies.
+ * At the end of its output the reader is reaped, timed for SHOW STATS,
+ * and the client's next commands may run.
+ *
+ * @return 0 if the client's reply stream is broken and it must be closed
+ */
+static int readReader(Connection *client) {
+    SnapshotReader *reader = &client->reader;
+    char buffer[SERVER_READ_CHUNK];
+    ssize_t got = read(reader->pipe, buffer, sizeof(buffer));
+    if (got < 0 && (errno == EINTR || errno == EAGAIN)) return 1;
+
+    if (got > 0) {
+        if (reader->received == 0) reader->failed = buffer[0] == REPLY_FAILED[0];
+        reader->received += (size_t)got;
+        OutputSink *previous = outputRedirect(&client->replies);
+        outputWrite(buffer, (size_t)got);
+        outputRedirect(previous);
+        if (!client->replies.failed) return 1;
+        endReader(reader, 1);
+        return 0;
+    }
+
+    double seconds = timerNow() - reader->started;
+    commandRecord(reader->line, seconds, reader->failed);
+    size_t received = reader->received;
+    int complete = endReader(reader, 0);
+    if (received == 0) {
+        queueReply(client, REPLY_FAILED, "CMS: The snapshot reader stopped without a reply.\n");
+        return 1;
+    }
+    if (!complete) return 0;    // Part of a frame: the client could not find the next one
+    if (!reader->failed) pageStateClear(client->page);     // As the view would have done here
+    return 1;
+}
+
+#else
+
+static int startReader(Connection *client, const char *line) {
+    return 0;
+}
+
+#endif
+
+
+// Whether another client's transaction holds this client's commands back
+static int waitsForTransaction(const Connection *client) {
+    return transactionClient && transactionClient != client;
+}
+
+
+static void closeClient(int index) {
+    Connection *client = clients[index];
+#ifndef _WIN32
+    if (client->reader.pid) endReader(&client->reader, 1);
+#endif
+    clients[index] = clients[--clientCount];
+    outputPrintf("CMS: Client %s disconnected (%d connected).\n", client->peer, clientCount);
+    if (client == transactionClient) {
+        transactionClient = NULL;
+        rollbackDB();
+    }
+    outputFlush();
+    netClose(client->socket);
+    free(client->input);
+    outputFree(&client->replies);
+    pageStateFree(client->page);
+    free(client);
+}
+
+
+// Accepts every pending connection, turning away those over the limit
+static void acceptClients(NetSocket listener) {
+    char peer[NET_PEER_MAX];
+    NetSocket socket;
+    while ((socket = netAccept(listener, peer, sizeof(peer))) != NET_INVALID) {
+        Connection *client = NULL;
+#ifndef _WIN32
+        int fits = socket < FD_SETSIZE;
+#else
+        int fits = 1;
+#endif
+        if (fits && clientCount < SERVER_MAX_CLIENTS && netSetNonBlocking(socket)) {
+            client = calloc(1, sizeof(Connection));
+            if (client && !(client->page = pageStateNew())) {
+                free(client);
+                client = NULL;
+            }
+        }
+        if (!client) {
+            static const char message[] = "CMS: The server cannot take more clients.\n";
+            char full[sizeof(message) + 32];
+            int length = snprintf(full, sizeof(full), "%s %d\n%s", REPLY_FAILED, (int)sizeof(message) - 1, message);
+            netSend(socket, full, (size_t)length);
+            netClose(socket);
+            continue;
+        }
+
+        client->socket = socket;
+        snprintf(client->peer, sizeof(client->peer), "%s", peer);
+        clients[clientCount++] = client;
+        outputPrintf("CMS: Client %s connected (%d connected).\n", peer, clientCount);
+        outputFlush();
+    }
+}
+
+
+/**
+ * runLine()
+ * -----------------------------------------
+ * Runs one command line for a client, or hands it to a snapshot reader.
+ * The engine prints straight into the client's reply buffer; the frame
+ * header is slotted in front afterwards. Blank lines and comments get an
+ * empty OK reply, so every line sent has exactly one reply.
+ */
+static void runLine(Connection *client, const char *line) {
+    OutputSink *replies = &client->replies;
+    size_t start = replies->length;
+    CommandStatus status = COMMAND_OK;
+
+    const char *text = line;
+    while (*text == ' ' || *text == '\t') text++;
+    if (*text != '\0' && *text != '#' && startReader(client, text)) return;
+    if (*text != '\0' && *text != '#') {
+        OutputSink *previous = outputRedirect(replies);
+        pageStateSwap(client->page);
+        status = executeCommand(text, 0);
+        renderFlush();
+        pageStateSwap(client->page);
+        outputRedirect(previous);
+    }
+
+    if (replies->failed) {
+        // Out of memory part-way: drop the partial output, report, hang up
+        replies->length = start;
+        replies->failed = 0;
+        queueReply(client, REPLY_FAILED, "CMS: The reply was too large to buffer.\n");
+        client->closing = 1;
+        return;
+    }
+
+    if (!frameReply(replies, start, status) || status == COMMAND_QUIT) client->closing = 1;
+}
+
+
+/**
+ * runCommands()
+ * -----------------------------------------
+ * Runs the complete lines a client has sent, in order, until its turn is
+ * used up, its replies back up, a snapshot reader takes its command or
+ * another client holds a transaction open. Once the client has finished
+ * sending, a last line without a newline runs too.
+ */
+static void runCommands(Connection *client) {
+    int ran = 0;
+    while (!client->closing && !client->reader.pid && !waitsForTransaction(client)) {
+        char *line = client->input + client->inputStart;
+        size_t available = client->inputLength - client->inputStart;
+        char *newline = available ? memchr(line, '\n', available) : NULL;
+
+        if (!newline) {
+            if (available > SERVER_LINE_MAX) {
+                queueReply(client, REPLY_FAILED, "CMS: The command line is too long.\n");
+                client->closing = 1;
+                break;
+            }
+            if (!client->peerDone) break;
+            if (available == 0) {
+                client->closing = 1;
+                break;
+            }
+            newline = line + available;     // Unterminated last line; there is room for its NUL
+        }
+        if (ran == SERVER_COMMANDS_PER_TURN || unsent(client) > SERVER_OUTPUT_HIGH) return;
+
+        size_t length = (size_t)(newline - line);
+        client->inputStart += length + (client->inputStart + length < client->inputLength);
+        if (length > 0 && line[length - 1] == '\r') length--;
+        line[length] = '\0';
+        runLine(client, line);
+        transactionClient = dbInTransaction() ? client : NULL;
+        ran++;
+    }
+
+    // Move what is left of a partial line to the front
+    size_t left = client->inputLength - client->inputStart;
+    if (left > 0) memmove(client->input, client->input + client->inputStart, left);
+    client->inputLength = left;
+    client->inputStart = 0;
+}
+
+
+// Reads what a client has sent; returns 0 if the connection failed
+static int readClient(Connection *client) {
+    if (client->inputCapacity - client->inputLength < SERVER_READ_CHUNK + 1) {
+        size_t capacity = client->inputCapacity ? client->inputCapacity * 2 : SERVER_READ_CHUNK * 2;
+        char *input = realloc(client->input, capacity);
+        if (!input) return 0;
+        client->input = input;
+        client->inputCapacity = capacity;
+    }
+    // One byte is always kept free for the NUL of an unterminated last line
+    long received = netRecv(client->socket, client->input + client->inputLength,
+                            client->inputCapacity - client->inputLength - 1);
+    if (received == NET_ERROR) return 0;
+    if (received == NET_CLOSED) client->peerDone = 1;
+    else if (received > 0) client->inputLength += (size_t)received;
+    return 1;
+}
+
+
+// Sends queued replies; returns 0 if the connection failed
+static int writeClient(Connection *client) {
+    while (unsent(client) > 0) {
+        long sent = netSend(client->socket, client->replies.data + client->sent, unsent(client));
+        if (sent == NET_ERROR) return 0;
+        if (sent == NET_AGAIN) break;
+        client->sent += (size_t)sent;
+    }
+    if (client->sent == client->replies.length) {
+        // Give back the memory of an unusually large reply
+        if (client->replies.capacity > SERVER_OUTPUT_HIGH) outputFree(&client->replies);
+        else outputClear(&client->replies);
+        client->sent = 0;
+    }
+    else if (client->sent > SERVER_OUTPUT_HIGH) {
+        // A slow reader: drop the sent part so the buffer does not keep growing
+        memmove(client->replies.data, client->replies.data + client->sent, unsent(client));
+        client->replies.length -= client->sent;
+        client->sent = 0;
+    }
+    return 1;
+}
+
+
+/**
+ * runServer()
+ * -----------------------------------------
+ * Opens the database and serves clients until SIGINT or SIGTERM. Unsaved
+ * changes are not written on the way out, the same as at the end of a
+ * batch; clients SAVE them.
+ *
+ * @param host - address to listen on
+ * @param port - TCP port
+ * @return process exit status
+ */
+int runServer(const char *host, int port) {
+    if (!netStartup()) {
+        outputPrintf("CMS: The network could not be started.\n");
+        return 1;
+    }
+    listener = netListen(host, port);
+    if (listener == NET_INVALID || !netSetNonBlocking(listener)) {
+        outputPrintf("CMS: Cannot listen on %s:%d.\n", host, port);
+        if (listener != NET_INVALID) netClose(listener);
+        netCleanup();
+        return 1;
+    }
+
+    openDB();
+    signal(SIGINT, onStopSignal);
+    signal(SIGTERM, onStopSignal);
+    outputPrintf("CMS: Serving \"P4_1-CMS.txt\" on %s:%d (up to %d clients). Press Ctrl+C to stop.\n",
+                 host, port, SERVER_MAX_CLIENTS);
+    outputFlush();
+
+    while (!stopRequested) {
+        saveTick();     // Background save results and autosave go to the server's log
+        fd_set readable, writable;
+        FD_ZERO(&readable);
+        FD_ZERO(&writable);
+        NetSocket highest = listener;
+        FD_SET(listener, &readable);
+
+        int backlog = 0;        // Someone has lines waiting for their next turn
+        for (int i = 0; i < clientCount; i++) {
+            Connection *client = clients[i];
+            size_t waiting = client->inputLength - client->inputStart;
+            if (!client->peerDone && !client->closing && waiting <= SERVER_LINE_MAX) {
+                FD_SET(client->socket, &readable);
+            }
+            if (unsent(client) > 0) FD_SET(client->socket, &writable);
+            if (client->socket > highest) highest = client->socket;
+            if (client->reader.pid) {
+                if (unsent(client) <= SERVER_OUTPUT_HIGH) FD_SET(client->reader.pipe, &readable);
+                if (client->reader.pipe > highest) highest = client->reader.pipe;
+            }
+            else if (waiting && !waitsForTransaction(client)
+                     && memchr(client->input + client->inputStart, '\n', waiting)) {
+                backlog = 1;
+            }
+        }
+
+        struct timeval timeout = { 0, 0 };
+        if (!backlog) {
+            timeout.tv_sec = SERVER_POLL_MS / 1000;
+            timeout.tv_usec = (SERVER_POLL_MS % 1000) * 1000;
+        }
+        int ready = select((int)highest + 1, &readable, &writable, NULL, &timeout);
+        if (ready < 0) continue;    // Interrupted, e.g. by the stop signal
+
+        if (FD_ISSET(listener, &readable)) acceptClients(listener);
+
+        for (int i = 0; i < clientCount; i++) {
+            Connection *client = clients[i];
+            int ok = 1;
+            if (FD_ISSET(client->socket, &readable)) ok = readClient(client);
+#ifndef _WIN32
+            if (ok && client->reader.pid && FD_ISSET(client->reader.pipe, &readable)) ok = readReader(client);
+#endif
+            if (ok) runCommands(client);
+            if (ok && unsent(client) > 0) ok = writeClient(client);
+            if (!ok || (client->closing && unsent(client) == 0 && !client->reader.pid)) {
+                closeClient(i);
+                i--;        // The last client moved into this slot
+            }
+        }
+    }
+
+    while (clientCount > 0) closeClient(clientCount - 1);
+    netClose(listener);
+    netCleanup();
+    outputPrintf("CMS: Server stopped.\n");
+    saveWait();
+    if (dbLoaded && dbModified) {
+        outputPrintf("CMS: WARNING: The server stopped with unsaved changes. They have been discarded.\n");
+    }
+    return 0;
+}
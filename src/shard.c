@@ -0,0 +1,159 @@
+/**
+ * ID-Range Shards
+ * --------------------------------------
+ * Bookkeeping for a table split by ID range into separate text files,
+ * P4_1-CMS-<key>.txt, where the key is the ID divided by the shard span
+ * (the intake-year prefix of a 7-digit ID). Each file has its own .bak
+ * and is written the way the single database file is: a synced temp file
+ * renamed into place.
+ *
+ * The manifest, P4_1-CMS.shards, lists the shards with the save that last
+ * wrote each one, so OPEN knows the shards without reading them and
+ * RESTORE knows which backups the latest save left behind.
+ *
+ * Authors: Team P4-1
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "headers/cms.h"
+#include "headers/file_io.h"
+#include "headers/shard.h"
+
+#define SHARD_MANIFEST_TEMP_SUFFIX ".tmp"
+
+
+int shardKeyOf(const ShardSet *set, int id) {
+    int span = set->span > 0 ? set->span : SHARD_ID_SPAN;
+    return id >= 0 ? id / span : -((-(long long)id + span - 1) / span);
+}
+
+
+void shardPath(int key, const char *extension, char *path, size_t size) {
+    snprintf(path, size, "%s%d%s", DB_SHARD_PREFIX, key, extension);
+}
+
+
+// Position of a key in the sorted shard array, or where it would go
+static size_t shardSlot(const ShardSet *set, int key) {
+    size_t low = 0, high = set->count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (set->shards[middle].key < key) low = middle + 1;
+        else high = middle;
+    }
+    return low;
+}
+
+
+Shard *shardFind(ShardSet *set, int key) {
+    size_t slot = shardSlot(set, key);
+    return slot < set->count && set->shards[slot].key == key ? &set->shards[slot] : NULL;
+}
+
+
+Shard *shardAdd(ShardSet *set, int key) {
+    size_t slot = shardSlot(set, key);
+    if (slot < set->count && set->shards[slot].key == key) return &set->shards[slot];
+
+    if (set->count == set->capacity) {
+        size_t capacity = set->capacity ? set->capacity * 2 : 16;
+        Shard *grown = realloc(set->shards, capacity * sizeof(Shard));
+        if (!grown) return NULL;
+        set->shards = grown;
+        set->capacity = capacity;
+    }
+    memmove(&set->shards[slot + 1], &set->shards[slot], (set->count - slot) * sizeof(Shard));
+    set->count++;
+
+    Shard *shard = &set->shards[slot];
+    memset(shard, 0, sizeof(*shard));
+    shard->key = key;
+    shard->loaded = 1;          // Nothing on disk to load yet
+    return shard;
+}
+
+
+/**
+ * shardManifestRead()
+ * -----------------------------------------
+ * Reads a manifest of the form:
+ *
+ *   P4_1-CMS shards 1
+ *   span 100000
+ *   generation 7
+ *   shard 23 7 41250
+ *
+ * with one "shard <key> <generation> <records>" line per shard.
+ */
+int shardManifestRead(ShardSet *set, const char *path) {
+    memset(set, 0, sizeof(*set));
+    FILE *file = fopen(path, "r");
+    if (!file) return 0;
+
+    char line[128];
+    int version = 0, valid = 0;
+    if (fgets(line, sizeof(line), file)
+        && strncmp(line, SHARD_MANIFEST_MAGIC " ", strlen(SHARD_MANIFEST_MAGIC) + 1) == 0
+        && sscanf(line + strlen(SHARD_MANIFEST_MAGIC), "%d", &version) == 1
+        && version == SHARD_MANIFEST_VERSION
+        && fgets(line, sizeof(line), file) && sscanf(line, "span %d", &set->span) == 1 && set->span > 0
+        && fgets(line, sizeof(line), file) && sscanf(line, "generation %ld", &set->generation) == 1) {
+        valid = 1;
+    }
+
+    while (valid && fgets(line, sizeof(line), file)) {
+        int key;
+        long generation, records;
+        if (line[0] == '\n') continue;
+        if (sscanf(line, "shard %d %ld %ld", &key, &generation, &records) != 3 || shardFind(set, key)) {
+            valid = 0;
+            break;
+        }
+        Shard *shard = shardAdd(set, key);
+        if (!shard) {
+            valid = 0;
+            break;
+        }
+        shard->generation = generation;
+        shard->records = records;
+        shard->loaded = 0;
+    }
+    if (ferror(file)) valid = 0;
+    fclose(file);
+
+    if (!valid) {
+        shardSetFree(set);
+        return -1;
+    }
+    return 1;
+}
+
+
+int shardManifestWrite(const ShardSet *set, const char *path) {
+    char tempPath[1024];
+    snprintf(tempPath, sizeof(tempPath), "%s%s", path, SHARD_MANIFEST_TEMP_SUFFIX);
+
+    FILE *file = fopen(tempPath, "w");
+    if (!file) return 0;
+    fprintf(file, "%s %d\nspan %d\ngeneration %ld\n",
+            SHARD_MANIFEST_MAGIC, SHARD_MANIFEST_VERSION, set->span, set->generation);
+    for (size_t i = 0; i < set->count; i++) {
+        const Shard *shard = &set->shards[i];
+        fprintf(file, "shard %d %ld %ld\n", shard->key, shard->generation, shard->records);
+    }
+    int ok = !ferror(file) && fileSync(file);
+    if (fclose(file) != 0) ok = 0;
+    if (!ok || !fileReplace(tempPath, path, NULL)) {
+        remove(tempPath);
+        return 0;
+    }
+    return 1;
+}
+
+
+void shardSetFree(ShardSet *set) {
+    free(set->shards);
+    memset(set, 0, sizeof(*set));
+}
@@ -0,0 +1,339 @@
+/**
+ * Binary Snapshot
+ * --------------------------------------
+ * Column-oriented binary image of the StudentRecords table, written next
+ * to the tab-separated text file by SAVE. Loading it needs one read, a
+ * checksum pass and no text parsing or float conversion:
+ * - IDs and marks are stored as fixed-width columns
+ * - programme codes refer to a small table stored once per file
+ * - names are stored back to back in a heap that becomes namePool as is
+ *
+ * Authors: Team P4-1
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "headers/cms.h"
+#include "headers/crc32.h"
+#include "headers/file_io.h"
+#include "headers/snapshot.h"
+
+#define WRITER_BUFFER_SIZE 65536        // Staging buffer for column writes
+
+
+// ===============================
+// Writer
+// ===============================
+
+// Buffered output stream that checksums everything written through it
+typedef struct SnapshotWriter {
+    FILE *file;
+    uint32_t crc;
+    size_t used;
+    int failed;
+    unsigned char buffer[WRITER_BUFFER_SIZE];
+} SnapshotWriter;
+
+static void writerFlush(SnapshotWriter *writer) {
+    if (writer->used == 0) return;
+    writer->crc = crc32Update(writer->crc, writer->buffer, writer->used);
+    if (fwrite(writer->buffer, 1, writer->used, writer->file) != writer->used) writer->failed = 1;
+    writer->used = 0;
+}
+
+static void writerPut(SnapshotWriter *writer, const void *data, size_t len) {
+    const unsigned char *p = data;
+    while (len > 0) {
+        if (writer->used == WRITER_BUFFER_SIZE) writerFlush(writer);
+        size_t chunk = WRITER_BUFFER_SIZE - writer->used;
+        if (chunk > len) chunk = len;
+        memcpy(writer->buffer + writer->used, p, chunk);
+        writer->used += chunk;
+        p += chunk;
+        len -= chunk;
+    }
+}
+
+
+/**
+ * snapshotWrite()
+ * -----------------------------------------
+ * Serialises every record in list order. The header is written last
+ * (once the checksum is known), then the file is synced and renamed
+ * over the previous snapshot.
+ *
+ * @param path     - snapshot file to produce
+ * @param tempPath - staging file in the same directory
+ * @return 1 on success, 0 on failure (previous snapshot left untouched)
+ */
+int snapshotWrite(const char *path, const char *tempPath) {
+    SnapshotWriter *writer = malloc(sizeof(SnapshotWriter));
+    if (!writer) return 0;
+
+    writer->file = fopen(tempPath, "wb");
+    if (!writer->file) {
+        free(writer);
+        return 0;
+    }
+    writer->crc = 0;
+    writer->used = 0;
+    writer->failed = 0;
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.byteOrder = SNAPSHOT_BYTE_ORDER;
+    header.version = SNAPSHOT_VERSION;
+
+    // Reserve room for the header, then stream the columns
+    fwrite(&header, sizeof(header), 1, writer->file);
+
+    uint32_t count = 0;
+    uint32_t nameHeapSize = 0;
+    for (Node *node = head; node; node = node->next) {
+        int32_t id = node->id;
+        writerPut(writer, &id, sizeof(id));
+        count++;
+        nameHeapSize += (uint32_t)node->nameLength + 1;
+    }
+    for (Node *node = head; node; node = node->next) {
+        writerPut(writer, &node->mark, sizeof(float));
+    }
+    for (Node *node = head; node; node = node->next) {
+        uint16_t code = node->programme;
+        writerPut(writer, &code, sizeof(code));
+    }
+    for (Node *node = head; node; node = node->next) {
+        uint16_t length = node->nameLength;
+        writerPut(writer, &length, sizeof(length));
+    }
+
+    // Programme table: the whole dictionary, so record codes need no remapping
+    uint32_t codes = (uint32_t)programmeCount();
+    uint32_t programmeHeapSize = 0;
+    for (uint32_t code = 0; code < codes; code++) {
+        uint16_t length = (uint16_t)programmeLength((ProgCode)code);
+        writerPut(writer, &length, sizeof(length));
+        programmeHeapSize += (uint32_t)length + 1;
+    }
+    for (uint32_t code = 0; code < codes; code++) {
+        writerPut(writer, programmeName((ProgCode)code), programmeLength((ProgCode)code) + 1);
+    }
+    for (Node *node = head; node; node = node->next) {
+        writerPut(writer, nodeName(node), (size_t)node->nameLength + 1);
+    }
+    writerFlush(writer);
+
+    header.recordCount = count;
+    header.programmeCount = codes;
+    header.programmeHeapSize = programmeHeapSize;
+    header.nameHeapSize = nameHeapSize;
+    header.checksum = writer->crc;
+
+    int ok = !writer->failed
+             && fseek(writer->file, 0, SEEK_SET) == 0
+             && fwrite(&header, sizeof(header), 1, writer->file) == 1
+             && fileSync(writer->file);
+    if (fclose(writer->file) != 0) ok = 0;
+    free(writer);
+
+    if (!ok || !fileReplace(tempPath, path, NULL)) {
+        remove(tempPath);
+        return 0;
+    }
+    return 1;
+}
+
+
+/**
+ * snapshotCapture()
+ * -----------------------------------------
+ * Copies the current table into memory in the snapshot file's layout,
+ * header space included, so that it can be written out later, from any
+ * thread, however the table changes meanwhile. Costs one pass over the
+ * records and a copy of their names.
+ *
+ * @param image - filled in on success; release with snapshotRelease()
+ * @return 1 on success, 0 if memory ran out
+ */
+int snapshotCapture(SnapshotImage *image) {
+    memset(image, 0, sizeof(*image));
+    size_t n = idIndex.count, pc = programmeCount();
+    size_t programmeHeapSize = 0;
+    for (size_t code = 0; code < pc; code++) programmeHeapSize += programmeLength((ProgCode)code) + 1;
+
+    // namePool holds every live name (and maybe released ones), so it
+    // bounds the name heap
+    size_t size = sizeof(SnapshotHeader) + n * (4 + 4 + 2 + 2) + pc * 2 + programmeHeapSize + namePool.used;
+    char *buffer = malloc(size);
+    if (!buffer) return 0;
+
+    char *p = buffer + sizeof(SnapshotHeader);
+    int32_t *ids = (int32_t*)p;                     p += n * 4;
+    float *marks = (float*)p;                       p += n * 4;
+    uint16_t *programmes = (uint16_t*)p;            p += n * 2;
+    uint16_t *nameLengths = (uint16_t*)p;           p += n * 2;
+    uint16_t *programmeLengths = (uint16_t*)p;      p += pc * 2;
+    char *programmeHeap = p;                        p += programmeHeapSize;
+    char *nameHeap = p;
+
+    for (size_t code = 0; code < pc; code++) {
+        size_t length = programmeLength((ProgCode)code);
+        programmeLengths[code] = (uint16_t)length;
+        memcpy(programmeHeap, programmeName((ProgCode)code), length + 1);
+        programmeHeap += length + 1;
+    }
+    size_t i = 0;
+    for (Node *node = head; node; node = node->next, i++) {
+        ids[i] = node->id;
+        marks[i] = node->mark;
+        programmes[i] = node->programme;
+        nameLengths[i] = node->nameLength;
+        memcpy(p, nodeName(node), (size_t)node->nameLength + 1);
+        p += node->nameLength + 1;
+    }
+
+    SnapshotHeader *header = &image->header;
+    memcpy(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic));
+    header->byteOrder = SNAPSHOT_BYTE_ORDER;
+    header->version = SNAPSHOT_VERSION;
+    header->recordCount = (uint32_t)n;
+    header->programmeCount = (uint32_t)pc;
+    header->programmeHeapSize = (uint32_t)programmeHeapSize;
+    header->nameHeapSize = (uint32_t)(p - nameHeap);
+
+    image->buffer = buffer;
+    image->bufferSize = (size_t)(p - buffer);
+    image->ids = ids;
+    image->marks = marks;
+    image->programmes = programmes;
+    image->nameLengths = nameLengths;
+    image->programmeLengths = programmeLengths;
+    image->programmeHeap = (const char*)programmeLengths + pc * 2;
+    image->nameHeap = nameHeap;
+    return 1;
+}
+
+
+/**
+ * snapshotWriteImage()
+ * -----------------------------------------
+ * Writes a captured image as a snapshot file: checksum, one write,
+ * sync, then a rename over the previous snapshot. Touches nothing but
+ * the image, so it may run on a background thread.
+ *
+ * @return 1 on success, 0 on failure (previous snapshot left untouched)
+ */
+int snapshotWriteImage(SnapshotImage *image, const char *path, const char *tempPath) {
+    image->header.checksum = crc32Update(0, image->buffer + sizeof(SnapshotHeader),
+                                         image->bufferSize - sizeof(SnapshotHeader));
+    memcpy(image->buffer, &image->header, sizeof(SnapshotHeader));
+
+    FILE *file = fopen(tempPath, "wb");
+    if (!file) return 0;
+    int ok = fwrite(image->buffer, 1, image->bufferSize, file) == image->bufferSize && fileSync(file);
+    if (fclose(file) != 0) ok = 0;
+    if (!ok || !fileReplace(tempPath, path, NULL)) {
+        remove(tempPath);
+        return 0;
+    }
+    return 1;
+}
+
+
+// ===============================
+// Reader
+// ===============================
+
+
+/**
+ * snapshotRead()
+ * -----------------------------------------
+ * Reads the whole snapshot with one fread and validates its header,
+ * section sizes, checksum and string heaps.
+ *
+ * @param path  - snapshot file
+ * @param image - filled in on success; release with snapshotRelease()
+ * @return 1 if the snapshot is usable, 0 if it is missing or invalid
+ */
+int snapshotRead(const char *path, SnapshotImage *image) {
+    memset(image, 0, sizeof(*image));
+
+    long long size = fileSize(path);
+    if (size < (long long)sizeof(SnapshotHeader)) return 0;
+
+    FILE *file = fopen(path, "rb");
+    if (!file) return 0;
+
+    char *buffer = malloc((size_t)size);
+    if (!buffer) {
+        fclose(file);
+        return 0;
+    }
+    size_t got = fread(buffer, 1, (size_t)size, file);
+    fclose(file);
+    if (got != (size_t)size) {
+        free(buffer);
+        return 0;
+    }
+
+    SnapshotHeader header;
+    memcpy(&header, buffer, sizeof(header));
+    size_t n = header.recordCount, pc = header.programmeCount;
+    size_t expected = sizeof(SnapshotHeader) + n * (4 + 4 + 2 + 2) + pc * 2
+                      + header.programmeHeapSize + header.nameHeapSize;
+
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0
+        || header.byteOrder != SNAPSHOT_BYTE_ORDER
+        || header.version != SNAPSHOT_VERSION
+        || pc > PROGRAMME_MAX_CODES
+        || expected != (size_t)size
+        || crc32Update(0, buffer + sizeof(header), (size_t)size - sizeof(header)) != header.checksum) {
+        free(buffer);
+        return 0;
+    }
+
+    char *p = buffer + sizeof(header);
+    image->ids = (const int32_t*)p;                 p += n * 4;
+    image->marks = (const float*)p;                 p += n * 4;
+    image->programmes = (const uint16_t*)p;         p += n * 2;
+    image->nameLengths = (const uint16_t*)p;        p += n * 2;
+    image->programmeLengths = (const uint16_t*)p;   p += pc * 2;
+    image->programmeHeap = p;                       p += header.programmeHeapSize;
+    image->nameHeap = p;
+
+    // Every string must fit its declared length and be NUL-terminated
+    size_t offset = 0;
+    for (size_t i = 0; i < pc; i++) {
+        offset += image->programmeLengths[i] + 1;
+        if (offset > header.programmeHeapSize || image->programmeHeap[offset - 1] != '\0') {
+            free(buffer);
+            return 0;
+        }
+    }
+    offset = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (image->nameLengths[i] >= MAX_NAME || image->programmes[i] >= pc) {
+            free(buffer);
+            return 0;
+        }
+        offset += image->nameLengths[i] + 1;
+        if (offset > header.nameHeapSize || image->nameHeap[offset - 1] != '\0') {
+            free(buffer);
+            return 0;
+        }
+    }
+
+    image->buffer = buffer;
+    image->bufferSize = (size_t)size;
+    image->header = header;
+    return 1;
+}
+
+
+// Frees the memory behind a snapshot image
+void snapshotRelease(SnapshotImage *image) {
+    free(image->buffer);
+    memset(image, 0, sizeof(*image));
+}
@@ -0,0 +1,169 @@
+/**
+ * Command Statistics
+ * --------------------------------------
+ * Counts and times every dispatched command for SHOW STATS:
+ * - latencies go into an HDR-style log-linear histogram, 16 buckets per
+ *   power of two of nanoseconds, so percentiles are within about 6%
+ *   whatever the range and recording is an increment, not a sort
+ * - collection is off unless STATS ON, --stats or --stats-dump turned it
+ *   on; when off the only cost is one test per command
+ * - with a dump file, a report is appended every STATS_DUMP_SECONDS
+ *
+ * Authors: Team P4-1
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "headers/stats.h"
+#include "headers/timer.h"
+#include "headers/output.h"
+
+#define SUB_BUCKETS (1 << STATS_SUB_BUCKET_BITS)
+
+int statsEnabled = 0;
+
+static CommandStats commandStats[STATS_MAX_COMMANDS];
+
+static FILE *dumpFile = NULL;
+static StatsReportFn dumpReport = NULL;
+static double lastDump = 0.0;
+
+
+// Index of the highest set bit of a non-zero value
+static int highestBit(unsigned long long value) {
+#if defined(__GNUC__)
+    return 63 - __builtin_clzll(value);
+#else
+    int bit = 0;
+    while (value >>= 1) bit++;
+    return bit;
+#endif
+}
+
+
+// Bucket of a latency in nanoseconds: exact below SUB_BUCKETS * 2, then
+// SUB_BUCKETS buckets per power of two
+static int bucketOf(unsigned long long ns) {
+    if (ns >= (1ULL << STATS_MAX_NS_BITS)) ns = (1ULL << STATS_MAX_NS_BITS) - 1;
+    if (ns < SUB_BUCKETS) return (int)ns;
+    int shift = highestBit(ns) - STATS_SUB_BUCKET_BITS;
+    return shift * SUB_BUCKETS + (int)(ns >> shift);
+}
+
+
+// Largest latency in nanoseconds that falls into a bucket
+static double bucketTop(int bucket) {
+    if (bucket < 2 * SUB_BUCKETS) return (double)bucket;
+    int shift = bucket / SUB_BUCKETS - 1;
+    unsigned long long base = (unsigned long long)(bucket - shift * SUB_BUCKETS);
+    return (double)(((base + 1) << shift) - 1);
+}
+
+
+// Appends a timestamped report to the dump file
+static void writeDump() {
+    time_t clock = time(NULL);
+    char stamp[32];
+    strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", localtime(&clock));
+    OutputSink sink = { dumpFile, NULL, 0, 0, 0 };
+    OutputSink *previous = outputRedirect(&sink);
+    outputPrintf("==== %s\n", stamp);
+    if (dumpReport) dumpReport();
+    outputPrintf("\n");
+    outputRedirect(previous);
+    fflush(dumpFile);
+}
+
+
+void statsRecord(int command, const char *name, double seconds, int failed) {
+    if (command < 0 || command >= STATS_MAX_COMMANDS) return;
+    CommandStats *stats = &commandStats[command];
+    stats->name = name;
+    stats->count++;
+    stats->failed += failed != 0;
+    stats->seconds += seconds;
+    if (seconds > stats->maxSeconds) stats->maxSeconds = seconds;
+    stats->buckets[bucketOf(seconds > 0 ? (unsigned long long)(seconds * 1e9) : 0)]++;
+
+    if (dumpFile) {
+        double now = timerNow();
+        if (now - lastDump >= STATS_DUMP_SECONDS) {
+            lastDump = now;
+            writeDump();
+        }
+    }
+}
+
+
+void statsReset(void) {
+    memset(commandStats, 0, sizeof(commandStats));
+}
+
+
+// Latency in seconds below which pct percent of the runs finished,
+// capped at the slowest run
+static double percentileOf(const CommandStats *stats, int pct) {
+    unsigned long long rank = (stats->count * (unsigned long long)pct + 99) / 100;
+    if (rank < 1) rank = 1;
+    unsigned long long seen = 0;
+    for (int b = 0; b < STATS_BUCKETS; b++) {
+        seen += stats->buckets[b];
+        if (seen >= rank) {
+            double top = bucketTop(b) / 1e9;
+            return top < stats->maxSeconds ? top : stats->maxSeconds;
+        }
+    }
+    return stats->maxSeconds;
+}
+
+
+/**
+ * statsPrint()
+ * -----------------------------------------
+ * Prints one line per command that has run since the last reset: runs,
+ * failures, p50/p90/p99 and the slowest run in microseconds, and the
+ * total time in seconds.
+ */
+void statsPrint(void) {
+    if (!statsEnabled) {
+        outputPrintf("Command timing is off. Use STATS ON (or start with --stats) to collect it.\n");
+        return;
+    }
+
+    int shown = 0;
+    for (int c = 0; c < STATS_MAX_COMMANDS; c++) {
+        const CommandStats *stats = &commandStats[c];
+        if (!stats->count) continue;
+        if (!shown++) {
+            outputPrintf("%-8s %10s %8s %10s %10s %10s %12s %10s\n",
+                         "Command", "Runs", "Failed", "p50 (us)", "p90 (us)", "p99 (us)", "Max (us)", "Total (s)");
+        }
+        outputPrintf("%-8s %10llu %8llu %10.1f %10.1f %10.1f %12.1f %10.3f\n",
+                     stats->name, stats->count, stats->failed,
+                     percentileOf(stats, 50) * 1e6, percentileOf(stats, 90) * 1e6,
+                     percentileOf(stats, 99) * 1e6, stats->maxSeconds * 1e6, stats->seconds);
+    }
+    if (!shown) outputPrintf("No commands have been timed yet.\n");
+}
+
+
+int statsDumpOpen(const char *path, StatsReportFn report) {
+    FILE *file = fopen(path, "a");
+    if (!file) return 0;
+    if (dumpFile) fclose(dumpFile);
+    dumpFile = file;
+    dumpReport = report;
+    lastDump = timerNow();
+    statsEnabled = 1;
+    return 1;
+}
+
+
+void statsDumpClose(void) {
+    if (!dumpFile) return;
+    writeDump();
+    FILE *file = dumpFile;
+    dumpFile = NULL;
+    fclose(file);
+}
@@ -0,0 +1,80 @@
+/**
+ * String Pool
+ * --------------------------------------
+ * Variable-length string storage for record names. Strings are packed
+ * back to back in one growing buffer and referenced by offset, so a
+ * record only pays for the characters it actually uses.
+ *
+ * Released strings are only counted as garbage; the owner decides when
+ * to rebuild the pool from the live strings.
+ *
+ * Authors: Team P4-1
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "headers/string_pool.h"
+
+
+/**
+ * stringPoolAdd()
+ * -----------------------------------------
+ * Copies a string (plus its terminator) to the end of the pool, doubling
+ * the buffer when it is full.
+ *
+ * @param str - characters to store (need not be NUL-terminated)
+ * @param len - number of characters
+ * @return offset of the stored string, or STRING_POOL_NONE on failure
+ */
+unsigned int stringPoolAdd(StringPool *pool, const char *str, size_t len) {
+    if (pool->used + len + 1 > pool->capacity) {
+        size_t newCapacity = pool->capacity ? pool->capacity : STRING_POOL_INITIAL;
+        while (pool->used + len + 1 > newCapacity) newCapacity <<= 1;
+        if (newCapacity > STRING_POOL_NONE) return STRING_POOL_NONE;
+
+        char *newData = realloc(pool->data, newCapacity);
+        if (!newData) return STRING_POOL_NONE;
+        pool->data = newData;
+        pool->capacity = newCapacity;
+    }
+
+    unsigned int offset = (unsigned int)pool->used;
+    memcpy(pool->data + offset, str, len);
+    pool->data[offset + len] = '\0';
+    pool->used += len + 1;
+    return offset;
+}
+
+
+// Marks a previously added string of the given length as no longer used
+void stringPoolRelease(StringPool *pool, size_t len) {
+    pool->garbage += len + 1;
+}
+
+
+// Forgets every string but keeps the buffer for reuse
+void stringPoolReset(StringPool *pool) {
+    pool->used = 0;
+    pool->garbage = 0;
+}
+
+
+// Replaces the pool contents with an existing malloc'd buffer of packed
+// NUL-terminated strings, taking ownership of it
+void stringPoolAdopt(StringPool *pool, char *data, size_t used) {
+    free(pool->data);
+    pool->data = data;
+    pool->used = used;
+    pool->capacity = used;
+    pool->garbage = 0;
+}
+
+
+// Releases the pool buffer
+void stringPoolFree(StringPool *pool) {
+    free(pool->data);
+    pool->data = NULL;
+    pool->used = 0;
+    pool->capacity = 0;
+    pool->garbage = 0;
+}
@@ -0,0 +1,180 @@
+/**
+ * Table Renderer
+ * --------------------------------------
+ * Formats record tables for SHOW ALL and QUERY, and the record lines SAVE
+ * writes (which share the TSV row format). Rows are written by hand
+ * into one large buffer that goes to the output sink in a single write
+ * when it fills up, instead of several printf() calls per row.
+ *
+ * The table layout is byte-for-byte what the printf() formats
+ * "%-8d %-*.*s %-*.*s %.1f" produced, including the wrapped lines of long
+ * names and programmes and the padding left before the mark.
+ *
+ * Authors: Team P4-1
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "headers/table_render.h"
+#include "headers/output.h"
+
+
+// Output waiting for the next renderFlush()
+static char buffer[RENDER_BUFFER_SIZE];
+static size_t used = 0;
+
+
+void renderFlush(void) {
+    if (used) outputWrite(buffer, used);
+    used = 0;
+}
+
+
+// Appends len bytes of text
+static char *putText(char *out, const char *text, size_t len) {
+    memcpy(out, text, len);
+    return out + len;
+}
+
+
+// Appends count spaces
+static char *putSpaces(char *out, int count) {
+    if (count <= 0) return out;
+    memset(out, ' ', (size_t)count);
+    return out + count;
+}
+
+
+// Appends a decimal integer, like "%d"
+static char *putInt(char *out, int value) {
+    char digits[12];
+    int count = 0;
+    unsigned int magnitude = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+    do {
+        digits[count++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+
+    if (value < 0) *out++ = '-';
+    while (count) *out++ = digits[--count];
+    return out;
+}
+
+
+/**
+ * putMark()
+ * -----------------------------------------
+ * Appends a mark like "%.1f". Marks are floats, so mark * 10 is exact in
+ * a double and rint() rounds it half-to-even just as printf() does. Huge
+ * or non-finite values fall back to snprintf().
+ */
+static char *putMark(char *out, float mark) {
+    double scaled = fabs((double)mark) * 10.0;
+    if (!(scaled < 1e15)) return out + snprintf(out, 64, "%.1f", mark);
+
+    long long tenths = (long long)rint(scaled);
+    if (signbit(mark)) *out++ = '-';
+
+    char digits[20];
+    int count = 0;
+    long long whole = tenths / 10;
+    do {
+        digits[count++] = (char)('0' + whole % 10);
+        whole /= 10;
+    } while (whole);
+    while (count) *out++ = digits[--count];
+
+    *out++ = '.';
+    *out++ = (char)('0' + tenths % 10);
+    return out;
+}
+
+
+// Appends one table cell: up to wrap characters of text padded to width,
+// then the column separator
+static char *putCell(char *out, const char *text, size_t length, int wrap, int width) {
+    size_t shown = length < (size_t)wrap ? length : (size_t)wrap;
+    out = putText(out, text, shown);
+    out = putSpaces(out, width - (int)shown);
+    *out++ = ' ';
+    return out;
+}
+
+
+char *renderTsvLine(char *out, int id, const char *name, size_t nameLength,
+                    const char *programme, size_t progLength, float mark) {
+    out = putInt(out, id);
+    *out++ = '\t';
+    out = putText(out, name, nameLength);
+    *out++ = '\t';
+    out = putText(out, programme, progLength);
+    *out++ = '\t';
+    out = putMark(out, mark);
+    *out++ = '\n';
+    return out;
+}
+
+
+/**
+ * renderHeader()
+ * -----------------------------------------
+ * Prints the message line and the column titles of a table. Anything
+ * still queued is flushed first so the output stays in order.
+ *
+ * @param headerMsg - line printed above the column titles
+ */
+void renderHeader(const TableLayout *layout, const char *headerMsg) {
+    renderFlush();
+    outputPrintf("%s\n", headerMsg);
+    if (layout->tsv) {
+        outputPrintf("ID\tName\tProgramme\tMark\n");
+        return;
+    }
+    outputPrintf("%-8s %-*s %-*s %-5s\n",
+                 "ID",
+                 layout->nameWidth, "Name",
+                 layout->progWidth, "Programme",
+                 "Mark");
+}
+
+
+/**
+ * renderRow()
+ * -----------------------------------------
+ * Queues one record. In table mode a name or programme longer than its
+ * wrap width continues on the following lines under its own column.
+ */
+void renderRow(const TableLayout *layout, int id, const char *name, size_t nameLength,
+               const char *programme, size_t progLength, float mark) {
+    if (used + RENDER_ROW_MAX > sizeof(buffer)) renderFlush();
+    char *out = buffer + used;
+
+    if (layout->tsv) {
+        out = renderTsvLine(out, id, name, nameLength, programme, progLength, mark);
+        used = (size_t)(out - buffer);
+        return;
+    }
+
+    size_t nameLines = nameLength ? (nameLength + layout->nameWrap - 1) / layout->nameWrap : 1;
+    size_t progLines = progLength ? (progLength + layout->progWrap - 1) / layout->progWrap : 1;
+    size_t lines = nameLines > progLines ? nameLines : progLines;
+
+    for (size_t i = 0; i < lines; i++) {
+        char *start = out;
+        if (i == 0) out = putInt(out, id);
+        out = putSpaces(out, 8 - (int)(out - start));
+        *out++ = ' ';
+
+        size_t nameAt = i * layout->nameWrap;
+        size_t progAt = i * layout->progWrap;
+        out = putCell(out, name + (nameAt < nameLength ? nameAt : nameLength),
+                      nameAt < nameLength ? nameLength - nameAt : 0, layout->nameWrap, layout->nameWidth);
+        out = putCell(out, programme + (progAt < progLength ? progAt : progLength),
+                      progAt < progLength ? progLength - progAt : 0, layout->progWrap, layout->progWidth);
+
+        if (i == 0) out = putMark(out, mark);
+        *out++ = '\n';
+    }
+    used = (size_t)(out - buffer);
+}
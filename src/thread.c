@@ -0,0 +1,93 @@
+/**
+ * Threads
+ * --------------------------------------
+ * Minimal portability layer for fork/join parallelism: start a worker,
+ * wait for it, ask how many processors there are, and the mutex and
+ * condition variable a pool of long-lived workers needs. Built on Win32
+ * threads (slim reader/writer locks) on Windows and POSIX threads
+ * elsewhere.
+ *
+ * Authors: Team P4-1
+ */
+
+#include "headers/thread.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+
+#ifdef _WIN32
+static DWORD WINAPI threadEntry(LPVOID arg) {
+    Thread *thread = arg;
+    thread->fn(thread->arg);
+    return 0;
+}
+#else
+static void *threadEntry(void *arg) {
+    Thread *thread = arg;
+    thread->fn(thread->arg);
+    return NULL;
+}
+#endif
+
+
+int threadStart(Thread *thread, ThreadFn fn, void *arg) {
+    thread->fn = fn;
+    thread->arg = arg;
+#ifdef _WIN32
+    thread->handle = CreateThread(NULL, 0, threadEntry, thread, 0, NULL);
+    return thread->handle != NULL;
+#else
+    return pthread_create(&thread->handle, NULL, threadEntry, thread) == 0;
+#endif
+}
+
+
+void threadJoin(Thread *thread) {
+#ifdef _WIN32
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+#else
+    pthread_join(thread->handle, NULL);
+#endif
+}
+
+
+int threadCpuCount(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+
+#ifdef _WIN32
+void mutexInit(ThreadMutex *mutex) { InitializeSRWLock((PSRWLOCK)&mutex->lock); }
+void mutexLock(ThreadMutex *mutex) { AcquireSRWLockExclusive((PSRWLOCK)&mutex->lock); }
+void mutexUnlock(ThreadMutex *mutex) { ReleaseSRWLockExclusive((PSRWLOCK)&mutex->lock); }
+void mutexDestroy(ThreadMutex *mutex) { (void)mutex; }
+
+void condInit(ThreadCond *cond) { InitializeConditionVariable((PCONDITION_VARIABLE)&cond->cond); }
+void condWait(ThreadCond *cond, ThreadMutex *mutex) {
+    SleepConditionVariableSRW((PCONDITION_VARIABLE)&cond->cond, (PSRWLOCK)&mutex->lock, INFINITE, 0);
+}
+void condBroadcast(ThreadCond *cond) { WakeAllConditionVariable((PCONDITION_VARIABLE)&cond->cond); }
+void condDestroy(ThreadCond *cond) { (void)cond; }
+#else
+void mutexInit(ThreadMutex *mutex) { pthread_mutex_init(mutex, NULL); }
+void mutexLock(ThreadMutex *mutex) { pthread_mutex_lock(mutex); }
+void mutexUnlock(ThreadMutex *mutex) { pthread_mutex_unlock(mutex); }
+void mutexDestroy(ThreadMutex *mutex) { pthread_mutex_destroy(mutex); }
+
+void condInit(ThreadCond *cond) { pthread_cond_init(cond, NULL); }
+void condWait(ThreadCond *cond, ThreadMutex *mutex) { pthread_cond_wait(cond, mutex); }
+void condBroadcast(ThreadCond *cond) { pthread_cond_broadcast(cond); }
+void condDestroy(ThreadCond *cond) { pthread_cond_destroy(cond); }
+#endif
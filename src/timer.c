@@ -0,0 +1,37 @@
+/**
+ * Timer
+ * --------------------------------------
+ * Portable monotonic clock used to report operation throughput.
+ *
+ * Authors: Team P4-1
+ */
+
+#include "headers/timer.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+
+/**
+ * timerNow()
+ * -----------------------------------------
+ * Reads a high-resolution monotonic clock.
+ *
+ * @return current time in seconds from an arbitrary fixed origin
+ */
+double timerNow(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    if (!frequency.QuadPart) QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+#endif
+}